@@ -0,0 +1,35 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/spd_tool.c" "CMakeFiles/spd-tool.dir/spd_tool.c.o" "gcc" "CMakeFiles/spd-tool.dir/spd_tool.c.o.d"
+  "/root/repo/tool/archive.c" "CMakeFiles/spd-tool.dir/tool/archive.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/archive.c.o.d"
+  "/root/repo/tool/console.c" "CMakeFiles/spd-tool.dir/tool/console.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/console.c.o.d"
+  "/root/repo/tool/corpus.c" "CMakeFiles/spd-tool.dir/tool/corpus.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/corpus.c.o.d"
+  "/root/repo/tool/diff.c" "CMakeFiles/spd-tool.dir/tool/diff.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/diff.c.o.d"
+  "/root/repo/tool/fingerprint.c" "CMakeFiles/spd-tool.dir/tool/fingerprint.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/fingerprint.c.o.d"
+  "/root/repo/tool/parallel.c" "CMakeFiles/spd-tool.dir/tool/parallel.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/parallel.c.o.d"
+  "/root/repo/tool/patch.c" "CMakeFiles/spd-tool.dir/tool/patch.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/patch.c.o.d"
+  "/root/repo/tool/query.c" "CMakeFiles/spd-tool.dir/tool/query.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/query.c.o.d"
+  "/root/repo/tool/serialize.c" "CMakeFiles/spd-tool.dir/tool/serialize.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/serialize.c.o.d"
+  "/root/repo/tool/source.c" "CMakeFiles/spd-tool.dir/tool/source.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/source.c.o.d"
+  "/root/repo/tool/stats.c" "CMakeFiles/spd-tool.dir/tool/stats.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/stats.c.o.d"
+  "/root/repo/tool/undo.c" "CMakeFiles/spd-tool.dir/tool/undo.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/undo.c.o.d"
+  "/root/repo/tool/validate.c" "CMakeFiles/spd-tool.dir/tool/validate.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/validate.c.o.d"
+  "/root/repo/tool/watch.c" "CMakeFiles/spd-tool.dir/tool/watch.c.o" "gcc" "CMakeFiles/spd-tool.dir/tool/watch.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_wx/spd/CMakeFiles/spd.dir/DependInfo.cmake"
+  "/root/repo/_wx/io/CMakeFiles/io.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
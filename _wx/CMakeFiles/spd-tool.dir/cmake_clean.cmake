@@ -0,0 +1,39 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/spd-tool.dir/spd_tool.c.o"
+  "CMakeFiles/spd-tool.dir/spd_tool.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/archive.c.o"
+  "CMakeFiles/spd-tool.dir/tool/archive.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/console.c.o"
+  "CMakeFiles/spd-tool.dir/tool/console.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/corpus.c.o"
+  "CMakeFiles/spd-tool.dir/tool/corpus.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/diff.c.o"
+  "CMakeFiles/spd-tool.dir/tool/diff.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/fingerprint.c.o"
+  "CMakeFiles/spd-tool.dir/tool/fingerprint.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/parallel.c.o"
+  "CMakeFiles/spd-tool.dir/tool/parallel.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/patch.c.o"
+  "CMakeFiles/spd-tool.dir/tool/patch.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/query.c.o"
+  "CMakeFiles/spd-tool.dir/tool/query.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/serialize.c.o"
+  "CMakeFiles/spd-tool.dir/tool/serialize.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/source.c.o"
+  "CMakeFiles/spd-tool.dir/tool/source.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/stats.c.o"
+  "CMakeFiles/spd-tool.dir/tool/stats.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/undo.c.o"
+  "CMakeFiles/spd-tool.dir/tool/undo.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/validate.c.o"
+  "CMakeFiles/spd-tool.dir/tool/validate.c.o.d"
+  "CMakeFiles/spd-tool.dir/tool/watch.c.o"
+  "CMakeFiles/spd-tool.dir/tool/watch.c.o.d"
+  "spd-tool"
+  "spd-tool.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/spd-tool.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/spdd.dir/spdd.c.o"
+  "CMakeFiles/spdd.dir/spdd.c.o.d"
+  "spdd"
+  "spdd.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/spdd.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,27 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/io/backup.c" "io/CMakeFiles/io.dir/backup.c.o" "gcc" "io/CMakeFiles/io.dir/backup.c.o.d"
+  "/root/repo/io/bulk.c" "io/CMakeFiles/io.dir/bulk.c.o" "gcc" "io/CMakeFiles/io.dir/bulk.c.o.d"
+  "/root/repo/io/ee1004.c" "io/CMakeFiles/io.dir/ee1004.c.o" "gcc" "io/CMakeFiles/io.dir/ee1004.c.o.d"
+  "/root/repo/io/io.c" "io/CMakeFiles/io.dir/io.c.o" "gcc" "io/CMakeFiles/io.dir/io.c.o.d"
+  "/root/repo/io/journal.c" "io/CMakeFiles/io.dir/journal.c.o" "gcc" "io/CMakeFiles/io.dir/journal.c.o.d"
+  "/root/repo/io/remote.c" "io/CMakeFiles/io.dir/remote.c.o" "gcc" "io/CMakeFiles/io.dir/remote.c.o.d"
+  "/root/repo/io/server.c" "io/CMakeFiles/io.dir/server.c.o" "gcc" "io/CMakeFiles/io.dir/server.c.o.d"
+  "/root/repo/io/watch.c" "io/CMakeFiles/io.dir/watch.c.o" "gcc" "io/CMakeFiles/io.dir/watch.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_wx/spd/CMakeFiles/spd.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
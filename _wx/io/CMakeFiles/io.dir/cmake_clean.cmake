@@ -0,0 +1,25 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/io.dir/backup.c.o"
+  "CMakeFiles/io.dir/backup.c.o.d"
+  "CMakeFiles/io.dir/bulk.c.o"
+  "CMakeFiles/io.dir/bulk.c.o.d"
+  "CMakeFiles/io.dir/ee1004.c.o"
+  "CMakeFiles/io.dir/ee1004.c.o.d"
+  "CMakeFiles/io.dir/io.c.o"
+  "CMakeFiles/io.dir/io.c.o.d"
+  "CMakeFiles/io.dir/journal.c.o"
+  "CMakeFiles/io.dir/journal.c.o.d"
+  "CMakeFiles/io.dir/remote.c.o"
+  "CMakeFiles/io.dir/remote.c.o.d"
+  "CMakeFiles/io.dir/server.c.o"
+  "CMakeFiles/io.dir/server.c.o.d"
+  "CMakeFiles/io.dir/watch.c.o"
+  "CMakeFiles/io.dir/watch.c.o.d"
+  "libio.a"
+  "libio.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/io.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
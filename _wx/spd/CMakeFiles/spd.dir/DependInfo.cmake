@@ -0,0 +1,35 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/spd/archive.c" "spd/CMakeFiles/spd.dir/archive.c.o" "gcc" "spd/CMakeFiles/spd.dir/archive.c.o.d"
+  "/root/repo/spd/cache.c" "spd/CMakeFiles/spd.dir/cache.c.o" "gcc" "spd/CMakeFiles/spd.dir/cache.c.o.d"
+  "/root/repo/spd/decoder.c" "spd/CMakeFiles/spd.dir/decoder.c.o" "gcc" "spd/CMakeFiles/spd.dir/decoder.c.o.d"
+  "/root/repo/spd/diff.c" "spd/CMakeFiles/spd.dir/diff.c.o" "gcc" "spd/CMakeFiles/spd.dir/diff.c.o.d"
+  "/root/repo/spd/fingerprint.c" "spd/CMakeFiles/spd.dir/fingerprint.c.o" "gcc" "spd/CMakeFiles/spd.dir/fingerprint.c.o.d"
+  "/root/repo/spd/hash.c" "spd/CMakeFiles/spd.dir/hash.c.o" "gcc" "spd/CMakeFiles/spd.dir/hash.c.o.d"
+  "/root/repo/spd/index.c" "spd/CMakeFiles/spd.dir/index.c.o" "gcc" "spd/CMakeFiles/spd.dir/index.c.o.d"
+  "/root/repo/spd/intern.c" "spd/CMakeFiles/spd.dir/intern.c.o" "gcc" "spd/CMakeFiles/spd.dir/intern.c.o.d"
+  "/root/repo/spd/packed.c" "spd/CMakeFiles/spd.dir/packed.c.o" "gcc" "spd/CMakeFiles/spd.dir/packed.c.o.d"
+  "/root/repo/spd/patch.c" "spd/CMakeFiles/spd.dir/patch.c.o" "gcc" "spd/CMakeFiles/spd.dir/patch.c.o.d"
+  "/root/repo/spd/query.c" "spd/CMakeFiles/spd.dir/query.c.o" "gcc" "spd/CMakeFiles/spd.dir/query.c.o.d"
+  "/root/repo/spd/serialize.c" "spd/CMakeFiles/spd.dir/serialize.c.o" "gcc" "spd/CMakeFiles/spd.dir/serialize.c.o.d"
+  "/root/repo/spd/spd.c" "spd/CMakeFiles/spd.dir/spd.c.o" "gcc" "spd/CMakeFiles/spd.dir/spd.c.o.d"
+  "/root/repo/spd/stats.c" "spd/CMakeFiles/spd.dir/stats.c.o" "gcc" "spd/CMakeFiles/spd.dir/stats.c.o.d"
+  "/root/repo/spd/txn.c" "spd/CMakeFiles/spd.dir/txn.c.o" "gcc" "spd/CMakeFiles/spd.dir/txn.c.o.d"
+  "/root/repo/spd/validate.c" "spd/CMakeFiles/spd.dir/validate.c.o" "gcc" "spd/CMakeFiles/spd.dir/validate.c.o.d"
+  "/root/repo/spd/view.c" "spd/CMakeFiles/spd.dir/view.c.o" "gcc" "spd/CMakeFiles/spd.dir/view.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
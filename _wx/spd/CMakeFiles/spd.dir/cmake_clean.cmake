@@ -0,0 +1,43 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/spd.dir/archive.c.o"
+  "CMakeFiles/spd.dir/archive.c.o.d"
+  "CMakeFiles/spd.dir/cache.c.o"
+  "CMakeFiles/spd.dir/cache.c.o.d"
+  "CMakeFiles/spd.dir/decoder.c.o"
+  "CMakeFiles/spd.dir/decoder.c.o.d"
+  "CMakeFiles/spd.dir/diff.c.o"
+  "CMakeFiles/spd.dir/diff.c.o.d"
+  "CMakeFiles/spd.dir/fingerprint.c.o"
+  "CMakeFiles/spd.dir/fingerprint.c.o.d"
+  "CMakeFiles/spd.dir/hash.c.o"
+  "CMakeFiles/spd.dir/hash.c.o.d"
+  "CMakeFiles/spd.dir/index.c.o"
+  "CMakeFiles/spd.dir/index.c.o.d"
+  "CMakeFiles/spd.dir/intern.c.o"
+  "CMakeFiles/spd.dir/intern.c.o.d"
+  "CMakeFiles/spd.dir/packed.c.o"
+  "CMakeFiles/spd.dir/packed.c.o.d"
+  "CMakeFiles/spd.dir/patch.c.o"
+  "CMakeFiles/spd.dir/patch.c.o.d"
+  "CMakeFiles/spd.dir/query.c.o"
+  "CMakeFiles/spd.dir/query.c.o.d"
+  "CMakeFiles/spd.dir/serialize.c.o"
+  "CMakeFiles/spd.dir/serialize.c.o.d"
+  "CMakeFiles/spd.dir/spd.c.o"
+  "CMakeFiles/spd.dir/spd.c.o.d"
+  "CMakeFiles/spd.dir/stats.c.o"
+  "CMakeFiles/spd.dir/stats.c.o.d"
+  "CMakeFiles/spd.dir/txn.c.o"
+  "CMakeFiles/spd.dir/txn.c.o.d"
+  "CMakeFiles/spd.dir/validate.c.o"
+  "CMakeFiles/spd.dir/validate.c.o.d"
+  "CMakeFiles/spd.dir/view.c.o"
+  "CMakeFiles/spd.dir/view.c.o.d"
+  "libspd.a"
+  "libspd.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/spd.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
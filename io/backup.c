@@ -0,0 +1,143 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <io/backup.h>
+
+#include <spd/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include <sys/stat.h>
+#if _WIN32
+#include <direct.h>
+#endif
+
+static bool make_dir(const char *path)
+{
+#if _WIN32
+    int rc = _mkdir(path);
+#else
+    int rc = mkdir(path, 0777);
+#endif
+    return rc == 0 || errno == EEXIST;
+}
+
+static bool is_file_exists(const char *path)
+{
+#if _WIN32
+    struct _stat64 st;
+    return 0 == _stat64(path, &st);
+#else
+    struct stat st;
+    return 0 == stat(path, &st);
+#endif
+}
+
+static char *join(const char *dir, const char *name, const char *ext)
+{
+    size_t size = strlen(dir) + strlen(name) + strlen(ext) + 2;
+    char *path = malloc(size);
+    if (path)
+        snprintf(path, size, "%s/%s%s", dir, name, ext);
+    return path;
+}
+
+bool io_backup_open(IoBackupStore *s, const char *dir)
+{
+    memset(s, 0, sizeof(s[0]));
+    s->dir = join(dir, "objects", "");
+    char *manifest = join(dir, "manifest.txt", "");
+    bool ok = s->dir && manifest && make_dir(dir) && make_dir(s->dir) && (s->manifest = fopen(manifest, "ab"));
+    int error = s->dir && manifest ? errno : ENOMEM;
+    free(manifest);
+    if (!ok) {
+        io_backup_close(s);
+        errno = error;
+    }
+    return ok;
+}
+
+void io_backup_close(IoBackupStore *s)
+{
+    if (s->manifest)
+        fclose(s->manifest);
+    free(s->dir);
+    memset(s, 0, sizeof(s[0]));
+}
+
+// Objects are immutable: write a temporary file and rename it in place
+static bool put_object(const char *path, const char *tmp, const uint8_t *data, size_t size)
+{
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f && size == fwrite(data, 1, size, f);
+    if (f)
+        ok = (fclose(f) == 0) && ok;
+    if (ok)
+        ok = rename(tmp, path) == 0 || is_file_exists(path);
+    if (!ok) {
+        int error = errno;
+        remove(tmp);
+        errno = error;
+    }
+    return ok;
+}
+
+bool io_backup_put(IoBackupStore *s, uint32_t device_id, const uint8_t *data, size_t size, char key[IO_BACKUP_KEY_SIZE])
+{
+    spd_hash_hex(spd_hash(data, size), key);
+    char *path = join(s->dir, key, ".bin");
+    char *tmp = join(s->dir, key, ".tmp");
+    bool ok = path && tmp && (is_file_exists(path) || put_object(path, tmp, data, size));
+    int error = path && tmp ? errno : ENOMEM;
+    free(path);
+    free(tmp);
+    if (!ok) {
+        errno = error;
+        return false;
+    }
+
+    fprintf(s->manifest, "%lld %u %s %zu\n", (long long)time(NULL), device_id, key, size);
+    return fflush(s->manifest) == 0;
+}
+
+bool io_backup_get(const IoBackupStore *s, const char *key, uint8_t *data, size_t size)
+{
+    char *path = join(s->dir, key, ".bin");
+    if (!path) {
+        errno = ENOMEM;
+        return false;
+    }
+    FILE *f = fopen(path, "rb");
+    bool ok = f && size == fread(data, 1, size, f);
+    int error = f ? ENODATA : errno;
+    if (f)
+        fclose(f);
+    free(path);
+    if (!ok)
+        errno = error;
+    return ok;
+}
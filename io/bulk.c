@@ -0,0 +1,331 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <io/bulk.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if _WIN32
+#include <io/io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define IO_BULK_URING 1
+#endif
+#endif
+
+#if IO_BULK_URING
+
+// Raw io_uring rings, liburing isn't required
+struct IoUring
+{
+    int fd;
+    void *sq_map;
+    size_t sq_size;
+    void *cq_map;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned tail;
+    int fds[IO_BULK_DEPTH];
+};
+
+#define CLOSE_TAG (1ull << 63)
+
+static void ring_free(IoUring *u)
+{
+    if (u->sqes)
+        munmap(u->sqes, u->sqes_size);
+    if (u->cq_map && u->cq_map != u->sq_map)
+        munmap(u->cq_map, u->cq_size);
+    if (u->sq_map)
+        munmap(u->sq_map, u->sq_size);
+    if (u->fd >= 0)
+        close(u->fd);
+    free(u);
+}
+
+// Open, read and close arrived in Linux 5.6, older rings fail the probe
+static bool ring_supported(int fd)
+{
+    size_t size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    bool ok = probe && syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0
+        && probe->last_op >= IORING_OP_READ
+        && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED)
+        && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+        && (probe->ops[IORING_OP_CLOSE].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return ok;
+}
+
+static IoUring *ring_open(void)
+{
+    IoUring *u = calloc(1, sizeof(IoUring));
+    if (!u)
+        return NULL;
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    u->fd = (int)syscall(__NR_io_uring_setup, 2 * IO_BULK_DEPTH, &p);
+    if (u->fd < 0 || !ring_supported(u->fd) || p.sq_entries < 2 * IO_BULK_DEPTH) {
+        ring_free(u);
+        return NULL;
+    }
+    u->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_size > u->sq_size)
+            u->sq_size = u->cq_size;
+        u->cq_size = u->sq_size;
+    }
+    u->sq_map = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_map == MAP_FAILED) {
+        u->sq_map = NULL;
+        ring_free(u);
+        return NULL;
+    }
+    u->cq_map = u->sq_map;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        u->cq_map = mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_map == MAP_FAILED) {
+            u->cq_map = NULL;
+            ring_free(u);
+            return NULL;
+        }
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        u->sqes = NULL;
+        ring_free(u);
+        return NULL;
+    }
+    uint8_t *sq = u->sq_map, *cq = u->cq_map;
+    u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + p.sq_off.array);
+    u->cq_head = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    u->tail = *u->sq_tail;
+    return u;
+}
+
+static struct io_uring_sqe *ring_sqe(IoUring *u, uint8_t opcode, int fd, uint64_t user_data)
+{
+    unsigned index = u->tail++ & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+    memset(sqe, 0, sizeof(sqe[0]));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = user_data;
+    u->sq_array[index] = index;
+    return sqe;
+}
+
+typedef struct RingBatch
+{
+    char *const *paths;
+    uint8_t *arena;
+    size_t slot_size;
+    uint8_t *failed;
+    size_t read;
+} RingBatch;
+
+static void ring_complete(IoUring *u, const struct io_uring_cqe *cqe, RingBatch *b, bool opening)
+{
+    size_t n = (size_t)(cqe->user_data & ~CLOSE_TAG);
+    if (cqe->user_data & CLOSE_TAG) {
+        u->fds[n] = -1;
+        return;
+    }
+    if (opening) {
+        u->fds[n] = cqe->res;
+        if (cqe->res < 0)
+            b->failed[n] = (uint8_t)-cqe->res;
+    } else if (cqe->res < 0) {
+        b->failed[n] = (uint8_t)-cqe->res;
+    } else if ((size_t)cqe->res != b->slot_size) {
+        b->failed[n] = ENODATA;
+    } else {
+        b->failed[n] = 0;
+        b->read++;
+    }
+}
+
+// Submits the queued entries and reaps count completions. Once anything
+// is submitted its completions are waited for, the kernel writes into the
+// arena until then. A submit error drops the entries the kernel hasn't
+// taken and returns false after the submitted ones complete.
+static bool ring_run(IoUring *u, unsigned count, RingBatch *b, bool opening)
+{
+    __atomic_store_n(u->sq_tail, u->tail, __ATOMIC_RELEASE);
+    unsigned submitted = 0, done = 0;
+    bool failed = false;
+    while (done < (failed ? submitted : count)) {
+        unsigned submit = failed ? 0 : count - submitted;
+        long n = syscall(__NR_io_uring_enter, u->fd, submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            failed = true;
+        if (n > 0)
+            submitted += (unsigned)n < submit ? (unsigned)n : submit;
+        unsigned head = *u->cq_head, tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++, done++)
+            ring_complete(u, &u->cqes[head & *u->cq_mask], b, opening);
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+    if (failed) {
+        u->tail -= count - submitted;
+        __atomic_store_n(u->sq_tail, u->tail, __ATOMIC_RELEASE);
+    }
+    return !failed;
+}
+
+// Descriptors the ring opened and hasn't closed
+static void ring_close_fds(IoUring *u, size_t count)
+{
+    for (size_t n = 0; n < count; n++) {
+        if (u->fds[n] >= 0)
+            close(u->fds[n]);
+    }
+}
+
+// One io_uring_enter for the opens, one for the reads and closes. On
+// failure the batch is read again without the ring.
+static bool ring_read(IoUring *u, char *const paths[], size_t count, uint8_t *arena, size_t slot_size, uint8_t *failed, size_t *read)
+{
+    RingBatch b = { paths, arena, slot_size, failed, 0 };
+    for (size_t n = 0; n < count; n++) {
+        struct io_uring_sqe *sqe = ring_sqe(u, IORING_OP_OPENAT, AT_FDCWD, n);
+        sqe->addr = (uint64_t)(uintptr_t)paths[n];
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        u->fds[n] = -1;
+    }
+    if (!ring_run(u, (unsigned)count, &b, true)) {
+        ring_close_fds(u, count);
+        return false;
+    }
+    unsigned queued = 0;
+    for (size_t n = 0; n < count; n++) {
+        if (u->fds[n] < 0)
+            continue;
+        // A hard link closes the file whatever the read returns
+        struct io_uring_sqe *sqe = ring_sqe(u, IORING_OP_READ, u->fds[n], n);
+        sqe->addr = (uint64_t)(uintptr_t)(arena + n * slot_size);
+        sqe->len = (unsigned)slot_size;
+        sqe->flags = IOSQE_IO_HARDLINK;
+        ring_sqe(u, IORING_OP_CLOSE, u->fds[n], n | CLOSE_TAG);
+        queued += 2;
+    }
+    if (queued && !ring_run(u, queued, &b, false)) {
+        ring_close_fds(u, count);
+        return false;
+    }
+    *read = b.read;
+    return true;
+}
+
+#endif
+
+void io_bulk_open(IoBulkReader *r, bool use_uring)
+{
+    r->ring = NULL;
+#if IO_BULK_URING
+    if (use_uring)
+        r->ring = ring_open();
+#else
+    (void)use_uring;
+#endif
+}
+
+void io_bulk_close(IoBulkReader *r)
+{
+#if IO_BULK_URING
+    if (r->ring)
+        ring_free(r->ring);
+#endif
+    r->ring = NULL;
+}
+
+// 0 or the errno of the failure
+static int read_file(const char *path, uint8_t *data, size_t size)
+{
+#if _WIN32
+    return io_file_read(path, data, size) ? 0 : errno;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+    size_t done = 0;
+    int error = ENODATA;
+    while (done < size) {
+        ssize_t n = pread(fd, data + done, size - done, (off_t)done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            error = errno;
+        if (n <= 0)
+            break;
+        done += (size_t)n;
+    }
+    close(fd);
+    return done == size ? 0 : error;
+#endif
+}
+
+size_t io_bulk_read(IoBulkReader *r, char *const paths[], size_t count, uint8_t *arena, size_t slot_size, uint8_t *failed)
+{
+    size_t read = 0;
+    for (size_t first = 0; first < count; first += IO_BULK_DEPTH) {
+        size_t n = count - first < IO_BULK_DEPTH ? count - first : IO_BULK_DEPTH, batch_read;
+#if IO_BULK_URING
+        if (r->ring && ring_read(r->ring, paths + first, n, arena + first * slot_size, slot_size, failed + first, &batch_read)) {
+            read += batch_read;
+            continue;
+        }
+#endif
+        for (size_t k = first; k < first + n; k++) {
+            failed[k] = (uint8_t)read_file(paths[k], arena + k * slot_size, slot_size);
+            read += !failed[k];
+        }
+        (void)batch_read;
+    }
+    return read;
+}
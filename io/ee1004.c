@@ -0,0 +1,197 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <io/ee1004.h>
+#include <spd/spd.h>
+
+#include <string.h>
+
+void io_ee1004_init(IoEe1004 *e, const IoI2cBus *bus, uint8_t address)
+{
+    memset(e, 0, sizeof(e[0]));
+    e->bus = bus;
+    e->address = address;
+    e->page = -1;
+    e->paged = true;
+}
+
+// The first SPA0 doubles as the probe for EEPROMs without pages
+static bool select_page(IoEe1004 *e, int page)
+{
+    if (e->page == page)
+        return true;
+    if (!e->paged)
+        return page == 0;
+    if (!e->bus->command(e->bus->ctx, page ? IO_EE1004_SPA1 : IO_EE1004_SPA0)) {
+        if (page || e->page >= 0)
+            return false;
+        e->paged = false;
+        e->page = 0;
+        return true;
+    }
+    e->page = page;
+    e->page_switches++;
+    return true;
+}
+
+// Pages in transfer order, the selected one first, so a pass over both
+// pages switches once at most
+static int page_order(const IoEe1004 *e, int pass)
+{
+    return pass ^ (e->page == 1);
+}
+
+bool io_ee1004_read(IoEe1004 *e, uint8_t data[IO_EE1004_SIZE], unsigned blocks)
+{
+    for (int pass = 0; pass < 2; pass++) {
+        int page = page_order(e, pass);
+        unsigned mask = blocks >> (page * 2) & 3;
+        if (!mask)
+            continue;
+        if (!select_page(e, page))
+            return false;
+        // Adjacent blocks of a page are one transfer
+        size_t offset = mask == 2 ? IO_EE1004_BLOCK_SIZE : 0;
+        size_t size = mask == 3 ? IO_EE1004_PAGE_SIZE : IO_EE1004_BLOCK_SIZE;
+        if (!e->bus->read(e->bus->ctx, e->address, (uint8_t)offset, data + page * IO_EE1004_PAGE_SIZE + offset, size))
+            return false;
+    }
+    return true;
+}
+
+// Only the selected 16-byte writes go to the bus, one page switch per pass
+bool io_ee1004_write_chunks(IoEe1004 *e, const uint8_t data[IO_EE1004_SIZE], uint32_t chunks)
+{
+    const int per_page = IO_EE1004_PAGE_SIZE / IO_EE1004_WRITE_SIZE;
+    for (int pass = 0; pass < 2; pass++) {
+        int page = page_order(e, pass);
+        uint32_t mask = chunks >> (page * per_page) & ((1u << per_page) - 1);
+        if (!mask)
+            continue;
+        if (!select_page(e, page))
+            return false;
+        for (int chunk = 0; chunk < per_page; chunk++) {
+            if (!(mask >> chunk & 1))
+                continue;
+            size_t offset = (size_t)chunk * IO_EE1004_WRITE_SIZE;
+            if (!e->bus->write(e->bus->ctx, e->address, (uint8_t)offset, data + page * IO_EE1004_PAGE_SIZE + offset, IO_EE1004_WRITE_SIZE))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool io_ee1004_write(IoEe1004 *e, const uint8_t data[IO_EE1004_SIZE], unsigned blocks)
+{
+    const int per_block = IO_EE1004_BLOCK_SIZE / IO_EE1004_WRITE_SIZE;
+    uint32_t chunks = 0;
+    for (int block = 0; block < IO_EE1004_BLOCKS; block++) {
+        if (blocks >> block & 1)
+            chunks |= ((1u << per_block) - 1) << (block * per_block);
+    }
+    return io_ee1004_write_chunks(e, data, chunks);
+}
+
+// Chunks holding any byte of [offset, offset + size)
+uint32_t io_ee1004_range_chunks(size_t offset, size_t size)
+{
+    uint32_t chunks = 0;
+    if (!size || offset >= IO_EE1004_SIZE)
+        return 0;
+    size_t last = offset + size - 1 < IO_EE1004_SIZE ? offset + size - 1 : IO_EE1004_SIZE - 1;
+    for (size_t n = offset / IO_EE1004_WRITE_SIZE; n <= last / IO_EE1004_WRITE_SIZE; n++)
+        chunks |= 1u << n;
+    return chunks;
+}
+
+// Blocks that differ between the two images
+unsigned io_ee1004_dirty(const uint8_t *before, const uint8_t *after, size_t size)
+{
+    unsigned blocks = 0;
+    for (size_t n = 0; n < size && n < IO_EE1004_SIZE; n += IO_EE1004_BLOCK_SIZE) {
+        size_t len = size - n < IO_EE1004_BLOCK_SIZE ? size - n : IO_EE1004_BLOCK_SIZE;
+        if (memcmp(before + n, after + n, len))
+            blocks |= 1u << (n / IO_EE1004_BLOCK_SIZE);
+    }
+    return blocks;
+}
+
+// Whole SPD image of a DDR3 or DDR4 module, returns its size, 0 on error.
+// Page 0 goes first unless page 1 is already selected.
+size_t io_spd_read(IoEe1004 *e, uint8_t data[IO_EE1004_SIZE])
+{
+    unsigned blocks = e->page == 1 ? IO_EE1004_ALL : IO_EE1004_PAGE0;
+    if (!io_ee1004_read(e, data, blocks))
+        return 0;
+    if (!(blocks & IO_EE1004_PAGE1))
+        memset(data + IO_EE1004_PAGE_SIZE, 0, IO_EE1004_PAGE_SIZE);
+    if (!e->paged || data[2] != SPD_DEVICE_TYPE_DDR4)
+        return SPD_DDR3_SIZE;
+    if (!(blocks & IO_EE1004_PAGE1) && !io_ee1004_read(e, data, IO_EE1004_PAGE1))
+        return 0;
+    return spd_image_size(data, IO_EE1004_SIZE);
+}
+
+static bool sim_read(void *ctx, uint8_t address, uint8_t offset, uint8_t *data, size_t size)
+{
+    IoEe1004Sim *s = (IoEe1004Sim *)ctx;
+    if (address != s->address || offset + size > IO_EE1004_PAGE_SIZE)
+        return false;
+    memcpy(data, s->memory + s->page * IO_EE1004_PAGE_SIZE + offset, size);
+    s->reads++;
+    return true;
+}
+
+// Page writes wrap inside 16 bytes on a real part, the simulator rejects them
+static bool sim_write(void *ctx, uint8_t address, uint8_t offset, const uint8_t *data, size_t size)
+{
+    IoEe1004Sim *s = (IoEe1004Sim *)ctx;
+    if (address != s->address || offset % IO_EE1004_WRITE_SIZE + size > IO_EE1004_WRITE_SIZE)
+        return false;
+    memcpy(s->memory + s->page * IO_EE1004_PAGE_SIZE + offset, data, size);
+    s->writes++;
+    s->bytes_written += size;
+    return true;
+}
+
+static bool sim_command(void *ctx, uint8_t address)
+{
+    IoEe1004Sim *s = (IoEe1004Sim *)ctx;
+    s->commands++;
+    if (!s->paged || (address != IO_EE1004_SPA0 && address != IO_EE1004_SPA1))
+        return false;
+    s->page = address == IO_EE1004_SPA1;
+    return true;
+}
+
+void io_ee1004_sim_init(IoEe1004Sim *s, IoI2cBus *bus, const uint8_t *image, size_t size)
+{
+    memset(s, 0, sizeof(s[0]));
+    memcpy(s->memory, image, size < IO_EE1004_SIZE ? size : IO_EE1004_SIZE);
+    s->address = IO_SPD_ADDRESS;
+    s->paged = size > IO_EE1004_PAGE_SIZE;
+    bus->ctx = s;
+    bus->read = sim_read;
+    bus->write = sim_write;
+    bus->command = sim_command;
+}
@@ -0,0 +1,54 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Content-addressed store of original SPD images.
+// DIR/objects/<hash>.bin - every distinct image, stored once
+// DIR/manifest.txt       - append-only "<time> <device> <hash> <size>" lines
+typedef struct IoBackupStore
+{
+    char *dir;
+    FILE *manifest;
+} IoBackupStore;
+
+#define IO_BACKUP_KEY_SIZE 33
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool io_backup_open(IoBackupStore *s, const char *dir);
+void io_backup_close(IoBackupStore *s);
+
+bool io_backup_put(IoBackupStore *s, uint32_t device_id, const uint8_t *data, size_t size, char key[IO_BACKUP_KEY_SIZE]);
+bool io_backup_get(const IoBackupStore *s, const char *key, uint8_t *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
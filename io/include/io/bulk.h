@@ -0,0 +1,58 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bulk reader of many small files into fixed-size slots of a caller's
+// arena. On Linux a batch of opens, then a batch of reads each hard-linked
+// to its close, goes through io_uring with one system call per batch;
+// without io_uring every file costs an open, a pread and a close on the
+// calling thread, callers sharding sources over threads keep it parallel.
+#define IO_BULK_DEPTH 256
+
+typedef struct IoUring IoUring;
+
+typedef struct IoBulkReader
+{
+    IoUring *ring;      // NULL without io_uring
+} IoBulkReader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Never fails, io_uring is used when asked for and available
+void io_bulk_open(IoBulkReader *r, bool use_uring);
+void io_bulk_close(IoBulkReader *r);
+// Reads the first slot_size bytes of paths[n] into arena + n * slot_size,
+// failed[n] is 0 or the errno of the failure, ENODATA for files that are
+// too small. Returns the number of files read.
+size_t io_bulk_read(IoBulkReader *r, char *const paths[], size_t count, uint8_t *arena, size_t slot_size, uint8_t *failed);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,90 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <io/io.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// EE1004 SPD EEPROM of DDR4 modules: 512 bytes as two 256-byte pages, the
+// page is selected by an address-only write to SPA0 (0x36) or SPA1 (0x37)
+// and stays selected for every EEPROM on the bus. Transfers are planned in
+// 128-byte blocks, block N is bit N of a block mask. Writes are 16-byte
+// chunks, chunk N is bit N of a chunk mask.
+#define IO_SPD_ADDRESS 0x50
+#define IO_EE1004_SPA0 0x36
+#define IO_EE1004_SPA1 0x37
+
+#define IO_EE1004_SIZE 512
+#define IO_EE1004_PAGE_SIZE 256
+#define IO_EE1004_BLOCK_SIZE 128
+#define IO_EE1004_BLOCKS 4
+#define IO_EE1004_WRITE_SIZE 16
+
+#define IO_EE1004_PAGE0 0x3u
+#define IO_EE1004_PAGE1 0xcu
+#define IO_EE1004_ALL 0xfu
+
+typedef struct IoEe1004
+{
+    const IoI2cBus *bus;
+    uint8_t address;
+    int page;                   // selected page, -1 unknown
+    bool paged;                 // cleared when SPA0 is NACKed, 256-byte DDR3 EEPROM
+    unsigned page_switches;
+} IoEe1004;
+
+// Simulated EE1004, or a 256-byte EEPROM without page select if paged is false
+typedef struct IoEe1004Sim
+{
+    uint8_t memory[IO_EE1004_SIZE];
+    uint8_t address;
+    bool paged;
+    int page;
+    unsigned reads;
+    unsigned writes;
+    unsigned commands;
+    size_t bytes_written;
+} IoEe1004Sim;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void io_ee1004_init(IoEe1004 *e, const IoI2cBus *bus, uint8_t address);
+bool io_ee1004_read(IoEe1004 *e, uint8_t data[IO_EE1004_SIZE], unsigned blocks);
+bool io_ee1004_write(IoEe1004 *e, const uint8_t data[IO_EE1004_SIZE], unsigned blocks);
+bool io_ee1004_write_chunks(IoEe1004 *e, const uint8_t data[IO_EE1004_SIZE], uint32_t chunks);
+uint32_t io_ee1004_range_chunks(size_t offset, size_t size);
+unsigned io_ee1004_dirty(const uint8_t *before, const uint8_t *after, size_t size);
+
+size_t io_spd_read(IoEe1004 *e, uint8_t data[IO_EE1004_SIZE]);
+
+void io_ee1004_sim_init(IoEe1004Sim *s, IoI2cBus *bus, const uint8_t *image, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
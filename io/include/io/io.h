@@ -28,22 +28,120 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include <spd/intern.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Byte-oriented I2C transport with 7-bit device addresses, EEPROM protocols
+// run on top of it over a programmer or a simulated device
+typedef struct IoI2cBus
+{
+    void *ctx;
+    // Sets the word address, then reads size bytes
+    bool (*read)(void *ctx, uint8_t address, uint8_t offset, uint8_t *data, size_t size);
+    // Writes size bytes from the word address, at most one EEPROM write page
+    bool (*write)(void *ctx, uint8_t address, uint8_t offset, const uint8_t *data, size_t size);
+    // Address-only command such as an EE1004 page select, false on NACK
+    bool (*command)(void *ctx, uint8_t address);
+} IoI2cBus;
+
+typedef struct IoMapping
+{
+    const uint8_t *data;
+    size_t size;
+} IoMapping;
+
+// What a write does to an existing file
+typedef enum IoOverwrite
+{
+    IO_OVERWRITE_ASK,       // IoWriter.confirm decides, without it as never
+    IO_OVERWRITE_NEVER,     // keep the file, the write fails
+    IO_OVERWRITE_ALWAYS,
+    IO_OVERWRITE_SUFFIX,    // write NAME.1.EXT, NAME.2.EXT, ... instead
+} IoOverwrite;
+
+typedef struct IoPendingFile
+{
+    char *temp;
+    // The policy allowed replacing an existing file
+    bool replace;
+} IoPendingFile;
+
+// Files are written to a new DIR/.NAME.XXXX.tmp and renamed to PATH, readers
+// see either the old or the new content. Only the always and confirmed ask
+// policies rename over an existing file, otherwise a file created meanwhile
+// fails the rename with EEXIST. A single write is synced before the rename.
+// A batch defers durability to io_writer_commit(): the temporary files are
+// synced together, renamed, then every directory is synced once.
+typedef struct IoWriter
+{
+    IoOverwrite overwrite;
+    bool batch;
+    // Asked about existing files by the ask policy, false keeps the file
+    bool (*confirm)(void *ctx, const char *path);
+    void *confirm_ctx;
+    // Paths of a batch, pending[n] holds the temporary file of target n
+    SpdIntern targets;
+    IoPendingFile *pending;
+    size_t count;
+    size_t capacity;
+} IoWriter;
+
+// File written in parts, see io_writer_open()
+typedef struct IoWriterFile
+{
+    char *target;
+    char *temp;
+    int fd;                 // -1 when the write was declined
+    bool replace;
+} IoWriterFile;
+
+// Calls returning false or 0 leave the reason in errno, nothing is printed
+
+bool io_overwrite_parse(const char *text, IoOverwrite *overwrite);
+
+void io_writer_init(IoWriter *w, IoOverwrite overwrite, bool batch);
+// A declined confirmation writes nothing and succeeds. EEXIST when the
+// policy keeps an existing file.
+bool io_writer_write(IoWriter *w, const char *path, const uint8_t *data, size_t size);
+// Creates the temporary file of a write in parts. The parts can be
+// written in any order and from several threads, io_writer_close() then
+// finishes the file like io_writer_write(). Writes after a declined
+// confirmation do nothing and succeed.
+bool io_writer_open(IoWriter *w, IoWriterFile *f, const char *path);
+bool io_writer_file_write(IoWriterFile *f, const uint8_t *data, size_t size, uint64_t offset);
+bool io_writer_close(IoWriter *w, IoWriterFile *f);
+// Drops the temporary file of an open write
+void io_writer_discard(IoWriterFile *f);
+bool io_writer_commit(IoWriter *w);
+// Drops the pending files of a batch
+void io_writer_abort(IoWriter *w);
+
+// Single write with the never policy
 bool io_file_write(const char *path, uint8_t *data, size_t size);
+// ENODATA when the file is shorter than size
 bool io_file_read(const char *path, uint8_t *data, size_t size);
+size_t io_file_read_some(const char *path, uint8_t *data, size_t size);
+
+bool io_file_map(IoMapping *m, const char *path);
+void io_file_unmap(IoMapping *m);
+
+bool io_file_size(const char *path, uint64_t *size, bool *is_dir);
+bool io_dir_list(const char *path, bool (*fn)(void *ctx, const char *path), void *ctx);
 
 #if _WIN32
 bool io_i2c_init(void);
 size_t io_i2c_read(uint32_t id, uint8_t *data, size_t size);
 size_t io_i2c_write(uint32_t id, const uint8_t *data, size_t size);
+bool io_i2c_bus(IoI2cBus *bus, uint32_t id);
 #else
 // TODO
-static inline bool io_i2c_init(void) { return fasle; }
+static inline bool io_i2c_init(void) { return false; }
 static inline size_t io_i2c_read(uint32_t, uint8_t *, size_t) { return 0; }
 static inline size_t io_i2c_write(uint32_t, const uint8_t *, size_t) { return 0; }
+static inline bool io_i2c_bus(IoI2cBus *, uint32_t) { return false; }
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,92 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <io/io.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Append-only undo journal of device writes. Records have a fixed size, so
+// a mapped journal is an array. All numbers are little endian.
+//   header   "SPDJRNL1", 8 reserved bytes
+//   record   0  device id, 4 bytes
+//            4  image size, 4 bytes
+//            8  unix time, 8 bytes
+//            16 check, 8 bytes: spd_hash() of the record with zero check
+//            24 reserved, 8 bytes
+//            32 image before the write, 512 bytes
+//            544 image after the write, 512 bytes
+// A torn last record fails its check and is ignored.
+#define IO_JOURNAL_HEADER_SIZE 16
+#define IO_JOURNAL_IMAGE_SIZE 512
+#define IO_JOURNAL_RECORD_SIZE (32 + 2 * IO_JOURNAL_IMAGE_SIZE)
+
+// Records are synced every batch appends and at close. Writers sync the
+// record of a device write before the write itself.
+#define IO_JOURNAL_BATCH 64
+
+typedef struct IoJournal
+{
+    FILE *file;
+    unsigned pending;
+    unsigned batch;
+} IoJournal;
+
+typedef struct IoJournalRecord
+{
+    uint32_t device_id;
+    uint32_t size;
+    int64_t time;
+    const uint8_t *before;
+    const uint8_t *after;
+} IoJournalRecord;
+
+typedef struct IoJournalView
+{
+    IoMapping map;
+    size_t count;
+} IoJournalView;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// EINVAL for existing files that aren't journals
+bool io_journal_open(IoJournal *j, const char *path, unsigned batch);
+bool io_journal_append(IoJournal *j, uint32_t device_id, int64_t time, const uint8_t *before, const uint8_t *after, size_t size);
+bool io_journal_sync(IoJournal *j);
+bool io_journal_close(IoJournal *j);
+
+// EINVAL for files that aren't journals
+bool io_journal_map(IoJournalView *v, const char *path);
+void io_journal_unmap(IoJournalView *v);
+// false for records failing the check
+bool io_journal_record(const IoJournalView *v, size_t index, IoJournalRecord *r);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,101 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// spdd protocol over a Unix stream socket. A frame is a header and up to
+// IO_REMOTE_PAYLOAD_MAX payload bytes, numbers are little endian:
+//   0  payload size, 4 bytes
+//   4  request id, 4 bytes, echoed by the response
+//   8  request op or response status
+//   9  device id
+//   10 reserved, 2 bytes
+// Requests of a connection are answered in order, so clients may send
+// many before reading the responses.
+#define IO_REMOTE_HEADER_SIZE 12
+#define IO_REMOTE_PAYLOAD_MAX 4096
+#define IO_REMOTE_SOCKET "/tmp/spdd.sock"
+
+// Payloads:
+//   READ    request empty, response the device image
+//   DECODE  request an image or empty for the device image, response a
+//           CRC ok byte then the image, clients decode it themselves
+//   VERIFY  request as DECODE, response a CRC ok byte then the DDR3
+//           violation bits, 8 bytes
+//   PATCH   request --set edits separated by newlines, applied to the
+//           device image in one transaction and written, response the new
+//           image
+//   FLASH   request a chunk mask, 4 bytes, then the image, the masked
+//           16-byte chunks are written, response empty
+typedef enum IoRemoteOp
+{
+    IO_REMOTE_READ = 1,
+    IO_REMOTE_DECODE,
+    IO_REMOTE_VERIFY,
+    IO_REMOTE_PATCH,
+    IO_REMOTE_FLASH
+} IoRemoteOp;
+
+typedef enum IoRemoteStatus
+{
+    IO_REMOTE_OK,
+    IO_REMOTE_BAD_REQUEST,
+    IO_REMOTE_NO_DEVICE,
+    IO_REMOTE_IO_ERROR
+} IoRemoteStatus;
+
+typedef struct IoRemoteHeader
+{
+    uint32_t size;
+    uint32_t id;
+    uint8_t code;
+    uint8_t device;
+} IoRemoteHeader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void io_remote_pack(uint8_t out[IO_REMOTE_HEADER_SIZE], const IoRemoteHeader *h);
+// false for oversized payloads
+bool io_remote_unpack(IoRemoteHeader *h, const uint8_t in[IO_REMOTE_HEADER_SIZE]);
+const char *io_remote_status_text(uint8_t status);
+
+// Socket descriptors, -1 with errno on errors. EADDRINUSE when a live
+// daemon owns the socket.
+int io_remote_listen(const char *path);
+int io_remote_connect(const char *path);
+void io_remote_close(int fd);
+
+// Blocking request and response, returns the response status or -1 with
+// errno for transport errors. out holds IO_REMOTE_PAYLOAD_MAX bytes, *size is the
+// response payload size.
+int io_remote_call(int fd, uint8_t op, uint8_t device, const void *payload, size_t payload_size, uint8_t *out, size_t *size);
+
+#ifdef __cplusplus
+}
+#endif
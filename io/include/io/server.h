@@ -0,0 +1,84 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <io/ee1004.h>
+#include <io/remote.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define IO_SERVER_DEVICES 256
+#define IO_SERVER_SIMULATED_MAX 8
+#define IO_SERVER_FRAME_MAX (IO_REMOTE_HEADER_SIZE + IO_REMOTE_PAYLOAD_MAX)
+
+// Device sessions stay open between requests: the bus and the backend
+// itself are set up once
+typedef struct IoServerSession
+{
+    bool open;
+    IoI2cBus bus;
+    IoEe1004 eeprom;
+} IoServerSession;
+
+// spdd request handling without the socket loop. Devices below
+// simulated_count are simulated EEPROMs, the others are I2C devices when
+// i2c is set.
+typedef struct IoServer
+{
+    bool i2c;
+    IoServerSession sessions[IO_SERVER_DEVICES];
+    IoEe1004Sim simulated[IO_SERVER_SIMULATED_MAX];
+    size_t simulated_count;
+    uint64_t requests;
+} IoServer;
+
+// Bytes of one connection: received ones and queued responses
+typedef struct IoServerConnection
+{
+    uint8_t in[2 * IO_SERVER_FRAME_MAX];
+    size_t in_size;
+    uint8_t *out;
+    size_t out_size;
+    size_t out_sent;
+    size_t out_capacity;
+} IoServerConnection;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void io_server_init(IoServer *s, bool i2c);
+// Adds the next simulated device, false when all are taken. The server
+// must not move afterwards.
+bool io_server_simulate(IoServer *s, const uint8_t *image, size_t size);
+// Answers every complete frame of c->in and queues the responses in
+// order. False with EPROTO for malformed frames, ENOMEM for a full queue.
+bool io_server_process(IoServer *s, IoServerConnection *c);
+void io_server_connection_free(IoServerConnection *c);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,85 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <spd/intern.h>
+
+// Directory watch for files that are completely written: closed after
+// writing or renamed into the directory. Needs inotify, elsewhere
+// io_watch_open() fails.
+typedef enum IoWatchEvent
+{
+    IO_WATCH_FILE,
+    IO_WATCH_OVERFLOW,      // events were lost, rescan the directory
+    IO_WATCH_TIMEOUT,
+    IO_WATCH_ERROR
+} IoWatchEvent;
+
+// Processed files keyed by "HASH NAME": a rewritten file is a new key.
+// Keys are appended to a state file as lines, reopening it restores them.
+typedef struct IoWatchState
+{
+    FILE *file;
+    SpdIntern keys;
+} IoWatchState;
+
+typedef struct IoWatch
+{
+    int fd;
+    size_t offset;
+    size_t size;
+    // Holds a whole batch of events, names are up to NAME_MAX bytes
+    uint8_t buffer[16384];
+} IoWatch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool io_watch_open(IoWatch *w, const char *dir);
+void io_watch_close(IoWatch *w);
+// Waits up to timeout_ms, -1 forever. name is the file name in the
+// directory for IO_WATCH_FILE, errno tells the reason of IO_WATCH_ERROR.
+IoWatchEvent io_watch_next(IoWatch *w, char *name, size_t size, int timeout_ms);
+
+// False for dot files and temporary files of atomic writers
+bool io_watch_is_candidate(const char *name);
+
+// The state is closed after failures too
+bool io_watch_state_open(IoWatchState *s, const char *path);
+void io_watch_state_close(IoWatchState *s);
+// Length of the key, truncated to size - 1
+size_t io_watch_key(char *key, size_t size, const char *name, const uint8_t *data, size_t data_size);
+bool io_watch_state_has(const IoWatchState *s, const char *key, size_t len);
+// Records and flushes a new key, known keys succeed without a write
+bool io_watch_state_add(IoWatchState *s, const char *key, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
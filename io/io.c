@@ -21,6 +21,11 @@
  * THE SOFTWARE.
  */
 
+#if __linux__
+// syncfs()
+#define _GNU_SOURCE
+#endif
+
 #include <io/io.h>
 
 #include <stdio.h>
@@ -29,8 +34,27 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#if _WIN32
+#include <windows.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#endif
+#if __linux__
+#include <sys/syscall.h>
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE 1
+#endif
+#endif
 
 static bool is_file_exists(const char *path)
 {
@@ -38,57 +62,657 @@ static bool is_file_exists(const char *path)
     struct _stat64 st;
     return 0 == _stat64(path, &st);
 #else
-    strust stat st;
+    struct stat st;
     return 0 == stat(path, &st);
 #endif
 }
 
-static char get_answer()
+#if _WIN32
+// Win32 calls report through GetLastError(), the library through errno
+static void set_errno(void)
+{
+    switch (GetLastError()) {
+        case ERROR_FILE_NOT_FOUND:
+        case ERROR_PATH_NOT_FOUND:
+            errno = ENOENT;
+            break;
+        case ERROR_ACCESS_DENIED:
+        case ERROR_SHARING_VIOLATION:
+            errno = EACCES;
+            break;
+        case ERROR_NOT_ENOUGH_MEMORY:
+            errno = ENOMEM;
+            break;
+        case ERROR_FILE_EXISTS:
+        case ERROR_ALREADY_EXISTS:
+            errno = EEXIST;
+            break;
+        default:
+            errno = EIO;
+            break;
+    }
+}
+#endif
+
+// remove() of a temporary file keeps the error that caused it
+static void remove_temp(const char *tmp)
+{
+    int error = errno;
+    remove(tmp);
+    errno = error;
+}
+
+static bool is_pending(const IoWriter *w, const char *path)
 {
-    char ans, c;
-    (void)scanf("%c", &ans);
+    return spd_intern_find(&w->targets, path, strlen(path)) != SPD_INTERN_NONE;
+}
 
-    // https://c-faq.com/stdio/stdinflush2.html
-    while (ans != '\n' && (c = getchar()) != '\n' && c != EOF)
-        /* discard */;
+static bool is_taken(const IoWriter *w, const char *path)
+{
+    return is_file_exists(path) || is_pending(w, path);
+}
 
-    return ans;
+static const char *file_name(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+#if _WIN32
+    const char *backslash = strrchr(path, '\\');
+    if (backslash && (!slash || backslash > slash))
+        slash = backslash;
+#endif
+    return slash ? slash + 1 : path;
 }
 
-bool io_file_write(const char *path, uint8_t *data, size_t size)
+// PATH.1.EXT, PATH.2.EXT, ... for PATH.EXT
+static bool find_suffix(const IoWriter *w, const char *path, char *out, size_t size)
 {
-    if (is_file_exists(path)) {
-        printf("The file already exists: %s\nDo you want to overwrite it? (y/N): ", path);
-        char ans = get_answer();
-        if (ans != 'y' && ans != 'Y')
+    const char *name = file_name(path);
+    const char *dot = strrchr(name, '.');
+    size_t stem = dot && dot != name ? (size_t)(dot - path) : strlen(path);
+    for (unsigned n = 1; n < 10000; n++) {
+        int len = snprintf(out, size, "%.*s.%u%s", (int)stem, path, n, path + stem);
+        if (len < 0 || (size_t)len >= size)
+            return false;
+        if (!is_taken(w, out))
             return true;
     }
-    FILE *f = fopen(path, "wb");
-    if (!f) {
-        printf("Can't open file: %s\n", path);
+    return false;
+}
+
+// The final path by the overwrite policy, false if the file is kept.
+// *replace allows the rename to replace a file, only when the policy said so.
+static bool resolve_path(const IoWriter *w, const char *path, char *out, size_t size, bool *skip, bool *replace)
+{
+    *skip = false;
+    *replace = w->overwrite == IO_OVERWRITE_ALWAYS;
+    if (strlen(path) + 1 > size) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    strcpy(out, path);
+    if (w->overwrite == IO_OVERWRITE_ALWAYS || !is_taken(w, path))
+        return true;
+    switch (w->overwrite) {
+        case IO_OVERWRITE_SUFFIX:
+            if (find_suffix(w, path, out, size))
+                return true;
+            errno = EEXIST;
+            return false;
+        case IO_OVERWRITE_ASK:
+            if (w->confirm) {
+                *skip = !w->confirm(w->confirm_ctx, path);
+                *replace = !*skip;
+                return true;
+            }
+            // fallthrough
+        case IO_OVERWRITE_NEVER:
+        default:
+            errno = EEXIST;
+            return false;
+    }
+}
+
+static size_t dir_length(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? (size_t)(slash - path) : 0;
+}
+
+// Makes renames in the directory of the path durable
+static bool sync_dir(const char *path)
+{
+#if _WIN32
+    (void)path;
+    return true;
+#else
+    char dir[4096];
+    size_t length = dir_length(path);
+    if (path[length] != '/')
+        strcpy(dir, ".");
+    else if (!length)
+        strcpy(dir, "/");
+    else
+        snprintf(dir, sizeof(dir), "%.*s", (int)length, path);
+    int fd = open(dir, O_RDONLY);
+    bool ok = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0)
+        close(fd);
+    return ok;
+#endif
+}
+
+// Without replace an existing target fails the rename with EEXIST, even
+// when it appeared after the policy was checked
+static bool rename_file(const char *from, const char *to, bool replace)
+{
+#if _WIN32
+    if (MoveFileExA(from, to, MOVEFILE_WRITE_THROUGH | (replace ? MOVEFILE_REPLACE_EXISTING : 0)))
+        return true;
+    set_errno();
+    return false;
+#else
+    if (replace)
+        return rename(from, to) == 0;
+#if __linux__
+    if (!syscall(SYS_renameat2, AT_FDCWD, from, AT_FDCWD, to, RENAME_NOREPLACE))
+        return true;
+    if (errno != EINVAL && errno != ENOSYS)
         return false;
+#endif
+    // A hard link never replaces, file systems without them get the check
+    if (!link(from, to)) {
+        unlink(from);
+        return true;
     }
-    if (size != fwrite(data, 1, size, f)) {
-        printf("Can't write file: %s\n", path);
-        fclose(f);
+    if (errno != EPERM && errno != ENOTSUP && errno != EOPNOTSUPP)
+        return false;
+    if (is_file_exists(to)) {
+        errno = EEXIST;
         return false;
     }
-    fclose(f);
+    return rename(from, to) == 0;
+#endif
+}
+
+// Unique DIR/.NAME.XXXX.tmp next to the target, created exclusively so
+// neither user files nor other writers' temporary files are touched.
+// Hidden and .tmp names are skipped by spool watchers.
+static char *create_temp(const IoWriter *w, const char *target, int *fd)
+{
+    size_t dir = (size_t)(file_name(target) - target);
+    size_t size = strlen(target) + 32;
+    char *tmp = malloc(size);
+    if (!tmp) {
+        errno = ENOMEM;
+        return NULL;
+    }
+#if _WIN32
+    unsigned long pid = (unsigned long)_getpid();
+#else
+    unsigned long pid = (unsigned long)getpid();
+#endif
+    uint32_t seed = (uint32_t)(uintptr_t)w ^ (uint32_t)time(NULL) * 2654435761u;
+    for (uint32_t n = 0; n < 100; n++) {
+        snprintf(tmp, size, "%.*s.%s.%lx%08x.tmp", (int)dir, target, target + dir, pid, seed + n * 0x9e3779b9u);
+#if _WIN32
+        *fd = _open(tmp, _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        *fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+#endif
+        if (*fd >= 0)
+            return tmp;
+        if (errno != EEXIST)
+            break;
+    }
+    free(tmp);
+    return NULL;
+}
+
+// Positioned write of the whole buffer, safe from several threads
+static bool write_at(int fd, const uint8_t *data, size_t size, uint64_t offset)
+{
+    while (size) {
+#if _WIN32
+        OVERLAPPED o;
+        memset(&o, 0, sizeof(o));
+        o.Offset = (DWORD)offset;
+        o.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD n;
+        if (!WriteFile((HANDLE)_get_osfhandle(fd), data, size < 0x40000000 ? (DWORD)size : 0x40000000, &n, &o)) {
+            set_errno();
+            return false;
+        }
+#else
+        ssize_t n = pwrite(fd, data, size, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return false;
+#endif
+        if (n == 0) {
+            errno = EIO;
+            return false;
+        }
+        data += n;
+        size -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+// Syncs if asked and closes, the first error is kept
+static bool close_temp(int fd, bool sync)
+{
+#if _WIN32
+    bool ok = !sync || _commit(fd) == 0;
+    int error = errno;
+    if (_close(fd) && ok) {
+#else
+    bool ok = !sync || fsync(fd) == 0;
+    int error = errno;
+    if (close(fd) && ok) {
+#endif
+        error = errno;
+        ok = false;
+    }
+    errno = error;
+    return ok;
+}
+
+// Batch entry of the target, the temporary file is owned by the batch
+// after success
+static bool add_pending(IoWriter *w, const char *target, char *tmp, bool replace)
+{
+    // A repeated path replaces its earlier temporary file
+    uint32_t id = spd_intern_find(&w->targets, target, strlen(target));
+    if (id != SPD_INTERN_NONE) {
+        remove(w->pending[id].temp);
+        free(w->pending[id].temp);
+        w->pending[id].temp = tmp;
+        w->pending[id].replace = w->pending[id].replace || replace;
+        return true;
+    }
+    if (w->count == w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 64;
+        IoPendingFile *pending = realloc(w->pending, capacity * sizeof(pending[0]));
+        if (!pending) {
+            errno = ENOMEM;
+            return false;
+        }
+        w->pending = pending;
+        w->capacity = capacity;
+    }
+    if (spd_intern(&w->targets, target, strlen(target)) != w->count) {
+        errno = ENOMEM;
+        return false;
+    }
+    w->pending[w->count].temp = tmp;
+    w->pending[w->count].replace = replace;
+    w->count++;
     return true;
 }
 
+bool io_overwrite_parse(const char *text, IoOverwrite *overwrite)
+{
+    static const char *names[] = { "ask", "never", "always", "suffix" };
+    for (size_t n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+        if (!strcmp(text, names[n])) {
+            *overwrite = (IoOverwrite)n;
+            return true;
+        }
+    }
+    return false;
+}
+
+void io_writer_init(IoWriter *w, IoOverwrite overwrite, bool batch)
+{
+    memset(w, 0, sizeof(w[0]));
+    w->overwrite = overwrite;
+    w->batch = batch;
+    spd_intern_init(&w->targets);
+}
+
+bool io_writer_open(IoWriter *w, IoWriterFile *f, const char *path)
+{
+    char target[4096];
+    bool skip;
+    memset(f, 0, sizeof(f[0]));
+    f->fd = -1;
+    if (!resolve_path(w, path, target, sizeof(target), &skip, &f->replace))
+        return false;
+    if (skip)
+        return true;
+    size_t size = strlen(target) + 1;
+    f->target = malloc(size);
+    if (!f->target) {
+        errno = ENOMEM;
+        return false;
+    }
+    memcpy(f->target, target, size);
+    f->temp = create_temp(w, target, &f->fd);
+    if (!f->temp) {
+        free(f->target);
+        f->target = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool io_writer_file_write(IoWriterFile *f, const uint8_t *data, size_t size, uint64_t offset)
+{
+    return f->fd < 0 || write_at(f->fd, data, size, offset);
+}
+
+bool io_writer_close(IoWriter *w, IoWriterFile *f)
+{
+    if (f->fd < 0)
+        return true;
+#if _WIN32
+    bool sync = true;
+#else
+    bool sync = !w->batch;
+#endif
+    bool ok = close_temp(f->fd, sync);
+    f->fd = -1;
+    // The temporary file is gone after the rename, a batch owns it
+    bool moved = false;
+    if (ok && !w->batch) {
+        moved = ok = rename_file(f->temp, f->target, f->replace);
+        ok = ok && sync_dir(f->target);
+    } else if (ok) {
+        moved = ok = add_pending(w, f->target, f->temp, f->replace);
+    }
+    if (!moved)
+        remove_temp(f->temp);
+    if (!moved || !w->batch)
+        free(f->temp);
+    free(f->target);
+    f->temp = f->target = NULL;
+    return ok;
+}
+
+void io_writer_discard(IoWriterFile *f)
+{
+    if (f->fd >= 0) {
+        close_temp(f->fd, false);
+        remove(f->temp);
+    }
+    free(f->temp);
+    free(f->target);
+    memset(f, 0, sizeof(f[0]));
+    f->fd = -1;
+}
+
+bool io_writer_write(IoWriter *w, const char *path, const uint8_t *data, size_t size)
+{
+    IoWriterFile f;
+    if (!io_writer_open(w, &f, path))
+        return false;
+    if (!io_writer_file_write(&f, data, size, 0)) {
+        int error = errno;
+        io_writer_discard(&f);
+        errno = error;
+        return false;
+    }
+    return io_writer_close(w, &f);
+}
+
+static void release_pending(IoWriter *w)
+{
+    for (size_t n = 0; n < w->count; n++)
+        free(w->pending[n].temp);
+    free(w->pending);
+    spd_intern_free(&w->targets);
+    w->pending = NULL;
+    w->count = w->capacity = 0;
+}
+
+static const char *pending_target(const IoWriter *w, size_t n)
+{
+    return spd_intern_str(&w->targets, (uint32_t)n);
+}
+
+#if !_WIN32
+// One sync per file system instead of one per file
+static bool sync_pending(const IoWriter *w)
+{
+    dev_t devices[16];
+    size_t device_count = 0;
+    bool ok = true;
+    for (size_t n = 0; n < w->count && ok; n++) {
+        const char *tmp = w->pending[n].temp;
+        struct stat st;
+        if (stat(tmp, &st))
+            return false;
+        size_t k = 0;
+        while (k < device_count && devices[k] != st.st_dev)
+            k++;
+        if (k < device_count)
+            continue;
+#if __linux__
+        if (device_count < sizeof(devices) / sizeof(devices[0])) {
+            devices[device_count++] = st.st_dev;
+            int fd = open(tmp, O_RDONLY);
+            ok = fd >= 0 && syncfs(fd) == 0;
+            if (fd >= 0)
+                close(fd);
+            continue;
+        }
+#endif
+        int fd = open(tmp, O_RDONLY);
+        ok = fd >= 0 && fsync(fd) == 0;
+        if (fd >= 0)
+            close(fd);
+    }
+    return ok;
+}
+#endif
+
+bool io_writer_commit(IoWriter *w)
+{
+    bool ok = true;
+#if _WIN32
+    // Temporary files are flushed as they are written
+#else
+    if (w->count && !sync_pending(w))
+        ok = false;
+#endif
+    for (size_t n = 0; n < w->count; n++) {
+        if (!ok) {
+            remove_temp(w->pending[n].temp);
+        } else if (!rename_file(w->pending[n].temp, pending_target(w, n), w->pending[n].replace)) {
+            remove_temp(w->pending[n].temp);
+            ok = false;
+        }
+    }
+    // Directories are synced once, batches usually go to a few of them
+    size_t synced[16], synced_count = 0;
+    for (size_t n = 0; n < w->count && ok; n++) {
+        const char *path = pending_target(w, n);
+        size_t length = dir_length(path), k = 0;
+        while (k < synced_count && !(dir_length(pending_target(w, synced[k])) == length && !strncmp(pending_target(w, synced[k]), path, length)))
+            k++;
+        if (k < synced_count)
+            continue;
+        if (synced_count < sizeof(synced) / sizeof(synced[0]))
+            synced[synced_count++] = n;
+        ok = sync_dir(path);
+    }
+    int error = errno;
+    release_pending(w);
+    errno = error;
+    return ok;
+}
+
+void io_writer_abort(IoWriter *w)
+{
+    for (size_t n = 0; n < w->count; n++)
+        remove(w->pending[n].temp);
+    release_pending(w);
+}
+
+bool io_file_write(const char *path, uint8_t *data, size_t size)
+{
+    IoWriter w;
+    io_writer_init(&w, IO_OVERWRITE_NEVER, false);
+    return io_writer_write(&w, path, data, size);
+}
+
 bool io_file_read(const char *path, uint8_t *data, size_t size)
 {
     FILE *f = fopen(path, "rb");
-    if (!f) {
-        printf("Can't open file: %s\n", path);
+    if (!f)
         return false;
+    bool ok = size == fread(data, 1, size, f);
+    if (!ok)
+        errno = ferror(f) ? EIO : ENODATA;
+    fclose(f);
+    return ok;
+}
+
+// Reads up to size bytes, returns the number of bytes read, 0 on error
+size_t io_file_read_some(const char *path, uint8_t *data, size_t size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return 0;
+    size_t n = fread(data, 1, size, f);
+    if (ferror(f)) {
+        errno = EIO;
+        n = 0;
+    } else if (!n) {
+        errno = ENODATA;
     }
-    if (size != fread(data, 1, size, f)) {
-        printf("File too small: %s\n", path);
-        fclose(f);
+    fclose(f);
+    return n;
+}
+
+// Read-only mapping of a whole file, empty files map to NULL data
+bool io_file_map(IoMapping *m, const char *path)
+{
+    memset(m, 0, sizeof(m[0]));
+#if _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        set_errno();
         return false;
     }
-    fclose(f);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        set_errno();
+        CloseHandle(file);
+        return false;
+    }
+    m->size = (size_t)size.QuadPart;
+    if (m->size) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        m->data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (mapping)
+            CloseHandle(mapping);
+        if (!m->data) {
+            set_errno();
+            CloseHandle(file);
+            return false;
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+        if (fd >= 0) {
+            int error = errno;
+            close(fd);
+            errno = error;
+        }
+        return false;
+    }
+    m->size = (size_t)st.st_size;
+    if (m->size) {
+        void *data = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return false;
+        }
+        m->data = data;
+    }
+    close(fd);
+#endif
     return true;
 }
+
+void io_file_unmap(IoMapping *m)
+{
+    if (m->data) {
+#if _WIN32
+        UnmapViewOfFile(m->data);
+#else
+        munmap((void *)m->data, m->size);
+#endif
+    }
+    memset(m, 0, sizeof(m[0]));
+}
+
+bool io_file_size(const char *path, uint64_t *size, bool *is_dir)
+{
+#if _WIN32
+    struct _stat64 st;
+    if (_stat64(path, &st))
+        return false;
+    *is_dir = (st.st_mode & _S_IFDIR) != 0;
+#else
+    struct stat st;
+    if (stat(path, &st))
+        return false;
+    *is_dir = S_ISDIR(st.st_mode);
+#endif
+    *size = (uint64_t)st.st_size;
+    return true;
+}
+
+// Calls fn for every regular file of the directory, not recursive.
+// Stops and returns false as soon as fn returns false, errno is then
+// cleared so callers can tell it from a directory that can't be read.
+bool io_dir_list(const char *path, bool (*fn)(void *ctx, const char *path), void *ctx)
+{
+    char file[4096];
+#if _WIN32
+    WIN32_FIND_DATAA fd;
+    snprintf(file, sizeof(file), "%s\\*", path);
+    HANDLE h = FindFirstFileA(file, &fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        set_errno();
+        return false;
+    }
+    bool ok = true;
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+        snprintf(file, sizeof(file), "%s\\%s", path, fd.cFileName);
+        ok = fn(ctx, file);
+    } while (ok && FindNextFileA(h, &fd));
+    FindClose(h);
+    if (!ok)
+        errno = 0;
+#else
+    DIR *dir = opendir(path);
+    if (!dir)
+        return false;
+    bool ok = true;
+    struct dirent *e;
+    while (ok && (e = readdir(dir))) {
+        if (e->d_name[0] == '.')
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, e->d_name);
+        struct stat st;
+        if (e->d_type == DT_REG || (e->d_type == DT_UNKNOWN && !stat(file, &st) && S_ISREG(st.st_mode)))
+            ok = fn(ctx, file);
+    }
+    closedir(dir);
+    if (!ok)
+        errno = 0;
+#endif
+    return ok;
+}
@@ -0,0 +1,176 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <io/journal.h>
+
+#include <spd/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char journal_magic[8] = { 'S', 'P', 'D', 'J', 'R', 'N', 'L', '1' };
+
+static void put_le(uint8_t *p, uint64_t value, int size)
+{
+    for (int n = 0; n < size; n++)
+        p[n] = (uint8_t)(value >> 8 * n);
+}
+
+static uint64_t get_le(const uint8_t *p, int size)
+{
+    uint64_t value = 0;
+    for (int n = 0; n < size; n++)
+        value |= (uint64_t)p[n] << 8 * n;
+    return value;
+}
+
+static uint64_t record_check(const uint8_t *record)
+{
+    uint8_t copy[IO_JOURNAL_RECORD_SIZE];
+    memcpy(copy, record, sizeof(copy));
+    memset(copy + 16, 0, 8);
+    return spd_hash(copy, sizeof(copy)).lo;
+}
+
+bool io_journal_open(IoJournal *j, const char *path, unsigned batch)
+{
+    memset(j, 0, sizeof(j[0]));
+    j->batch = batch ? batch : 1;
+    j->file = fopen(path, "a+b");
+    if (!j->file)
+        return false;
+    // A new journal starts with the header, a torn last record is padded
+    // to a whole record that fails the check so appends stay aligned.
+    // Anything else than a journal is left alone.
+    static const uint8_t zeros[IO_JOURNAL_RECORD_SIZE];
+    long size = fseek(j->file, 0, SEEK_END) ? -1 : ftell(j->file);
+    bool ok = size >= 0;
+    if (size > 0) {
+        uint8_t header[IO_JOURNAL_HEADER_SIZE];
+        ok = size >= IO_JOURNAL_HEADER_SIZE && !fseek(j->file, 0, SEEK_SET)
+            && fread(header, 1, sizeof(header), j->file) == sizeof(header)
+            && !memcmp(header, journal_magic, sizeof(journal_magic));
+        if (!ok)
+            errno = ferror(j->file) ? EIO : EINVAL;
+        // Switching from reading to appending needs a seek
+        else if (fseek(j->file, 0, SEEK_END))
+            ok = false;
+    }
+    if (ok && size == 0) {
+        uint8_t header[IO_JOURNAL_HEADER_SIZE] = {0};
+        memcpy(header, journal_magic, sizeof(journal_magic));
+        ok = fwrite(header, 1, sizeof(header), j->file) == sizeof(header) && io_journal_sync(j);
+    } else if (ok && size > IO_JOURNAL_HEADER_SIZE && (size - IO_JOURNAL_HEADER_SIZE) % IO_JOURNAL_RECORD_SIZE) {
+        size_t pad = IO_JOURNAL_RECORD_SIZE - (size_t)(size - IO_JOURNAL_HEADER_SIZE) % IO_JOURNAL_RECORD_SIZE;
+        ok = fwrite(zeros, 1, pad, j->file) == pad && io_journal_sync(j);
+    }
+    if (!ok) {
+        int error = errno;
+        fclose(j->file);
+        j->file = NULL;
+        errno = error;
+    }
+    return ok;
+}
+
+bool io_journal_append(IoJournal *j, uint32_t device_id, int64_t time, const uint8_t *before, const uint8_t *after, size_t size)
+{
+    uint8_t record[IO_JOURNAL_RECORD_SIZE] = {0};
+    if (size > IO_JOURNAL_IMAGE_SIZE) {
+        errno = EINVAL;
+        return false;
+    }
+    put_le(record, device_id, 4);
+    put_le(record + 4, size, 4);
+    put_le(record + 8, (uint64_t)time, 8);
+    memcpy(record + 32, before, size);
+    memcpy(record + 32 + IO_JOURNAL_IMAGE_SIZE, after, size);
+    put_le(record + 16, record_check(record), 8);
+    if (fwrite(record, 1, sizeof(record), j->file) != sizeof(record))
+        return false;
+    return ++j->pending < j->batch || io_journal_sync(j);
+}
+
+bool io_journal_sync(IoJournal *j)
+{
+    bool ok = fflush(j->file) == 0;
+#if _WIN32
+    ok = ok && _commit(_fileno(j->file)) == 0;
+#else
+    ok = ok && fsync(fileno(j->file)) == 0;
+#endif
+    j->pending = 0;
+    return ok;
+}
+
+bool io_journal_close(IoJournal *j)
+{
+    bool ok = true;
+    if (j->file) {
+        ok = !j->pending || io_journal_sync(j);
+        ok = fclose(j->file) == 0 && ok;
+    }
+    memset(j, 0, sizeof(j[0]));
+    return ok;
+}
+
+bool io_journal_map(IoJournalView *v, const char *path)
+{
+    memset(v, 0, sizeof(v[0]));
+    if (!io_file_map(&v->map, path))
+        return false;
+    if (v->map.size < IO_JOURNAL_HEADER_SIZE || memcmp(v->map.data, journal_magic, sizeof(journal_magic))) {
+        io_file_unmap(&v->map);
+        errno = EINVAL;
+        return false;
+    }
+    v->count = (v->map.size - IO_JOURNAL_HEADER_SIZE) / IO_JOURNAL_RECORD_SIZE;
+    return true;
+}
+
+void io_journal_unmap(IoJournalView *v)
+{
+    io_file_unmap(&v->map);
+    memset(v, 0, sizeof(v[0]));
+}
+
+bool io_journal_record(const IoJournalView *v, size_t index, IoJournalRecord *r)
+{
+    if (index >= v->count)
+        return false;
+    const uint8_t *record = v->map.data + IO_JOURNAL_HEADER_SIZE + index * IO_JOURNAL_RECORD_SIZE;
+    r->device_id = (uint32_t)get_le(record, 4);
+    r->size = (uint32_t)get_le(record + 4, 4);
+    r->time = (int64_t)get_le(record + 8, 8);
+    r->before = record + 32;
+    r->after = record + 32 + IO_JOURNAL_IMAGE_SIZE;
+    return r->size <= IO_JOURNAL_IMAGE_SIZE && get_le(record + 16, 8) == record_check(record);
+}
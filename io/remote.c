@@ -0,0 +1,231 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <io/remote.h>
+
+#include <string.h>
+#include <errno.h>
+
+#if !_WIN32
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+void io_remote_pack(uint8_t out[IO_REMOTE_HEADER_SIZE], const IoRemoteHeader *h)
+{
+    put32(out, h->size);
+    put32(out + 4, h->id);
+    out[8] = h->code;
+    out[9] = h->device;
+    out[10] = out[11] = 0;
+}
+
+bool io_remote_unpack(IoRemoteHeader *h, const uint8_t in[IO_REMOTE_HEADER_SIZE])
+{
+    h->size = get32(in);
+    h->id = get32(in + 4);
+    h->code = in[8];
+    h->device = in[9];
+    return h->size <= IO_REMOTE_PAYLOAD_MAX;
+}
+
+const char *io_remote_status_text(uint8_t status)
+{
+    switch (status) {
+        case IO_REMOTE_OK: return "OK";
+        case IO_REMOTE_BAD_REQUEST: return "bad request";
+        case IO_REMOTE_NO_DEVICE: return "device isn't available";
+        case IO_REMOTE_IO_ERROR: return "I2C transfer failed";
+        default: return "unknown status";
+    }
+}
+
+#if _WIN32
+
+int io_remote_listen(const char *path)
+{
+    (void)path;
+    errno = ENOSYS;
+    return -1;
+}
+
+int io_remote_connect(const char *path)
+{
+    (void)path;
+    errno = ENOSYS;
+    return -1;
+}
+
+void io_remote_close(int fd)
+{
+    (void)fd;
+}
+
+int io_remote_call(int fd, uint8_t op, uint8_t device, const void *payload, size_t payload_size, uint8_t *out, size_t *size)
+{
+    (void)fd, (void)op, (void)device, (void)payload, (void)payload_size, (void)out;
+    *size = 0;
+    errno = ENOSYS;
+    return -1;
+}
+
+#else
+
+static bool socket_address(struct sockaddr_un *a, const char *path)
+{
+    memset(a, 0, sizeof(a[0]));
+    a->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(a->sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    strcpy(a->sun_path, path);
+    return true;
+}
+
+// A stale socket of a dead daemon is replaced
+int io_remote_listen(const char *path)
+{
+    struct sockaddr_un a;
+    if (!socket_address(&a, path))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && bind(fd, (struct sockaddr *)&a, sizeof(a)) && errno == EADDRINUSE) {
+        int probe = io_remote_connect(path);
+        if (probe >= 0) {
+            close(probe);
+            close(fd);
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path);
+        if (bind(fd, (struct sockaddr *)&a, sizeof(a))) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd < 0 || listen(fd, 64)) {
+        if (fd >= 0) {
+            int error = errno;
+            close(fd);
+            errno = error;
+        }
+        return -1;
+    }
+    return fd;
+}
+
+int io_remote_connect(const char *path)
+{
+    struct sockaddr_un a;
+    if (!socket_address(&a, path))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&a, sizeof(a))) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        fd = -1;
+    }
+    return fd;
+}
+
+void io_remote_close(int fd)
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+static bool send_all(int fd, const uint8_t *data, size_t size)
+{
+    while (size) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool recv_all(int fd, uint8_t *data, size_t size)
+{
+    while (size) {
+        ssize_t n = recv(fd, data, size, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+            errno = ECONNRESET;
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+int io_remote_call(int fd, uint8_t op, uint8_t device, const void *payload, size_t payload_size, uint8_t *out, size_t *size)
+{
+    // Ids only pair a response with its request, threads may share them
+    static uint32_t next_id;
+    uint8_t frame[IO_REMOTE_HEADER_SIZE + IO_REMOTE_PAYLOAD_MAX];
+    IoRemoteHeader h = { (uint32_t)payload_size, __atomic_add_fetch(&next_id, 1, __ATOMIC_RELAXED), op, device };
+    *size = 0;
+    if (payload_size > IO_REMOTE_PAYLOAD_MAX) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    io_remote_pack(frame, &h);
+    if (payload_size)
+        memcpy(frame + IO_REMOTE_HEADER_SIZE, payload, payload_size);
+    IoRemoteHeader r;
+    if (!send_all(fd, frame, IO_REMOTE_HEADER_SIZE + payload_size) || !recv_all(fd, frame, IO_REMOTE_HEADER_SIZE))
+        return -1;
+    if (!io_remote_unpack(&r, frame) || r.id != h.id) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (!recv_all(fd, frame, r.size))
+        return -1;
+    *size = r.size;
+    memcpy(out, frame, r.size);
+    return r.code;
+}
+
+#endif
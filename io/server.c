@@ -0,0 +1,237 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <io/server.h>
+#include <spd/spd.h>
+#include <spd/txn.h>
+#include <spd/validate.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+void io_server_init(IoServer *s, bool i2c)
+{
+    memset(s, 0, sizeof(s[0]));
+    s->i2c = i2c;
+}
+
+bool io_server_simulate(IoServer *s, const uint8_t *image, size_t size)
+{
+    if (s->simulated_count == IO_SERVER_SIMULATED_MAX)
+        return false;
+    IoServerSession *session = &s->sessions[s->simulated_count];
+    io_ee1004_sim_init(&s->simulated[s->simulated_count++], &session->bus, image, size);
+    io_ee1004_init(&session->eeprom, &session->bus, IO_SPD_ADDRESS);
+    session->open = true;
+    return true;
+}
+
+static IoServerSession *open_session(IoServer *d, uint8_t device)
+{
+    IoServerSession *s = &d->sessions[device];
+    if (!s->open && d->i2c && io_i2c_bus(&s->bus, device)) {
+        io_ee1004_init(&s->eeprom, &s->bus, IO_SPD_ADDRESS);
+        s->open = true;
+    }
+    return s->open ? s : NULL;
+}
+
+// A failed transfer closes the session, the next request opens it again
+static size_t read_device(IoServer *d, uint8_t device, uint8_t data[SPD_SIZE_MAX], int *status)
+{
+    IoServerSession *s = open_session(d, device);
+    size_t size = s ? io_spd_read(&s->eeprom, data) : 0;
+    if (!s)
+        *status = IO_REMOTE_NO_DEVICE;
+    else if (!size)
+        *status = IO_REMOTE_IO_ERROR;
+    if (s && !size && device >= d->simulated_count)
+        s->open = false;
+    return size;
+}
+
+static bool write_device(IoServer *d, uint8_t device, const uint8_t data[SPD_SIZE_MAX], uint32_t chunks, int *status)
+{
+    IoServerSession *s = open_session(d, device);
+    if (!s) {
+        *status = IO_REMOTE_NO_DEVICE;
+        return false;
+    }
+    if (!io_ee1004_write_chunks(&s->eeprom, data, chunks)) {
+        *status = IO_REMOTE_IO_ERROR;
+        if (device >= d->simulated_count)
+            s->open = false;
+        return false;
+    }
+    return true;
+}
+
+static void put64(uint8_t *p, uint64_t v)
+{
+    for (int n = 0; n < 8; n++)
+        p[n] = (uint8_t)(v >> (8 * n));
+}
+
+// Image of the request payload, or of the device for an empty payload
+static size_t request_image(IoServer *d, const IoRemoteHeader *h, const uint8_t *payload, uint8_t data[SPD_SIZE_MAX], int *status)
+{
+    if (!h->size)
+        return read_device(d, h->device, data, status);
+    if (h->size < SPD_DDR3_SIZE || h->size > SPD_SIZE_MAX) {
+        *status = IO_REMOTE_BAD_REQUEST;
+        return 0;
+    }
+    memcpy(data, payload, h->size);
+    return h->size;
+}
+
+static int patch_device(IoServer *d, const IoRemoteHeader *h, const uint8_t *payload, uint8_t *out, size_t *out_size)
+{
+    uint8_t data[SPD_SIZE_MAX] = { 0 };
+    char edits[IO_REMOTE_PAYLOAD_MAX + 1];
+    int status = IO_REMOTE_OK;
+    size_t size = read_device(d, h->device, data, &status);
+    if (!size)
+        return status;
+    memcpy(edits, payload, h->size);
+    edits[h->size] = 0;
+    SpdTxn txn;
+    spd_txn_begin(&txn, data, size);
+    for (char *edit = strtok(edits, "\n"); edit; edit = strtok(NULL, "\n")) {
+        if (!spd_txn_parse(&txn, edit))
+            return IO_REMOTE_BAD_REQUEST;
+    }
+    SpdInfo i;
+    SpdRange ranges[32];
+    size_t count = spd_txn_commit(&txn, &i, ranges, sizeof(ranges) / sizeof(ranges[0]));
+    uint32_t chunks = 0;
+    for (size_t n = 0; n < count; n++)
+        chunks |= io_ee1004_range_chunks(ranges[n].offset, ranges[n].size);
+    if (chunks && !write_device(d, h->device, data, chunks, &status))
+        return status;
+    memcpy(out, data, size);
+    *out_size = size;
+    return IO_REMOTE_OK;
+}
+
+static int handle(IoServer *d, const IoRemoteHeader *h, const uint8_t *payload, uint8_t *out, size_t *out_size)
+{
+    uint8_t data[SPD_SIZE_MAX] = { 0 };
+    int status = IO_REMOTE_OK;
+    size_t size;
+    SpdInfo i;
+    *out_size = 0;
+    // The EE1004 page latch is shared by every master on the bus, BIOS, the
+    // kernel driver or a local spd-tool may have switched it meanwhile
+    d->sessions[h->device].eeprom.page = -1;
+    switch (h->code) {
+        case IO_REMOTE_READ:
+            if (!(size = read_device(d, h->device, data, &status)))
+                return status;
+            memcpy(out, data, size);
+            *out_size = size;
+            return IO_REMOTE_OK;
+        case IO_REMOTE_DECODE:
+        case IO_REMOTE_VERIFY: {
+            if (!(size = request_image(d, h, payload, data, &status)))
+                return status;
+            SpdImage image = { data, size };
+            out[0] = spd_image_decode(&i, image);
+            if (h->code == IO_REMOTE_DECODE) {
+                memcpy(out + 1, data, size);
+                *out_size = 1 + size;
+            } else {
+                put64(out + 1, data[2] == SPD_DEVICE_TYPE_DDR3 ? spd_validate(data) : 0);
+                *out_size = 9;
+            }
+            return IO_REMOTE_OK;
+        }
+        case IO_REMOTE_PATCH:
+            return patch_device(d, h, payload, out, out_size);
+        case IO_REMOTE_FLASH: {
+            size = h->size - 4;
+            if (h->size < 4 || (size != SPD_DDR3_SIZE && size != SPD_DDR4_SIZE))
+                return IO_REMOTE_BAD_REQUEST;
+            uint32_t chunks = payload[0] | (uint32_t)payload[1] << 8 | (uint32_t)payload[2] << 16 | (uint32_t)payload[3] << 24;
+            memcpy(data, payload + 4, size);
+            if (size < IO_EE1004_SIZE && chunks >> (size / IO_EE1004_WRITE_SIZE))
+                return IO_REMOTE_BAD_REQUEST;
+            return write_device(d, h->device, data, chunks, &status) ? IO_REMOTE_OK : status;
+        }
+        default:
+            return IO_REMOTE_BAD_REQUEST;
+    }
+}
+
+static bool reserve_out(IoServerConnection *c, size_t size)
+{
+    if (c->out_size + size <= c->out_capacity)
+        return true;
+    size_t capacity = c->out_capacity ? c->out_capacity : 4 * IO_SERVER_FRAME_MAX;
+    while (capacity < c->out_size + size)
+        capacity *= 2;
+    uint8_t *out = realloc(c->out, capacity);
+    if (!out)
+        return false;
+    c->out = out;
+    c->out_capacity = capacity;
+    return true;
+}
+
+bool io_server_process(IoServer *d, IoServerConnection *c)
+{
+    size_t offset = 0;
+    while (c->in_size - offset >= IO_REMOTE_HEADER_SIZE) {
+        IoRemoteHeader h;
+        if (!io_remote_unpack(&h, c->in + offset)) {
+            errno = EPROTO;
+            return false;
+        }
+        if (c->in_size - offset < IO_REMOTE_HEADER_SIZE + h.size)
+            break;
+        if (!reserve_out(c, IO_SERVER_FRAME_MAX)) {
+            errno = ENOMEM;
+            return false;
+        }
+        uint8_t *response = c->out + c->out_size;
+        size_t size;
+        IoRemoteHeader r = { 0, h.id, 0, h.device };
+        r.code = (uint8_t)handle(d, &h, c->in + offset + IO_REMOTE_HEADER_SIZE, response + IO_REMOTE_HEADER_SIZE, &size);
+        r.size = (uint32_t)size;
+        io_remote_pack(response, &r);
+        c->out_size += IO_REMOTE_HEADER_SIZE + size;
+        offset += IO_REMOTE_HEADER_SIZE + h.size;
+        d->requests++;
+    }
+    memmove(c->in, c->in + offset, c->in_size - offset);
+    c->in_size -= offset;
+    return true;
+}
+
+void io_server_connection_free(IoServerConnection *c)
+{
+    free(c->out);
+    c->out = NULL;
+    c->out_size = c->out_sent = c->out_capacity = 0;
+}
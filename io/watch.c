@@ -0,0 +1,182 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <io/watch.h>
+#include <spd/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+bool io_watch_open(IoWatch *w, const char *dir)
+{
+    w->offset = w->size = 0;
+#if __linux__
+    w->fd = inotify_init1(IN_CLOEXEC);
+    if (w->fd < 0 || inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0) {
+        int error = errno;
+        if (w->fd >= 0)
+            close(w->fd);
+        w->fd = -1;
+        errno = error;
+        return false;
+    }
+    return true;
+#else
+    (void)dir;
+    w->fd = -1;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+void io_watch_close(IoWatch *w)
+{
+#if __linux__
+    if (w->fd >= 0)
+        close(w->fd);
+#endif
+    w->fd = -1;
+}
+
+IoWatchEvent io_watch_next(IoWatch *w, char *name, size_t size, int timeout_ms)
+{
+#if __linux__
+    while (true) {
+        // One read returns many events, they are parsed from the buffer
+        while (w->offset < w->size) {
+            struct inotify_event e;
+            memcpy(&e, w->buffer + w->offset, sizeof(e));
+            const char *event_name = (const char *)w->buffer + w->offset + sizeof(e);
+            w->offset += sizeof(e) + e.len;
+            if (e.mask & IN_Q_OVERFLOW)
+                return IO_WATCH_OVERFLOW;
+            // The directory is gone
+            if (e.mask & IN_IGNORED) {
+                errno = ENOENT;
+                return IO_WATCH_ERROR;
+            }
+            if ((e.mask & IN_ISDIR) || !e.len)
+                continue;
+            snprintf(name, size, "%s", event_name);
+            return IO_WATCH_FILE;
+        }
+        struct pollfd p = { w->fd, POLLIN, 0 };
+        int ready = poll(&p, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            return ready ? IO_WATCH_ERROR : IO_WATCH_TIMEOUT;
+        ssize_t n = read(w->fd, w->buffer, sizeof(w->buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+            errno = EIO;
+        if (n <= 0)
+            return IO_WATCH_ERROR;
+        w->offset = 0;
+        w->size = (size_t)n;
+    }
+#else
+    (void)w;
+    (void)name;
+    (void)size;
+    (void)timeout_ms;
+    errno = ENOSYS;
+    return IO_WATCH_ERROR;
+#endif
+}
+
+bool io_watch_is_candidate(const char *name)
+{
+    size_t len = strlen(name);
+    return name[0] != '.' && !strchr(name, '\n') && !(len > 4 && !strcmp(name + len - 4, ".tmp"));
+}
+
+bool io_watch_state_open(IoWatchState *s, const char *path)
+{
+    spd_intern_init(&s->keys);
+    s->file = NULL;
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        char line[4096 + SPD_HASH_HEX_SIZE + 2];
+        while (fgets(line, sizeof(line), f)) {
+            size_t len = strcspn(line, "\r\n");
+            if (len && spd_intern(&s->keys, line, len) == SPD_INTERN_NONE) {
+                fclose(f);
+                spd_intern_free(&s->keys);
+                errno = ENOMEM;
+                return false;
+            }
+        }
+        fclose(f);
+    }
+    s->file = fopen(path, "ab");
+    if (!s->file)
+        spd_intern_free(&s->keys);
+    return s->file != NULL;
+}
+
+void io_watch_state_close(IoWatchState *s)
+{
+    if (s->file)
+        fclose(s->file);
+    s->file = NULL;
+    spd_intern_free(&s->keys);
+}
+
+size_t io_watch_key(char *key, size_t size, const char *name, const uint8_t *data, size_t data_size)
+{
+    char hex[SPD_HASH_HEX_SIZE];
+    spd_hash_hex(spd_hash(data, data_size), hex);
+    int len = snprintf(key, size, "%s %s", hex, name);
+    return len < 0 ? 0 : (size_t)len < size ? (size_t)len : size - 1;
+}
+
+bool io_watch_state_has(const IoWatchState *s, const char *key, size_t len)
+{
+    return spd_intern_find(&s->keys, key, len) != SPD_INTERN_NONE;
+}
+
+bool io_watch_state_add(IoWatchState *s, const char *key, size_t len)
+{
+    if (io_watch_state_has(s, key, len))
+        return true;
+    if (spd_intern(&s->keys, key, len) == SPD_INTERN_NONE) {
+        errno = ENOMEM;
+        return false;
+    }
+    if (fprintf(s->file, "%.*s\n", (int)len, key) < 0 || fflush(s->file)) {
+        if (!errno)
+            errno = EIO;
+        return false;
+    }
+    return true;
+}
@@ -31,9 +31,10 @@
 #include <windows.h>
 
 #include <stdint.h>
-#include <stdio.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
+#include <errno.h>
 
 /* Get the DLL version number, return the version number */
 static ULONG(WINAPI *CH341GetVersion)();
@@ -124,8 +125,7 @@ static BOOL CALLBACK InitCH341(PINIT_ONCE InitOnce, PVOID Parameter, PVOID *lpCo
 {
     HMODULE lib = LoadLibraryA("CH341DLLA64.DLL");
     if (!lib) {
-        DWORD err = GetLastError();
-        printf("LoadLibraryA failed: %u\n", err);
+        errno = ENOENT;
         return FALSE;
     }
     
@@ -151,6 +151,7 @@ do { \
 
 fail:
     FreeLibrary(lib);
+    errno = ENOSYS;
     return FALSE;
 }
 
@@ -193,4 +194,52 @@ size_t io_i2c_write(uint32_t id, const uint8_t *data, size_t size)
     return io_i2c_proc(id, (uint8_t *)data, size, CH341WriteEEPROM);
 }
 
+// Raw I2C streams for protocols beyond 24C02, the device is opened per transfer
+static bool i2c_stream(void *ctx, const uint8_t *out, size_t out_size, uint8_t *in, size_t in_size)
+{
+    ULONG iIndex = (ULONG)(uintptr_t)ctx;
+    if (!io_i2c_init() || !CH341OpenDevice(iIndex))
+        return false;
+    BOOL ok = CH341StreamI2C(iIndex, (ULONG)out_size, (PVOID)out, (ULONG)in_size, in);
+    CH341CloseDevice(iIndex);
+    return !!ok;
+}
+
+static bool i2c_bus_read(void *ctx, uint8_t address, uint8_t offset, uint8_t *data, size_t size)
+{
+    uint8_t out[2] = { (uint8_t)(address << 1), offset };
+    return i2c_stream(ctx, out, sizeof(out), data, size);
+}
+
+static bool i2c_bus_write(void *ctx, uint8_t address, uint8_t offset, const uint8_t *data, size_t size)
+{
+    uint8_t out[2 + 16];
+    if (size > sizeof(out) - 2)
+        return false;
+    out[0] = (uint8_t)(address << 1);
+    out[1] = offset;
+    memcpy(out + 2, data, size);
+    bool ok = i2c_stream(ctx, out, size + 2, NULL, 0);
+    // Write cycle time tWR
+    Sleep(5);
+    return ok;
+}
+
+static bool i2c_bus_command(void *ctx, uint8_t address)
+{
+    uint8_t out[3] = { (uint8_t)(address << 1), 0, 0 };
+    return i2c_stream(ctx, out, sizeof(out), NULL, 0);
+}
+
+bool io_i2c_bus(IoI2cBus *bus, uint32_t id)
+{
+    if (!io_i2c_init())
+        return false;
+    bus->ctx = (void *)(uintptr_t)id;
+    bus->read = i2c_bus_read;
+    bus->write = i2c_bus_write;
+    bus->command = i2c_bus_command;
+    return true;
+}
+
 #endif
@@ -0,0 +1,336 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/archive.h>
+#include <spd/diff.h>
+#include <spd/hash.h>
+#include <spd/bits.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAGIC "SPDARC1"
+
+// Bytes that vary between modules of one SKU: manufacturing location, date,
+// serial number and CRC. They don't take part in the template key.
+#define VOLATILE_FIRST 119
+#define VOLATILE_LAST  127
+
+// Runs split by a gap longer than this, shorter gaps are stored as bytes
+#define RUN_GAP_MAX 2
+
+// Largest encoded record: tag, run count and runs of single bytes
+#define RECORD_SIZE_MAX (10 + 1 + SPD_DDR3_SIZE * 3)
+
+static const uint8_t *varint_read(const uint8_t *p, const uint8_t *end, uint64_t *value)
+{
+    uint64_t v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint8_t *varint_write(uint8_t *p, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        *p++ = (uint8_t)(value | 0x80);
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+// Record at p: template id and the end, NULL when incomplete. Runs
+// reaching past the image set *malformed.
+static const uint8_t *record_skip(const uint8_t *p, const uint8_t *end, uint64_t *tag, bool *malformed)
+{
+    *malformed = false;
+    p = varint_read(p, end, tag);
+    if (!p)
+        return NULL;
+    if (*tag & 1)
+        return (size_t)(end - p) >= SPD_DDR3_SIZE ? p + SPD_DDR3_SIZE : NULL;
+    if (p == end)
+        return NULL;
+    size_t offset = 0;
+    for (unsigned runs = *p++; runs; runs--) {
+        if (end - p < 2)
+            return NULL;
+        size_t len = (size_t)p[1] + 1;
+        offset += p[0];
+        p += 2;
+        if (offset + len > SPD_DDR3_SIZE) {
+            *malformed = true;
+            return NULL;
+        }
+        if ((size_t)(end - p) < len)
+            return NULL;
+        offset += len;
+        p += len;
+    }
+    return p;
+}
+
+// Attached archives are validated, so records decode without bounds checks
+static const uint8_t *record_decode(const SpdArchive *a, const uint8_t *p, uint8_t image[SPD_DDR3_SIZE])
+{
+    uint64_t tag;
+    p = varint_read(p, a->data + a->size, &tag);
+    if (tag & 1) {
+        memcpy(image, p, SPD_DDR3_SIZE);
+        return p + SPD_DDR3_SIZE;
+    }
+    memcpy(image, a->templates[tag >> 1], SPD_DDR3_SIZE);
+    size_t offset = 0;
+    for (unsigned runs = *p++; runs; runs--) {
+        size_t len = (size_t)p[1] + 1;
+        offset += p[0];
+        memcpy(image + offset, p + 2, len);
+        offset += len;
+        p += 2 + len;
+    }
+    return p;
+}
+
+// Archive magic at the start of data
+bool spd_archive_check(const void *data, size_t size)
+{
+    return size >= SPD_ARCHIVE_MAGIC_SIZE && !memcmp(data, MAGIC, SPD_ARCHIVE_MAGIC_SIZE);
+}
+
+bool spd_archive_attach(SpdArchive *a, const void *data, size_t size)
+{
+    memset(a, 0, sizeof(a[0]));
+    if (!spd_archive_check(data, size))
+        return false;
+    a->data = data;
+
+    const uint8_t *p = a->data + SPD_ARCHIVE_MAGIC_SIZE, *end = a->data + size;
+    size_t offset_capacity = 0, template_capacity = 0;
+    bool ok = true;
+    while (ok && p < end) {
+        uint64_t tag;
+        bool malformed;
+        const uint8_t *next = record_skip(p, end, &tag, &malformed);
+        ok = !malformed;
+        if (!next)
+            break;
+        if (a->count % SPD_ARCHIVE_STRIDE == 0) {
+            size_t n = a->count / SPD_ARCHIVE_STRIDE;
+            if (n == offset_capacity) {
+                offset_capacity = offset_capacity ? offset_capacity * 2 : 256;
+                uint64_t *offsets = realloc(a->offsets, offset_capacity * sizeof(offsets[0]));
+                ok = offsets != NULL;
+                if (!ok)
+                    break;
+                a->offsets = offsets;
+            }
+            a->offsets[n] = (uint64_t)(p - a->data);
+        }
+        if (tag & 1) {
+            if (a->template_count == template_capacity) {
+                template_capacity = template_capacity ? template_capacity * 2 : 256;
+                const uint8_t **templates = realloc((void *)a->templates, template_capacity * sizeof(templates[0]));
+                ok = templates != NULL;
+                if (!ok)
+                    break;
+                a->templates = templates;
+            }
+            a->templates[a->template_count++] = next - SPD_DDR3_SIZE;
+        } else {
+            ok = (tag >> 1) < a->template_count;
+        }
+        a->count++;
+        p = next;
+    }
+    a->size = (size_t)(p - a->data);
+    if (!ok)
+        spd_archive_free(a);
+    return ok;
+}
+
+void spd_archive_free(SpdArchive *a)
+{
+    free((void *)a->templates);
+    free(a->offsets);
+    memset(a, 0, sizeof(a[0]));
+}
+
+size_t spd_archive_read(const SpdArchive *a, size_t index, uint8_t *images, size_t count)
+{
+    if (index >= a->count)
+        return 0;
+    if (count > a->count - index)
+        count = a->count - index;
+    const uint8_t *p = a->data + a->offsets[index / SPD_ARCHIVE_STRIDE];
+    for (size_t n = index - index % SPD_ARCHIVE_STRIDE; n < index; n++) {
+        uint64_t tag;
+        bool malformed;
+        p = record_skip(p, a->data + a->size, &tag, &malformed);
+    }
+    for (size_t n = 0; n < count; n++)
+        p = record_decode(a, p, images + n * SPD_DDR3_SIZE);
+    return count;
+}
+
+bool spd_archive_get(const SpdArchive *a, size_t index, uint8_t image[SPD_DDR3_SIZE])
+{
+    return spd_archive_read(a, index, image, 1) == 1;
+}
+
+static uint64_t template_key(const uint8_t image[SPD_DDR3_SIZE])
+{
+    uint8_t masked[SPD_DDR3_SIZE];
+    memcpy(masked, image, SPD_DDR3_SIZE);
+    memset(masked + VOLATILE_FIRST, 0, VOLATILE_LAST - VOLATILE_FIRST + 1);
+    return spd_hash(masked, SPD_DDR3_SIZE).lo;
+}
+
+static uint32_t *template_slot(SpdArchiveWriter *w, uint64_t key)
+{
+    size_t mask = w->slot_count - 1;
+    for (size_t n = (size_t)(key ^ (key >> 32)) & mask;; n = (n + 1) & mask) {
+        if (!w->slots[n] || w->keys[w->slots[n] - 1] == key)
+            return &w->slots[n];
+    }
+}
+
+static bool template_add(SpdArchiveWriter *w, const uint8_t image[SPD_DDR3_SIZE], uint64_t key)
+{
+    if (w->template_count == w->template_capacity) {
+        uint32_t capacity = w->template_capacity ? w->template_capacity * 2 : 256;
+        uint8_t *templates = realloc(w->templates, (size_t)capacity * SPD_DDR3_SIZE);
+        if (templates)
+            w->templates = templates;
+        uint64_t *keys = realloc(w->keys, capacity * sizeof(keys[0]));
+        if (keys)
+            w->keys = keys;
+        if (!templates || !keys)
+            return false;
+        w->template_capacity = capacity;
+    }
+    if ((w->template_count + 1) * 2 > w->slot_count) {
+        size_t count = w->slot_count ? w->slot_count * 2 : 512;
+        uint32_t *slots = calloc(count, sizeof(slots[0]));
+        if (!slots)
+            return false;
+        free(w->slots);
+        w->slots = slots;
+        w->slot_count = count;
+        for (uint32_t n = 0; n < w->template_count; n++) {
+            uint32_t *slot = template_slot(w, w->keys[n]);
+            if (!*slot)
+                *slot = n + 1;
+        }
+    }
+    memcpy(w->templates + (size_t)w->template_count * SPD_DDR3_SIZE, image, SPD_DDR3_SIZE);
+    w->keys[w->template_count] = key;
+    uint32_t *slot = template_slot(w, key);
+    if (!*slot)
+        *slot = w->template_count + 1;
+    w->template_count++;
+    return true;
+}
+
+bool spd_archive_writer_open(SpdArchiveWriter *w, FILE *f, const SpdArchive *existing)
+{
+    memset(w, 0, sizeof(w[0]));
+    w->file = f;
+    if (!existing) {
+        if (fwrite(MAGIC, SPD_ARCHIVE_MAGIC_SIZE, 1, f) != 1)
+            return false;
+        w->size = SPD_ARCHIVE_MAGIC_SIZE;
+        return true;
+    }
+    for (uint32_t n = 0; n < existing->template_count; n++) {
+        if (!template_add(w, existing->templates[n], template_key(existing->templates[n]))) {
+            spd_archive_writer_close(w);
+            return false;
+        }
+    }
+    w->records = existing->count;
+    w->size = existing->size;
+    return true;
+}
+
+bool spd_archive_append(SpdArchiveWriter *w, const uint8_t image[SPD_DDR3_SIZE])
+{
+    uint8_t record[RECORD_SIZE_MAX], *p = record;
+    uint64_t key = template_key(image);
+    uint32_t slot = w->slots ? *template_slot(w, key) : 0;
+    if (!slot) {
+        if (!template_add(w, image, key))
+            return false;
+        p = varint_write(p, 1);
+        memcpy(p, image, SPD_DDR3_SIZE);
+        p += SPD_DDR3_SIZE;
+    } else {
+        const uint8_t *t = w->templates + (size_t)(slot - 1) * SPD_DDR3_SIZE;
+        uint64_t changed[SPD_DIFF_WORDS];
+        p = varint_write(p, (uint64_t)(slot - 1) * 2);
+        uint8_t *runs = p++;
+        *runs = 0;
+        if (spd_diff(t, image, changed)) {
+            int first = -1, last = -1, done = 0;
+            for (int word = 0; word <= SPD_DIFF_WORDS; word++) {
+                uint64_t bits = word < SPD_DIFF_WORDS ? changed[word] : 1;
+                for (; bits; bits &= bits - 1) {
+                    int n = word * 64 + spd_ctz64(bits);
+                    // Close the current run on a long gap or at the end
+                    if (first >= 0 && (n == SPD_DDR3_SIZE || n - last > RUN_GAP_MAX + 1)) {
+                        *p++ = (uint8_t)(first - done);
+                        *p++ = (uint8_t)(last - first);
+                        memcpy(p, image + first, (size_t)(last - first + 1));
+                        p += last - first + 1;
+                        done = last + 1;
+                        (*runs)++;
+                        first = -1;
+                    }
+                    if (n == SPD_DDR3_SIZE)
+                        break;
+                    if (first < 0)
+                        first = n;
+                    last = n;
+                }
+            }
+        }
+    }
+    size_t size = (size_t)(p - record);
+    if (fwrite(record, size, 1, w->file) != 1)
+        return false;
+    w->records++;
+    w->size += size;
+    return true;
+}
+
+void spd_archive_writer_close(SpdArchiveWriter *w)
+{
+    free(w->templates);
+    free(w->keys);
+    free(w->slots);
+    memset(w, 0, sizeof(w[0]));
+}
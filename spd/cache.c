@@ -0,0 +1,92 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/cache.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define WAYS 4
+
+struct SpdCacheEntry
+{
+    SpdHash hash;
+    uint64_t tick;  // 0 - empty entry
+    bool ok;
+    SpdInfo info;
+};
+
+bool spd_cache_init(SpdCache *c, size_t capacity)
+{
+    memset(c, 0, sizeof(c[0]));
+    size_t sets = 1;
+    while (sets * WAYS < capacity)
+        sets *= 2;
+    c->entries = calloc(sets * WAYS, sizeof(c->entries[0]));
+    if (!c->entries)
+        return false;
+    c->set_mask = sets - 1;
+    return true;
+}
+
+void spd_cache_free(SpdCache *c)
+{
+    free(c->entries);
+    memset(c, 0, sizeof(c[0]));
+}
+
+bool spd_cache_decode(SpdCache *c, SpdInfo *i, const uint8_t data[SPD_DDR3_SIZE])
+{
+    SpdHash h = spd_hash(data, SPD_DDR3_SIZE);
+    SpdCacheEntry *set = c->entries + (h.lo & c->set_mask) * WAYS;
+    SpdCacheEntry *victim = set;
+    for (int n = 0; n < WAYS; n++) {
+        SpdCacheEntry *e = set + n;
+        if (e->tick && spd_hash_equal(e->hash, h)) {
+            e->tick = ++c->tick;
+            c->stats.hits++;
+            *i = e->info;
+            return e->ok;
+        }
+        if (e->tick < victim->tick)
+            victim = e;
+    }
+
+    c->stats.misses++;
+    c->stats.evictions += victim->tick != 0;
+    victim->hash = h;
+    victim->tick = ++c->tick;
+    victim->ok = spd_decode(&victim->info, data);
+    *i = victim->info;
+    return victim->ok;
+}
+
+size_t spd_cache_decode_batch(SpdCache *c, SpdInfo *i, bool *ok, const uint8_t *images, size_t count, size_t stride)
+{
+    size_t decoded = 0;
+    for (size_t n = 0; n < count; n++) {
+        ok[n] = spd_cache_decode(c, i + n, images + n * stride);
+        decoded += ok[n];
+    }
+    return decoded;
+}
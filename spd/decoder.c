@@ -0,0 +1,146 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/decoder.h>
+
+#include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#define U &spd_decoder_unsupported
+#define U16 U, U, U, U, U, U, U, U, U, U, U, U, U, U, U, U
+
+const SpdDecoder *spd_decoder_table[256] = {
+    U, U, U, U, U, U, U, U, &spd_decoder_ddr2, U, U, &spd_decoder_ddr3, &spd_decoder_ddr4, U, U, U,
+    U16, U16, U16, U16, U16, U16, U16, U16, U16, U16, U16, U16, U16, U16, U16
+};
+
+#undef U16
+#undef U
+
+const SpdDecoder *spd_decoder_register(uint8_t device_type, const SpdDecoder *d)
+{
+    const SpdDecoder *old = spd_decoder_table[device_type];
+    spd_decoder_table[device_type] = d ? d : &spd_decoder_unsupported;
+    return old;
+}
+
+size_t spd_image_size(const uint8_t *data, size_t size)
+{
+    size_t full = spd_decoder_find(data[2])->size;
+    return size >= full ? full : SPD_DDR3_SIZE;
+}
+
+bool spd_decode(SpdInfo *i, const uint8_t data[SPD_DDR3_SIZE])
+{
+    return spd_decoder_find(data[2])->decode(i, data, SPD_DDR3_SIZE);
+}
+
+// A DDR4 page 0 alone decodes without the part number
+bool spd_decode_ex(SpdInfo *i, const uint8_t *data, size_t size)
+{
+    return spd_decoder_find(data[2])->decode(i, data, size);
+}
+
+bool spd_image_decode(SpdInfo *i, SpdImage image)
+{
+    return spd_decoder_find(image.data[2])->decode(i, image.data, image.size);
+}
+
+// Mixed generations, one table lookup per image. ok is optional, returns
+// the number of images decoded without errors.
+size_t spd_image_decode_batch(SpdInfo *i, bool *ok, const SpdImage *images, size_t count)
+{
+    size_t decoded = 0;
+    for (size_t n = 0; n < count; n++) {
+        bool result = spd_decoder_find(images[n].data[2])->decode(i + n, images[n].data, images[n].size);
+        if (ok)
+            ok[n] = result;
+        decoded += result;
+    }
+    return decoded;
+}
+
+void spd_text_printf(SpdText *t, const char *format, ...)
+{
+    size_t left = t->length < t->size ? t->size - t->length : 0;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(left ? t->buf + t->length : NULL, left, format, args);
+    va_end(args);
+    if (n > 0) {
+        t->length += (size_t)n;
+    }
+}
+
+size_t spd_format(const SpdInfo *i, bool verbose, char *buf, size_t size)
+{
+    SpdText t = { buf, size, 0 };
+    if (size) {
+        buf[0] = '\0';
+    }
+    spd_decoder_find((uint8_t)i->DRAM_Device_Type)->format(i, verbose, &t);
+    return t.length;
+}
+
+SpdError spd_info_error(const SpdInfo *i)
+{
+    if (spd_decoder_find((uint8_t)i->DRAM_Device_Type) == &spd_decoder_unsupported) {
+        return SPD_ERROR_UNSUPPORTED;
+    }
+    return spd_crc_ok(i) ? SPD_OK : SPD_ERROR_CRC;
+}
+
+const char *spd_error_text(SpdError e)
+{
+    switch (e) {
+    case SPD_OK: return "OK";
+    case SPD_ERROR_CRC: return "CRC mismatch";
+    case SPD_ERROR_UNSUPPORTED: return "Unsupported device type";
+    }
+    return "Unknown error";
+}
+
+bool spd_fix_crc(uint8_t data[SPD_DDR3_SIZE], SpdInfo *i)
+{
+    return spd_decoder_find((uint8_t)i->DRAM_Device_Type)->fix_crc(data, i);
+}
+
+size_t spd_encode(const SpdInfo *i, uint8_t data[SPD_SIZE_MAX])
+{
+    const SpdDecoder *d = spd_decoder_find((uint8_t)i->DRAM_Device_Type);
+    return d->encode && d->encode(i, data, NULL) ? d->size : 0;
+}
+
+size_t spd_encode_mask(int device_type, uint8_t mask[SPD_SIZE_MAX])
+{
+    const SpdDecoder *d = spd_decoder_find((uint8_t)device_type);
+    memset(mask, 0, SPD_SIZE_MAX);
+    if (!d->encode)
+        return 0;
+    SpdInfo i;
+    memset(&i, 0, sizeof(i));
+    i.DRAM_Device_Type = device_type;
+    d->encode(&i, NULL, mask);
+    return d->size;
+}
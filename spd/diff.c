@@ -0,0 +1,332 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/diff.h>
+#include <spd/bits.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIFF_SSE2
+#endif
+
+typedef char spd_signature_fit[SPD_FIELD_COUNT <= 32 && SPD_REGION_COUNT <= 32 ? 1 : -1];
+
+#define LSH_BANDS 16
+#define LSH_BITS  20
+
+static const struct { int first, last; const char *name; } spd_regions[SPD_REGION_COUNT] = {
+#define SPD_X(ID, first, last, name) { first, last, name },
+    SPD_REGIONS(SPD_X)
+#undef SPD_X
+};
+
+static inline uint64_t load64(const uint8_t *p)
+{
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+#ifndef DIFF_SSE2
+// Non-zero byte flags of a word: bit n is set when byte n of x is non-zero
+static inline unsigned nonzero_bytes(uint64_t x)
+{
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7full;
+    uint64_t high = (((x & low7) + low7) | x) & ~low7;
+    return (unsigned)(((high >> 7) * 0x0102040810204080ull) >> 56);
+}
+#endif
+
+int spd_diff(const uint8_t a[SPD_DDR3_SIZE], const uint8_t b[SPD_DDR3_SIZE], uint64_t changed[SPD_DIFF_WORDS])
+{
+    int count = 0;
+    for (int w = 0; w < SPD_DIFF_WORDS; w++) {
+        uint64_t bits = 0;
+#ifdef DIFF_SSE2
+        for (int n = 0; n < 64; n += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(a + w * 64 + n));
+            __m128i y = _mm_loadu_si128((const __m128i *)(b + w * 64 + n));
+            unsigned equal = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+            bits |= (uint64_t)(~equal & 0xffff) << n;
+        }
+#else
+        for (int n = 0; n < 64; n += 8)
+            bits |= (uint64_t)nonzero_bytes(load64(a + w * 64 + n) ^ load64(b + w * 64 + n)) << n;
+#endif
+        changed[w] = bits;
+        count += spd_popcount64(bits);
+    }
+    return count;
+}
+
+int spd_distance(const uint8_t a[SPD_DDR3_SIZE], const uint8_t b[SPD_DDR3_SIZE])
+{
+    int d0 = 0, d1 = 0, d2 = 0, d3 = 0;
+    for (int n = 0; n < SPD_DDR3_SIZE; n += 32) {
+        d0 += spd_popcount64(load64(a + n) ^ load64(b + n));
+        d1 += spd_popcount64(load64(a + n + 8) ^ load64(b + n + 8));
+        d2 += spd_popcount64(load64(a + n + 16) ^ load64(b + n + 16));
+        d3 += spd_popcount64(load64(a + n + 24) ^ load64(b + n + 24));
+    }
+    return d0 + d1 + d2 + d3;
+}
+
+SpdRegion spd_region(int byte)
+{
+    for (int r = 0; r < SPD_REGION_COUNT; r++) {
+        if (byte <= spd_regions[r].last)
+            return (SpdRegion)r;
+    }
+    return SPD_REGION_CUSTOMER;
+}
+
+const char *spd_region_name(SpdRegion r)
+{
+    return (unsigned)r < SPD_REGION_COUNT ? spd_regions[r].name : NULL;
+}
+
+uint64_t spd_diff_signature(const uint8_t a[SPD_DDR3_SIZE], const uint8_t b[SPD_DDR3_SIZE])
+{
+    uint64_t changed[SPD_DIFF_WORDS];
+    if (!spd_diff(a, b, changed))
+        return 0;
+
+    // Bits described by fields
+    uint8_t covered[SPD_DDR3_SIZE] = {0};
+    uint64_t signature = 0;
+    for (int f = 0; f < SPD_FIELD_COUNT; f++) {
+        const SpdFieldInfo *fi = spd_field_info((SpdField)f);
+        unsigned mask = ((1u << fi->width) - 1) << fi->shift;
+        covered[fi->byte] |= (uint8_t)mask;
+        if ((a[fi->byte] ^ b[fi->byte]) & mask)
+            signature |= SPD_SIGNATURE_FIELD(f);
+    }
+    for (int w = 0; w < SPD_DIFF_WORDS; w++) {
+        for (uint64_t bits = changed[w]; bits; bits &= bits - 1) {
+            int n = w * 64 + spd_ctz64(bits);
+            unsigned outside = (unsigned)(a[n] ^ b[n]) & ~(unsigned)covered[n];
+            if (outside)
+                signature |= SPD_SIGNATURE_REGION(spd_region(n));
+        }
+    }
+    return signature;
+}
+
+// Bucket table: (band, key) -> chain of cluster ids
+typedef struct Buckets
+{
+    uint64_t *keys;
+    uint32_t *heads;        // entry + 1, 0 - empty slot
+    size_t capacity;
+    size_t used;
+    uint32_t *next;         // entry + 1
+    uint32_t *ids;
+    size_t entries;
+    size_t entry_capacity;
+} Buckets;
+
+static inline size_t bucket_hash(uint64_t key)
+{
+    key *= 0x9e3779b97f4a7c15ull;
+    return (size_t)(key ^ (key >> 29));
+}
+
+static uint32_t *bucket_slot(Buckets *t, uint64_t key)
+{
+    size_t mask = t->capacity - 1;
+    for (size_t n = bucket_hash(key) & mask;; n = (n + 1) & mask) {
+        if (!t->heads[n] || t->keys[n] == key) {
+            t->keys[n] = key;
+            return &t->heads[n];
+        }
+    }
+}
+
+static bool buckets_grow(Buckets *t)
+{
+    Buckets old = *t;
+    t->capacity = old.capacity ? old.capacity * 2 : 1024;
+    t->keys = malloc(t->capacity * sizeof(t->keys[0]));
+    t->heads = calloc(t->capacity, sizeof(t->heads[0]));
+    if (!t->keys || !t->heads) {
+        free(t->keys);
+        free(t->heads);
+        t->keys = old.keys;
+        t->heads = old.heads;
+        t->capacity = old.capacity;
+        return false;
+    }
+    for (size_t n = 0; n < old.capacity; n++) {
+        if (old.heads[n])
+            *bucket_slot(t, old.keys[n]) = old.heads[n];
+    }
+    free(old.keys);
+    free(old.heads);
+    return true;
+}
+
+static bool buckets_add(Buckets *t, uint64_t key, uint32_t id)
+{
+    if ((t->used + 1) * 2 > t->capacity && !buckets_grow(t))
+        return false;
+    if (t->entries == t->entry_capacity) {
+        size_t capacity = t->entry_capacity ? t->entry_capacity * 2 : 1024;
+        uint32_t *next = realloc(t->next, capacity * sizeof(next[0]));
+        if (next)
+            t->next = next;
+        uint32_t *ids = realloc(t->ids, capacity * sizeof(ids[0]));
+        if (ids)
+            t->ids = ids;
+        if (!next || !ids)
+            return false;
+        t->entry_capacity = capacity;
+    }
+    uint32_t *head = bucket_slot(t, key);
+    if (!*head)
+        t->used++;
+    t->ids[t->entries] = id;
+    t->next[t->entries] = *head;
+    *head = (uint32_t)++t->entries;
+    return true;
+}
+
+static uint32_t bucket_find(const Buckets *t, uint64_t key)
+{
+    size_t mask = t->capacity - 1;
+    for (size_t n = bucket_hash(key) & mask; t->heads[n]; n = (n + 1) & mask) {
+        if (t->keys[n] == key)
+            return t->heads[n];
+    }
+    return 0;
+}
+
+static void buckets_free(Buckets *t)
+{
+    free(t->keys);
+    free(t->heads);
+    free(t->next);
+    free(t->ids);
+}
+
+static inline uint64_t band_key(const uint8_t *image, int band, const uint16_t bits[LSH_BITS])
+{
+    uint64_t key = 0;
+    for (int k = 0; k < LSH_BITS; k++)
+        key |= (uint64_t)((image[bits[k] >> 3] >> (bits[k] & 7)) & 1) << k;
+    return key | (uint64_t)band << 32;
+}
+
+static bool cluster_add(SpdClustering *c, size_t *capacity, size_t image)
+{
+    if (c->count == *capacity) {
+        size_t n = *capacity ? *capacity * 2 : 256;
+        size_t *leader = realloc(c->leader, n * sizeof(leader[0]));
+        if (leader)
+            c->leader = leader;
+        size_t *size = realloc(c->size, n * sizeof(size[0]));
+        if (size)
+            c->size = size;
+        if (!leader || !size)
+            return false;
+        *capacity = n;
+    }
+    c->leader[c->count] = image;
+    c->size[c->count] = 1;
+    c->cluster[image] = (uint32_t)c->count++;
+    return true;
+}
+
+bool spd_cluster(SpdClustering *c, const uint8_t *images, size_t count, int max_distance)
+{
+    memset(c, 0, sizeof(c[0]));
+    if (count > UINT32_MAX - 1)
+        return false;
+    c->cluster = malloc((count ? count : 1) * sizeof(c->cluster[0]));
+    uint32_t *seen = calloc(count ? count : 1, sizeof(seen[0]));
+    if (!c->cluster || !seen) {
+        free(seen);
+        spd_cluster_free(c);
+        return false;
+    }
+
+    // Fixed pseudo-random bit samples, one per band
+    uint16_t bits[LSH_BANDS][LSH_BITS];
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for (int b = 0; b < LSH_BANDS; b++) {
+        for (int k = 0; k < LSH_BITS; k++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            bits[b][k] = (uint16_t)(x % (SPD_DDR3_SIZE * 8));
+        }
+    }
+
+    Buckets t = {0};
+    size_t capacity = 0;
+    bool ok = buckets_grow(&t);
+    for (size_t n = 0; n < count && ok; n++) {
+        const uint8_t *image = images + n * SPD_DDR3_SIZE;
+        uint64_t keys[LSH_BANDS];
+        uint32_t best = UINT32_MAX;
+        int best_distance = max_distance + 1;
+        for (int b = 0; b < LSH_BANDS; b++) {
+            keys[b] = band_key(image, b, bits[b]);
+            for (uint32_t e = bucket_find(&t, keys[b]); e; e = t.next[e - 1]) {
+                uint32_t id = t.ids[e - 1];
+                if (seen[id] == n + 1)
+                    continue;
+                seen[id] = (uint32_t)(n + 1);
+                c->comparisons++;
+                int d = spd_distance(image, images + c->leader[id] * SPD_DDR3_SIZE);
+                if (d < best_distance) {
+                    best_distance = d;
+                    best = id;
+                }
+            }
+        }
+        if (best != UINT32_MAX) {
+            c->cluster[n] = best;
+            c->size[best]++;
+            continue;
+        }
+        ok = cluster_add(c, &capacity, n);
+        for (int b = 0; b < LSH_BANDS && ok; b++)
+            ok = buckets_add(&t, keys[b], (uint32_t)(c->count - 1));
+    }
+    buckets_free(&t);
+    free(seen);
+    if (!ok)
+        spd_cluster_free(c);
+    return ok;
+}
+
+void spd_cluster_free(SpdClustering *c)
+{
+    free(c->cluster);
+    free(c->leader);
+    free(c->size);
+    memset(c, 0, sizeof(c[0]));
+}
@@ -0,0 +1,237 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/fingerprint.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAGIC "SPDFPR1"
+#define FINGERPRINT_MASK ((1u << 30) - 1)
+#define CLASS_SHIFT 30
+#define BUILD_TRIES 64
+
+typedef struct Header
+{
+    char magic[8];
+    uint64_t count;
+    uint64_t seed;
+    uint32_t segment;
+    uint32_t reserved;
+} Header;
+
+typedef struct Key
+{
+    SpdHash hash;
+    uint8_t cls;
+} Key;
+
+static uint64_t fmix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint32_t reduce(uint32_t x, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+// Slot in each of the 3 segments and the 30-bit fingerprint of a hash
+static inline uint32_t locate(SpdHash h, uint64_t seed, uint32_t segment, uint32_t slot[3])
+{
+    uint64_t x = fmix(h.lo ^ seed) ^ h.hi;
+    slot[0] = reduce((uint32_t)x, segment);
+    slot[1] = segment + reduce((uint32_t)(x >> 21 | x << 43), segment);
+    slot[2] = 2 * segment + reduce((uint32_t)(x >> 42 | x << 22), segment);
+    return (uint32_t)fmix(x + seed) & FINGERPRINT_MASK;
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+    const Key *x = a, *y = b;
+    if (x->hash.hi != y->hash.hi)
+        return x->hash.hi < y->hash.hi ? -1 : 1;
+    if (x->hash.lo != y->hash.lo)
+        return x->hash.lo < y->hash.lo ? -1 : 1;
+    return (int)x->cls - (int)y->cls;
+}
+
+// Peels the 3-hypergraph of keys; on success order[] holds keys with the
+// slot each one owns, last peeled first to assign
+static bool peel(const Key *keys, size_t count, uint64_t seed, uint32_t segment,
+                 uint32_t *degree, uint32_t *xor_key, uint32_t *queue, uint32_t (*order)[2])
+{
+    size_t slots = 3 * (size_t)segment;
+    memset(degree, 0, slots * sizeof(degree[0]));
+    memset(xor_key, 0, slots * sizeof(xor_key[0]));
+    for (size_t k = 0; k < count; k++) {
+        uint32_t slot[3];
+        locate(keys[k].hash, seed, segment, slot);
+        for (int n = 0; n < 3; n++) {
+            degree[slot[n]]++;
+            xor_key[slot[n]] ^= (uint32_t)k;
+        }
+    }
+    size_t head = 0, tail = 0, peeled = 0;
+    for (size_t s = 0; s < slots; s++) {
+        if (degree[s] == 1)
+            queue[tail++] = (uint32_t)s;
+    }
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        if (degree[s] != 1)
+            continue;
+        uint32_t k = xor_key[s];
+        order[peeled][0] = k;
+        order[peeled][1] = s;
+        peeled++;
+        uint32_t slot[3];
+        locate(keys[k].hash, seed, segment, slot);
+        for (int n = 0; n < 3; n++) {
+            degree[slot[n]]--;
+            xor_key[slot[n]] ^= k;
+            if (degree[slot[n]] == 1)
+                queue[tail++] = slot[n];
+        }
+    }
+    return peeled == count;
+}
+
+bool spd_fingerprint_build(SpdFingerprints *f, const SpdHash *hashes, const uint8_t *classes, size_t count)
+{
+    memset(f, 0, sizeof(f[0]));
+    if (count >= UINT32_MAX / 4)
+        return false;
+
+    // Distinct keys, bad wins over good for the same hash
+    Key *keys = malloc((count ? count : 1) * sizeof(keys[0]));
+    if (!keys)
+        return false;
+    for (size_t n = 0; n < count; n++) {
+        keys[n].hash = hashes[n];
+        keys[n].cls = classes[n];
+    }
+    qsort(keys, count, sizeof(keys[0]), compare_keys);
+    size_t unique = 0;
+    for (size_t n = 0; n < count; n++) {
+        if (unique && spd_hash_equal(keys[unique - 1].hash, keys[n].hash))
+            keys[unique - 1].cls = keys[n].cls;
+        else
+            keys[unique++] = keys[n];
+    }
+
+    uint32_t segment = (uint32_t)(unique * 123 / 300) + 32;
+    size_t slots = 3 * (size_t)segment;
+    size_t size = sizeof(Header) + slots * sizeof(uint32_t);
+    uint32_t *degree = malloc(slots * sizeof(degree[0]));
+    uint32_t *xor_key = malloc(slots * sizeof(xor_key[0]));
+    uint32_t *queue = malloc(3 * (unique + slots) * sizeof(queue[0]));
+    uint32_t (*order)[2] = malloc((unique ? unique : 1) * sizeof(order[0]));
+    uint8_t *data = calloc(1, size);
+    bool ok = degree && xor_key && queue && order && data;
+
+    uint64_t seed = 0;
+    bool peeled = false;
+    for (int t = 0; ok && !peeled && t < BUILD_TRIES; t++) {
+        seed = fmix(seed + 0x9e3779b97f4a7c15ull);
+        peeled = peel(keys, unique, seed, segment, degree, xor_key, queue, order);
+    }
+    ok = ok && peeled;
+    if (ok) {
+        Header *h = (Header *)data;
+        memcpy(h->magic, MAGIC, sizeof(h->magic));
+        h->count = unique;
+        h->seed = seed;
+        h->segment = segment;
+        uint32_t *table = (uint32_t *)(data + sizeof(Header));
+        for (size_t n = unique; n-- > 0;) {
+            const Key *k = &keys[order[n][0]];
+            uint32_t slot[3];
+            uint32_t value = locate(k->hash, seed, segment, slot) | (uint32_t)k->cls << CLASS_SHIFT;
+            table[order[n][1]] = value ^ table[slot[0]] ^ table[slot[1]] ^ table[slot[2]];
+        }
+        ok = spd_fingerprint_attach(f, data, size);
+    }
+    if (ok)
+        f->owned = data;
+    else
+        free(data);
+    free(keys);
+    free(degree);
+    free(xor_key);
+    free(queue);
+    free(order);
+    return ok;
+}
+
+bool spd_fingerprint_attach(SpdFingerprints *f, const void *data, size_t size)
+{
+    memset(f, 0, sizeof(f[0]));
+    const Header *h = data;
+    if (size < sizeof(Header) || memcmp(h->magic, MAGIC, sizeof(h->magic)) || !h->segment
+        || (size - sizeof(Header)) / sizeof(uint32_t) != 3 * (uint64_t)h->segment)
+        return false;
+    f->data = data;
+    f->size = size;
+    f->count = h->count;
+    f->seed = h->seed;
+    f->segment = h->segment;
+    f->slots = (const uint32_t *)((const uint8_t *)data + sizeof(Header));
+    return true;
+}
+
+bool spd_fingerprint_write(const SpdFingerprints *f, FILE *file)
+{
+    return fwrite(f->data, 1, f->size, file) == f->size;
+}
+
+void spd_fingerprint_free(SpdFingerprints *f)
+{
+    free(f->owned);
+    memset(f, 0, sizeof(f[0]));
+}
+
+SpdClass spd_fingerprint_probe_hash(const SpdFingerprints *f, SpdHash h)
+{
+    uint32_t slot[3];
+    uint32_t fingerprint = locate(h, f->seed, f->segment, slot);
+    uint32_t value = f->slots[slot[0]] ^ f->slots[slot[1]] ^ f->slots[slot[2]];
+    if ((value & FINGERPRINT_MASK) != fingerprint)
+        return SPD_CLASS_UNKNOWN;
+    uint32_t cls = value >> CLASS_SHIFT;
+    return cls == SPD_CLASS_GOOD || cls == SPD_CLASS_BAD ? (SpdClass)cls : SPD_CLASS_UNKNOWN;
+}
+
+const char *spd_class_name(SpdClass c)
+{
+    switch (c) {
+        case SPD_CLASS_GOOD: return "known-good";
+        case SPD_CLASS_BAD: return "known-bad";
+        default: return "new";
+    }
+}
@@ -0,0 +1,92 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/hash.h>
+
+#include <stdio.h>
+
+#define P1 0x9e3779b185ebca87ull
+#define P2 0xc2b2ae3d27d4eb4full
+#define P3 0x165667b19e3779f9ull
+
+static uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t load64(const uint8_t *p)
+{
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24
+        | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static uint64_t fmix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+SpdHash spd_hash(const uint8_t *data, size_t size)
+{
+    uint64_t a = P3 ^ size, b = P1 ^ size;
+    for (; size >= 16; size -= 16, data += 16) {
+        a = rotl(a ^ load64(data) * P1, 27) * P2 + b;
+        b = rotl(b ^ load64(data + 8) * P2, 31) * P1 + a;
+    }
+    uint8_t tail[16] = {0};
+    for (size_t n = 0; n < size; n++)
+        tail[n] = data[n];
+    a = rotl(a ^ load64(tail) * P1, 27) * P2 + b;
+    b = rotl(b ^ load64(tail + 8) * P2, 31) * P1 + a;
+
+    SpdHash h;
+    h.lo = fmix(a + b);
+    h.hi = fmix(b ^ rotl(a, 17));
+    return h;
+}
+
+void spd_hash_hex(SpdHash h, char hex[SPD_HASH_HEX_SIZE])
+{
+    snprintf(hex, SPD_HASH_HEX_SIZE, "%016llx%016llx", (unsigned long long)h.hi, (unsigned long long)h.lo);
+}
+
+bool spd_hash_parse(SpdHash *h, const char *hex)
+{
+    uint64_t v[2] = {0, 0};
+    for (int n = 0; n < 32; n++) {
+        char c = hex[n];
+        int d = c >= '0' && c <= '9' ? c - '0'
+            : c >= 'a' && c <= 'f' ? c - 'a' + 10
+            : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (d < 0)
+            return false;
+        v[n / 16] = v[n / 16] << 4 | (uint64_t)d;
+    }
+    h->hi = v[0];
+    h->lo = v[1];
+    return true;
+}
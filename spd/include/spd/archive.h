@@ -0,0 +1,95 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Delta-compressed archive: an append-only stream of records, each either
+// a template image (the first image of a SKU) or a sparse delta against a
+// template as offset/length/bytes runs. Images of one SKU usually differ
+// only in the date, serial number and CRC, so a record takes ~12 bytes.
+//
+// Layout: "SPDARC1\0", then records of
+//   varint tag: template id * 2 for a delta, 1 for a new template
+//   template:   SPD_DDR3_SIZE bytes
+//   delta:      u8 run count, then per run u8 gap from the previous run end,
+//               u8 length - 1 and the run bytes
+#define SPD_ARCHIVE_MAGIC_SIZE 8
+
+// Record offsets are kept for every SPD_ARCHIVE_STRIDE records, random
+// access skips at most SPD_ARCHIVE_STRIDE - 1 record headers
+#define SPD_ARCHIVE_STRIDE 64
+
+// Read-only view of an archive image in memory, e.g. a mapped file
+typedef struct SpdArchive
+{
+    const uint8_t *data;
+    size_t size;            // bytes of complete records, less on a torn tail
+    size_t count;
+    const uint8_t **templates;
+    uint32_t template_count;
+    uint64_t *offsets;
+} SpdArchive;
+
+typedef struct SpdArchiveWriter
+{
+    FILE *file;
+    uint8_t *templates;
+    uint32_t template_count;
+    uint32_t template_capacity;
+    uint64_t *keys;
+    uint32_t *slots;        // template id + 1, 0 - empty
+    size_t slot_count;
+
+    uint64_t records;
+    uint64_t size;          // bytes written, header included
+} SpdArchiveWriter;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool spd_archive_check(const void *data, size_t size);
+bool spd_archive_attach(SpdArchive *a, const void *data, size_t size);
+void spd_archive_free(SpdArchive *a);
+bool spd_archive_get(const SpdArchive *a, size_t index, uint8_t image[SPD_DDR3_SIZE]);
+size_t spd_archive_read(const SpdArchive *a, size_t index, uint8_t *images, size_t count);
+
+bool spd_archive_writer_open(SpdArchiveWriter *w, FILE *f, const SpdArchive *existing);
+bool spd_archive_append(SpdArchiveWriter *w, const uint8_t image[SPD_DDR3_SIZE]);
+void spd_archive_writer_close(SpdArchiveWriter *w);
+
+static inline double spd_archive_ratio(uint64_t records, uint64_t size)
+{
+    return size ? (double)records * SPD_DDR3_SIZE / (double)size : 0.0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,71 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+#include <spd/hash.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct SpdCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} SpdCacheStats;
+
+typedef struct SpdCacheEntry SpdCacheEntry;
+
+// Decode memoization keyed by the image content hash.
+// Fixed capacity, 4-way set associative with LRU replacement in a set.
+// Not thread-safe: use one cache per thread.
+typedef struct SpdCache
+{
+    SpdCacheEntry *entries;
+    size_t set_mask;
+    uint64_t tick;
+    SpdCacheStats stats;
+} SpdCache;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool spd_cache_init(SpdCache *c, size_t capacity);
+void spd_cache_free(SpdCache *c);
+
+bool spd_cache_decode(SpdCache *c, SpdInfo *i, const uint8_t data[SPD_DDR3_SIZE]);
+size_t spd_cache_decode_batch(SpdCache *c, SpdInfo *i, bool *ok, const uint8_t *images, size_t count, size_t stride);
+
+static inline double spd_cache_hit_rate(const SpdCacheStats *s)
+{
+    uint64_t total = s->hits + s->misses;
+    return total ? (double)s->hits / (double)total : 0.0;
+}
+
+#ifdef __cplusplus
+}
+#endif
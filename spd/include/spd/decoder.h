@@ -0,0 +1,84 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Growing text sink for SpdDecoder.format. length counts the whole text,
+// buf holds what fits and stays NUL terminated, as with snprintf().
+typedef struct SpdText
+{
+    char *buf;
+    size_t size;
+    size_t length;
+} SpdText;
+
+// Per-generation SPD decoder. The registry holds one decoder per DRAM
+// device type (byte 2), unknown types map to spd_decoder_unsupported, so a
+// lookup is a single table load without branches.
+typedef struct SpdDecoder
+{
+    const char *name;
+    size_t size;                // whole image size
+    // Fills i, false for CRC errors and unsupported devices. size is at
+    // least SPD_DDR3_SIZE.
+    bool (*decode)(SpdInfo *i, const uint8_t *data, size_t size);
+    // Appends the human readable description to t
+    void (*format)(const SpdInfo *i, bool verbose, SpdText *t);
+    // Rewrites the stored CRC or checksum from the decoded real one
+    bool (*fix_crc)(uint8_t *data, SpdInfo *i);
+    // Inverse of decode, see spd_encode(). Bits written to data are also
+    // set in mask, either may be NULL. NULL if the generation can't encode.
+    bool (*encode)(const SpdInfo *i, uint8_t *data, uint8_t *mask);
+} SpdDecoder;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const SpdDecoder spd_decoder_unsupported;
+extern const SpdDecoder spd_decoder_ddr2;
+extern const SpdDecoder spd_decoder_ddr3;
+extern const SpdDecoder spd_decoder_ddr4;
+
+extern const SpdDecoder *spd_decoder_table[256];
+
+void spd_text_printf(SpdText *t, const char *format, ...);
+
+static inline const SpdDecoder *spd_decoder_find(uint8_t device_type)
+{
+    return spd_decoder_table[device_type];
+}
+
+// Not thread-safe, register before decoding. NULL restores
+// spd_decoder_unsupported. Returns the replaced decoder.
+const SpdDecoder *spd_decoder_register(uint8_t device_type, const SpdDecoder *d);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,93 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Changed byte bitmap of two images: bit n of word n / 64 is byte n
+#define SPD_DIFF_WORDS (SPD_DDR3_SIZE / 64)
+
+// Named byte ranges of the DDR3 SPD layout for bytes outside SPD_FIELDS
+#define SPD_REGIONS(X) \
+    X(GENERAL,       0,  59, "General Configuration") \
+    X(MODULE,       60, 116, "Module Specific") \
+    X(MANUFACTURER, 117, 118, "Module Manufacturer ID") \
+    X(LOCATION,     119, 119, "Module Manufacturing Location") \
+    X(DATE,         120, 121, "Module Manufacturing Date") \
+    X(SERIAL,       122, 125, "Module Serial Number") \
+    X(CRC,          126, 127, "CRC") \
+    X(PART_NUMBER,  128, 145, "Module Part Number") \
+    X(REVISION,     146, 147, "Module Revision Code") \
+    X(DRAM_MAKER,   148, 149, "DRAM Manufacturer ID") \
+    X(VENDOR,       150, 175, "Manufacturer Specific Data") \
+    X(CUSTOMER,     176, 255, "Open For Customer Use")
+
+typedef enum SpdRegion
+{
+#define SPD_X(ID, ...) SPD_REGION_##ID,
+    SPD_REGIONS(SPD_X)
+#undef SPD_X
+    SPD_REGION_COUNT
+} SpdRegion;
+
+// Changed-field signature: SpdField bits, then SpdRegion bits for changes
+// outside every field
+#define SPD_SIGNATURE_FIELD(f)  (1ull << (f))
+#define SPD_SIGNATURE_REGION(r) (1ull << (32 + (r)))
+
+// Leader clustering by Hamming distance: every image joins the nearest
+// cluster leader within max_distance bits or starts a new cluster.
+// Leaders are only compared when they share an LSH band (a fixed sample
+// of image bits), so the cost grows with the number of near candidates
+// instead of N^2; an image may rarely start a cluster it could join.
+typedef struct SpdClustering
+{
+    uint32_t *cluster;      // per image cluster id
+    size_t *leader;         // per cluster leader image index
+    size_t *size;           // per cluster image count
+    size_t count;
+    uint64_t comparisons;
+} SpdClustering;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int spd_diff(const uint8_t a[SPD_DDR3_SIZE], const uint8_t b[SPD_DDR3_SIZE], uint64_t changed[SPD_DIFF_WORDS]);
+int spd_distance(const uint8_t a[SPD_DDR3_SIZE], const uint8_t b[SPD_DDR3_SIZE]);
+uint64_t spd_diff_signature(const uint8_t a[SPD_DDR3_SIZE], const uint8_t b[SPD_DDR3_SIZE]);
+
+SpdRegion spd_region(int byte);
+const char *spd_region_name(SpdRegion r);
+
+bool spd_cluster(SpdClustering *c, const uint8_t *images, size_t count, int max_distance);
+void spd_cluster_free(SpdClustering *c);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,79 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+#include <spd/hash.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum SpdClass
+{
+    SPD_CLASS_UNKNOWN,
+    SPD_CLASS_GOOD,
+    SPD_CLASS_BAD
+} SpdClass;
+
+// Static set of known image hashes with a class per image: an xor filter
+// of 32-bit entries, 30 bits of fingerprint and 2 bits of class. A probe
+// reads 3 entries, unknown images match with 2^-30 probability. Like the
+// corpus index, the serialized form is what spd_fingerprint_write()
+// stores, so a set file can be mapped and attached without parsing.
+typedef struct SpdFingerprints
+{
+    const uint8_t *data;
+    size_t size;
+    uint8_t *owned;
+
+    uint64_t count;
+    uint64_t seed;
+    uint32_t segment;
+    const uint32_t *slots;
+} SpdFingerprints;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Keys are image hashes; a hash listed as both good and bad is bad
+bool spd_fingerprint_build(SpdFingerprints *f, const SpdHash *keys, const uint8_t *classes, size_t count);
+bool spd_fingerprint_attach(SpdFingerprints *f, const void *data, size_t size);
+bool spd_fingerprint_write(const SpdFingerprints *f, FILE *file);
+void spd_fingerprint_free(SpdFingerprints *f);
+
+SpdClass spd_fingerprint_probe_hash(const SpdFingerprints *f, SpdHash h);
+
+static inline SpdClass spd_fingerprint_probe(const SpdFingerprints *f, const uint8_t image[SPD_DDR3_SIZE])
+{
+    return spd_fingerprint_probe_hash(f, spd_hash(image, SPD_DDR3_SIZE));
+}
+
+const char *spd_class_name(SpdClass c);
+
+#ifdef __cplusplus
+}
+#endif
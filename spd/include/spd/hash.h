@@ -0,0 +1,55 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Fast non-cryptographic 128-bit content hash of SPD images.
+// The result doesn't depend on the host byte order, so it can be stored.
+typedef struct SpdHash
+{
+    uint64_t lo;
+    uint64_t hi;
+} SpdHash;
+
+#define SPD_HASH_HEX_SIZE 33
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+SpdHash spd_hash(const uint8_t *data, size_t size);
+void spd_hash_hex(SpdHash h, char hex[SPD_HASH_HEX_SIZE]);
+bool spd_hash_parse(SpdHash *h, const char *hex);
+
+static inline bool spd_hash_equal(SpdHash a, SpdHash b)
+{
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,110 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+#include <spd/hash.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Corpus: a flat file of SPD_DDR3_SIZE byte images, record N at N * SPD_DDR3_SIZE
+
+// Query keys beyond the SPD_FIELDS ones
+#define SPD_KEY_CAPACITY    (SPD_FIELD_COUNT + 0)
+#define SPD_KEY_PART        (SPD_FIELD_COUNT + 1)
+#define SPD_KEY_CRC         (SPD_FIELD_COUNT + 2)
+#define SPD_KEY_CL          (SPD_FIELD_COUNT + 3)
+#define SPD_KEY_TIMING(t)   (SPD_FIELD_COUNT + 4 + (t))
+#define SPD_KEY_COUNT       (SPD_FIELD_COUNT + 4 + SPD_TIMING_COUNT)
+
+#define SPD_INDEX_COLUMNS_MAX 16
+
+// Bitmap column: one bitmap over all records per distinct value
+typedef struct SpdIndexColumn
+{
+    int key;
+    uint32_t values;
+    const int32_t *value;
+    const uint64_t *bitmaps;
+} SpdIndexColumn;
+
+typedef struct SpdIndexPart
+{
+    uint32_t name;
+    uint32_t postings;
+    uint32_t count;
+} SpdIndexPart;
+
+// Secondary indexes over a corpus: bitmaps on small enum fields and a
+// sorted part number dictionary with posting lists. The serialized form
+// is what spd_index_write() stores, so an index file can be mapped and
+// attached without parsing. The corpus size and content hash tell whether
+// the index still describes a corpus, a patch keeps the size.
+typedef struct SpdIndex
+{
+    const uint8_t *data;
+    size_t size;
+    uint8_t *owned;
+
+    uint64_t corpus_size;
+    SpdHash corpus_hash;
+    uint64_t count;
+    size_t words;
+
+    SpdIndexColumn columns[SPD_INDEX_COLUMNS_MAX];
+    uint32_t column_count;
+
+    const SpdIndexPart *parts;
+    uint32_t part_count;
+    const char *names;
+    const uint32_t *postings;
+} SpdIndex;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline size_t spd_bitmap_words(size_t count)
+{
+    return (count + 63) / 64;
+}
+
+bool spd_index_build(SpdIndex *x, const uint8_t *images, size_t count);
+bool spd_index_attach(SpdIndex *x, const void *data, size_t size);
+bool spd_index_write(const SpdIndex *x, FILE *f);
+void spd_index_free(SpdIndex *x);
+
+const SpdIndexColumn *spd_index_column(const SpdIndex *x, int key);
+
+static inline const char *spd_index_part_name(const SpdIndex *x, uint32_t part)
+{
+    return x->names + x->parts[part].name;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,84 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+#include <spd/packed.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SPD_INTERN_NONE UINT32_MAX
+
+typedef struct SpdInternBlock SpdInternBlock;
+
+// String interning table: maps part numbers to stable 32-bit ids.
+// Strings live in an append-only block arena, so pointers returned by
+// spd_intern_str() stay valid until spd_intern_free().
+typedef struct SpdIntern
+{
+    SpdInternBlock *blocks;
+    const char **strs;
+    uint32_t *lens;
+    uint32_t *hashes;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;
+    uint32_t slot_mask;
+} SpdIntern;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void spd_intern_init(SpdIntern *t);
+void spd_intern_free(SpdIntern *t);
+
+uint32_t spd_intern(SpdIntern *t, const char *s, size_t len);
+uint32_t spd_intern_find(const SpdIntern *t, const char *s, size_t len);
+
+static inline uint32_t spd_intern_count(const SpdIntern *t)
+{
+    return t->count;
+}
+
+static inline const char *spd_intern_str(const SpdIntern *t, uint32_t id)
+{
+    return id < t->count ? t->strs[id] : NULL;
+}
+
+static inline size_t spd_intern_len(const SpdIntern *t, uint32_t id)
+{
+    return id < t->count ? t->lens[id] : 0;
+}
+
+uint32_t spd_intern_part(SpdIntern *t, const SpdInfo *i);
+// False for non-DDR3 modules, see spd_pack()
+bool spd_pack_interned(SpdPacked *p, const SpdInfo *i, SpdIntern *t);
+void spd_unpack_interned(SpdInfo *i, const SpdPacked *p, const SpdIntern *t);
+
+#ifdef __cplusplus
+}
+#endif
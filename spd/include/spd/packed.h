@@ -0,0 +1,95 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bit offsets of the SPD_FIELDS raw values inside SpdPacked::fields
+enum SpdPackedLayout
+{
+#define SPD_X(ID, key, member, byte, shift, width, ...) \
+    SPD_PACKED_##ID, SPD_PACKED_##ID##_END = SPD_PACKED_##ID + (width) - 1,
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+    SPD_PACKED_HAS_CAPACITY,
+    SPD_PACKED_BITS
+};
+
+// Compact 16-byte SpdInfo of DDR3 modules for large in-memory inventories.
+// Module_Capacity is derived from the fields, the part number is held as
+// a caller-defined handle (e.g. an interned string id). Timings aren't
+// packed, spd_unpack() leaves them zero.
+typedef struct SpdPacked
+{
+    uint64_t fields;
+    uint16_t crc;
+    uint16_t crc_real;
+    uint32_t part;
+} SpdPacked;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Raw field accessors: spd_packed_ranks(p), spd_packed_voltage(p), ...
+#define SPD_X(ID, key, member, byte, shift, width, ...) \
+static inline int spd_packed_##key(const SpdPacked *p) \
+{ \
+    return (int)((p->fields >> SPD_PACKED_##ID) & ((1u << (width)) - 1)); \
+}
+SPD_FIELDS(SPD_X)
+#undef SPD_X
+
+static inline int spd_packed_capacity(const SpdPacked *p)
+{
+    if (!((p->fields >> SPD_PACKED_HAS_CAPACITY) & 1))
+        return 0;
+    return spd_capacity(spd_packed_sdram_capacity(p), spd_packed_bus_width(p), spd_packed_ranks(p), spd_packed_sdram_width(p));
+}
+
+static inline bool spd_packed_crc_ok(const SpdPacked *p)
+{
+    return p->crc == p->crc_real;
+}
+
+// Mask and value for one-compare filters over several fields:
+// (p->fields & mask) == value
+uint64_t spd_packed_mask(SpdField f);
+uint64_t spd_packed_value(SpdField f, int raw);
+int spd_packed_field(const SpdPacked *p, SpdField f);
+
+// The layout has the DDR3 field widths, other device types would lose
+// fields: false and EINVAL for them
+bool spd_pack(SpdPacked *p, const SpdInfo *i, uint32_t part);
+void spd_unpack(SpdInfo *i, const SpdPacked *p, const char *part_number);
+
+size_t spd_packed_filter(const SpdPacked *p, size_t count, uint64_t mask, uint64_t value, uint32_t *matches);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,77 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+#include <spd/query.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bulk patch rules, one per line, '#' starts a comment:
+//   WHERE => EDIT...
+// WHERE is a query expression (spd/query.h) or '*' for every image, EDITs
+// are spd/txn.h edits separated by spaces, double quotes keep spaces in
+// text. Rules are evaluated against the unpatched image, the edits of all
+// matching rules are one transaction with a single CRC recompute.
+//   part~'GR1600*' && crc=ok => byte6.bit1=0
+#define SPD_PATCH_RULES_MAX 32
+#define SPD_PATCH_EDITS_MAX 16
+#define SPD_PATCH_EDIT_SIZE 64
+
+typedef struct SpdPatchRule
+{
+    SpdQuery where;
+    bool all;
+    int line;
+    int edit_count;
+    char edits[SPD_PATCH_EDITS_MAX][SPD_PATCH_EDIT_SIZE];
+} SpdPatchRule;
+
+typedef struct SpdPatch
+{
+    SpdPatchRule rules[SPD_PATCH_RULES_MAX];
+    int count;
+} SpdPatch;
+
+typedef struct SpdPatchResult
+{
+    uint32_t matched;           // bit N - rule N
+    bool changed;
+    bool failed;                // an edit doesn't apply, the image is unchanged
+} SpdPatchResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Edits are checked against the DDR3 layout. On error line is the rule
+// line and error points into it.
+bool spd_patch_parse(SpdPatch *p, const char *text, int *line, const char **error);
+SpdPatchResult spd_patch_apply(const SpdPatch *p, uint8_t image[SPD_DDR3_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
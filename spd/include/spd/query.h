@@ -0,0 +1,89 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+#include <spd/index.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Inventory query language:
+//   EXPR := AND ('||' AND)*
+//   AND  := TERM ('&&' TERM)*
+//   TERM := KEY OP VALUE
+//   KEY  := SPD_FIELDS key | capacity | part | crc | cl | SPD_TIMINGS key
+//   OP   := = != < <= > >= ~
+// Text fields compare by the leading words of their text, e.g.
+// voltage=1.35/1.5 or module_type=SO-DIMM, numeric fields compare the
+// mapped value (ranks=2, capacity>=8192). '~' is a glob match with '*'
+// and '?', e.g. part~'GR1600*'. crc takes ok or err. Timings compare in
+// picoseconds (tck<=1250), cl is the CAS latency at tCKmin.
+
+typedef enum SpdQueryOp
+{
+    SPD_OP_EQ,
+    SPD_OP_NE,
+    SPD_OP_LT,
+    SPD_OP_LE,
+    SPD_OP_GT,
+    SPD_OP_GE,
+    SPD_OP_MATCH
+} SpdQueryOp;
+
+#define SPD_QUERY_TERMS_MAX 32
+#define SPD_QUERY_TEXT_MAX 64
+
+typedef struct SpdQueryTerm
+{
+    int key;
+    SpdQueryOp op;
+    int group;
+    bool numeric;
+    int number;
+    char text[SPD_QUERY_TEXT_MAX];
+    uint8_t truth[256];  // precomputed verdicts by raw field value
+} SpdQueryTerm;
+
+typedef struct SpdQuery
+{
+    SpdQueryTerm terms[SPD_QUERY_TERMS_MAX];
+    int count;
+    int groups;
+} SpdQuery;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool spd_query_parse(SpdQuery *q, const char *expr, const char **error);
+bool spd_query_match(const SpdQuery *q, const uint8_t image[SPD_DDR3_SIZE]);
+size_t spd_query_run(const SpdQuery *q, const SpdIndex *x, const uint8_t *images, size_t count, uint64_t *result);
+
+bool spd_glob(const char *pattern, const char *s, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,77 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Per-unit manufacturing fields stamped on a template image for production
+// runs: location, date (BCD year and week) and a 4-byte serial stored most
+// significant byte first.
+// DDR3: bytes 119 ~ 125, the tail of the CRC range unless byte 0 bit 7 is set
+// DDR4: bytes 322 ~ 328, outside the CRC blocks
+#define SPD_UNIT_SIZE 7
+
+typedef struct SpdUnit
+{
+    uint8_t location;
+    uint8_t year;               // 0 ~ 99
+    uint8_t week;               // 1 ~ 53
+    uint32_t serial;
+} SpdUnit;
+
+// CRC16 is linear with a zero initial value, so the CRC of a unit image is
+// the CRC of the template with zeroed unit bytes (the constant prefix state
+// carried over them) xor the contributions of every unit byte by position.
+// A unit then costs a copy of the template and 7 table lookups.
+typedef struct SpdSerializer
+{
+    uint8_t image[SPD_SIZE_MAX];
+    size_t size;
+    size_t offset;              // first unit byte
+    size_t crc_offset;          // stored CRC of the covering block, 0 if none
+    uint16_t prefix;            // CRC state after the constant prefix
+    uint16_t base;              // CRC with zeroed unit bytes
+    uint16_t table[SPD_UNIT_SIZE][256];
+} SpdSerializer;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// DDR3 or DDR4 template, a DDR4 template needs both pages
+bool spd_serializer_init(SpdSerializer *s, const uint8_t *image, size_t size);
+void spd_unit_from_image(const SpdSerializer *s, SpdUnit *u);
+
+void spd_serialize(const SpdSerializer *s, const SpdUnit *u, uint8_t *out);
+// Serials u->serial ~ u->serial + count - 1 with the same location and
+// date, image n at out + n * s->size
+void spd_serialize_range(const SpdSerializer *s, const SpdUnit *u, size_t count, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
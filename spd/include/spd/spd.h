@@ -28,46 +28,267 @@
 #include <stdbool.h>
 #include <stddef.h>
 
-#define SPD_SIZE_MAX 256
+// DDR3 images and corpus records are 256 bytes, DDR4 EE1004 images are
+// two 256-byte pages
+#define SPD_DDR3_SIZE 256
+#define SPD_DDR4_SIZE 512
+#define SPD_SIZE_MAX SPD_DDR4_SIZE
+
+#define SPD_DEVICE_TYPE_DDR2 8
+#define SPD_DEVICE_TYPE_DDR3 11
+#define SPD_DEVICE_TYPE_DDR4 12
+
+// JEDEC Standard No. 21-C
+// Annex K: Serial Presence Detect (SPD) for DDR3 SDRAM Modules
+//
+// SPD bit fields, the single place where a field is described:
+// X(ID, key, member, byte, shift, width, valid, kind, map, label, format)
+//   ID      - SpdField enumerator suffix
+//   key     - short field name used in tool expressions
+//   member  - SpdInfo member holding the raw value
+//   byte    - SPD byte offset
+//   shift   - bit offset inside the byte
+//   width   - bit width
+//   valid   - bitmask of defined raw values, 0 - not checked
+//   kind    - value mapping: RAW (none), INT or STR (table lookup)
+//   map     - mapping table suffix, ignored for RAW
+//   label   - human readable field name
+//   format  - printf format of the mapped value
+#define SPD_FIELDS(X) \
+    X(CRC_COVERAGE,       crc_coverage,       CRC_Coverage,                   0, 7, 1, 0x0003, INT, crc_coverage,   "CRC Coverage",                   "0...%d") \
+    X(BYTES_TOTAL,        bytes_total,        SPD_Bytes_Total,                0, 4, 3, 0x0002, INT, bytes_total,    "Bytes total",                    "%d bytes") \
+    X(BYTES_USED,         bytes_used,         SPD_Bytes_Used,                 0, 0, 4, 0x000e, INT, bytes_used,     "Bytes used",                     "%d bytes") \
+    X(REVISION_ENCODING,  revision_encoding,  SPD_Revision_Encoding_Level,    1, 4, 4, 0,      RAW, none,           "Revision Encoding Level",        "%d") \
+    X(REVISION_ADDITIONS, revision_additions, SPD_Revision_Additions_Level,   1, 0, 4, 0,      RAW, none,           "Revision Additions Level",       "%d") \
+    X(DEVICE_TYPE,        device_type,        DRAM_Device_Type,               2, 0, 8, 0,      STR, device_type,    "DRAM Device Type",               "%s") \
+    X(MODULE_TYPE,        module_type,        Module_Type,                    3, 0, 4, 0x3ffe, STR, module_type,    "Module Type",                    "%s") \
+    X(SDRAM_CAPACITY,     sdram_capacity,     Total_SDRAM_capacity,           4, 0, 4, 0x00ff, INT, sdram_capacity, "Total SDRAM capacity",           "%d Mbits") \
+    X(BANK_BITS,          bank_bits,          Bank_Address_Bits,              4, 4, 3, 0x000f, INT, bank_bits,      "Bank Address Bits",              "%d bits") \
+    X(COLUMN_BITS,        column_bits,        Column_Address_Bits,            5, 0, 3, 0x000f, INT, column_bits,    "Column Address Bits",            "%d bits") \
+    X(ROW_BITS,           row_bits,           Row_Address_Bits,               5, 3, 3, 0x001f, INT, row_bits,       "Row Address Bits",               "%d bits") \
+    X(VOLTAGE,            voltage,            Module_Minimum_Nominal_Voltage, 6, 0, 3, 0x00fd, STR, voltage,        "Module Minimum Nominal Voltage", "%s") \
+    X(SDRAM_WIDTH,        sdram_width,        SDRAM_Device_Width,             7, 0, 3, 0x000f, INT, sdram_width,    "SDRAM Device Width",             "%d") \
+    X(RANKS,              ranks,              Number_of_Ranks,                7, 3, 3, 0x001f, INT, ranks,          "Number of Ranks",                "%d") \
+    X(BUS_WIDTH,          bus_width,          Primary_bus_width,              8, 0, 3, 0x000f, INT, bus_width,      "Primary bus width",              "%d") \
+    X(BUS_WIDTH_EXT,      bus_width_ext,      Bus_width_extension,            8, 3, 2, 0x0003, INT, bus_width_ext,  "Bus width extension",            "%d")
+
+// JEDEC Standard No. 21-C
+// Annex L: Serial Presence Detect (SPD) for DDR4 SDRAM Modules
+//
+// DDR4 layout of the same fields, same columns as SPD_FIELDS. Members hold
+// DDR4 raw encodings, mapped values and derived members are comparable.
+#define SPD_DDR4_FIELDS(X) \
+    X(BYTES_TOTAL,        bytes_total,        SPD_Bytes_Total,                0, 4, 3, 0x0006, INT, ddr4_bytes_total,    "Bytes total",                    "%d bytes") \
+    X(BYTES_USED,         bytes_used,         SPD_Bytes_Used,                 0, 0, 4, 0x001e, INT, ddr4_bytes_used,     "Bytes used",                     "%d bytes") \
+    X(REVISION_ENCODING,  revision_encoding,  SPD_Revision_Encoding_Level,    1, 4, 4, 0,      RAW, none,                "Revision Encoding Level",        "%d") \
+    X(REVISION_ADDITIONS, revision_additions, SPD_Revision_Additions_Level,   1, 0, 4, 0,      RAW, none,                "Revision Additions Level",       "%d") \
+    X(DEVICE_TYPE,        device_type,        DRAM_Device_Type,               2, 0, 8, 0,      STR, device_type,         "DRAM Device Type",               "%s") \
+    X(MODULE_TYPE,        module_type,        Module_Type,                    3, 0, 4, 0x337e, STR, ddr4_module_type,    "Module Type",                    "%s") \
+    X(SDRAM_CAPACITY,     sdram_capacity,     Total_SDRAM_capacity,           4, 0, 4, 0x03ff, INT, ddr4_sdram_capacity, "Total SDRAM capacity",           "%d Mbits") \
+    X(BANK_BITS,          bank_bits,          Bank_Address_Bits,              4, 4, 2, 0x0003, INT, ddr4_bank_bits,      "Bank Address Bits",              "%d banks") \
+    X(BANK_GROUP_BITS,    bank_group_bits,    Bank_Group_Bits,                4, 6, 2, 0x0007, INT, ddr4_bank_groups,    "Bank Group Bits",                "%d groups") \
+    X(COLUMN_BITS,        column_bits,        Column_Address_Bits,            5, 0, 3, 0x000f, INT, column_bits,         "Column Address Bits",            "%d bits") \
+    X(ROW_BITS,           row_bits,           Row_Address_Bits,               5, 3, 3, 0x007f, INT, ddr4_row_bits,       "Row Address Bits",               "%d bits") \
+    X(VOLTAGE,            voltage,            Module_Minimum_Nominal_Voltage, 11, 0, 2, 0x000a, STR, ddr4_voltage,       "Module Nominal Voltage",         "%s") \
+    X(SDRAM_WIDTH,        sdram_width,        SDRAM_Device_Width,             12, 0, 3, 0x000f, INT, sdram_width,        "SDRAM Device Width",             "%d") \
+    X(RANKS,              ranks,              Number_of_Ranks,                12, 3, 3, 0x00ff, INT, ddr4_ranks,         "Number of Ranks",                "%d") \
+    X(BUS_WIDTH,          bus_width,          Primary_bus_width,              13, 0, 3, 0x000f, INT, bus_width,          "Primary bus width",              "%d") \
+    X(BUS_WIDTH_EXT,      bus_width_ext,      Bus_width_extension,            13, 3, 2, 0x0003, INT, bus_width_ext,      "Bus width extension",            "%d")
+
+// JEDEC Standard No. 21-C
+// Annex J: Serial Presence Detect (SPD) for DDR2 SDRAM Modules
+//
+// DDR2 layout, same columns as SPD_FIELDS. Most DDR2 fields are whole
+// bytes holding the value itself.
+#define SPD_DDR2_FIELDS(X) \
+    X(BYTES_USED,         bytes_used,         SPD_Bytes_Used,                 0, 0, 8, 0,      RAW, none,             "Bytes used",                     "%d bytes") \
+    X(BYTES_TOTAL,        bytes_total,        SPD_Bytes_Total,                1, 0, 4, 0,      INT, ddr2_bytes_total, "Bytes total",                    "%d bytes") \
+    X(DEVICE_TYPE,        device_type,        DRAM_Device_Type,               2, 0, 8, 0,      STR, device_type,      "DRAM Device Type",               "%s") \
+    X(ROW_BITS,           row_bits,           Row_Address_Bits,               3, 0, 5, 0,      RAW, none,             "Row Address Bits",               "%d bits") \
+    X(COLUMN_BITS,        column_bits,        Column_Address_Bits,            4, 0, 4, 0,      RAW, none,             "Column Address Bits",            "%d bits") \
+    X(RANKS,              ranks,              Number_of_Ranks,                5, 0, 3, 0,      INT, ddr2_ranks,       "Number of Ranks",                "%d") \
+    X(BUS_WIDTH,          bus_width,          Primary_bus_width,              6, 0, 8, 0,      RAW, none,             "Module Data Width",              "%d") \
+    X(VOLTAGE,            voltage,            Module_Minimum_Nominal_Voltage, 8, 0, 4, 0x003f, STR, ddr2_voltage,     "Voltage Interface Level",        "%s") \
+    X(SDRAM_WIDTH,        sdram_width,        SDRAM_Device_Width,             13, 0, 8, 0,     RAW, none,             "SDRAM Device Width",             "%d") \
+    X(BANK_BITS,          bank_bits,          Bank_Address_Bits,              17, 0, 8, 0,     RAW, none,             "Banks per SDRAM Device",         "%d banks") \
+    X(MODULE_TYPE,        module_type,        Module_Type,                    20, 0, 6, 0,     STR, ddr2_module_type, "Module Type",                    "%s")
+
+typedef enum SpdField
+{
+#define SPD_X(ID, ...) SPD_FIELD_##ID,
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+    SPD_FIELD_COUNT
+} SpdField;
+
+// Timing parameters, bytes 9 ~ 38: MTB counts with optional upper bits and
+// a signed FTB fine correction, decoded to picoseconds with integer math
+// X(ID, key, member, lsb, msb, msb_shift, msb_width, fine, label)
+//   lsb       - byte offset of the low 8 bits
+//   msb       - byte offset of the upper bits, msb_width 0 if none
+//   fine      - byte offset of the FTB correction, 0 if none
+#define SPD_TIMINGS(X) \
+    X(TCK,  tck,  tCKmin,  12, 12, 0, 0, 34, "Cycle Time (tCKmin)") \
+    X(TAA,  taa,  tAAmin,  16, 16, 0, 0, 35, "CAS Latency Time (tAAmin)") \
+    X(TWR,  twr,  tWRmin,  17, 17, 0, 0,  0, "Write Recovery (tWRmin)") \
+    X(TRCD, trcd, tRCDmin, 18, 18, 0, 0, 36, "RAS to CAS Delay (tRCDmin)") \
+    X(TRRD, trrd, tRRDmin, 19, 19, 0, 0,  0, "Row to Row Delay (tRRDmin)") \
+    X(TRP,  trp,  tRPmin,  20, 20, 0, 0, 37, "Row Precharge (tRPmin)") \
+    X(TRAS, tras, tRASmin, 22, 21, 0, 4,  0, "Active to Precharge (tRASmin)") \
+    X(TRC,  trc,  tRCmin,  23, 21, 4, 4, 38, "Active to Active (tRCmin)") \
+    X(TRFC, trfc, tRFCmin, 24, 25, 0, 8,  0, "Refresh Recovery (tRFCmin)") \
+    X(TWTR, twtr, tWTRmin, 26, 26, 0, 0,  0, "Write to Read (tWTRmin)") \
+    X(TRTP, trtp, tRTPmin, 27, 27, 0, 0,  0, "Read to Precharge (tRTPmin)") \
+    X(TFAW, tfaw, tFAWmin, 29, 28, 0, 4,  0, "Four Activate Window (tFAWmin)")
+
+// DDR4 timings, same columns as SPD_TIMINGS with the 125 ps MTB and 1 ps
+// FTB of byte 17. tRRD, tWTR and tRFC are the short/same bank group and
+// 1x refresh variants, lsb 0 marks a timing DDR4 SPD doesn't describe.
+#define SPD_DDR4_TIMINGS(X) \
+    X(TCK,  tck,  tCKmin,  18, 18, 0, 0, 125, "Cycle Time (tCKAVGmin)") \
+    X(TAA,  taa,  tAAmin,  24, 24, 0, 0, 123, "CAS Latency Time (tAAmin)") \
+    X(TWR,  twr,  tWRmin,  42, 41, 0, 4,   0, "Write Recovery (tWRmin)") \
+    X(TRCD, trcd, tRCDmin, 25, 25, 0, 0, 122, "RAS to CAS Delay (tRCDmin)") \
+    X(TRRD, trrd, tRRDmin, 38, 38, 0, 0, 119, "Row to Row Delay (tRRD_Smin)") \
+    X(TRP,  trp,  tRPmin,  26, 26, 0, 0, 121, "Row Precharge (tRPmin)") \
+    X(TRAS, tras, tRASmin, 28, 27, 0, 4,   0, "Active to Precharge (tRASmin)") \
+    X(TRC,  trc,  tRCmin,  29, 27, 4, 4, 120, "Active to Active (tRCmin)") \
+    X(TRFC, trfc, tRFCmin, 30, 31, 0, 8,   0, "Refresh Recovery (tRFC1min)") \
+    X(TWTR, twtr, tWTRmin, 44, 43, 0, 4,   0, "Write to Read (tWTR_Smin)") \
+    X(TRTP, trtp, tRTPmin,  0,  0, 0, 0,   0, "Read to Precharge (tRTPmin)") \
+    X(TFAW, tfaw, tFAWmin, 37, 36, 0, 4,   0, "Four Activate Window (tFAWmin)")
+
+typedef enum SpdTiming
+{
+#define SPD_X(ID, ...) SPD_TIMING_##ID,
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+    SPD_TIMING_COUNT
+} SpdTiming;
+
+typedef enum SpdFieldKind
+{
+    SPD_KIND_RAW,
+    SPD_KIND_INT,
+    SPD_KIND_STR
+} SpdFieldKind;
+
+typedef struct SpdFieldInfo
+{
+    const char *key;
+    const char *label;
+    int byte;
+    int shift;
+    int width;
+    SpdFieldKind kind;
+} SpdFieldInfo;
+
+// Image with an explicit size: SPD_DDR3_SIZE for DDR2/DDR3 and DDR4 page 0,
+// SPD_DDR4_SIZE for a whole DDR4 EEPROM
+typedef struct SpdImage
+{
+    const uint8_t *data;
+    size_t size;
+} SpdImage;
 
 typedef struct SpdInfo
 {
-    bool CRC_Coverage;
-    int SPD_Bytes_Total;
-    int SPD_Bytes_Used;
-    struct {
-        int Encoding_Level;
-        int Additions_Level;
-    } SPD_Revision;
-    int DRAM_Device_Type;
-    int Module_Type;
-    int Total_SDRAM_capacity;
-    int Bank_Address_Bits;
-    int Row_Address_Bits;
-    int Column_Address_Bits;
-    int Module_Minimum_Nominal_Voltage;
-    int SDRAM_Device_Width;
-    int Number_of_Ranks;
-    int Primary_bus_width;
-    int Bus_width_extension;
+#define SPD_X(ID, key, member, ...) int member;
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
     int Module_Capacity;
-    char Module_Part_Number[145 - 128 + 1 + 1];
+    char Module_Part_Number[348 - 329 + 1 + 1];    // DDR3 128 ~ 145, DDR4 329 ~ 348
 
     int CRC;
     int CRC_real;
+
+    // Timings in picoseconds and in clocks at tCKmin
+    int Medium_Timebase_fs;
+    int Fine_Timebase_fs;
+#define SPD_X(ID, key, member, ...) int member;
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+#define SPD_X(ID, key, member, ...) int member##_nCK;
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+    // Stored MTB counts and FTB corrections, DDR3 and DDR4 only. spd_encode()
+    // writes them back while they still give the timing in picoseconds.
+#define SPD_X(ID, key, member, ...) int member##_MTB; int member##_FTB;
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+    int CAS_Latencies_Supported;    // bit N - CL N
+    int CAS_Latency;                // lowest supported CL for tAAmin at tCKmin, 0 if none
+
+    // DDR4 only: bank groups and the CRC of block 1, bytes 128 ~ 253.
+    // DDR2 keeps its byte 63 checksum in CRC and CRC_real.
+    int Bank_Group_Bits;
+    int CRC_Module;
+    int CRC_Module_real;
 } SpdInfo;
 
+typedef enum SpdError
+{
+    SPD_OK,
+    SPD_ERROR_CRC,
+    SPD_ERROR_UNSUPPORTED,
+} SpdError;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-bool spd_decode(SpdInfo *i, const uint8_t data[SPD_SIZE_MAX]);
-void spd_print(const SpdInfo* i, bool verbose);
+int spd_crc16(const uint8_t *data, size_t size);
+int spd_crc16_update(int crc, const uint8_t *data, size_t size);
+int spd_capacity(int sdram_capacity, int bus_width, int ranks, int sdram_width);
+
+// Generation specific calls dispatch on the device type, see spd/decoder.h
+size_t spd_image_size(const uint8_t *data, size_t size);
+bool spd_decode(SpdInfo *i, const uint8_t data[SPD_DDR3_SIZE]);
+bool spd_decode_ex(SpdInfo *i, const uint8_t *data, size_t size);
+bool spd_image_decode(SpdInfo *i, SpdImage image);
+size_t spd_image_decode_batch(SpdInfo *i, bool *ok, const SpdImage *images, size_t count);
+// Describes i into buf like snprintf(), returns the full text length
+size_t spd_format(const SpdInfo *i, bool verbose, char *buf, size_t size);
+// Why spd_decode() returned false for i
+SpdError spd_info_error(const SpdInfo *i);
+const char *spd_error_text(SpdError e);
+
+bool spd_crc_ok(const SpdInfo *i);
+bool spd_fix_crc(uint8_t data[SPD_DDR3_SIZE], SpdInfo *i);
+bool spd_enable_lp(uint8_t byte[SPD_DDR3_SIZE], SpdInfo *i, bool enable);
+
+const SpdFieldInfo *spd_field_info(SpdField f);
+SpdField spd_field_find(const char *key);
+int spd_field_value(SpdField f, int raw);
+const char *spd_field_text(SpdField f, int raw);
+int spd_field_format(SpdField f, int raw, char *buf, size_t size);
+// Field of the device type's own layout by key
+const SpdFieldInfo *spd_field_locate(int device_type, const char *key);
+int spd_field_raw(int device_type, const char *key, int value);
+
+int spd_timing_ps(const uint8_t data[SPD_DDR3_SIZE], SpdTiming t);
+int spd_timing_clocks(int ps, int tck_ps);
+const char *spd_timing_key(SpdTiming t);
+const char *spd_timing_label(SpdTiming t);
+int spd_cas_latencies(const uint8_t data[SPD_DDR3_SIZE]);
+int spd_cas_latency(int supported, int taa_ps, int tck_ps);
+void spd_decode_timings(SpdInfo *i, const uint8_t data[SPD_DDR3_SIZE]);
 
-bool spd_fix_crc(uint8_t data[SPD_SIZE_MAX], SpdInfo *i);
-bool spd_enable_lp(uint8_t byte[SPD_SIZE_MAX], SpdInfo *i, bool enable);
+// Inverse of spd_decode(): writes the bits described by i over data and
+// recomputes the CRC, other bits are kept. Returns the image size, 0 for
+// unsupported devices and timebases that have no encoding. For an image x
+// with a valid CRC and a defined timebase, encoding decode(x) over x gives
+// x. With CAS latencies up to 30, encoding over zeros gives x for the bits
+// of spd_encode_mask(), except for DDR4 images in the low CL range with no
+// latency below CL 23: without data the high range is used for them.
+size_t spd_encode(const SpdInfo *i, uint8_t data[SPD_SIZE_MAX]);
+// Bits spd_encode() derives from SpdInfo alone, the CRC bytes aren't
+// included. Returns the image size, 0 for unsupported devices.
+size_t spd_encode_mask(int device_type, uint8_t mask[SPD_SIZE_MAX]);
+void spd_encode_fields(const SpdInfo *i, uint8_t data[SPD_DDR3_SIZE]);
+uint32_t spd_validate_fields(const SpdInfo *i);
 
-void spd_parse_i2cdump(uint8_t data[SPD_SIZE_MAX], const char *i2cdump);
+void spd_parse_i2cdump(uint8_t data[SPD_DDR3_SIZE], const char *i2cdump);
 
 #ifdef __cplusplus
 }
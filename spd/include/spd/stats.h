@@ -0,0 +1,76 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+#include <spd/intern.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SPD_STATS_VALUES_MAX 64
+
+// Mergeable corpus histograms: keep one per thread, merge at the end.
+// Enum fields are counted by raw value, geometry by [ranks][width] raw,
+// capacities (MB) and tCKmin (ps) by distinct value.
+typedef struct SpdStats
+{
+    uint64_t images;
+    uint64_t crc_errors;
+    uint64_t unsupported;
+
+    uint64_t device_type[256];
+    uint64_t module_type[16];
+    uint64_t voltage[8];
+    uint64_t geometry[8][8];
+
+    uint64_t cas_latency[32];
+
+    int capacity[SPD_STATS_VALUES_MAX];
+    uint64_t capacity_count[SPD_STATS_VALUES_MAX];
+    int capacities;
+
+    int tck[SPD_STATS_VALUES_MAX];
+    uint64_t tck_count[SPD_STATS_VALUES_MAX];
+    int tcks;
+
+    SpdIntern parts;
+    uint64_t *part_count;
+    uint32_t part_capacity;
+} SpdStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void spd_stats_init(SpdStats *s);
+void spd_stats_free(SpdStats *s);
+
+bool spd_stats_add(SpdStats *s, const SpdInfo *i, bool decoded);
+bool spd_stats_merge(SpdStats *s, const SpdStats *other);
+
+#ifdef __cplusplus
+}
+#endif
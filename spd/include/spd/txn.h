@@ -0,0 +1,71 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Edit transaction over an image buffer: edits change the buffer in place,
+// the CRC is recomputed once at commit and only byte ranges that differ
+// from the state at begin are reported for writing.
+//
+// Edit language, numbers are decimal or 0x hexadecimal:
+//   byteN=V           whole byte
+//   byteN.bitM=V      single bit, V is 0 or 1
+//   A..B=TEXT         bytes A ~ B, TEXT optionally quoted, padded with spaces
+//   field:KEY=V       field of the image's generation, see spd_field_raw()
+typedef struct SpdRange
+{
+    size_t offset;
+    size_t size;
+} SpdRange;
+
+typedef struct SpdTxn
+{
+    uint8_t *data;
+    size_t size;
+    uint8_t original[SPD_SIZE_MAX];
+    unsigned edits;
+} SpdTxn;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void spd_txn_begin(SpdTxn *t, uint8_t *data, size_t size);
+bool spd_txn_set_bits(SpdTxn *t, size_t offset, int shift, int width, int value);
+bool spd_txn_set_bytes(SpdTxn *t, size_t offset, const uint8_t *bytes, size_t count);
+bool spd_txn_set_field(SpdTxn *t, const char *key, int value);
+bool spd_txn_parse(SpdTxn *t, const char *edit);
+// Recomputes the CRC or checksum, decodes the result into i and returns
+// the number of changed ranges. Ranges beyond max are merged into the last.
+size_t spd_txn_commit(SpdTxn *t, SpdInfo *i, SpdRange *ranges, size_t max);
+void spd_txn_rollback(SpdTxn *t);
+
+#ifdef __cplusplus
+}
+#endif
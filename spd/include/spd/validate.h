@@ -0,0 +1,73 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// JEDEC consistency rules checked on top of the per-field encodings:
+// X(ID, key, label)
+#define SPD_RULES(X) \
+    X(DEVICE_TYPE,     device_type,     "DRAM device type isn't DDR3") \
+    X(CRC,             crc,             "CRC mismatch") \
+    X(RESERVED_BITS,   reserved_bits,   "Reserved bits set") \
+    X(BYTES_USED,      bytes_used,      "More bytes used than total") \
+    X(GEOMETRY,        geometry,        "SDRAM capacity disagrees with banks, rows, columns and width") \
+    X(CAPACITY,        capacity,        "Module capacity is undefined") \
+    X(PART_NUMBER,     part_number,     "Part number isn't printable ASCII") \
+    X(CAS_LATENCY,     cas_latency,     "No supported CAS latency covers tAAmin at tCKmin")
+
+typedef enum SpdRule
+{
+#define SPD_X(ID, ...) SPD_RULE_##ID,
+    SPD_RULES(SPD_X)
+#undef SPD_X
+    SPD_RULE_COUNT
+} SpdRule;
+
+// Per-image violation bitset: SpdField bits for reserved field encodings
+// (as spd_validate_fields()), then SpdRule bits
+#define SPD_VIOLATION_FIELD(f)  (1ull << (f))
+#define SPD_VIOLATION_RULE(r)   (1ull << (32 + (r)))
+#define SPD_VIOLATION_BITS      64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t spd_validate(const uint8_t image[SPD_DDR3_SIZE]);
+void spd_validate_batch(uint64_t *violations, const uint8_t *images, size_t count, size_t stride);
+void spd_violations_count(uint64_t counts[SPD_VIOLATION_BITS], const uint64_t *violations, size_t count);
+
+const char *spd_rule_key(SpdRule r);
+const char *spd_rule_label(SpdRule r);
+// Violation bit name: field key or rule key
+const char *spd_violation_key(int bit);
+
+#ifdef __cplusplus
+}
+#endif
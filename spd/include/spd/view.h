@@ -0,0 +1,99 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <spd/spd.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Zero-copy view over a borrowed SPD image: fields are decoded on access,
+// nothing is copied and the CRC is only computed on request.
+typedef struct SpdView
+{
+    const uint8_t *data;
+} SpdView;
+
+// Projection masks for spd_view_decode(): SpdField bits plus derived values
+#define SPD_PROJ_FIELD(f)       (1u << (f))
+#define SPD_PROJ_FIELDS         ((1u << SPD_FIELD_COUNT) - 1)
+#define SPD_PROJ_TIMINGS        (1u << 28)
+#define SPD_PROJ_CAPACITY       (1u << 29)
+#define SPD_PROJ_PART_NUMBER    (1u << 30)
+#define SPD_PROJ_CRC            (1u << 31)
+#define SPD_PROJ_ALL            0xffffffffu
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline void spd_view_init(SpdView *v, const uint8_t data[SPD_DDR3_SIZE])
+{
+    v->data = data;
+}
+
+// Views read the DDR3 layout. Other device types, such as 256 byte DDR2
+// records, read as zeros and an empty part number; only the device type
+// itself is reported.
+static inline bool spd_view_is_ddr3(const SpdView *v)
+{
+    return v->data[2] == SPD_DEVICE_TYPE_DDR3;
+}
+
+// Raw field accessors: spd_view_ranks(v), spd_view_voltage(v), ...
+#define SPD_X(ID, key, member, byte, shift, width, ...) \
+static inline int spd_view_##key(const SpdView *v) \
+{ \
+    return (v->data[byte] >> (shift)) & ((1u << (width)) - 1) & -(unsigned)((byte) == 2 || spd_view_is_ddr3(v)); \
+}
+SPD_FIELDS(SPD_X)
+#undef SPD_X
+
+int spd_view_field(const SpdView *v, SpdField f);
+int spd_view_capacity(const SpdView *v);
+const char *spd_view_part_number(const SpdView *v, size_t *len);
+
+static inline int spd_view_timing(const SpdView *v, SpdTiming t)
+{
+    return spd_view_is_ddr3(v) ? spd_timing_ps(v->data, t) : 0;
+}
+
+static inline int spd_view_cas_latency(const SpdView *v)
+{
+    if (!spd_view_is_ddr3(v))
+        return 0;
+    return spd_cas_latency(spd_cas_latencies(v->data), spd_timing_ps(v->data, SPD_TIMING_TAA), spd_timing_ps(v->data, SPD_TIMING_TCK));
+}
+
+int spd_view_crc(const SpdView *v);
+int spd_view_crc_real(const SpdView *v);
+bool spd_view_crc_ok(const SpdView *v);
+
+void spd_view_decode(const SpdView *v, SpdInfo *i, uint32_t projection);
+void spd_view_decode_batch(SpdInfo *i, const uint8_t *images, size_t count, size_t stride, uint32_t projection);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,300 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/index.h>
+#include <spd/hash.h>
+#include <spd/intern.h>
+#include <spd/view.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAGIC "SPDIDX2"
+#define ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+typedef struct Header
+{
+    char magic[8];
+    uint64_t corpus_size;
+    SpdHash corpus_hash;
+    uint64_t count;
+    uint32_t columns;
+    uint32_t parts;
+    uint64_t names_size;
+} Header;
+
+typedef struct ColumnHeader
+{
+    uint32_t key;
+    uint32_t values;
+} ColumnHeader;
+
+// Small enum columns worth a bitmap per value
+static const int indexed_keys[] = {
+    SPD_FIELD_DEVICE_TYPE,
+    SPD_FIELD_MODULE_TYPE,
+    SPD_FIELD_SDRAM_CAPACITY,
+    SPD_FIELD_VOLTAGE,
+    SPD_FIELD_SDRAM_WIDTH,
+    SPD_FIELD_RANKS,
+    SPD_FIELD_BUS_WIDTH,
+    SPD_KEY_CAPACITY,
+};
+#define INDEXED_KEYS (sizeof(indexed_keys) / sizeof(indexed_keys[0]))
+#define VALUES_MAX 256
+
+static int key_value(const SpdView *v, int key)
+{
+    return key == SPD_KEY_CAPACITY ? spd_view_capacity(v) : spd_view_field(v, (SpdField)key);
+}
+
+typedef struct Column
+{
+    int32_t value[VALUES_MAX];
+    uint32_t values;
+    uint8_t *slot;  // per record value slot
+} Column;
+
+static int find_value(const Column *c, int32_t value)
+{
+    for (uint32_t n = 0; n < c->values; n++)
+        if (c->value[n] == value)
+            return (int)n;
+    return -1;
+}
+
+typedef struct SortedPart
+{
+    const char *name;
+    uint32_t id;
+} SortedPart;
+
+static int compare_parts(const void *a, const void *b)
+{
+    return strcmp(((const SortedPart *)a)->name, ((const SortedPart *)b)->name);
+}
+
+bool spd_index_build(SpdIndex *x, const uint8_t *images, size_t count)
+{
+    memset(x, 0, sizeof(x[0]));
+    size_t words = spd_bitmap_words(count);
+    bool ok = false;
+
+    Column *columns = calloc(INDEXED_KEYS, sizeof(columns[0]));
+    uint32_t *part_of = malloc((count ? count : 1) * sizeof(part_of[0]));
+    SortedPart *sorted = NULL;
+    uint32_t *rank = NULL, *cursor = NULL;
+    SpdIntern parts;
+    spd_intern_init(&parts);
+    if (!columns || !part_of)
+        goto done;
+
+    // Pass 1: distinct values per column and part number ids
+    for (size_t k = 0; k < INDEXED_KEYS; k++) {
+        columns[k].slot = malloc(count ? count : 1);
+        if (!columns[k].slot)
+            goto done;
+    }
+    for (size_t n = 0; n < count; n++) {
+        SpdView v;
+        spd_view_init(&v, images + n * SPD_DDR3_SIZE);
+        for (size_t k = 0; k < INDEXED_KEYS; k++) {
+            Column *c = &columns[k];
+            int32_t value = key_value(&v, indexed_keys[k]);
+            int slot = find_value(c, value);
+            if (slot < 0) {
+                if (c->values == VALUES_MAX)
+                    goto done;
+                slot = (int)c->values;
+                c->value[c->values++] = value;
+            }
+            c->slot[n] = (uint8_t)slot;
+        }
+        size_t len;
+        const char *part = spd_view_part_number(&v, &len);
+        part_of[n] = spd_intern(&parts, part, len);
+        if (part_of[n] == SPD_INTERN_NONE)
+            goto done;
+    }
+
+    // Sorted part dictionary
+    uint32_t part_count = spd_intern_count(&parts);
+    sorted = malloc((part_count ? part_count : 1) * sizeof(sorted[0]));
+    rank = calloc(part_count ? part_count : 1, sizeof(rank[0]));
+    cursor = calloc(part_count + 1, sizeof(cursor[0]));
+    if (!sorted || !rank || !cursor)
+        goto done;
+    size_t names_size = 0;
+    for (uint32_t id = 0; id < part_count; id++) {
+        sorted[id].name = spd_intern_str(&parts, id);
+        sorted[id].id = id;
+        names_size += spd_intern_len(&parts, id) + 1;
+    }
+    qsort(sorted, part_count, sizeof(sorted[0]), compare_parts);
+    for (uint32_t r = 0; r < part_count; r++)
+        rank[sorted[r].id] = r;
+
+    // Serialized layout
+    size_t size = sizeof(Header);
+    for (size_t k = 0; k < INDEXED_KEYS; k++) {
+        size += sizeof(ColumnHeader) + ALIGN(columns[k].values * sizeof(int32_t));
+        size += columns[k].values * words * sizeof(uint64_t);
+    }
+    size += ALIGN(part_count * sizeof(SpdIndexPart));
+    size += ALIGN(names_size);
+    size += count * sizeof(uint32_t);
+
+    uint8_t *data = calloc(1, size);
+    if (!data)
+        goto done;
+    uint8_t *p = data;
+
+    Header *h = (Header *)p;
+    memcpy(h->magic, MAGIC, sizeof(h->magic));
+    h->corpus_size = (uint64_t)count * SPD_DDR3_SIZE;
+    h->corpus_hash = spd_hash(images, count * SPD_DDR3_SIZE);
+    h->count = count;
+    h->columns = (uint32_t)INDEXED_KEYS;
+    h->parts = part_count;
+    h->names_size = ALIGN(names_size);
+    p += sizeof(Header);
+
+    // Pass 2: bitmaps
+    for (size_t k = 0; k < INDEXED_KEYS; k++) {
+        const Column *c = &columns[k];
+        ColumnHeader *ch = (ColumnHeader *)p;
+        ch->key = (uint32_t)indexed_keys[k];
+        ch->values = c->values;
+        p += sizeof(ColumnHeader);
+        memcpy(p, c->value, c->values * sizeof(int32_t));
+        p += ALIGN(c->values * sizeof(int32_t));
+        uint64_t *bitmaps = (uint64_t *)p;
+        for (size_t n = 0; n < count; n++)
+            bitmaps[c->slot[n] * words + n / 64] |= 1ull << (n % 64);
+        p += c->values * words * sizeof(uint64_t);
+    }
+
+    // Parts in name order, postings in record order
+    SpdIndexPart *index_parts = (SpdIndexPart *)p;
+    p += ALIGN(part_count * sizeof(SpdIndexPart));
+    char *names = (char *)p;
+    p += ALIGN(names_size);
+    uint32_t *postings = (uint32_t *)p;
+
+    for (size_t n = 0; n < count; n++)
+        cursor[rank[part_of[n]] + 1]++;
+    for (uint32_t r = 0; r < part_count; r++)
+        cursor[r + 1] += cursor[r];
+    size_t name = 0;
+    for (uint32_t r = 0; r < part_count; r++) {
+        index_parts[r].name = (uint32_t)name;
+        index_parts[r].postings = cursor[r];
+        index_parts[r].count = cursor[r + 1] - cursor[r];
+        size_t len = spd_intern_len(&parts, sorted[r].id);
+        memcpy(names + name, sorted[r].name, len + 1);
+        name += len + 1;
+    }
+    for (size_t n = 0; n < count; n++)
+        postings[cursor[rank[part_of[n]]]++] = (uint32_t)n;
+
+    ok = spd_index_attach(x, data, size);
+    if (ok)
+        x->owned = data;
+    else
+        free(data);
+
+done:
+    if (columns) {
+        for (size_t k = 0; k < INDEXED_KEYS; k++)
+            free(columns[k].slot);
+    }
+    free(columns);
+    free(part_of);
+    free(sorted);
+    free(rank);
+    free(cursor);
+    spd_intern_free(&parts);
+    return ok;
+}
+
+bool spd_index_attach(SpdIndex *x, const void *data, size_t size)
+{
+    memset(x, 0, sizeof(x[0]));
+    const uint8_t *p = data, *end = p + size;
+    const Header *h = (const Header *)p;
+    if (size < sizeof(Header) || memcmp(h->magic, MAGIC, sizeof(h->magic)) || h->columns > SPD_INDEX_COLUMNS_MAX)
+        return false;
+    x->data = data;
+    x->size = size;
+    x->corpus_size = h->corpus_size;
+    x->corpus_hash = h->corpus_hash;
+    x->count = h->count;
+    x->words = spd_bitmap_words((size_t)h->count);
+    p += sizeof(Header);
+
+    for (uint32_t k = 0; k < h->columns; k++) {
+        const ColumnHeader *ch = (const ColumnHeader *)p;
+        if ((size_t)(end - p) < sizeof(ColumnHeader))
+            return false;
+        p += sizeof(ColumnHeader);
+        size_t values_size = ALIGN(ch->values * sizeof(int32_t));
+        size_t bitmaps_size = ch->values * x->words * sizeof(uint64_t);
+        if ((size_t)(end - p) < values_size + bitmaps_size)
+            return false;
+        SpdIndexColumn *c = &x->columns[x->column_count++];
+        c->key = (int)ch->key;
+        c->values = ch->values;
+        c->value = (const int32_t *)p;
+        c->bitmaps = (const uint64_t *)(p + values_size);
+        p += values_size + bitmaps_size;
+    }
+
+    size_t parts_size = ALIGN(h->parts * sizeof(SpdIndexPart));
+    size_t postings_size = (size_t)h->count * sizeof(uint32_t);
+    if ((size_t)(end - p) != parts_size + h->names_size + postings_size)
+        return false;
+    x->parts = (const SpdIndexPart *)p;
+    x->part_count = h->parts;
+    x->names = (const char *)p + parts_size;
+    x->postings = (const uint32_t *)(p + parts_size + h->names_size);
+    return true;
+}
+
+bool spd_index_write(const SpdIndex *x, FILE *f)
+{
+    return x->size == fwrite(x->data, 1, x->size, f);
+}
+
+void spd_index_free(SpdIndex *x)
+{
+    free(x->owned);
+    memset(x, 0, sizeof(x[0]));
+}
+
+const SpdIndexColumn *spd_index_column(const SpdIndex *x, int key)
+{
+    for (uint32_t k = 0; k < x->column_count; k++)
+        if (x->columns[k].key == key)
+            return &x->columns[k];
+    return NULL;
+}
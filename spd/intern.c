@@ -0,0 +1,184 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/intern.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE (64 * 1024)
+
+struct SpdInternBlock
+{
+    SpdInternBlock *next;
+    size_t used;
+    size_t size;
+    char data[1];
+};
+
+static uint32_t hash(const char *s, size_t len)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (len--) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void spd_intern_init(SpdIntern *t)
+{
+    memset(t, 0, sizeof(t[0]));
+}
+
+void spd_intern_free(SpdIntern *t)
+{
+    while (t->blocks) {
+        SpdInternBlock *next = t->blocks->next;
+        free(t->blocks);
+        t->blocks = next;
+    }
+    free(t->strs);
+    free(t->lens);
+    free(t->hashes);
+    free(t->slots);
+    spd_intern_init(t);
+}
+
+// Slot values are id + 1, zero marks an empty slot
+static uint32_t *find_slot(const SpdIntern *t, const char *s, size_t len, uint32_t h)
+{
+    uint32_t n = h & t->slot_mask;
+    while (true) {
+        uint32_t id = t->slots[n];
+        if (!id--)
+            return &t->slots[n];
+        if (t->hashes[id] == h && t->lens[id] == len && !memcmp(t->strs[id], s, len))
+            return &t->slots[n];
+        n = (n + 1) & t->slot_mask;
+    }
+}
+
+uint32_t spd_intern_find(const SpdIntern *t, const char *s, size_t len)
+{
+    if (!t->slots)
+        return SPD_INTERN_NONE;
+    return *find_slot(t, s, len, hash(s, len)) - 1;
+}
+
+static bool rehash(SpdIntern *t)
+{
+    uint32_t slot_count = t->slots ? (t->slot_mask + 1) * 2 : 1024;
+    uint32_t *slots = calloc(slot_count, sizeof(slots[0]));
+    if (!slots)
+        return false;
+    free(t->slots);
+    t->slots = slots;
+    t->slot_mask = slot_count - 1;
+    for (uint32_t id = 0; id < t->count; id++) {
+        *find_slot(t, t->strs[id], t->lens[id], t->hashes[id]) = id + 1;
+    }
+    return true;
+}
+
+static bool reserve(SpdIntern *t)
+{
+    if (t->count < t->capacity)
+        return true;
+    uint32_t capacity = t->capacity ? t->capacity * 2 : 256;
+    const char **strs = realloc((void *)t->strs, capacity * sizeof(strs[0]));
+    if (strs)
+        t->strs = strs;
+    uint32_t *lens = realloc(t->lens, capacity * sizeof(lens[0]));
+    if (lens)
+        t->lens = lens;
+    uint32_t *hashes = realloc(t->hashes, capacity * sizeof(hashes[0]));
+    if (hashes)
+        t->hashes = hashes;
+    if (!strs || !lens || !hashes)
+        return false;
+    t->capacity = capacity;
+    return true;
+}
+
+static char *arena_alloc(SpdIntern *t, size_t size)
+{
+    SpdInternBlock *b = t->blocks;
+    if (!b || b->size - b->used < size) {
+        size_t block_size = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+        b = malloc(sizeof(*b) + block_size);
+        if (!b)
+            return NULL;
+        b->next = t->blocks;
+        b->used = 0;
+        b->size = block_size;
+        t->blocks = b;
+    }
+    char *p = b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+uint32_t spd_intern(SpdIntern *t, const char *s, size_t len)
+{
+    // Keep the load factor below 1/2
+    if ((t->count + 1) * 2 > (t->slots ? t->slot_mask + 1 : 0) && !rehash(t))
+        return SPD_INTERN_NONE;
+
+    uint32_t h = hash(s, len);
+    uint32_t *slot = find_slot(t, s, len, h);
+    if (*slot)
+        return *slot - 1;
+
+    char *str = arena_alloc(t, len + 1);
+    if (!str || !reserve(t))
+        return SPD_INTERN_NONE;
+    memcpy(str, s, len);
+    str[len] = 0;
+
+    uint32_t id = t->count++;
+    t->strs[id] = str;
+    t->lens[id] = (uint32_t)len;
+    t->hashes[id] = h;
+    *slot = id + 1;
+    return id;
+}
+
+uint32_t spd_intern_part(SpdIntern *t, const SpdInfo *i)
+{
+    return spd_intern(t, i->Module_Part_Number, strlen(i->Module_Part_Number));
+}
+
+bool spd_pack_interned(SpdPacked *p, const SpdInfo *i, SpdIntern *t)
+{
+    if (!spd_pack(p, i, SPD_INTERN_NONE))
+        return false;
+    p->part = spd_intern_part(t, i);
+    return p->part != SPD_INTERN_NONE;
+}
+
+void spd_unpack_interned(SpdInfo *i, const SpdPacked *p, const SpdIntern *t)
+{
+    spd_unpack(i, p, spd_intern_str(t, p->part));
+}
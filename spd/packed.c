@@ -0,0 +1,109 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/packed.h>
+
+#include <string.h>
+#include <errno.h>
+
+typedef char spd_packed_fits[SPD_PACKED_BITS <= 64 && sizeof(SpdPacked) == 16 ? 1 : -1];
+
+#define FIELD_MASK(width) ((1u << (width)) - 1)
+
+uint64_t spd_packed_mask(SpdField f)
+{
+    switch (f) {
+#define SPD_X(ID, key, member, byte, shift, width, ...) \
+        case SPD_FIELD_##ID: return (uint64_t)FIELD_MASK(width) << SPD_PACKED_##ID;
+        SPD_FIELDS(SPD_X)
+#undef SPD_X
+        default: return 0;
+    }
+}
+
+uint64_t spd_packed_value(SpdField f, int raw)
+{
+    switch (f) {
+#define SPD_X(ID, key, member, byte, shift, width, ...) \
+        case SPD_FIELD_##ID: return (uint64_t)((unsigned)raw & FIELD_MASK(width)) << SPD_PACKED_##ID;
+        SPD_FIELDS(SPD_X)
+#undef SPD_X
+        default: return 0;
+    }
+}
+
+int spd_packed_field(const SpdPacked *p, SpdField f)
+{
+    switch (f) {
+#define SPD_X(ID, key, ...) \
+        case SPD_FIELD_##ID: return spd_packed_##key(p);
+        SPD_FIELDS(SPD_X)
+#undef SPD_X
+        default: return 0;
+    }
+}
+
+bool spd_pack(SpdPacked *p, const SpdInfo *i, uint32_t part)
+{
+    if (i->DRAM_Device_Type != SPD_DEVICE_TYPE_DDR3) {
+        errno = EINVAL;
+        return false;
+    }
+    uint64_t fields = 0;
+#define SPD_X(ID, key, member, byte, shift, width, ...) \
+    fields |= (uint64_t)((unsigned)i->member & FIELD_MASK(width)) << SPD_PACKED_##ID;
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+    fields |= (uint64_t)(i->Module_Capacity != 0) << SPD_PACKED_HAS_CAPACITY;
+
+    p->fields = fields;
+    p->crc = (uint16_t)i->CRC;
+    p->crc_real = (uint16_t)i->CRC_real;
+    p->part = part;
+    return true;
+}
+
+void spd_unpack(SpdInfo *i, const SpdPacked *p, const char *part_number)
+{
+    memset(i, 0, sizeof(i[0]));
+#define SPD_X(ID, key, member, ...) \
+    i->member = spd_packed_##key(p);
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+    i->Module_Capacity = spd_packed_capacity(p);
+    if (part_number) {
+        strncpy(i->Module_Part_Number, part_number, sizeof(i->Module_Part_Number) - 1);
+    }
+    i->CRC = p->crc;
+    i->CRC_real = p->crc_real;
+}
+
+size_t spd_packed_filter(const SpdPacked *p, size_t count, uint64_t mask, uint64_t value, uint32_t *matches)
+{
+    size_t found = 0;
+    for (size_t n = 0; n < count; n++) {
+        matches[found] = (uint32_t)n;
+        found += (p[n].fields & mask) == value;
+    }
+    return found;
+}
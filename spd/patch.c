@@ -0,0 +1,156 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/patch.h>
+#include <spd/txn.h>
+#include <spd/bits.h>
+
+#include <ctype.h>
+#include <string.h>
+
+static const char *skip_spaces(const char *s, const char *end)
+{
+    while (s < end && isspace((unsigned char)*s))
+        s++;
+    return s;
+}
+
+// Space separated edits, double quotes keep spaces
+static bool parse_edits(SpdPatchRule *r, const char *s, const char *end, const char **error)
+{
+    static const uint8_t ddr3[SPD_DDR3_SIZE] = { [2] = SPD_DEVICE_TYPE_DDR3 };
+    uint8_t check[SPD_DDR3_SIZE];
+    SpdTxn txn;
+    memcpy(check, ddr3, sizeof(check));
+    spd_txn_begin(&txn, check, sizeof(check));
+    while ((s = skip_spaces(s, end)) < end) {
+        const char *edit = s;
+        bool quoted = false;
+        while (s < end && (quoted || !isspace((unsigned char)*s))) {
+            if (*s == '"')
+                quoted = !quoted;
+            s++;
+        }
+        size_t len = (size_t)(s - edit);
+        char *text = r->edits[r->edit_count];
+        if (r->edit_count == SPD_PATCH_EDITS_MAX || len >= SPD_PATCH_EDIT_SIZE) {
+            *error = edit;
+            return false;
+        }
+        memcpy(text, edit, len);
+        text[len] = 0;
+        if (!spd_txn_parse(&txn, text)) {
+            *error = edit;
+            return false;
+        }
+        r->edit_count++;
+    }
+    if (!r->edit_count)
+        *error = end;
+    return r->edit_count > 0;
+}
+
+static bool parse_rule(SpdPatchRule *r, const char *s, const char *end, const char **error)
+{
+    const char *arrow = strstr(s, "=>");
+    if (!arrow || arrow >= end) {
+        *error = s;
+        return false;
+    }
+    char where[1024];
+    const char *first = skip_spaces(s, arrow);
+    size_t len = (size_t)(arrow - first);
+    while (len && isspace((unsigned char)first[len - 1]))
+        len--;
+    if (len >= sizeof(where)) {
+        *error = s;
+        return false;
+    }
+    memcpy(where, first, len);
+    where[len] = 0;
+    if (!strcmp(where, "*")) {
+        r->all = true;
+    } else {
+        const char *at = NULL;
+        if (!spd_query_parse(&r->where, where, &at)) {
+            *error = first + (at ? at - where : 0);
+            return false;
+        }
+    }
+    return parse_edits(r, arrow + 2, end, error);
+}
+
+bool spd_patch_parse(SpdPatch *p, const char *text, int *line, const char **error)
+{
+    memset(p, 0, sizeof(p[0]));
+    *line = 0;
+    while (*text) {
+        const char *eol = strchr(text, '\n');
+        const char *end = eol ? eol : text + strlen(text);
+        const char *comment = memchr(text, '#', (size_t)(end - text));
+        const char *s = skip_spaces(text, comment ? comment : end);
+        const char *stop = comment ? comment : end;
+        (*line)++;
+        if (s < stop) {
+            if (p->count == SPD_PATCH_RULES_MAX) {
+                *error = s;
+                return false;
+            }
+            SpdPatchRule *r = &p->rules[p->count];
+            r->line = *line;
+            if (!parse_rule(r, s, stop, error))
+                return false;
+            p->count++;
+        }
+        text = eol ? eol + 1 : end;
+    }
+    return true;
+}
+
+SpdPatchResult spd_patch_apply(const SpdPatch *p, uint8_t image[SPD_DDR3_SIZE])
+{
+    SpdPatchResult result = { 0, false, false };
+    for (int n = 0; n < p->count; n++) {
+        if (p->rules[n].all || spd_query_match(&p->rules[n].where, image))
+            result.matched |= 1u << n;
+    }
+    if (!result.matched)
+        return result;
+
+    SpdTxn txn;
+    spd_txn_begin(&txn, image, SPD_DDR3_SIZE);
+    for (uint32_t bits = result.matched; bits; bits &= bits - 1) {
+        const SpdPatchRule *r = &p->rules[spd_ctz64(bits)];
+        for (int e = 0; e < r->edit_count; e++) {
+            if (!spd_txn_parse(&txn, r->edits[e])) {
+                spd_txn_rollback(&txn);
+                result.failed = true;
+                return result;
+            }
+        }
+    }
+    SpdInfo i;
+    SpdRange range;
+    result.changed = spd_txn_commit(&txn, &i, &range, 1) != 0;
+    return result;
+}
@@ -0,0 +1,414 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/query.h>
+#include <spd/view.h>
+#include <spd/bits.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *skip_spaces(const char *s)
+{
+    while (isspace((unsigned char)*s))
+        s++;
+    return s;
+}
+
+static int parse_key(const char *s, size_t len)
+{
+    static const char *const extra[] = { "capacity", "part", "crc", "cl" };
+    for (int n = 0; n < SPD_FIELD_COUNT; n++) {
+        const char *key = spd_field_info((SpdField)n)->key;
+        if (strlen(key) == len && !memcmp(key, s, len))
+            return n;
+    }
+    for (int n = 0; n < 4; n++) {
+        if (strlen(extra[n]) == len && !memcmp(extra[n], s, len))
+            return SPD_FIELD_COUNT + n;
+    }
+    for (int n = 0; n < SPD_TIMING_COUNT; n++) {
+        const char *key = spd_timing_key((SpdTiming)n);
+        if (strlen(key) == len && !memcmp(key, s, len))
+            return SPD_KEY_TIMING(n);
+    }
+    return -1;
+}
+
+static const char *parse_op(const char *s, SpdQueryOp *op)
+{
+    if (s[0] == '!' && s[1] == '=') { *op = SPD_OP_NE; return s + 2; }
+    if (s[0] == '<' && s[1] == '=') { *op = SPD_OP_LE; return s + 2; }
+    if (s[0] == '>' && s[1] == '=') { *op = SPD_OP_GE; return s + 2; }
+    if (s[0] == '=' && s[1] == '=') { *op = SPD_OP_EQ; return s + 2; }
+    if (s[0] == '=') { *op = SPD_OP_EQ; return s + 1; }
+    if (s[0] == '<') { *op = SPD_OP_LT; return s + 1; }
+    if (s[0] == '>') { *op = SPD_OP_GT; return s + 1; }
+    if (s[0] == '~') { *op = SPD_OP_MATCH; return s + 1; }
+    return NULL;
+}
+
+static const char *parse_value(const char *s, SpdQueryTerm *t)
+{
+    size_t len = 0;
+    if (*s == '\'' || *s == '"') {
+        const char *end = strchr(s + 1, *s);
+        if (!end)
+            return NULL;
+        len = (size_t)(end - s - 1);
+        if (len >= sizeof(t->text))
+            return NULL;
+        memcpy(t->text, s + 1, len);
+        s = end + 1;
+    } else {
+        while (s[len] && !isspace((unsigned char)s[len]) && s[len] != '&' && s[len] != '|')
+            len++;
+        if (!len || len >= sizeof(t->text))
+            return NULL;
+        memcpy(t->text, s, len);
+        s += len;
+    }
+    t->text[len] = 0;
+
+    char *end;
+    long number = strtol(t->text, &end, 0);
+    t->numeric = *t->text && !*end;
+    t->number = (int)number;
+    return s;
+}
+
+static bool compare(SpdQueryOp op, int a, int b)
+{
+    switch (op) {
+        case SPD_OP_EQ: return a == b;
+        case SPD_OP_NE: return a != b;
+        case SPD_OP_LT: return a < b;
+        case SPD_OP_LE: return a <= b;
+        case SPD_OP_GT: return a > b;
+        case SPD_OP_GE: return a >= b;
+        default: return false;
+    }
+}
+
+bool spd_glob(const char *pattern, const char *s, size_t len)
+{
+    const char *star = NULL;
+    size_t n = 0, retry = 0;
+    while (n < len) {
+        if (*pattern == '*') {
+            star = ++pattern;
+            retry = n;
+        } else if (*pattern && (*pattern == '?' || *pattern == s[n])) {
+            pattern++;
+            n++;
+        } else if (star) {
+            pattern = star;
+            n = ++retry;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*')
+        pattern++;
+    return !*pattern;
+}
+
+// "1.35/1.5" matches "1.35/1.5 V operable", but "1.5" doesn't
+static bool text_equal(const char *text, const char *value)
+{
+    size_t len = strlen(value);
+    return text && !strncmp(text, value, len) && (text[len] == 0 || text[len] == ' ');
+}
+
+static bool text_verdict(const SpdQueryTerm *t, const char *text, size_t len)
+{
+    switch (t->op) {
+        case SPD_OP_EQ: return len == strlen(t->text) && !memcmp(text, t->text, len);
+        case SPD_OP_NE: return !(len == strlen(t->text) && !memcmp(text, t->text, len));
+        case SPD_OP_MATCH: return spd_glob(t->text, text, len);
+        default: return false;
+    }
+}
+
+static bool value_verdict(const SpdQueryTerm *t, int value)
+{
+    return t->op != SPD_OP_MATCH && t->numeric && compare(t->op, value, t->number);
+}
+
+// Field verdicts only depend on the raw value, precompute all of them
+static bool build_truth(SpdQueryTerm *t)
+{
+    SpdField f = (SpdField)t->key;
+    int values = 1 << spd_field_info(f)->width;
+    bool is_text = spd_field_info(f)->kind == SPD_KIND_STR;
+    for (int raw = 0; raw < values; raw++) {
+        const char *text = spd_field_text(f, raw);
+        bool verdict;
+        if (t->numeric) {
+            // Raw value for text fields, mapped value for numeric ones
+            verdict = compare(t->op, is_text ? raw : spd_field_value(f, raw), t->number);
+        } else if (!is_text) {
+            return false;
+        } else if (t->op == SPD_OP_MATCH) {
+            verdict = text && spd_glob(t->text, text, strlen(text));
+        } else if (t->op == SPD_OP_EQ || t->op == SPD_OP_NE) {
+            verdict = text_equal(text, t->text) == (t->op == SPD_OP_EQ);
+        } else {
+            return false;
+        }
+        t->truth[raw] = verdict;
+    }
+    return true;
+}
+
+static bool build_term(SpdQueryTerm *t)
+{
+    if (t->key >= SPD_KEY_TIMING(0))
+        return t->numeric && t->op != SPD_OP_MATCH;
+    switch (t->key) {
+        case SPD_KEY_CAPACITY:
+        case SPD_KEY_CL:
+            return t->numeric && t->op != SPD_OP_MATCH;
+        case SPD_KEY_PART:
+            return t->op == SPD_OP_EQ || t->op == SPD_OP_NE || t->op == SPD_OP_MATCH;
+        case SPD_KEY_CRC:
+            if (t->op != SPD_OP_EQ && t->op != SPD_OP_NE)
+                return false;
+            if (!strcmp(t->text, "ok"))
+                t->number = 1;
+            else if (!strcmp(t->text, "err"))
+                t->number = 0;
+            else
+                return false;
+            t->numeric = true;
+            return true;
+        default:
+            return build_truth(t);
+    }
+}
+
+bool spd_query_parse(SpdQuery *q, const char *expr, const char **error)
+{
+    memset(q, 0, sizeof(q[0]));
+    const char *s = skip_spaces(expr);
+    q->groups = 1;
+    while (true) {
+        const char *term = s;
+        if (q->count == SPD_QUERY_TERMS_MAX)
+            goto fail;
+        SpdQueryTerm *t = &q->terms[q->count++];
+        t->group = q->groups - 1;
+
+        size_t len = 0;
+        while (isalnum((unsigned char)s[len]) || s[len] == '_')
+            len++;
+        t->key = parse_key(s, len);
+        if (t->key < 0)
+            goto fail;
+        s = parse_op(skip_spaces(s + len), &t->op);
+        if (!s)
+            goto fail;
+        s = parse_value(skip_spaces(s), t);
+        if (!s || !build_term(t)) {
+            s = term;
+            goto fail;
+        }
+
+        s = skip_spaces(s);
+        if (!*s)
+            return true;
+        if (s[0] == '&' && s[1] == '&') {
+            s = skip_spaces(s + 2);
+        } else if (s[0] == '|' && s[1] == '|') {
+            s = skip_spaces(s + 2);
+            q->groups++;
+        } else {
+            goto fail;
+        }
+    }
+
+fail:
+    if (error)
+        *error = s ? s : expr;
+    return false;
+}
+
+static bool term_match(const SpdQueryTerm *t, const SpdView *v)
+{
+    if (t->key >= SPD_KEY_TIMING(0))
+        return value_verdict(t, spd_view_timing(v, (SpdTiming)(t->key - SPD_KEY_TIMING(0))));
+    switch (t->key) {
+        case SPD_KEY_CAPACITY:
+            return value_verdict(t, spd_view_capacity(v));
+        case SPD_KEY_CL:
+            return value_verdict(t, spd_view_cas_latency(v));
+        case SPD_KEY_PART: {
+            size_t len;
+            const char *part = spd_view_part_number(v, &len);
+            return text_verdict(t, part, len);
+        }
+        case SPD_KEY_CRC:
+            return spd_view_crc_ok(v) == (t->op == SPD_OP_EQ ? t->number : !t->number);
+        default:
+            return t->truth[spd_view_field(v, (SpdField)t->key)];
+    }
+}
+
+bool spd_query_match(const SpdQuery *q, const uint8_t image[SPD_DDR3_SIZE])
+{
+    SpdView v;
+    spd_view_init(&v, image);
+    for (int g = 0; g < q->groups; g++) {
+        bool match = true;
+        for (int n = 0; n < q->count && match; n++) {
+            if (q->terms[n].group == g)
+                match = term_match(&q->terms[n], &v);
+        }
+        if (match)
+            return true;
+    }
+    return false;
+}
+
+static int part_compare(const SpdIndex *x, uint32_t part, const char *s, size_t len)
+{
+    return strncmp(spd_index_part_name(x, part), s, len);
+}
+
+// First part whose name doesn't sort below the prefix
+static uint32_t part_lower_bound(const SpdIndex *x, const char *prefix, size_t len)
+{
+    uint32_t lo = 0, hi = x->part_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (part_compare(x, mid, prefix, len) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void add_postings(const SpdIndex *x, uint32_t part, uint64_t *bitmap)
+{
+    const uint32_t *p = x->postings + x->parts[part].postings;
+    for (uint32_t n = 0; n < x->parts[part].count; n++)
+        bitmap[p[n] / 64] |= 1ull << (p[n] % 64);
+}
+
+// Term bitmap from the index, false if the term isn't indexed
+static bool term_indexed(const SpdQueryTerm *t, const SpdIndex *x, uint64_t *bitmap)
+{
+    memset(bitmap, 0, x->words * sizeof(bitmap[0]));
+    if (t->key == SPD_KEY_PART) {
+        size_t prefix = t->op == SPD_OP_MATCH ? strcspn(t->text, "*?") : strlen(t->text);
+        for (uint32_t p = part_lower_bound(x, t->text, prefix); p < x->part_count; p++) {
+            const char *name = spd_index_part_name(x, p);
+            if (part_compare(x, p, t->text, prefix))
+                break;
+            if (t->op == SPD_OP_MATCH ? spd_glob(t->text, name, strlen(name)) : !strcmp(name, t->text))
+                add_postings(x, p, bitmap);
+        }
+        if (t->op == SPD_OP_NE) {
+            for (size_t w = 0; w < x->words; w++)
+                bitmap[w] = ~bitmap[w];
+        }
+        return true;
+    }
+
+    const SpdIndexColumn *c = spd_index_column(x, t->key);
+    if (!c)
+        return false;
+    for (uint32_t n = 0; n < c->values; n++) {
+        int value = c->value[n];
+        bool verdict = t->key == SPD_KEY_CAPACITY ? value_verdict(t, value) : t->truth[value & 0xff];
+        if (!verdict)
+            continue;
+        const uint64_t *b = c->bitmaps + n * x->words;
+        for (size_t w = 0; w < x->words; w++)
+            bitmap[w] |= b[w];
+    }
+    return true;
+}
+
+static bool is_indexed(const SpdQueryTerm *t, const SpdIndex *x)
+{
+    return x && (t->key == SPD_KEY_PART || spd_index_column(x, t->key));
+}
+
+size_t spd_query_run(const SpdQuery *q, const SpdIndex *x, const uint8_t *images, size_t count, uint64_t *result)
+{
+    size_t words = spd_bitmap_words(count);
+    uint64_t tail = count % 64 ? (1ull << (count % 64)) - 1 : ~0ull;
+    uint64_t *group = malloc(2 * words * sizeof(group[0]) + 1);
+    if (!group)
+        return 0;
+    uint64_t *term = group + words;
+    if (x && x->count != count)
+        x = NULL;
+
+    memset(result, 0, words * sizeof(result[0]));
+    for (int g = 0; g < q->groups; g++) {
+        memset(group, 0xff, words * sizeof(group[0]));
+        if (words)
+            group[words - 1] = tail;
+
+        // Indexed terms narrow the candidates with bitmap ANDs
+        bool scan = false;
+        for (int n = 0; n < q->count; n++) {
+            const SpdQueryTerm *t = &q->terms[n];
+            if (t->group != g)
+                continue;
+            if (is_indexed(t, x) && term_indexed(t, x, term)) {
+                for (size_t w = 0; w < words; w++)
+                    group[w] &= term[w];
+            } else {
+                scan = true;
+            }
+        }
+
+        // The rest is checked only for the remaining candidates
+        for (size_t w = 0; scan && w < words; w++) {
+            for (uint64_t bits = group[w]; bits; bits &= bits - 1) {
+                SpdView v;
+                spd_view_init(&v, images + (w * 64 + spd_ctz64(bits)) * SPD_DDR3_SIZE);
+                for (int n = 0; n < q->count; n++) {
+                    const SpdQueryTerm *t = &q->terms[n];
+                    if (t->group == g && !is_indexed(t, x) && !term_match(t, &v)) {
+                        group[w] &= ~(bits & (0 - bits));
+                        break;
+                    }
+                }
+            }
+        }
+        for (size_t w = 0; w < words; w++)
+            result[w] |= group[w];
+    }
+    free(group);
+
+    size_t matches = 0;
+    for (size_t w = 0; w < words; w++)
+        matches += spd_popcount64(result[w]);
+    return matches;
+}
@@ -0,0 +1,128 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/serialize.h>
+
+#include <string.h>
+
+#define DDR3_UNIT_OFFSET 119
+#define DDR3_CRC_OFFSET 126
+#define DDR4_UNIT_OFFSET 322
+
+static uint8_t bcd(int value)
+{
+    return (uint8_t)((value / 10 % 10) << 4 | value % 10);
+}
+
+static int from_bcd(uint8_t value)
+{
+    return (value >> 4) * 10 + (value & 15);
+}
+
+static void unit_bytes(const SpdUnit *u, uint8_t bytes[SPD_UNIT_SIZE])
+{
+    bytes[0] = u->location;
+    bytes[1] = bcd(u->year);
+    bytes[2] = bcd(u->week);
+    bytes[3] = (uint8_t)(u->serial >> 24);
+    bytes[4] = (uint8_t)(u->serial >> 16);
+    bytes[5] = (uint8_t)(u->serial >> 8);
+    bytes[6] = (uint8_t)u->serial;
+}
+
+bool spd_serializer_init(SpdSerializer *s, const uint8_t *image, size_t size)
+{
+    memset(s, 0, sizeof(s[0]));
+    if (size >= SPD_DDR4_SIZE && image[2] == SPD_DEVICE_TYPE_DDR4) {
+        s->size = SPD_DDR4_SIZE;
+        s->offset = DDR4_UNIT_OFFSET;
+    } else if (size >= SPD_DDR3_SIZE && image[2] == SPD_DEVICE_TYPE_DDR3) {
+        s->size = SPD_DDR3_SIZE;
+        s->offset = DDR3_UNIT_OFFSET;
+        // CRC over bytes 0 ~ 116 leaves the unit bytes out
+        s->crc_offset = image[0] & 0x80 ? 0 : DDR3_CRC_OFFSET;
+    } else {
+        return false;
+    }
+    memcpy(s->image, image, s->size);
+    if (!s->crc_offset)
+        return true;
+
+    static const uint8_t zeros[SPD_UNIT_SIZE];
+    s->prefix = (uint16_t)spd_crc16_update(0, image, s->offset);
+    s->base = (uint16_t)spd_crc16_update(s->prefix, zeros, SPD_UNIT_SIZE);
+    for (int k = 0; k < SPD_UNIT_SIZE; k++) {
+        uint8_t unit[SPD_UNIT_SIZE] = {0};
+        for (int b = 0; b < 256; b++) {
+            unit[k] = (uint8_t)b;
+            s->table[k][b] = (uint16_t)spd_crc16(unit, SPD_UNIT_SIZE);
+        }
+    }
+    return true;
+}
+
+void spd_unit_from_image(const SpdSerializer *s, SpdUnit *u)
+{
+    const uint8_t *bytes = s->image + s->offset;
+    u->location = bytes[0];
+    u->year = (uint8_t)from_bcd(bytes[1]);
+    u->week = (uint8_t)from_bcd(bytes[2]);
+    u->serial = (uint32_t)bytes[3] << 24 | (uint32_t)bytes[4] << 16 | (uint32_t)bytes[5] << 8 | bytes[6];
+}
+
+static void stamp(const SpdSerializer *s, const uint8_t bytes[SPD_UNIT_SIZE], int crc, uint8_t *out)
+{
+    memcpy(out, s->image, s->size);
+    memcpy(out + s->offset, bytes, SPD_UNIT_SIZE);
+    if (s->crc_offset) {
+        out[s->crc_offset] = (uint8_t)crc;
+        out[s->crc_offset + 1] = (uint8_t)(crc >> 8);
+    }
+}
+
+void spd_serialize(const SpdSerializer *s, const SpdUnit *u, uint8_t *out)
+{
+    uint8_t bytes[SPD_UNIT_SIZE];
+    unit_bytes(u, bytes);
+    int crc = s->base;
+    for (int k = 0; k < SPD_UNIT_SIZE; k++)
+        crc ^= s->table[k][bytes[k]];
+    stamp(s, bytes, crc, out);
+}
+
+void spd_serialize_range(const SpdSerializer *s, const SpdUnit *u, size_t count, uint8_t *out)
+{
+    uint8_t bytes[SPD_UNIT_SIZE];
+    unit_bytes(u, bytes);
+    // Location and date are the same for the whole range
+    int run = s->base ^ s->table[0][bytes[0]] ^ s->table[1][bytes[1]] ^ s->table[2][bytes[2]];
+    for (size_t n = 0; n < count; n++, out += s->size) {
+        uint32_t serial = u->serial + (uint32_t)n;
+        bytes[3] = (uint8_t)(serial >> 24);
+        bytes[4] = (uint8_t)(serial >> 16);
+        bytes[5] = (uint8_t)(serial >> 8);
+        bytes[6] = (uint8_t)serial;
+        int crc = run ^ s->table[3][bytes[3]] ^ s->table[4][bytes[4]] ^ s->table[5][bytes[5]] ^ s->table[6][bytes[6]];
+        stamp(s, bytes, crc, out);
+    }
+}
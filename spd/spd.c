@@ -22,24 +22,33 @@
  */
 
 #include <spd/spd.h>
+#include <spd/bits.h>
+#include <spd/decoder.h>
 
 #include <string.h>
 #include <stdio.h>
 
 // JEDEC Standard No. 21-C
+// Annex J: Serial Presence Detect (SPD) for DDR2 SDRAM Modules
 // Annex K: Serial Presence Detect (SPD) for DDR3 SDRAM Modules
+// Annex L: Serial Presence Detect (SPD) for DDR4 SDRAM Modules
 
 // 2.4 CRC: Bytes 126 ~ 127
-static int crc16(const uint8_t *data, size_t size)
+int spd_crc16(const uint8_t *data, size_t size)
+{
+    return spd_crc16_update(0, data, size);
+}
+
+// Continues a CRC over more data, spd_crc16() starts from 0
+int spd_crc16_update(int crc, const uint8_t *data, size_t size)
 {
-    int crc = 0;
     while (size--) {
         crc = crc ^ (int)*data++ << 8;
         for (int i = 0; i < 8; i++) {
             if (crc & 0x8000) {
-                crc = crc << 1 ^ 0x1021;
+                crc = (crc << 1 ^ 0x1021) & 0xFFFF;
             } else {
-                crc = crc << 1;
+                crc = (crc << 1) & 0xFFFF;
             }
         }
     }
@@ -51,154 +60,524 @@ static size_t crc_size(const SpdInfo *i)
     return i->CRC_Coverage ? 117 : 126;
 }
 
-static int sdram_capacity(const SpdInfo *i)
+// DDR4 CRC blocks: bytes 0 ~ 125 and 128 ~ 253, CRC in the last two bytes
+#define DDR4_CRC_BLOCK 128
+#define DDR4_CRC_SIZE 126
+
+#define DDR3_PART_NUMBER_OFFSET 128
+#define DDR3_PART_NUMBER_SIZE (145 - 128 + 1)
+#define DDR4_PART_NUMBER_OFFSET 329
+#define DDR4_PART_NUMBER_SIZE (348 - 329 + 1)
+
+// DDR2 checksum of bytes 0 ~ 62 at byte 63
+#define DDR2_CHECKSUM_BYTE 63
+#define DDR2_PART_NUMBER_OFFSET 73
+#define DDR2_PART_NUMBER_SIZE (90 - 73 + 1)
+
+// Value mapping tables, indexed by the raw field value masked to the field
+// width, so lookups never go out of bounds. Zero/NULL entries are reserved.
+
+static const int spd_map_crc_coverage[2] = { 125, 116 };
+static const int spd_map_bytes_total[8] = { 0, 256 };
+static const int spd_map_bytes_used[16] = { 0, 128, 176, 256 };
+static const int spd_map_sdram_capacity[16] = { 256, 512, 1024, 2048, 4096, 8192, 16384, 32768 };
+static const int spd_map_bank_bits[8] = { 8, 16, 32, 64 };
+static const int spd_map_column_bits[8] = { 9, 10, 11, 12 };
+static const int spd_map_row_bits[8] = { 12, 13, 14, 15, 16 };
+static const int spd_map_sdram_width[8] = { 4, 8, 16, 32 };
+static const int spd_map_ranks[8] = { 1, 2, 3, 4, 8 };
+static const int spd_map_bus_width[8] = { 8, 16, 32, 64 };
+static const int spd_map_bus_width_ext[4] = { 0, 8 };
+
+static const int spd_map_ddr2_bytes_total[16] = { 0, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384 };
+static const int spd_map_ddr2_ranks[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+// Byte 31 rank density, bit 0 ~ 4: 1 ~ 16 GB, bit 5 ~ 7: 128 ~ 512 MB
+static const int spd_map_ddr2_rank_density[8] = { 1024, 2048, 4096, 8192, 16384, 128, 256, 512 };
+
+static const int spd_map_ddr4_bytes_total[8] = { 0, 256, 512 };
+static const int spd_map_ddr4_bytes_used[16] = { 0, 128, 256, 384, 512 };
+static const int spd_map_ddr4_sdram_capacity[16] = { 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 12288, 24576 };
+static const int spd_map_ddr4_bank_bits[4] = { 4, 8 };
+static const int spd_map_ddr4_bank_groups[4] = { 0, 2, 4 };
+static const int spd_map_ddr4_row_bits[8] = { 12, 13, 14, 15, 16, 17, 18 };
+static const int spd_map_ddr4_ranks[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+static const char *const spd_map_device_type[256] = {
+    NULL,
+    "Standard FPM DRAM",
+    "EDO",
+    "Pipelined Nibble",
+    "SDRAM",
+    "ROM",
+    "DDR SGRAM",
+    "DDR SDRAM",
+    "DDR2 SDRAM",
+    "DDR2 SDRAM FB-DIMM",
+    "DDR2 SDRAM FB-DIMM PROBE",
+    "DDR3 SDRAM",
+    "DDR4 SDRAM",
+    // 0x0D is reserved
+    [0x0E] = "DDR4E SDRAM",
+    [0x0F] = "LPDDR3 SDRAM",
+    [0x10] = "LPDDR4 SDRAM",
+};
+
+static const char *const spd_map_module_type[16] = {
+    NULL,
+    "RDIMM (width = 133.35 mm nom)",
+    "UDIMM (width = 133.35 mm nom)",
+    "SO-DIMM (width = 67.6 mm nom)",
+    "Micro-DIMM (width = TBD mm nom)",
+    "Mini-RDIMM (width = 82.0 mm nom)",
+    "Mini-UDIMM (width = 82.0 mm nom)",
+    "Mini-CDIMM (width = 67.6 mm nom)",
+    "72b-SO-UDIMM (width = 67.6 mm nom)",
+    "72b-SO-RDIMM (width = 67.6 mm nom)",
+    "72b-SO-CDIMM (width = 67.6 mm nom)",
+    "LRDIMM (width = 133.35 mm nom)",
+    "16b-SO-DIMM (width = 67.6 mm nom)",
+    "32b-SO-DIMM (width = 67.6 mm nom)",
+};
+
+static const char *const spd_map_voltage[8] = {
+    "1.5 V operable",
+    NULL,
+    "1.35/1.5 V operable",
+    "1.35 V operable",
+    "1.25/1.5 V operable",
+    "1.25 V operable",
+    "1.25/1.35/1.5 V operable",
+    "1.25/1.35 V operable",
+};
+
+static const char *const spd_map_ddr2_module_type[64] = {
+    [0x01] = "RDIMM",
+    [0x02] = "UDIMM",
+    [0x04] = "SO-DIMM",
+    [0x08] = "Micro-DIMM",
+    [0x10] = "Mini-RDIMM",
+    [0x20] = "Mini-UDIMM",
+};
+
+static const char *const spd_map_ddr2_voltage[16] = {
+    "TTL/5 V tolerant",
+    "LVTTL",
+    "HSTL 1.5 V",
+    "SSTL 3.3 V",
+    "SSTL 2.5 V",
+    "SSTL 1.8 V",
+};
+
+static const char *const spd_map_ddr4_module_type[16] = {
+    NULL,
+    "RDIMM",
+    "UDIMM",
+    "SO-DIMM",
+    "LRDIMM",
+    "Mini-RDIMM",
+    "Mini-UDIMM",
+    NULL,
+    "72b-SO-RDIMM",
+    "72b-SO-UDIMM",
+    NULL,
+    NULL,
+    "16b-SO-DIMM",
+    "32b-SO-DIMM",
+};
+
+static const char *const spd_map_ddr4_voltage[4] = {
+    NULL,
+    "1.2 V operable",
+    NULL,
+    "1.2 V operable, endurant",
+};
+
+static const char *text(const char *s)
 {
-    return 256 << i->Total_SDRAM_capacity;
+    return s ? s : "Unknown";
 }
 
-static int sdram_width(const SpdInfo *i)
+#define FIELD_MASK(width) ((1u << (width)) - 1)
+#define FIELD_RAW(i, member, width) ((unsigned)(i)->member & FIELD_MASK(width))
+
+#define VALUE_TYPE_RAW int
+#define VALUE_TYPE_INT int
+#define VALUE_TYPE_STR const char *
+#define VALUE_RAW(map, raw) (int)(raw)
+#define VALUE_INT(map, raw) spd_map_##map[raw]
+#define VALUE_STR(map, raw) text(spd_map_##map[raw])
+
+// spd_field_value(): mapped number, raw value for text fields
+#define NUMBER_RAW(map, raw) VALUE_RAW(map, raw)
+#define NUMBER_INT(map, raw) VALUE_INT(map, raw)
+#define NUMBER_STR(map, raw) (int)(raw)
+
+// spd_field_text(): mapped text, NULL for numeric fields
+#define TEXT_RAW(map, raw) NULL
+#define TEXT_INT(map, raw) NULL
+#define TEXT_STR(map, raw) spd_map_##map[raw]
+
+// Validation masks are 32 bits wide and indexed by SpdField
+typedef char spd_fields_fit_mask[SPD_FIELD_COUNT <= 32 ? 1 : -1];
+
+// Per-field mapped value getters: field_ranks(i), field_voltage(i), ...
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+static VALUE_TYPE_##kind field_##key(const SpdInfo *i) \
+{ \
+    return VALUE_##kind(map, FIELD_RAW(i, member, width)); \
+}
+SPD_FIELDS(SPD_X)
+#undef SPD_X
+
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+static VALUE_TYPE_##kind ddr2_field_##key(const SpdInfo *i) \
+{ \
+    return VALUE_##kind(map, FIELD_RAW(i, member, width)); \
+}
+SPD_DDR2_FIELDS(SPD_X)
+#undef SPD_X
+
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+static VALUE_TYPE_##kind ddr4_field_##key(const SpdInfo *i) \
+{ \
+    return VALUE_##kind(map, FIELD_RAW(i, member, width)); \
+}
+SPD_DDR4_FIELDS(SPD_X)
+#undef SPD_X
+
+static const SpdFieldInfo spd_fields[SPD_FIELD_COUNT] = {
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+    { #key, label, byte, shift, width, SPD_KIND_##kind },
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+};
+
+const SpdFieldInfo *spd_field_info(SpdField f)
 {
-    switch (i->SDRAM_Device_Width) {
-        case 0: return 4;
-        case 1: return 8;
-        case 2: return 16;
-        case 3: return 32;
-        default: return 0;
-    }
+    return (unsigned)f < SPD_FIELD_COUNT ? &spd_fields[f] : NULL;
+}
+
+SpdField spd_field_find(const char *key)
+{
+    int f = 0;
+    while (f < SPD_FIELD_COUNT && strcmp(spd_fields[f].key, key))
+        f++;
+    return (SpdField)f;
 }
 
-static int primary_bus_width(const SpdInfo *i)
+int spd_field_value(SpdField f, int raw)
 {
-    switch (i->Primary_bus_width) {
-        case 0: return 8;
-        case 1: return 16;
-        case 2: return 32;
-        case 3: return 64;
+    switch (f) {
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+        case SPD_FIELD_##ID: return NUMBER_##kind(map, (unsigned)raw & FIELD_MASK(width));
+        SPD_FIELDS(SPD_X)
+#undef SPD_X
         default: return 0;
     }
 }
 
-static int ranks(const SpdInfo *i)
+const char *spd_field_text(SpdField f, int raw)
 {
-    switch (i->Number_of_Ranks) {
-        case 0: return 1;
-        case 1: return 2;
-        case 2: return 3;
-        case 3: return 4;
-        case 4: return 8;
-        default: return 0;
+    switch (f) {
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+        case SPD_FIELD_##ID: return TEXT_##kind(map, (unsigned)raw & FIELD_MASK(width));
+        SPD_FIELDS(SPD_X)
+#undef SPD_X
+        default: return NULL;
     }
 }
 
-static int bytes_total(const SpdInfo *i)
+// Mapped value printed with the field format ("4096 Mbits"), returns snprintf() result
+int spd_field_format(SpdField f, int raw, char *buf, size_t size)
 {
-    switch (i->SPD_Bytes_Total) {
-        case 1: return 256;
-        default: return 0;
+    switch (f) {
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+        case SPD_FIELD_##ID: return snprintf(buf, size, format, VALUE_##kind(map, (unsigned)raw & FIELD_MASK(width)));
+        SPD_FIELDS(SPD_X)
+#undef SPD_X
+        default: return snprintf(buf, size, "Unknown");
     }
 }
 
-static int bytes_used(const SpdInfo *i)
+// Field tables of every generation for lookups by key, INT fields carry
+// their mapping table to turn values back into raw encodings
+typedef struct FieldEntry
 {
-    switch (i->SPD_Bytes_Used) {
-        case 1: return 128;
-        case 2: return 176;
-        case 3: return 256;
-        default: return 0;
+    SpdFieldInfo info;
+    const int *map;
+    int map_size;
+} FieldEntry;
+
+#define FIELD_MAP_RAW(map) NULL, 0
+#define FIELD_MAP_INT(map) spd_map_##map, (int)(sizeof(spd_map_##map) / sizeof(spd_map_##map[0]))
+#define FIELD_MAP_STR(map) NULL, 0
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+    { { #key, label, byte, shift, width, SPD_KIND_##kind }, FIELD_MAP_##kind(map) },
+static const FieldEntry ddr2_field_entries[] = { SPD_DDR2_FIELDS(SPD_X) };
+static const FieldEntry ddr3_field_entries[] = { SPD_FIELDS(SPD_X) };
+static const FieldEntry ddr4_field_entries[] = { SPD_DDR4_FIELDS(SPD_X) };
+#undef SPD_X
+
+// Unknown device types use the DDR3 layout as the decoder does
+static const FieldEntry *field_entry(int device_type, const char *key)
+{
+    const FieldEntry *table = ddr3_field_entries;
+    size_t count = sizeof(ddr3_field_entries) / sizeof(ddr3_field_entries[0]);
+    if (device_type == SPD_DEVICE_TYPE_DDR2) {
+        table = ddr2_field_entries;
+        count = sizeof(ddr2_field_entries) / sizeof(ddr2_field_entries[0]);
+    } else if (device_type == SPD_DEVICE_TYPE_DDR4) {
+        table = ddr4_field_entries;
+        count = sizeof(ddr4_field_entries) / sizeof(ddr4_field_entries[0]);
     }
+    for (size_t n = 0; n < count; n++) {
+        if (!strcmp(table[n].info.key, key))
+            return &table[n];
+    }
+    return NULL;
 }
 
-static const char* device_name(const SpdInfo *i)
+const SpdFieldInfo *spd_field_locate(int device_type, const char *key)
 {
-    switch (i->DRAM_Device_Type)
-    {
-        case 1: return "Standard FPM DRAM";
-        case 2: return "EDO";
-        case 3: return "Pipelined Nibble";
-        case 4: return "SDRAM";
-        case 5: return "ROM";
-        case 6: return "DDR SGRAM";
-        case 7: return "DDR SDRAM";
-        case 8: return "DDR2 SDRAM";
-        case 9: return "DDR2 SDRAM FB-DIMM";
-        case 10: return "DDR2 SDRAM FB-DIMM PROBE";
-        case 11: return "DDR3 SDRAM";
-        default: return "Unknown";
+    const FieldEntry *e = field_entry(device_type, key);
+    return e ? &e->info : NULL;
+}
+
+// INT fields take the mapped value ("ranks=2" is raw 1), the others the
+// raw value. -1 for unknown keys and values without an encoding.
+int spd_field_raw(int device_type, const char *key, int value)
+{
+    const FieldEntry *e = field_entry(device_type, key);
+    if (!e)
+        return -1;
+    int count = (int)FIELD_MASK(e->info.width) + 1;
+    if (!e->map)
+        return value >= 0 && value < count ? value : -1;
+    for (int raw = 0; raw < count && raw < e->map_size; raw++) {
+        if (e->map[raw] == value)
+            return raw;
     }
+    return -1;
+}
+
+int spd_capacity(int sdram_capacity, int bus_width, int ranks, int sdram_width)
+{
+    int bus = spd_map_bus_width[bus_width & 7] * spd_map_ranks[ranks & 7];
+    int width = 8 * spd_map_sdram_width[sdram_width & 7];
+    return width ? spd_map_sdram_capacity[sdram_capacity & 15] * bus / width : 0;
 }
 
-static const char* module_type(const SpdInfo *i)
+static int ddr4_capacity(const SpdInfo *i)
 {
-    switch (i->Module_Type)
-    {
-        case 1: return "RDIMM (width = 133.35 mm nom)";
-        case 2: return "UDIMM (width = 133.35 mm nom)";
-        case 3: return "SO-DIMM (width = 67.6 mm nom)";
-        case 4: return "Micro-DIMM (width = TBD mm nom)";
-        case 5: return "Mini-RDIMM (width = 82.0 mm nom)";
-        case 6: return "Mini-UDIMM (width = 82.0 mm nom)";
-        case 7: return "Mini-CDIMM (width = 67.6 mm nom)";
-        case 8: return "72b-SO-UDIMM (width = 67.6 mm nom)";
-        case 9: return "72b-SO-RDIMM (width = 67.6 mm nom)";
-        case 10: return "72b-SO-CDIMM (width = 67.6 mm nom)";
-        case 11: return "LRDIMM (width = 133.35 mm nom)";
-        case 12: return "16b-SO-DIMM (width = 67.6 mm nom)";
-        case 13: return "32b-SO-DIMM (width = 67.6 mm nom)";
-        default: return "Unknown";
+    int bus = ddr4_field_bus_width(i) * ddr4_field_ranks(i);
+    int width = 8 * ddr4_field_sdram_width(i);
+    return width ? ddr4_field_sdram_capacity(i) * bus / width : 0;
+}
+
+// 1.1 Timebases: MTB = byte 10 / byte 11 ns, FTB = byte 9 bits 7~4 / 3~0 ps
+#define FTB_BYTE 9
+#define MTB_DIVIDEND_BYTE 10
+#define MTB_DIVISOR_BYTE 11
+
+// DDR4 byte 17: MTB bits 3~2 and FTB bits 1~0, only 0 (125 ps and 1 ps) is defined
+#define DDR4_TIMEBASES_BYTE 17
+
+// CAS Latencies Supported, bytes 14 ~ 15: bit 0 of byte 14 is CL 4
+#define CAS_LATENCIES_BYTE 14
+#define CAS_LATENCY_MIN 4
+
+// DDR4 bytes 20 ~ 23: bit 0 of byte 20 is CL 7, or CL 23 if byte 23 bit 7 is set
+#define DDR4_CAS_LATENCIES_BYTE 20
+#define DDR4_CAS_LATENCY_MIN 7
+#define DDR4_CAS_LATENCY_HIGH 23
+
+// MTB = mtb_dividend / mtb_divisor ns, FTB = ftb_dividend / ftb_divisor ps,
+// zero divisors mark an undefined timebase
+typedef struct Timebase
+{
+    int64_t mtb_dividend;
+    int64_t mtb_divisor;
+    int64_t ftb_dividend;
+    int64_t ftb_divisor;
+} Timebase;
+
+static Timebase ddr3_timebase(const uint8_t data[SPD_DDR3_SIZE])
+{
+    Timebase tb = { data[MTB_DIVIDEND_BYTE], data[MTB_DIVISOR_BYTE], data[FTB_BYTE] >> 4, data[FTB_BYTE] & 15 };
+    return tb;
+}
+
+static Timebase ddr4_timebase(const uint8_t data[SPD_DDR3_SIZE])
+{
+    Timebase tb = { 1, 8, 1, 1 };
+    if (data[DDR4_TIMEBASES_BYTE] & 15)
+        memset(&tb, 0, sizeof(tb));
+    return tb;
+}
+
+// JEDEC rounding algorithm: clocks = ceil(t / tCK) with a 2.5% guard band
+// for timebase truncation, in thousandths of a clock
+#define CLOCKS_GUARD_BAND 974
+
+#define TIMING_COUNT(data, lsb, msb, shift, width) \
+    ((int)(data)[lsb] | (int)(((unsigned)(data)[msb] >> (shift)) & FIELD_MASK(width)) << 8)
+#define TIMING_FINE(data, fine) ((fine) ? (int)(int8_t)(data)[fine] : 0)
+
+// t = count * MTB + fine * FTB in ps, exact over the common denominator
+// and rounded to the nearest picosecond
+static int timing_ps(Timebase tb, int count, int fine)
+{
+    if (!tb.mtb_divisor)
+        return 0;
+    if (!tb.ftb_divisor) {
+        tb.ftb_dividend = 0;
+        tb.ftb_divisor = 1;
     }
+    int64_t num = (int64_t)count * tb.mtb_dividend * 1000 * tb.ftb_divisor + (int64_t)fine * tb.ftb_dividend * tb.mtb_divisor;
+    int64_t den = tb.mtb_divisor * tb.ftb_divisor;
+    return num > 0 ? (int)((num + den / 2) / den) : 0;
 }
 
-static const char* module_voltage(const SpdInfo *i)
+int spd_timing_ps(const uint8_t data[SPD_DDR3_SIZE], SpdTiming t)
 {
-    switch (i->Module_Minimum_Nominal_Voltage)
-    {
-        case 0b000: return "1.5 V operable";
-        case 0b010: return "1.35/1.5 V operable";
-        case 0b011: return "1.35 V operable";
-        case 0b100: return "1.25/1.5 V operable";
-        case 0b101: return "1.25 V operable";
-        case 0b110: return "1.25/1.35/1.5 V operable";
-        case 0b111: return "1.25/1.35 V operable";
-        default: return "Unknown";
+    Timebase tb = ddr3_timebase(data);
+    switch (t) {
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) \
+        case SPD_TIMING_##ID: return timing_ps(tb, TIMING_COUNT(data, lsb, msb, shift, width), TIMING_FINE(data, fine));
+        SPD_TIMINGS(SPD_X)
+#undef SPD_X
+        default: return 0;
     }
 }
 
-bool spd_decode(SpdInfo *i, const uint8_t byte[SPD_SIZE_MAX])
+int spd_timing_clocks(int ps, int tck_ps)
+{
+    return tck_ps > 0 ? (int)(((int64_t)ps * 1000 / tck_ps + CLOCKS_GUARD_BAND) / 1000) : 0;
+}
+
+static const struct { const char *key, *label; } spd_timings[SPD_TIMING_COUNT] = {
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) { #key, label },
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+};
+
+const char *spd_timing_key(SpdTiming t)
+{
+    return (unsigned)t < SPD_TIMING_COUNT ? spd_timings[t].key : NULL;
+}
+
+const char *spd_timing_label(SpdTiming t)
+{
+    return (unsigned)t < SPD_TIMING_COUNT ? spd_timings[t].label : NULL;
+}
+
+// Bit N set for supported CL N
+int spd_cas_latencies(const uint8_t data[SPD_DDR3_SIZE])
+{
+    return (data[CAS_LATENCIES_BYTE] | (data[CAS_LATENCIES_BYTE + 1] & 0x7f) << 8) << CAS_LATENCY_MIN;
+}
+
+// CL above 30 doesn't fit the mask and is dropped
+static int ddr4_cas_latencies(const uint8_t data[SPD_DDR3_SIZE])
+{
+    const uint8_t *cl = data + DDR4_CAS_LATENCIES_BYTE;
+    uint64_t mask = cl[0] | (uint64_t)cl[1] << 8 | (uint64_t)cl[2] << 16 | (uint64_t)(cl[3] & 0x3f) << 24;
+    int min = cl[3] & 0x80 ? DDR4_CAS_LATENCY_HIGH : DDR4_CAS_LATENCY_MIN;
+    return (int)(mask << min & 0x7fffffff);
+}
+
+int spd_cas_latency(int supported, int taa_ps, int tck_ps)
+{
+    int clocks = spd_timing_clocks(taa_ps, tck_ps);
+    uint64_t usable = tck_ps > 0 && taa_ps > 0 && clocks < 63 ? (uint64_t)(unsigned)supported & ~((1ull << clocks) - 1) : 0;
+    return usable ? spd_ctz64(usable) : 0;
+}
+
+static void decode_timebases(SpdInfo *i, Timebase tb)
+{
+    i->Medium_Timebase_fs = tb.mtb_divisor ? (int)(tb.mtb_dividend * 1000000 / tb.mtb_divisor) : 0;
+    i->Fine_Timebase_fs = tb.ftb_divisor ? (int)(tb.ftb_dividend * 1000 / tb.ftb_divisor) : 0;
+}
+
+static void decode_clocks(SpdInfo *i)
+{
+#define SPD_X(ID, key, member, ...) \
+    i->member##_nCK = spd_timing_clocks(i->member, i->tCKmin);
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+    i->CAS_Latency = spd_cas_latency(i->CAS_Latencies_Supported, i->tAAmin, i->tCKmin);
+}
+
+void spd_decode_timings(SpdInfo *i, const uint8_t data[SPD_DDR3_SIZE])
+{
+    decode_timebases(i, ddr3_timebase(data));
+#define SPD_X(ID, key, member, ...) \
+    i->member = spd_timing_ps(data, SPD_TIMING_##ID);
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) \
+    i->member##_MTB = TIMING_COUNT(data, lsb, msb, shift, width); \
+    i->member##_FTB = TIMING_FINE(data, fine);
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+    i->CAS_Latencies_Supported = spd_cas_latencies(data);
+    decode_clocks(i);
+}
+
+static void ddr4_decode_timings(SpdInfo *i, const uint8_t data[SPD_DDR3_SIZE])
+{
+    Timebase tb = ddr4_timebase(data);
+    decode_timebases(i, tb);
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) \
+    i->member##_MTB = (lsb) ? TIMING_COUNT(data, lsb, msb, shift, width) : 0; \
+    i->member##_FTB = (lsb) ? TIMING_FINE(data, fine) : 0; \
+    i->member = timing_ps(tb, i->member##_MTB, i->member##_FTB);
+    SPD_DDR4_TIMINGS(SPD_X)
+#undef SPD_X
+    i->CAS_Latencies_Supported = ddr4_cas_latencies(data);
+    decode_clocks(i);
+}
+
+static bool ddr4_decode(SpdInfo *i, const uint8_t *byte, size_t size)
 {
     memset(i, 0, sizeof(i[0]));
 
-    i->CRC_Coverage = byte[0] >> 7;
-    i->SPD_Bytes_Total = (byte[0] >> 4) & 0b111;
-    i->SPD_Bytes_Used = byte[0] & 0b1111;
+#define SPD_X(ID, key, member, byte_, shift, width, valid, kind, map, label, format) \
+    i->member = (byte[byte_] >> (shift)) & FIELD_MASK(width);
+    SPD_DDR4_FIELDS(SPD_X)
+#undef SPD_X
 
-    i->SPD_Revision.Encoding_Level = byte[1] >> 4;
-    i->SPD_Revision.Encoding_Level = byte[1] & 0b1111;
+    i->Module_Capacity = ddr4_capacity(i);
+    // Manufacturing information is on the upper page
+    if (size >= DDR4_PART_NUMBER_OFFSET + DDR4_PART_NUMBER_SIZE)
+        memcpy(i->Module_Part_Number, byte + DDR4_PART_NUMBER_OFFSET, DDR4_PART_NUMBER_SIZE);
+    ddr4_decode_timings(i, byte);
 
-    i->DRAM_Device_Type = byte[2];
-    if (i->DRAM_Device_Type != 11) {
-        printf("Unsupported device type: %s (%d)", device_name(i), i->DRAM_Device_Type);
-        return false;
-    }
-    i->Module_Type = byte[3] & 0b1111;
+    i->CRC = byte[DDR4_CRC_SIZE] | (byte[DDR4_CRC_SIZE + 1] << 8);
+    i->CRC_real = spd_crc16(byte, DDR4_CRC_SIZE);
+    i->CRC_Module = byte[DDR4_CRC_BLOCK + DDR4_CRC_SIZE] | (byte[DDR4_CRC_BLOCK + DDR4_CRC_SIZE + 1] << 8);
+    i->CRC_Module_real = spd_crc16(byte + DDR4_CRC_BLOCK, DDR4_CRC_SIZE);
+    return spd_crc_ok(i);
+}
 
-    i->Total_SDRAM_capacity = byte[4] & 0b1111;
-    i->Bank_Address_Bits = (byte[4] >> 4) & 0b111;
-    i->Column_Address_Bits = byte[5] & 0b111;
-    i->Row_Address_Bits = (byte[5] >> 3) & 0b111;
+static bool ddr3_decode(SpdInfo *i, const uint8_t *byte, size_t size)
+{
+    (void)size;
+    memset(i, 0, sizeof(i[0]));
 
-    i->Module_Minimum_Nominal_Voltage = byte[6] & 0b111;
+#define SPD_X(ID, key, member, byte_, shift, width, valid, kind, map, label, format) \
+    i->member = (byte[byte_] >> (shift)) & FIELD_MASK(width);
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
 
-    i->SDRAM_Device_Width = byte[7] & 0b111;
-    i->Number_of_Ranks = (byte[7] >> 3) & 0b111;
-    i->Primary_bus_width = byte[8] & 0b111;
-    i->Bus_width_extension = (byte[8] >> 3) & 0b11;
-    i->Module_Capacity = (sdram_capacity(i) * primary_bus_width(i) * ranks(i)) / (8 * sdram_width(i));
+    i->Module_Capacity = spd_capacity(i->Total_SDRAM_capacity, i->Primary_bus_width, i->Number_of_Ranks, i->SDRAM_Device_Width);
 
-    memcpy(i->Module_Part_Number, byte + 128, sizeof(i->Module_Part_Number) - 1);
+    memcpy(i->Module_Part_Number, byte + DDR3_PART_NUMBER_OFFSET, DDR3_PART_NUMBER_SIZE);
+    spd_decode_timings(i, byte);
 
     i->CRC = byte[126] | (byte[127] << 8);
 
-    i->CRC_real = crc16(byte, crc_size(i));
+    i->CRC_real = spd_crc16(byte, crc_size(i));
     if (i->CRC != i->CRC_real) {
         //printf("CRC invalid: 0x%04x(spd) != 0x%04x(real)\n", i->CRC, i->CRC_real);
         return false;
@@ -206,19 +585,372 @@ bool spd_decode(SpdInfo *i, const uint8_t byte[SPD_SIZE_MAX])
     return true;
 }
 
-bool spd_fix_crc(uint8_t byte[SPD_SIZE_MAX], SpdInfo *i)
+// Fields are decoded with the DDR3 layout for the record
+static bool unsupported_decode(SpdInfo *i, const uint8_t *byte, size_t size)
+{
+    (void)size;
+    memset(i, 0, sizeof(i[0]));
+
+#define SPD_X(ID, key, member, byte_, shift, width, valid, kind, map, label, format) \
+    i->member = (byte[byte_] >> (shift)) & FIELD_MASK(width);
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+
+    return false;
+}
+
+// tCK: ns in bits 7 ~ 4, tenths in bits 3 ~ 0 with 0xa ~ 0xd for .25, .33, .66, .75
+static const int ddr2_tck_fraction_ps[16] = { 0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 250, 333, 667, 750 };
+// Byte 40 extensions of tRC (bits 6 ~ 4) and tRFC (bits 3 ~ 1)
+static const int ddr2_fraction_ps[8] = { 0, 250, 333, 500, 667, 750 };
+
+static int ddr2_quarter_ps(uint8_t b)
+{
+    return (b >> 2) * 1000 + (b & 3) * 250;
+}
+
+static void ddr2_decode_timings(SpdInfo *i, const uint8_t *byte)
+{
+    // Byte 9 is tCK at the highest supported CL
+    i->tCKmin = (byte[9] >> 4) * 1000 + ddr2_tck_fraction_ps[byte[9] & 15];
+    i->CAS_Latencies_Supported = byte[18];
+    int cl = 0;
+    for (int n = 0; n < 8; n++) {
+        if (byte[18] >> n & 1)
+            cl = n;
+    }
+    i->tAAmin = cl * i->tCKmin;
+    i->tRPmin = ddr2_quarter_ps(byte[27]);
+    i->tRRDmin = ddr2_quarter_ps(byte[28]);
+    i->tRCDmin = ddr2_quarter_ps(byte[29]);
+    i->tRASmin = byte[30] * 1000;
+    i->tWRmin = ddr2_quarter_ps(byte[36]);
+    i->tWTRmin = ddr2_quarter_ps(byte[37]);
+    i->tRTPmin = ddr2_quarter_ps(byte[38]);
+    i->tRCmin = byte[41] * 1000 + ddr2_fraction_ps[byte[40] >> 4 & 7];
+    i->tRFCmin = (byte[42] + (byte[40] & 1) * 256) * 1000 + ddr2_fraction_ps[byte[40] >> 1 & 7];
+    decode_clocks(i);
+}
+
+static bool ddr2_decode(SpdInfo *i, const uint8_t *byte, size_t size)
+{
+    (void)size;
+    memset(i, 0, sizeof(i[0]));
+
+#define SPD_X(ID, key, member, byte_, shift, width, valid, kind, map, label, format) \
+    i->member = (byte[byte_] >> (shift)) & FIELD_MASK(width);
+    SPD_DDR2_FIELDS(SPD_X)
+#undef SPD_X
+
+    int density = byte[31] ? spd_map_ddr2_rank_density[spd_ctz64(byte[31])] : 0;
+    i->Module_Capacity = density * ddr2_field_ranks(i);
+    memcpy(i->Module_Part_Number, byte + DDR2_PART_NUMBER_OFFSET, DDR2_PART_NUMBER_SIZE);
+    ddr2_decode_timings(i, byte);
+
+    int sum = 0;
+    for (int n = 0; n < DDR2_CHECKSUM_BYTE; n++)
+        sum += byte[n];
+    i->CRC = byte[DDR2_CHECKSUM_BYTE];
+    i->CRC_real = sum & 0xff;
+    return i->CRC == i->CRC_real;
+}
+
+// Encoded bits go to data and are marked in mask, either may be NULL
+typedef struct Encoder
+{
+    uint8_t *data;
+    uint8_t *mask;
+} Encoder;
+
+static void put_bits(Encoder *e, int byte, int shift, int width, int value)
+{
+    uint8_t bits = (uint8_t)(FIELD_MASK(width) << shift);
+    if (e->data)
+        e->data[byte] = (uint8_t)((e->data[byte] & ~bits) | (((unsigned)value << shift) & bits));
+    if (e->mask)
+        e->mask[byte] |= bits;
+}
+
+static void put_bytes(Encoder *e, int offset, const char *bytes, int size)
+{
+    for (int n = 0; n < size; n++)
+        put_bits(e, offset + n, 0, 8, (uint8_t)bytes[n]);
+}
+
+// Lowest terms fraction dividend / divisor that decode_timebases() maps to
+// fs, 0 / 0 for an undefined timebase
+static bool timebase_fraction(int fs, int64_t unit, int max, int64_t *dividend, int64_t *divisor)
+{
+    *dividend = *divisor = 0;
+    if (!fs)
+        return true;
+    for (int64_t d = 1; d <= max; d++) {
+        int64_t n = (fs * d + unit - 1) / unit;
+        if (n <= max && n * unit / d == fs) {
+            *dividend = n;
+            *divisor = d;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The stored counts while they still give ps, otherwise ps rounded up to
+// MTB with a negative FTB correction as JEDEC recommends
+static void timing_encode(Timebase tb, int ps, int mtb, int ftb, int width, bool has_fine, int *count, int *fine)
+{
+    int max = (int)FIELD_MASK(8 + width);
+    if (mtb >= 0 && mtb <= max && (has_fine ? ftb >= -128 && ftb <= 127 : !ftb) && timing_ps(tb, mtb, ftb) == ps) {
+        *count = mtb;
+        *fine = ftb;
+        return;
+    }
+    *count = *fine = 0;
+    if (!tb.mtb_divisor || !tb.mtb_dividend || ps <= 0)
+        return;
+    int64_t unit = tb.mtb_dividend * 1000;
+    int64_t c = ((int64_t)ps * tb.mtb_divisor + unit - 1) / unit;
+    *count = (int)(c < max ? c : max);
+    if (has_fine && tb.ftb_divisor && tb.ftb_dividend) {
+        // (ps - count * MTB) / FTB rounded to nearest, the remainder is <= 0
+        int64_t num = ((int64_t)ps * tb.mtb_divisor - *count * unit) * tb.ftb_divisor;
+        int64_t den = tb.ftb_dividend * tb.mtb_divisor;
+        int64_t f = (num - den / 2) / den;
+        *fine = (int)(f < -128 ? -128 : f > 127 ? 127 : f);
+    }
+}
+
+#define SPD_ENCODE_TIMING(e, tb, i, member, lsb, msb, shift, width, fine) \
+    do { \
+        int count_, fine_; \
+        timing_encode(tb, (i)->member, (i)->member##_MTB, (i)->member##_FTB, width, (fine) != 0, &count_, &fine_); \
+        put_bits(e, lsb, 0, 8, count_); \
+        if (width) \
+            put_bits(e, msb, shift, width, count_ >> 8); \
+        if (fine) \
+            put_bits(e, fine, 0, 8, fine_); \
+    } while (0)
+
+static bool ddr3_encode(const SpdInfo *i, uint8_t *byte, uint8_t *mask)
+{
+    Encoder e = { byte, mask };
+    Timebase tb;
+    if (!timebase_fraction(i->Medium_Timebase_fs, 1000000, 255, &tb.mtb_dividend, &tb.mtb_divisor)
+        || !timebase_fraction(i->Fine_Timebase_fs, 1000, 15, &tb.ftb_dividend, &tb.ftb_divisor))
+        return false;
+
+#define SPD_X(ID, key, member, byte_, shift, width, valid, kind, map, label, format) \
+    put_bits(&e, byte_, shift, width, i->member);
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+
+    put_bits(&e, FTB_BYTE, 4, 4, (int)tb.ftb_dividend);
+    put_bits(&e, FTB_BYTE, 0, 4, (int)tb.ftb_divisor);
+    put_bits(&e, MTB_DIVIDEND_BYTE, 0, 8, (int)tb.mtb_dividend);
+    put_bits(&e, MTB_DIVISOR_BYTE, 0, 8, (int)tb.mtb_divisor);
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) \
+    SPD_ENCODE_TIMING(&e, tb, i, member, lsb, msb, shift, width, fine);
+    SPD_TIMINGS(SPD_X)
+#undef SPD_X
+    int cl = (int)((unsigned)i->CAS_Latencies_Supported >> CAS_LATENCY_MIN);
+    put_bits(&e, CAS_LATENCIES_BYTE, 0, 8, cl);
+    put_bits(&e, CAS_LATENCIES_BYTE + 1, 0, 7, cl >> 8);
+    put_bytes(&e, DDR3_PART_NUMBER_OFFSET, i->Module_Part_Number, DDR3_PART_NUMBER_SIZE);
+
+    if (byte) {
+        int crc = spd_crc16(byte, crc_size(i));
+        byte[126] = (uint8_t)crc;
+        byte[127] = (uint8_t)(crc >> 8);
+    }
+    return true;
+}
+
+static bool ddr4_encode(const SpdInfo *i, uint8_t *byte, uint8_t *mask)
+{
+    Encoder e = { byte, mask };
+    Timebase tb = { 1, 8, 1, 1 };
+    // Only the 125 ps MTB and 1 ps FTB are defined
+    if (byte && (i->Medium_Timebase_fs != 125000 || i->Fine_Timebase_fs != 1000))
+        return false;
+
+#define SPD_X(ID, key, member, byte_, shift, width, valid, kind, map, label, format) \
+    put_bits(&e, byte_, shift, width, i->member);
+    SPD_DDR4_FIELDS(SPD_X)
+#undef SPD_X
+
+    put_bits(&e, DDR4_TIMEBASES_BYTE, 0, 4, 0);
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) \
+    if (lsb) \
+        SPD_ENCODE_TIMING(&e, tb, i, member, lsb, msb, shift, width, fine);
+    SPD_DDR4_TIMINGS(SPD_X)
+#undef SPD_X
+    // CL 7 ~ 30 in the low range, the high range starts at CL 23. The range
+    // of data is kept while the latencies fit it, data without latencies
+    // gets the high range when they all fit there. Only latencies up to
+    // CL 30 are decoded, the bits above are kept from data in the same range
+    // and cleared when the range changes.
+    unsigned supported = (unsigned)i->CAS_Latencies_Supported;
+    bool high = !(supported & FIELD_MASK(DDR4_CAS_LATENCY_HIGH)) && supported;
+    uint8_t *above = byte ? byte + DDR4_CAS_LATENCIES_BYTE : NULL;
+    if (above && (above[0] || above[1] || above[2] || (above[3] & 0xbf)))
+        high = high && (above[3] & 0x80);
+    unsigned cl = supported >> (high ? DDR4_CAS_LATENCY_HIGH : DDR4_CAS_LATENCY_MIN);
+    if (above && high != !!(above[3] & 0x80)) {
+        // Bytes 21 and 22 are rewritten below in the low range
+        memset(above + 1, 0, 2);
+        above[3] &= 0xc0;
+    }
+    put_bits(&e, DDR4_CAS_LATENCIES_BYTE, 0, 8, (int)cl);
+    if (!high) {
+        put_bits(&e, DDR4_CAS_LATENCIES_BYTE + 1, 0, 8, (int)(cl >> 8));
+        put_bits(&e, DDR4_CAS_LATENCIES_BYTE + 2, 0, 8, (int)(cl >> 16));
+    }
+    put_bits(&e, DDR4_CAS_LATENCIES_BYTE + 3, 7, 1, high);
+    put_bytes(&e, DDR4_PART_NUMBER_OFFSET, i->Module_Part_Number, DDR4_PART_NUMBER_SIZE);
+
+    if (byte) {
+        for (int block = 0; block < 2; block++) {
+            uint8_t *b = byte + block * DDR4_CRC_BLOCK;
+            int crc = spd_crc16(b, DDR4_CRC_SIZE);
+            b[DDR4_CRC_SIZE] = (uint8_t)crc;
+            b[DDR4_CRC_SIZE + 1] = (uint8_t)(crc >> 8);
+        }
+    }
+    return true;
+}
+
+static int ddr2_find(const int *table, int count, int value)
+{
+    for (int n = 0; n < count; n++) {
+        if (table[n] == value)
+            return n;
+    }
+    return -1;
+}
+
+// Whole ns and one of the fractions of table, rounded up to the next ns
+// if the fraction isn't there
+static void ddr2_split_ps(int ps, const int *table, int count, int *ns, int *fraction)
+{
+    *ns = ps / 1000;
+    *fraction = ddr2_find(table, count, ps % 1000);
+    if (*fraction < 0) {
+        *ns += 1;
+        *fraction = 0;
+    }
+}
+
+static bool ddr2_encode(const SpdInfo *i, uint8_t *byte, uint8_t *mask)
+{
+    Encoder e = { byte, mask };
+    int ns, fraction;
+    ddr2_split_ps(i->tCKmin, ddr2_tck_fraction_ps, 14, &ns, &fraction);
+    if (byte && (ns > 15 || i->tCKmin % 1000 != ddr2_tck_fraction_ps[fraction]))
+        return false;
+
+#define SPD_X(ID, key, member, byte_, shift, width, valid, kind, map, label, format) \
+    put_bits(&e, byte_, shift, width, i->member);
+    SPD_DDR2_FIELDS(SPD_X)
+#undef SPD_X
+
+    put_bits(&e, 9, 4, 4, ns);
+    put_bits(&e, 9, 0, 4, fraction);
+    put_bits(&e, 18, 0, 8, i->CAS_Latencies_Supported);
+    int ranks = ddr2_field_ranks(i);
+    int density = ranks ? ddr2_find(spd_map_ddr2_rank_density, 8, i->Module_Capacity / ranks) : -1;
+    put_bits(&e, 31, 0, 8, density < 0 ? 0 : 1 << density);
+    // Quarter ns steps
+    put_bits(&e, 27, 0, 8, (i->tRPmin + 249) / 250);
+    put_bits(&e, 28, 0, 8, (i->tRRDmin + 249) / 250);
+    put_bits(&e, 29, 0, 8, (i->tRCDmin + 249) / 250);
+    put_bits(&e, 30, 0, 8, (i->tRASmin + 999) / 1000);
+    put_bits(&e, 36, 0, 8, (i->tWRmin + 249) / 250);
+    put_bits(&e, 37, 0, 8, (i->tWTRmin + 249) / 250);
+    put_bits(&e, 38, 0, 8, (i->tRTPmin + 249) / 250);
+    ddr2_split_ps(i->tRCmin, ddr2_fraction_ps, 6, &ns, &fraction);
+    put_bits(&e, 41, 0, 8, ns);
+    put_bits(&e, 40, 4, 3, fraction);
+    ddr2_split_ps(i->tRFCmin, ddr2_fraction_ps, 6, &ns, &fraction);
+    put_bits(&e, 42, 0, 8, ns);
+    put_bits(&e, 40, 0, 1, ns >> 8);
+    put_bits(&e, 40, 1, 3, fraction);
+    put_bytes(&e, DDR2_PART_NUMBER_OFFSET, i->Module_Part_Number, DDR2_PART_NUMBER_SIZE);
+
+    if (byte) {
+        int sum = 0;
+        for (int n = 0; n < DDR2_CHECKSUM_BYTE; n++)
+            sum += byte[n];
+        byte[DDR2_CHECKSUM_BYTE] = (uint8_t)sum;
+    }
+    return true;
+}
+
+void spd_encode_fields(const SpdInfo *i, uint8_t byte[SPD_DDR3_SIZE])
+{
+#define SPD_X(ID, key, member, byte_, shift, width, valid, kind, map, label, format) \
+    byte[byte_] = (uint8_t)((byte[byte_] & ~(FIELD_MASK(width) << (shift))) | (FIELD_RAW(i, member, width) << (shift)));
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+}
+
+uint32_t spd_validate_fields(const SpdInfo *i)
+{
+    uint32_t invalid = 0;
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+    invalid |= (valid ? (~((uint32_t)(valid) >> FIELD_RAW(i, member, width)) & 1u) : 0u) << SPD_FIELD_##ID;
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+    return invalid;
+}
+
+// Every CRC block matches, DDR3 has one block
+bool spd_crc_ok(const SpdInfo *i)
+{
+    return i->CRC == i->CRC_real && i->CRC_Module == i->CRC_Module_real;
+}
+
+// Rewrites only the CRC blocks that don't match
+static bool crc16_fix(uint8_t *byte, SpdInfo *i)
+{
+    if (spd_crc_ok(i)) {
+        return false;
+    }
+    if (i->CRC != i->CRC_real) {
+        i->CRC = i->CRC_real;
+        byte[126] = (uint8_t)i->CRC_real;
+        byte[127] = (uint8_t)(i->CRC_real >> 8);
+    }
+    if (i->CRC_Module != i->CRC_Module_real) {
+        i->CRC_Module = i->CRC_Module_real;
+        byte[DDR4_CRC_BLOCK + DDR4_CRC_SIZE] = (uint8_t)i->CRC_Module_real;
+        byte[DDR4_CRC_BLOCK + DDR4_CRC_SIZE + 1] = (uint8_t)(i->CRC_Module_real >> 8);
+    }
+    return true;
+}
+
+static bool ddr2_fix_checksum(uint8_t *byte, SpdInfo *i)
 {
     if (i->CRC == i->CRC_real) {
         return false;
     }
     i->CRC = i->CRC_real;
-    byte[126] = (uint8_t)i->CRC_real;
-    byte[127] = (uint8_t)(i->CRC_real >> 8);
+    byte[DDR2_CHECKSUM_BYTE] = (uint8_t)i->CRC_real;
     return true;
 }
 
-bool spd_enable_lp(uint8_t byte[SPD_SIZE_MAX], SpdInfo *i, bool enable)
+static bool unsupported_fix_crc(uint8_t *byte, SpdInfo *i)
 {
+    (void)byte;
+    (void)i;
+    return false;
+}
+
+// DDR3 only, DDR4 modules have no low voltage option
+bool spd_enable_lp(uint8_t byte[SPD_DDR3_SIZE], SpdInfo *i, bool enable)
+{
+    if (i->DRAM_Device_Type != SPD_DEVICE_TYPE_DDR3) {
+        return false;
+    }
     int VDD = byte[6] & 0b111;
     if (enable) {
         VDD |= 0b10;
@@ -230,76 +962,181 @@ bool spd_enable_lp(uint8_t byte[SPD_SIZE_MAX], SpdInfo *i, bool enable)
     }
     i->Module_Minimum_Nominal_Voltage = VDD;
     byte[6] = (uint8_t)VDD;
-    i->CRC_real = crc16(byte, crc_size(i));
+    i->CRC_real = spd_crc16(byte, crc_size(i));
     spd_fix_crc(byte, i);
     return true;
 }
 
 
-void spd_print(const SpdInfo *i, bool verbose)
+static void format_timing(SpdText *t, const char *label, int ps, int clocks)
+{
+    spd_text_printf(t, "%s:%*s%d.%03d ns (%d nCK)\n", label, 31 - (int)strlen(label), "", ps / 1000, ps % 1000, clocks);
+}
+
+static void format_cas_latencies(SpdText *t, const SpdInfo *i)
+{
+    spd_text_printf(t, "CAS Latencies Supported:       ");
+    for (int cl = 0; cl < 31; cl++) {
+        if (i->CAS_Latencies_Supported >> cl & 1)
+            spd_text_printf(t, " %d", cl);
+    }
+    spd_text_printf(t, "\nCAS Latency at tCKmin:          %d\n", i->CAS_Latency);
+}
+
+static void ddr3_format(const SpdInfo *i, bool verbose, SpdText *t)
 {
     if (verbose) {
-        printf(
-            "CRC Coverage:                   0...%zd (%d)\n"
-            "Bytes total:                    %d bytes (%d)\n"
-            "Bytes used:                     %d bytes (%d)\n"
-            "Revision:                       %d.%d\n"
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+        spd_text_printf(t, "%-32s" format " (%d)\n", label ":", field_##key(i), i->member);
+        SPD_FIELDS(SPD_X)
+#undef SPD_X
+        spd_text_printf(t,
+            "Module Capacity:                %d MBytes\n"
+            "Module Part Number:             %s\n"
+            "CRC:                            0x%04x %s\n"
+            , i->Module_Capacity
+            , i->Module_Part_Number
+            , i->CRC, i->CRC == i->CRC_real ? "OK" : "ERR"
+        );
+        spd_text_printf(t,
+            "Medium Timebase:                %d fs\n"
+            "Fine Timebase:                  %d fs\n"
+            , i->Medium_Timebase_fs
+            , i->Fine_Timebase_fs
+        );
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) \
+        format_timing(t, label, i->member, i->member##_nCK);
+        SPD_TIMINGS(SPD_X)
+#undef SPD_X
+        format_cas_latencies(t, i);
+    } else {
+        bool gbytes = i->Module_Capacity >= 1024;
+        spd_text_printf(t,
+            "SPD Bytes used/total:           %d/%d bytes (%d)\n"
             "DRAM Device Type:               %s (%d)\n"
             "Module Type:                    %s (%d)\n"
-            "Total SDRAM capacity:           %d Mbits (%d)\n"
-            "Bank Address Bits:              %d bits (%d)\n"
-            "Row Address Bits:               %d bits (%d)\n"
-            "Column Address Bits:            %d bits (%d)\n"
             "Module Minimum Nominal Voltage: %s (%d)\n"
-            "SDRAM Device Width:             %d (%d)\n"
-            "Number of Ranks:                %d (%d)\n"
-            "Primary bus width:              %d (%d)\n"
-            "Bus width extension:            %d (%d)\n"
+            "Module Capacity:                %d %s\n"
+            "Module Part Number:             %s\n"
+            "CRC[0...%zd]:                   0x%04x %s\n"
+            , field_bytes_used(i), field_bytes_total(i), i->SPD_Bytes_Used
+            , field_device_type(i), i->DRAM_Device_Type
+            , field_module_type(i), i->Module_Type
+            , field_voltage(i), i->Module_Minimum_Nominal_Voltage
+            , i->Module_Capacity / (gbytes ? 1024 : 1), gbytes ? "GB" : "MB"
+            , i->Module_Part_Number
+            , crc_size(i) - 1, i->CRC, i->CRC == i->CRC_real ? "OK" : "ERR"
+        );
+    }
+}
+
+static void ddr4_format(const SpdInfo *i, bool verbose, SpdText *t)
+{
+    if (verbose) {
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+        spd_text_printf(t, "%-32s" format " (%d)\n", label ":", ddr4_field_##key(i), i->member);
+        SPD_DDR4_FIELDS(SPD_X)
+#undef SPD_X
+        spd_text_printf(t,
             "Module Capacity:                %d MBytes\n"
             "Module Part Number:             %s\n"
             "CRC:                            0x%04x %s\n"
-            , crc_size(i) - 1, i->CRC_Coverage
-            , bytes_total(i), i->SPD_Bytes_Total
-            , bytes_used(i), i->SPD_Bytes_Used
-            , i->SPD_Revision.Encoding_Level, i->SPD_Revision.Additions_Level
-            , device_name(i), i->DRAM_Device_Type
-            , module_type(i), i->Module_Type
-            , sdram_capacity(i), i->Total_SDRAM_capacity
-            , 8 << i->Bank_Address_Bits, i->Bank_Address_Bits
-            , 12 + i->Row_Address_Bits, i->Row_Address_Bits
-            , 9 + i->Column_Address_Bits, i->Column_Address_Bits
-            , module_voltage(i), i->Module_Minimum_Nominal_Voltage
-            , sdram_width(i), i->SDRAM_Device_Width
-            , ranks(i), i->Number_of_Ranks
-            , primary_bus_width(i), i->Primary_bus_width
-            , i->Bus_width_extension, i->Bus_width_extension
+            "Module CRC:                     0x%04x %s\n"
             , i->Module_Capacity
             , i->Module_Part_Number
+            , i->CRC, i->CRC == i->CRC_real ? "OK" : "ERR"
+            , i->CRC_Module, i->CRC_Module == i->CRC_Module_real ? "OK" : "ERR"
+        );
+        spd_text_printf(t,
+            "Medium Timebase:                %d fs\n"
+            "Fine Timebase:                  %d fs\n"
+            , i->Medium_Timebase_fs
+            , i->Fine_Timebase_fs
+        );
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) \
+        if (lsb) \
+            format_timing(t, label, i->member, i->member##_nCK);
+        SPD_DDR4_TIMINGS(SPD_X)
+#undef SPD_X
+        format_cas_latencies(t, i);
+    } else {
+        bool gbytes = i->Module_Capacity >= 1024;
+        spd_text_printf(t,
+            "SPD Bytes used/total:           %d/%d bytes (%d)\n"
+            "DRAM Device Type:               %s (%d)\n"
+            "Module Type:                    %s (%d)\n"
+            "Module Nominal Voltage:         %s (%d)\n"
+            "Module Capacity:                %d %s\n"
+            "Module Part Number:             %s\n"
+            "CRC[0...125]:                   0x%04x %s\n"
+            "CRC[128...253]:                 0x%04x %s\n"
+            , ddr4_field_bytes_used(i), ddr4_field_bytes_total(i), i->SPD_Bytes_Used
+            , ddr4_field_device_type(i), i->DRAM_Device_Type
+            , ddr4_field_module_type(i), i->Module_Type
+            , ddr4_field_voltage(i), i->Module_Minimum_Nominal_Voltage
+            , i->Module_Capacity / (gbytes ? 1024 : 1), gbytes ? "GB" : "MB"
+            , i->Module_Part_Number
+            , i->CRC, i->CRC == i->CRC_real ? "OK" : "ERR"
+            , i->CRC_Module, i->CRC_Module == i->CRC_Module_real ? "OK" : "ERR"
+        );
+    }
+}
 
+static void ddr2_format(const SpdInfo *i, bool verbose, SpdText *t)
+{
+    if (verbose) {
+#define SPD_X(ID, key, member, byte, shift, width, valid, kind, map, label, format) \
+        spd_text_printf(t, "%-32s" format " (%d)\n", label ":", ddr2_field_##key(i), i->member);
+        SPD_DDR2_FIELDS(SPD_X)
+#undef SPD_X
+        spd_text_printf(t,
+            "Module Capacity:                %d MBytes\n"
+            "Module Part Number:             %s\n"
+            "Checksum:                       0x%02x %s\n"
+            , i->Module_Capacity
+            , i->Module_Part_Number
             , i->CRC, i->CRC == i->CRC_real ? "OK" : "ERR"
         );
+#define SPD_X(ID, key, member, lsb, msb, shift, width, fine, label) \
+        if (i->member) \
+            format_timing(t, label, i->member, i->member##_nCK);
+        SPD_TIMINGS(SPD_X)
+#undef SPD_X
+        format_cas_latencies(t, i);
     } else {
         bool gbytes = i->Module_Capacity >= 1024;
-        printf(
+        spd_text_printf(t,
             "SPD Bytes used/total:           %d/%d bytes (%d)\n"
             "DRAM Device Type:               %s (%d)\n"
             "Module Type:                    %s (%d)\n"
-            "Module Minimum Nominal Voltage: %s (%d)\n"
+            "Voltage Interface Level:        %s (%d)\n"
             "Module Capacity:                %d %s\n"
             "Module Part Number:             %s\n"
-            "CRC[0...%zd]:                   0x%04x %s\n"
-            , bytes_used(i), bytes_total(i), i->SPD_Bytes_Used
-            , device_name(i), i->DRAM_Device_Type
-            , module_type(i), i->Module_Type
-            , module_voltage(i), i->Module_Minimum_Nominal_Voltage
+            "Checksum[0...62]:               0x%02x %s\n"
+            , ddr2_field_bytes_used(i), ddr2_field_bytes_total(i), i->SPD_Bytes_Used
+            , ddr2_field_device_type(i), i->DRAM_Device_Type
+            , ddr2_field_module_type(i), i->Module_Type
+            , ddr2_field_voltage(i), i->Module_Minimum_Nominal_Voltage
             , i->Module_Capacity / (gbytes ? 1024 : 1), gbytes ? "GB" : "MB"
             , i->Module_Part_Number
-            , crc_size(i) - 1, i->CRC, i->CRC == i->CRC_real ? "OK" : "ERR"
+            , i->CRC, i->CRC == i->CRC_real ? "OK" : "ERR"
         );
     }
 }
 
-static const void parse_line(uint8_t data[SPD_SIZE_MAX], const char *line, size_t len)
+// Fields are shown with the DDR3 layout
+static void unsupported_format(const SpdInfo *i, bool verbose, SpdText *t)
+{
+    spd_text_printf(t, "Unsupported device type: %s (%d)\n", field_device_type(i), i->DRAM_Device_Type);
+    ddr3_format(i, verbose, t);
+}
+
+const SpdDecoder spd_decoder_unsupported = { "Unsupported", SPD_DDR3_SIZE, unsupported_decode, unsupported_format, unsupported_fix_crc, NULL };
+const SpdDecoder spd_decoder_ddr2 = { "DDR2", SPD_DDR3_SIZE, ddr2_decode, ddr2_format, ddr2_fix_checksum, ddr2_encode };
+const SpdDecoder spd_decoder_ddr3 = { "DDR3", SPD_DDR3_SIZE, ddr3_decode, ddr3_format, crc16_fix, ddr3_encode };
+const SpdDecoder spd_decoder_ddr4 = { "DDR4", SPD_DDR4_SIZE, ddr4_decode, ddr4_format, crc16_fix, ddr4_encode };
+
+static const void parse_line(uint8_t data[SPD_DDR3_SIZE], const char *line, size_t len)
 {
     bool is_len_valid = (len >= 71);
     if (!is_len_valid) {
@@ -316,7 +1153,7 @@ static const void parse_line(uint8_t data[SPD_SIZE_MAX], const char *line, size_
         , x + 8, x + 9, x +10, x +11
         , x +12, x +13, x +14, x +15
     );
-    if (tokens != 17 || address > (SPD_SIZE_MAX - 16)) {
+    if (tokens != 17 || address > (SPD_DDR3_SIZE - 16)) {
         return;
     }
     data += address;
@@ -325,7 +1162,7 @@ static const void parse_line(uint8_t data[SPD_SIZE_MAX], const char *line, size_
     }
 }
 
-void spd_parse_i2cdump(uint8_t data[SPD_SIZE_MAX], const char *dump)
+void spd_parse_i2cdump(uint8_t data[SPD_DDR3_SIZE], const char *dump)
 {
     while (dump[0]) {
         const char* eol = strstr(dump, "\n");
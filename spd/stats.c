@@ -0,0 +1,127 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/stats.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+void spd_stats_init(SpdStats *s)
+{
+    memset(s, 0, sizeof(s[0]));
+    spd_intern_init(&s->parts);
+}
+
+void spd_stats_free(SpdStats *s)
+{
+    spd_intern_free(&s->parts);
+    free(s->part_count);
+    memset(s, 0, sizeof(s[0]));
+}
+
+// Distinct values beyond the limit share the last bucket
+static void add_value(int *values, uint64_t *counts, int *size, int value, uint64_t count)
+{
+    int n = 0;
+    while (n < *size && values[n] != value)
+        n++;
+    if (n == *size) {
+        if (n == SPD_STATS_VALUES_MAX) {
+            n--;
+            value = -1;
+        } else {
+            (*size)++;
+        }
+        values[n] = value;
+    }
+    counts[n] += count;
+}
+
+static bool add_part(SpdStats *s, const char *part, size_t len, uint64_t count)
+{
+    uint32_t id = spd_intern(&s->parts, part, len);
+    if (id == SPD_INTERN_NONE)
+        return false;
+    if (id >= s->part_capacity) {
+        uint32_t capacity = s->part_capacity ? s->part_capacity * 2 : 1024;
+        uint64_t *part_count = realloc(s->part_count, capacity * sizeof(part_count[0]));
+        if (!part_count)
+            return false;
+        memset(part_count + s->part_capacity, 0, (capacity - s->part_capacity) * sizeof(part_count[0]));
+        s->part_count = part_count;
+        s->part_capacity = capacity;
+    }
+    s->part_count[id] += count;
+    return true;
+}
+
+// decoded - spd_decode() result, false for CRC errors and unsupported devices
+bool spd_stats_add(SpdStats *s, const SpdInfo *i, bool decoded)
+{
+    bool supported = i->DRAM_Device_Type == SPD_DEVICE_TYPE_DDR3;
+    s->images++;
+    s->unsupported += !supported;
+    s->crc_errors += supported && !decoded;
+    s->device_type[i->DRAM_Device_Type & 0xff]++;
+    if (!supported)
+        return true;
+
+    s->module_type[i->Module_Type & 15]++;
+    s->voltage[i->Module_Minimum_Nominal_Voltage & 7]++;
+    s->geometry[i->Number_of_Ranks & 7][i->SDRAM_Device_Width & 7]++;
+    s->cas_latency[i->CAS_Latency & 31]++;
+    add_value(s->capacity, s->capacity_count, &s->capacities, i->Module_Capacity, 1);
+    add_value(s->tck, s->tck_count, &s->tcks, i->tCKmin, 1);
+    size_t len = strlen(i->Module_Part_Number);
+    while (len && i->Module_Part_Number[len - 1] == ' ')
+        len--;
+    return add_part(s, i->Module_Part_Number, len, 1);
+}
+
+bool spd_stats_merge(SpdStats *s, const SpdStats *other)
+{
+    s->images += other->images;
+    s->crc_errors += other->crc_errors;
+    s->unsupported += other->unsupported;
+    for (int n = 0; n < 256; n++)
+        s->device_type[n] += other->device_type[n];
+    for (int n = 0; n < 16; n++)
+        s->module_type[n] += other->module_type[n];
+    for (int n = 0; n < 8; n++)
+        s->voltage[n] += other->voltage[n];
+    for (int r = 0; r < 8; r++) {
+        for (int w = 0; w < 8; w++)
+            s->geometry[r][w] += other->geometry[r][w];
+    }
+    for (int n = 0; n < 32; n++)
+        s->cas_latency[n] += other->cas_latency[n];
+    for (int n = 0; n < other->capacities; n++)
+        add_value(s->capacity, s->capacity_count, &s->capacities, other->capacity[n], other->capacity_count[n]);
+    for (int n = 0; n < other->tcks; n++)
+        add_value(s->tck, s->tck_count, &s->tcks, other->tck[n], other->tck_count[n]);
+    for (uint32_t id = 0; id < spd_intern_count(&other->parts); id++) {
+        if (!add_part(s, spd_intern_str(&other->parts, id), spd_intern_len(&other->parts, id), other->part_count[id]))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,155 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/txn.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+void spd_txn_begin(SpdTxn *t, uint8_t *data, size_t size)
+{
+    t->data = data;
+    t->size = size < SPD_SIZE_MAX ? size : SPD_SIZE_MAX;
+    t->edits = 0;
+    memcpy(t->original, data, t->size);
+}
+
+bool spd_txn_set_bits(SpdTxn *t, size_t offset, int shift, int width, int value)
+{
+    if (offset >= t->size || width < 1 || shift < 0 || shift + width > 8 || value < 0 || value >> width)
+        return false;
+    uint8_t bits = (uint8_t)(((1u << width) - 1) << shift);
+    t->data[offset] = (uint8_t)((t->data[offset] & ~bits) | (unsigned)value << shift);
+    t->edits++;
+    return true;
+}
+
+bool spd_txn_set_bytes(SpdTxn *t, size_t offset, const uint8_t *bytes, size_t count)
+{
+    if (offset > t->size || count > t->size - offset)
+        return false;
+    memcpy(t->data + offset, bytes, count);
+    t->edits++;
+    return true;
+}
+
+bool spd_txn_set_field(SpdTxn *t, const char *key, int value)
+{
+    const SpdFieldInfo *f = spd_field_locate(t->data[2], key);
+    int raw = spd_field_raw(t->data[2], key, value);
+    return f && raw >= 0 && spd_txn_set_bits(t, (size_t)f->byte, f->shift, f->width, raw);
+}
+
+static bool parse_number(const char *text, const char *end, long *value)
+{
+    char *stop;
+    if (text == end)
+        return false;
+    *value = strtol(text, &stop, 0);
+    return stop == end && *value >= 0;
+}
+
+static bool parse_range(SpdTxn *t, const char *edit, const char *dots, const char *value)
+{
+    long first, last;
+    if (!parse_number(edit, dots, &first) || !parse_number(dots + 2, value - 1, &last) || first > last)
+        return false;
+    size_t len = strlen(value);
+    if (len >= 2 && value[0] == '"' && value[len - 1] == '"') {
+        value++;
+        len -= 2;
+    }
+    size_t count = (size_t)(last - first + 1);
+    if (len > count || count > SPD_SIZE_MAX)
+        return false;
+    uint8_t bytes[SPD_SIZE_MAX];
+    memset(bytes, ' ', count);
+    memcpy(bytes, value, len);
+    return spd_txn_set_bytes(t, (size_t)first, bytes, count);
+}
+
+bool spd_txn_parse(SpdTxn *t, const char *edit)
+{
+    const char *eq = strchr(edit, '=');
+    if (!eq)
+        return false;
+    const char *value = eq + 1;
+    long v;
+    if (!strncmp(edit, "field:", 6)) {
+        char key[32];
+        size_t len = (size_t)(eq - edit - 6);
+        if (len >= sizeof(key) || !parse_number(value, value + strlen(value), &v))
+            return false;
+        memcpy(key, edit + 6, len);
+        key[len] = 0;
+        return spd_txn_set_field(t, key, (int)v);
+    }
+    if (!strncmp(edit, "byte", 4)) {
+        const char *dot = memchr(edit, '.', (size_t)(eq - edit));
+        long offset, bit;
+        if (!parse_number(edit + 4, dot ? dot : eq, &offset) || !parse_number(value, value + strlen(value), &v))
+            return false;
+        if (!dot)
+            return spd_txn_set_bits(t, (size_t)offset, 0, 8, (int)v);
+        if (strncmp(dot, ".bit", 4) || !parse_number(dot + 4, eq, &bit) || bit > 7)
+            return false;
+        return spd_txn_set_bits(t, (size_t)offset, (int)bit, 1, (int)v);
+    }
+    const char *dots = strstr(edit, "..");
+    if (dots && dots < eq)
+        return parse_range(t, edit, dots, value);
+    return false;
+}
+
+size_t spd_txn_commit(SpdTxn *t, SpdInfo *i, SpdRange *ranges, size_t max)
+{
+    // The decode computes the real CRC once, the fix only stores it
+    spd_decode_ex(i, t->data, t->size);
+    spd_fix_crc(t->data, i);
+
+    size_t count = 0;
+    for (size_t n = 0; n < t->size; n++) {
+        if (t->data[n] == t->original[n])
+            continue;
+        if (count && ranges[count - 1].offset + ranges[count - 1].size == n) {
+            ranges[count - 1].size++;
+        } else if (count == max) {
+            if (!max)
+                break;
+            ranges[count - 1].size = n + 1 - ranges[count - 1].offset;
+        } else {
+            ranges[count].offset = n;
+            ranges[count].size = 1;
+            count++;
+        }
+    }
+    memcpy(t->original, t->data, t->size);
+    t->edits = 0;
+    return count;
+}
+
+void spd_txn_rollback(SpdTxn *t)
+{
+    memcpy(t->data, t->original, t->size);
+    t->edits = 0;
+}
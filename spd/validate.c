@@ -0,0 +1,168 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/validate.h>
+#include <spd/view.h>
+#include <spd/bits.h>
+
+#include <string.h>
+
+typedef char spd_violations_fit[SPD_FIELD_COUNT <= 32 && SPD_RULE_COUNT <= 32 ? 1 : -1];
+
+static const struct { const char *key, *label; } spd_rules[SPD_RULE_COUNT] = {
+#define SPD_X(ID, key, label) { #key, label },
+    SPD_RULES(SPD_X)
+#undef SPD_X
+};
+
+#define FIELD_MASK(width) ((1u << (width)) - 1)
+
+// Bytes described by SPD_FIELDS, the rest of their bits are reserved
+#define FIELD_BYTES 9
+
+#define PART_NUMBER_FIRST 128
+#define PART_NUMBER_LAST 145
+
+// Lookup tables derived from the field maps once per batch, so that every
+// rule is a table load and a compare
+typedef struct Tables
+{
+    uint8_t reserved[FIELD_BYTES];
+    int log2_capacity[16];      // Mbits
+    int log2_banks[8];
+    int log2_columns[8];
+    int log2_rows[8];
+    int log2_width[8];
+    int bytes_used[16];
+    int bytes_total[8];
+    uint8_t printable[256];
+} Tables;
+
+static int log2_of(int value)
+{
+    // Undefined encodings map to 0 and never balance the geometry equation
+    if (value <= 0)
+        return -64;
+    int n = 0;
+    while (value > 1) {
+        value >>= 1;
+        n++;
+    }
+    return n;
+}
+
+static void tables_init(Tables *t)
+{
+    memset(t->reserved, 0xff, sizeof(t->reserved));
+#define SPD_X(ID, key, member, byte, shift, width, ...) \
+    t->reserved[byte] &= (uint8_t)~(FIELD_MASK(width) << (shift));
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+    for (int raw = 0; raw < 16; raw++) {
+        t->log2_capacity[raw] = log2_of(spd_field_value(SPD_FIELD_SDRAM_CAPACITY, raw));
+        t->bytes_used[raw] = spd_field_value(SPD_FIELD_BYTES_USED, raw);
+    }
+    for (int raw = 0; raw < 8; raw++) {
+        t->log2_banks[raw] = log2_of(spd_field_value(SPD_FIELD_BANK_BITS, raw));
+        t->log2_columns[raw] = spd_field_value(SPD_FIELD_COLUMN_BITS, raw) ? spd_field_value(SPD_FIELD_COLUMN_BITS, raw) : -64;
+        t->log2_rows[raw] = spd_field_value(SPD_FIELD_ROW_BITS, raw) ? spd_field_value(SPD_FIELD_ROW_BITS, raw) : -64;
+        t->log2_width[raw] = log2_of(spd_field_value(SPD_FIELD_SDRAM_WIDTH, raw));
+        t->bytes_total[raw] = spd_field_value(SPD_FIELD_BYTES_TOTAL, raw);
+    }
+    for (int c = 0; c < 256; c++)
+        t->printable[c] = (uint8_t)(c == 0 || (c >= 0x20 && c < 0x7f));
+}
+
+static inline uint64_t validate(const Tables *t, const uint8_t *image)
+{
+    SpdView view;
+    const SpdView *i = &view;
+    spd_view_init(&view, image);
+    uint64_t v = 0;
+
+    // Reserved field encodings, bit per field
+#define SPD_X(ID, key, member, byte, shift, width, valid, ...) \
+    v |= (uint64_t)((valid) ? (~((uint32_t)(valid) >> spd_view_##key(i)) & 1u) : 0u) << SPD_FIELD_##ID;
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+
+    unsigned reserved = 0;
+    for (int n = 0; n < FIELD_BYTES; n++)
+        reserved |= image[n] & t->reserved[n];
+
+    // Capacity (Mbits) = 2^(rows + columns) * banks * width / 2^20
+    int geometry = t->log2_rows[spd_view_row_bits(i)] + t->log2_columns[spd_view_column_bits(i)]
+        + t->log2_banks[spd_view_bank_bits(i)] + t->log2_width[spd_view_sdram_width(i)] - 20;
+
+    unsigned printable = 1;
+    for (int n = PART_NUMBER_FIRST; n <= PART_NUMBER_LAST; n++)
+        printable &= t->printable[image[n]];
+
+    v |= (uint64_t)(spd_view_device_type(i) != SPD_DEVICE_TYPE_DDR3) << (32 + SPD_RULE_DEVICE_TYPE);
+    v |= (uint64_t)!spd_view_crc_ok(i) << (32 + SPD_RULE_CRC);
+    v |= (uint64_t)(reserved != 0) << (32 + SPD_RULE_RESERVED_BITS);
+    v |= (uint64_t)(t->bytes_used[spd_view_bytes_used(i)] > t->bytes_total[spd_view_bytes_total(i)]) << (32 + SPD_RULE_BYTES_USED);
+    v |= (uint64_t)(geometry != t->log2_capacity[spd_view_sdram_capacity(i)]) << (32 + SPD_RULE_GEOMETRY);
+    v |= (uint64_t)(spd_view_capacity(i) <= 0) << (32 + SPD_RULE_CAPACITY);
+    v |= (uint64_t)!printable << (32 + SPD_RULE_PART_NUMBER);
+    v |= (uint64_t)(spd_view_cas_latency(i) == 0) << (32 + SPD_RULE_CAS_LATENCY);
+    return v;
+}
+
+uint64_t spd_validate(const uint8_t image[SPD_DDR3_SIZE])
+{
+    uint64_t v;
+    spd_validate_batch(&v, image, 1, SPD_DDR3_SIZE);
+    return v;
+}
+
+void spd_validate_batch(uint64_t *violations, const uint8_t *images, size_t count, size_t stride)
+{
+    Tables t;
+    tables_init(&t);
+    for (size_t n = 0; n < count; n++)
+        violations[n] = validate(&t, images + n * stride);
+}
+
+void spd_violations_count(uint64_t counts[SPD_VIOLATION_BITS], const uint64_t *violations, size_t count)
+{
+    for (size_t n = 0; n < count; n++) {
+        for (uint64_t bits = violations[n]; bits; bits &= bits - 1)
+            counts[spd_ctz64(bits)]++;
+    }
+}
+
+const char *spd_rule_key(SpdRule r)
+{
+    return (unsigned)r < SPD_RULE_COUNT ? spd_rules[r].key : NULL;
+}
+
+const char *spd_rule_label(SpdRule r)
+{
+    return (unsigned)r < SPD_RULE_COUNT ? spd_rules[r].label : NULL;
+}
+
+const char *spd_violation_key(int bit)
+{
+    return bit < 32 ? spd_field_info((SpdField)bit)->key : spd_rule_key((SpdRule)(bit - 32));
+}
@@ -0,0 +1,111 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/view.h>
+
+#include <string.h>
+
+#define PART_NUMBER_OFFSET 128
+#define PART_NUMBER_SIZE (145 - 128 + 1)
+
+int spd_view_field(const SpdView *v, SpdField f)
+{
+    switch (f) {
+#define SPD_X(ID, key, ...) \
+        case SPD_FIELD_##ID: return spd_view_##key(v);
+        SPD_FIELDS(SPD_X)
+#undef SPD_X
+        default: return 0;
+    }
+}
+
+int spd_view_capacity(const SpdView *v)
+{
+    if (!spd_view_is_ddr3(v))
+        return 0;
+    return spd_capacity(spd_view_sdram_capacity(v), spd_view_bus_width(v), spd_view_ranks(v), spd_view_sdram_width(v));
+}
+
+// Borrowed pointer into the image, the length stops at the first NUL
+// and excludes the trailing space padding
+const char *spd_view_part_number(const SpdView *v, size_t *len)
+{
+    const char *part = (const char *)v->data + PART_NUMBER_OFFSET;
+    const char *end = memchr(part, 0, PART_NUMBER_SIZE);
+    size_t n = end ? (size_t)(end - part) : PART_NUMBER_SIZE;
+    if (!spd_view_is_ddr3(v))
+        n = 0;
+    while (n && part[n - 1] == ' ')
+        n--;
+    *len = n;
+    return part;
+}
+
+int spd_view_crc(const SpdView *v)
+{
+    return spd_view_is_ddr3(v) ? v->data[126] | (v->data[127] << 8) : 0;
+}
+
+int spd_view_crc_real(const SpdView *v)
+{
+    return spd_view_is_ddr3(v) ? spd_crc16(v->data, spd_view_crc_coverage(v) ? 117 : 126) : 0;
+}
+
+bool spd_view_crc_ok(const SpdView *v)
+{
+    return spd_view_is_ddr3(v) && spd_view_crc(v) == spd_view_crc_real(v);
+}
+
+void spd_view_decode(const SpdView *v, SpdInfo *i, uint32_t projection)
+{
+    memset(i, 0, sizeof(i[0]));
+
+    // Masking is cheaper than branching for the bit fields
+#define SPD_X(ID, key, member, ...) \
+    i->member = spd_view_##key(v) & -(int)((projection >> SPD_FIELD_##ID) & 1);
+    SPD_FIELDS(SPD_X)
+#undef SPD_X
+
+    if (projection & SPD_PROJ_CAPACITY) {
+        i->Module_Capacity = spd_view_capacity(v);
+    }
+    if ((projection & SPD_PROJ_PART_NUMBER) && spd_view_is_ddr3(v)) {
+        memcpy(i->Module_Part_Number, v->data + PART_NUMBER_OFFSET, PART_NUMBER_SIZE);
+    }
+    if (projection & SPD_PROJ_CRC) {
+        i->CRC = spd_view_crc(v);
+        i->CRC_real = spd_view_crc_real(v);
+    }
+    if ((projection & SPD_PROJ_TIMINGS) && spd_view_is_ddr3(v)) {
+        spd_decode_timings(i, v->data);
+    }
+}
+
+void spd_view_decode_batch(SpdInfo *i, const uint8_t *images, size_t count, size_t stride, uint32_t projection)
+{
+    for (size_t n = 0; n < count; n++) {
+        SpdView v;
+        spd_view_init(&v, images + n * stride);
+        spd_view_decode(&v, i + n, projection);
+    }
+}
@@ -22,7 +22,16 @@
  */
 
 #include <spd/spd.h>
+#include <spd/fingerprint.h>
+#include <spd/txn.h>
+#include <spd/validate.h>
 #include <io/io.h>
+#include <io/backup.h>
+#include <io/ee1004.h>
+#include <io/journal.h>
+#include <io/remote.h>
+
+#include "tool/tool.h"
 
 #include <getopt.h>
 
@@ -32,6 +41,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
 
 enum Options {
     OP_DEVICE = 'd',
@@ -42,37 +53,94 @@ enum Options {
 
     OP_SET_LV = 'z' + 1,
     OP_RESET_LV,
-    OP_FIX_CRC
+    OP_FIX_CRC,
+    OP_BACKUP_DIR,
+    OP_CLASSIFY,
+    OP_SET,
+    OP_JOURNAL,
+    OP_OVERWRITE,
+    OP_REMOTE
 };
 
+#define EDITS_MAX 64
+#define RANGES_MAX 32
+
 typedef struct Args
 {
     bool use_i2c;
     int device_id;
     const char* in_file;
     const char* out_file;
+    const char* backup_dir;
+    const char* journal;
+    IoOverwrite overwrite;
+    const char* remote;
+    const char* classify;
     bool set_lv;
     bool reset_lv;
     bool fix_crc;
     bool verbose;
+    const char* edits[EDITS_MAX];
+    int edit_count;
 } Args;
 
 static void print_usage()
 {
     printf(
-        "DDR3 SPD helper tool\n"
+        "DDR3/DDR4 SPD helper tool\n"
         "Usage:\n"
-        "    spd-tool OPTIONS\n\n"
+        "    spd-tool OPTIONS\n"
+        "    spd-tool COMMAND ARGS, run 'spd-tool COMMAND --help' for details\n\n"
+        "COMMANDS:\n"
+        "    archive add|info|get ARCHIVE ...\n"
+        "        Delta-compressed archive of images against per-SKU templates\n"
+        "    cluster INPUT...\n"
+        "        Group images by Hamming distance or changed fields\n"
+        "    diff A B\n"
+        "        Changed bytes of two images with decoded field names\n"
+        "    fingerprint SET --good INPUT --bad INPUT\n"
+        "        Build a known image set for --classify\n"
+        "    index CORPUS\n"
+        "        Build secondary indexes for a corpus of concatenated dumps\n"
+        "    patch --rules RULES INPUT...\n"
+        "        Rule based bulk edits with dry-run, new corpus or in-place output\n"
+        "    query CORPUS --where EXPR\n"
+        "        Find corpus images matching a filter expression\n"
+        "    serialize TEMPLATE --serial FIRST --count N -o OUTPUT\n"
+        "        Stamp production serial numbers on a template image\n"
+        "    stats INPUT...\n"
+        "        Fleet histograms and CRC failure rate in one pass\n"
+        "    undo JOURNAL --since TIME\n"
+        "        Restore devices written since TIME from the undo journal\n"
+        "    validate INPUT...\n"
+        "        JEDEC consistency checks with per-rule violation counts\n"
+        "    watch DIR\n"
+        "        Process dumps as they land in a spool directory\n\n"
         "OPTIONS:\n"
         "    --device,-d [DEVICE_ID]\n"
         "        I2C device for reading SPD directly from SO-DIMM module.\n"
         "        DEVICE_ID - optional zero-based device id, default 0\n"
+        "        DDR4 EE1004 pages are switched once per pass, only changed blocks are written\n"
         "    --input,-i INPUT_FILE\n"
         "        An input EEPROM binary file if the device is unspecified.\n"
         "        An original EEPROM dump file if the device is specified.\n"
         "    --output,-o OUTPUT_FILE\n"
         "        An output EEPROM binary file if the device is unspecified.\n"
         "        A modified EEPROM dump file if the device is specified.\n"
+        "    --backup-dir DIR\n"
+        "        Content-addressed store for original EEPROM dumps if the device is specified.\n"
+        "        Identical dumps are stored once, DIR/manifest.txt records every backup.\n"
+        "    --overwrite POLICY\n"
+        "        Existing output files: ask (default, never without a terminal), never,\n"
+        "        always or suffix to write NAME.1.EXT. Files are replaced atomically.\n"
+        "    --remote[=SOCKET]\n"
+        "        Access the device through spdd, default socket " IO_REMOTE_SOCKET "\n"
+        "    --journal FILE\n"
+        "        Append-only undo journal of device writes with the images before and\n"
+        "        after every write, see 'spd-tool undo'.\n"
+        "    --classify SET\n"
+        "        Look the image up in a fingerprint set built by 'spd-tool fingerprint'.\n"
+        "        Known-good and known-bad images aren't decoded unless modified.\n"
         "    --set-lv\n"
         "        Set low voltage flag\n"
         "        Module minimum nominal voltage 1.35 V\n"
@@ -81,6 +149,12 @@ static void print_usage()
         "        Module minimum nominal voltage 1.35 V\n"
         "     --fix-crc\n"
         "        Fix CRC checksum\n"
+        "    --set EDIT\n"
+        "        Edit the image, repeatable. All edits are applied at once and the CRC\n"
+        "        is recomputed, only changed 16-byte chunks are written to the device.\n"
+        "        byteN=V, byteN.bitM=V - byte or bit value\n"
+        "        A..B=TEXT - bytes A ~ B, padded with spaces\n"
+        "        field:KEY=V - field value, e.g. field:ranks=2\n"
         "    --verbose,-v\n"
         "        Verbose output\n"
         "    --help,-h\n"
@@ -96,6 +170,15 @@ static void print_usage()
         "        spd-tool -i DDR3L.bin --reset-lv -o DDR3.bin\n"
         "    Convert DDR3L to DDR3 via CH341 programmer\n"
         "        spd-tool -d --reset-lv\n"
+        "    Decode only images that aren't known yet\n"
+        "        spd-tool -d --classify known.fps\n"
+        "    Change the part number and the number of ranks\n"
+        "        spd-tool -i dump.bin --set 128..145=\"PARTNO\" --set field:ranks=2 -o new.bin\n"
+        "    Journal device writes, then undo the writes of the last hour\n"
+        "        spd-tool -d --reset-lv --journal spd.journal\n"
+        "        spd-tool undo spd.journal --since -3600\n"
+        "    Keep original dumps of flashed modules in a backup store\n"
+        "        spd-tool -d --reset-lv --backup-dir backups\n"
     );
 }
 
@@ -114,6 +197,12 @@ static void parse_args(Args *args, int argc, char* argv[])
             { "set-lv",             no_argument,       0, OP_SET_LV },
             { "reset-lv",           no_argument,       0, OP_RESET_LV },
             { "fix-crc",            no_argument,       0, OP_FIX_CRC },
+            { "backup-dir",         required_argument, 0, OP_BACKUP_DIR },
+            { "classify",           required_argument, 0, OP_CLASSIFY },
+            { "set",                required_argument, 0, OP_SET },
+            { "journal",            required_argument, 0, OP_JOURNAL },
+            { "overwrite",          required_argument, 0, OP_OVERWRITE },
+            { "remote",             optional_argument, 0, OP_REMOTE },
             { "verbose",            no_argument,       0, OP_VERBOSE },
             { "help",               no_argument,       0, OP_HELP },
             { 0, 0, 0, 0 }
@@ -125,11 +214,7 @@ static void parse_args(Args *args, int argc, char* argv[])
         }
         switch (c) {
             case OP_DEVICE:
-                args->use_i2c = io_i2c_init();
-                if (!args->use_i2c) {
-                    printf("I2C driver isn't available\n");
-                    exit(EXIT_FAILURE);
-                }
+                args->use_i2c = true;
                 if (optarg)
                     args->device_id = atoi(optarg);
                 break;
@@ -148,6 +233,31 @@ static void parse_args(Args *args, int argc, char* argv[])
             case OP_FIX_CRC:
                 args->fix_crc = true;
                 break;
+            case OP_BACKUP_DIR:
+                args->backup_dir = optarg;
+                break;
+            case OP_CLASSIFY:
+                args->classify = optarg;
+                break;
+            case OP_JOURNAL:
+                args->journal = optarg;
+                break;
+            case OP_REMOTE:
+                args->remote = optarg ? optarg : IO_REMOTE_SOCKET;
+                break;
+            case OP_OVERWRITE:
+                if (!io_overwrite_parse(optarg, &args->overwrite)) {
+                    printf("Invalid overwrite policy: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case OP_SET:
+                if (args->edit_count == EDITS_MAX) {
+                    printf("Too many edits, at most %d\n", EDITS_MAX);
+                    exit(EXIT_FAILURE);
+                }
+                args->edits[args->edit_count++] = optarg;
+                break;
             case OP_VERBOSE:
                 args->verbose = true;
                 break;
@@ -160,6 +270,15 @@ static void parse_args(Args *args, int argc, char* argv[])
         }
     }
 
+    // Devices behind spdd don't need a local driver
+    if (args->use_i2c && !args->remote && !io_i2c_init()) {
+        printf("I2C driver isn't available\n");
+        exit(EXIT_FAILURE);
+    }
+    if (args->remote && !args->use_i2c) {
+        printf("Option --remote needs a device\n");
+        exit(EXIT_FAILURE);
+    }
     if (!args->in_file && !args->use_i2c) {
         printf("SPD source is undefined\n");
         exit(EXIT_FAILURE);
@@ -185,82 +304,275 @@ void print_hex(uint8_t *data, size_t size)
     }
 }
 
+static void print_info(const SpdInfo *i, bool verbose)
+{
+    char text[8192];
+    spd_format(i, verbose, text, sizeof(text));
+    fputs(text, stdout);
+}
+
+static bool write_file(const Args *args, const char *path, uint8_t *data, size_t size)
+{
+    IoWriter writer;
+    writer_init(&writer, args->overwrite, false);
+    if (io_writer_write(&writer, path, data, size))
+        return true;
+    print_error("Can't write file", path, errno);
+    return false;
+}
+
+// Local I2C device or one served by spdd, the connection is closed at exit
+typedef struct Device
+{
+    int remote;
+    uint8_t id;
+    IoI2cBus bus;
+    IoEe1004 eeprom;
+} Device;
+
+static size_t device_read(Device *d, const Args *args, uint8_t data[SPD_SIZE_MAX])
+{
+    d->remote = -1;
+    d->id = (uint8_t)args->device_id;
+    if (!args->remote) {
+        if (!io_i2c_bus(&d->bus, args->device_id))
+            return 0;
+        io_ee1004_init(&d->eeprom, &d->bus, IO_SPD_ADDRESS);
+        return io_spd_read(&d->eeprom, data);
+    }
+    d->remote = io_remote_connect(args->remote);
+    if (d->remote < 0) {
+        print_error("Can't connect to spdd", args->remote, errno);
+        return 0;
+    }
+    uint8_t response[IO_REMOTE_PAYLOAD_MAX];
+    size_t size;
+    int status = io_remote_call(d->remote, IO_REMOTE_READ, d->id, NULL, 0, response, &size);
+    if (status < 0) {
+        print_error("spdd", NULL, errno);
+        return 0;
+    }
+    if (status != IO_REMOTE_OK || size < SPD_DDR3_SIZE || size > SPD_SIZE_MAX) {
+        printf("spdd: %s\n", io_remote_status_text((uint8_t)status));
+        return 0;
+    }
+    memcpy(data, response, size);
+    return size;
+}
+
+static bool device_write(Device *d, const uint8_t data[SPD_SIZE_MAX], size_t size, uint32_t chunks)
+{
+    if (d->remote < 0)
+        return io_ee1004_write_chunks(&d->eeprom, data, chunks);
+    uint8_t request[4 + SPD_SIZE_MAX], response[IO_REMOTE_PAYLOAD_MAX];
+    size_t response_size;
+    for (int n = 0; n < 4; n++)
+        request[n] = (uint8_t)(chunks >> (8 * n));
+    memcpy(request + 4, data, size);
+    int status = io_remote_call(d->remote, IO_REMOTE_FLASH, d->id, request, 4 + size, response, &response_size);
+    if (status < 0)
+        print_error("spdd", NULL, errno);
+    else if (status != IO_REMOTE_OK)
+        printf("spdd: %s\n", io_remote_status_text((uint8_t)status));
+    return status == IO_REMOTE_OK;
+}
+
 static bool run_tool(const Args *args)
 {
-    uint8_t spd_data[SPD_SIZE_MAX];
+    uint8_t spd_data[SPD_SIZE_MAX] = { 0 };
+    uint8_t original[SPD_SIZE_MAX];
+    size_t size = SPD_DDR3_SIZE;
+    Device device = { .remote = -1 };
     if (args->use_i2c) {
-        if (!io_i2c_read(args->device_id, spd_data, sizeof(spd_data))) {
+        size = device_read(&device, args, spd_data);
+        if (!size) {
             printf("Read I2C device-%d failed\n", args->device_id);
             return false;
         }
     }
+    if (args->use_i2c && args->backup_dir) {
+        IoBackupStore store;
+        char key[IO_BACKUP_KEY_SIZE];
+        if (!io_backup_open(&store, args->backup_dir)) {
+            print_error("Can't open backup store", args->backup_dir, errno);
+            return false;
+        }
+        bool ok = io_backup_put(&store, args->device_id, spd_data, size, key);
+        if (!ok)
+            print_error("Can't write backup", args->backup_dir, errno);
+        io_backup_close(&store);
+        if (!ok)
+            return false;
+        printf("Backup: %s\n", key);
+    }
     if (args->in_file) {
         if (args->use_i2c) {
-            if (!io_file_write(args->in_file, spd_data, sizeof(spd_data)))
+            if (!write_file(args, args->in_file, spd_data, size))
                 return false;
         } else {
-            if (!io_file_read(args->in_file, spd_data, sizeof(spd_data)))
+            size_t n = io_file_read_some(args->in_file, spd_data, sizeof(spd_data));
+            if (n < SPD_DDR3_SIZE) {
+                print_error("Can't read file", args->in_file, n ? ENODATA : errno);
                 return false;
+            }
+            size = spd_image_size(spd_data, n);
+        }
+    }
+    memcpy(original, spd_data, sizeof(original));
+
+    // Known images are reported without the decode unless they're modified
+    if (args->classify) {
+        IoMapping map;
+        SpdFingerprints f;
+        if (!io_file_map(&map, args->classify)) {
+            print_error("Can't open file", args->classify, errno);
+            return false;
+        }
+        bool ok = spd_fingerprint_attach(&f, map.data, map.size);
+        SpdClass c = ok ? spd_fingerprint_probe(&f, spd_data) : SPD_CLASS_UNKNOWN;
+        io_file_unmap(&map);
+        if (!ok) {
+            printf("Not a fingerprint set: %s\n", args->classify);
+            return false;
         }
+        printf("Class: %s\n", spd_class_name(c));
+        if (c != SPD_CLASS_UNKNOWN && !args->fix_crc && !args->set_lv && !args->reset_lv && !args->edit_count && !args->out_file)
+            return true;
+        printf("\n");
     }
 
     SpdInfo i;
-    spd_decode(&i, spd_data);
+    SpdImage image = { spd_data, size };
+    spd_image_decode(&i, image);
 
     if (args->verbose) {
-        print_hex(spd_data, sizeof(spd_data));
+        print_hex(spd_data, size);
         printf("\n");
     }
     printf("SPD:\n");
-    spd_print(&i, args->verbose);
+    print_info(&i, args->verbose);
     printf("\n");
-
-    bool is_spd_changed = false;
-    if (args->fix_crc) {
-        if (spd_fix_crc(spd_data, &i)) {
-            is_spd_changed = true;
-            printf("CRC was fixed\n");
+    if (args->verbose && i.DRAM_Device_Type == SPD_DEVICE_TYPE_DDR3) {
+        uint64_t violations = spd_validate(spd_data);
+        for (int f = 0; f < SPD_FIELD_COUNT; f++) {
+            if (violations & SPD_VIOLATION_FIELD(f))
+                printf("Warning: %s: reserved encoding\n", spd_field_info((SpdField)f)->label);
+        }
+        for (int r = 0; r < SPD_RULE_COUNT; r++) {
+            if (violations & SPD_VIOLATION_RULE(r))
+                printf("Warning: %s\n", spd_rule_label((SpdRule)r));
         }
+        if (violations)
+            printf("\n");
     }
-    if (args->set_lv) {
-        if (spd_enable_lp(spd_data, &i, true)) {
-            is_spd_changed = true;
-            printf("Low-Voltage flag was set\n");
+
+    // All edits are one transaction, the CRC is recomputed once at commit
+    SpdTxn txn;
+    spd_txn_begin(&txn, spd_data, size);
+    if ((args->set_lv || args->reset_lv) && i.DRAM_Device_Type != SPD_DEVICE_TYPE_DDR3) {
+        printf("Low-Voltage flag is DDR3 only\n");
+    } else if (args->set_lv || args->reset_lv) {
+        // Byte 6 bit 1: 1.35 V operable
+        spd_txn_set_bits(&txn, 6, 1, 1, args->set_lv);
+    }
+    for (int n = 0; n < args->edit_count; n++) {
+        if (!spd_txn_parse(&txn, args->edits[n])) {
+            printf("Invalid edit: %s\n", args->edits[n]);
+            return false;
         }
     }
-    if (args->reset_lv) {
-        if (spd_enable_lp(spd_data, &i, false)) {
-            is_spd_changed = true;
+    SpdRange ranges[RANGES_MAX];
+    size_t range_count = 0;
+    bool crc_ok = spd_crc_ok(&i);
+    if (args->fix_crc || memcmp(original, spd_data, size))
+        range_count = spd_txn_commit(&txn, &i, ranges, RANGES_MAX);
+    bool is_spd_changed = range_count != 0;
+    if (is_spd_changed && !crc_ok && spd_crc_ok(&i))
+        printf("CRC was fixed\n");
+    if ((original[6] ^ spd_data[6]) & 0b10) {
+        if (spd_data[6] & 0b10)
+            printf("Low-Voltage flag was set\n");
+        else
             printf("Low-Voltage flag was reseted\n");
-        }
     }
 
     if (is_spd_changed) {
         printf("\nModified SPD:\n");
-        spd_print(&i, args->verbose);
-        printf("\n");
+        print_info(&i, args->verbose);
+        printf("\nChanged bytes:");
+        for (size_t n = 0; n < range_count; n++) {
+            if (ranges[n].size == 1)
+                printf(" %zu", ranges[n].offset);
+            else
+                printf(" %zu..%zu", ranges[n].offset, ranges[n].offset + ranges[n].size - 1);
+        }
+        printf("\n\n");
         if (args->verbose)
-            print_hex(spd_data, sizeof(spd_data));
+            print_hex(spd_data, size);
         printf("\n");
     }
 
     if (args->out_file) {
-        if (!io_file_write(args->out_file, spd_data, sizeof(spd_data))) {
+        if (!write_file(args, args->out_file, spd_data, size)) {
             printf("Write output file failed\n");
             return false;
         }
     }
     if (args->use_i2c && is_spd_changed) {
-        if (!io_i2c_write(args->device_id, spd_data, sizeof(spd_data))) {
-            printf("Write I2C device-%d failed\n", args->device_id);
+        // The record is synced before the write, a failed write leaves a
+        // harmless undo
+        IoJournal journal = { NULL, 0, 0 };
+        if (args->journal && (!io_journal_open(&journal, args->journal, IO_JOURNAL_BATCH)
+            || !io_journal_append(&journal, (uint32_t)args->device_id, (int64_t)time(NULL), original, spd_data, size)
+            || !io_journal_sync(&journal))) {
+            if (errno == EINVAL)
+                printf("Not an SPD journal: %s\n", args->journal);
+            else
+                print_error("Can't write journal", args->journal, errno);
+            io_journal_close(&journal);
             return false;
         }
+        uint32_t chunks = 0;
+        for (size_t n = 0; n < range_count; n++)
+            chunks |= io_ee1004_range_chunks(ranges[n].offset, ranges[n].size);
+        bool ok = device_write(&device, spd_data, size, chunks);
+        if (!ok)
+            printf("Write I2C device-%d failed\n", args->device_id);
+        if (!io_journal_close(&journal)) {
+            print_error("Can't sync journal", args->journal, errno);
+            ok = false;
+        }
+        if (!ok)
+            return false;
     }
     return true;
 }
 
+static const struct {
+    const char *name;
+    int (*run)(int argc, char *argv[]);
+} commands[] = {
+    { "archive", cmd_archive },
+    { "cluster", cmd_cluster },
+    { "diff", cmd_diff },
+    { "fingerprint", cmd_fingerprint },
+    { "index", cmd_index },
+    { "patch", cmd_patch },
+    { "query", cmd_query },
+    { "serialize", cmd_serialize },
+    { "stats", cmd_stats },
+    { "undo", cmd_undo },
+    { "validate", cmd_validate },
+    { "watch", cmd_watch },
+};
+
 int main(int argc, char* argv[])
 {
+    for (size_t n = 0; argc > 1 && n < sizeof(commands) / sizeof(commands[0]); n++) {
+        if (!strcmp(argv[1], commands[n].name))
+            return commands[n].run(argc - 1, argv + 1);
+    }
+
     Args args;
     parse_args(&args, argc, argv);
     return run_tool(&args) ? EXIT_SUCCESS : EXIT_FAILURE;
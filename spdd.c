@@ -0,0 +1,224 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <spd/spd.h>
+#include <io/io.h>
+#include <io/remote.h>
+#include <io/server.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define CLIENTS_MAX 64
+// A client that doesn't read its responses isn't read from either
+#define OUT_PENDING_MAX (16 * IO_SERVER_FRAME_MAX)
+
+typedef struct Client
+{
+    int fd;
+    IoServerConnection conn;
+} Client;
+
+typedef struct Daemon
+{
+    IoServer server;
+    Client clients[CLIENTS_MAX];
+    size_t client_count;
+} Daemon;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int signal)
+{
+    (void)signal;
+    running = 0;
+}
+
+static bool client_read(Daemon *d, Client *c)
+{
+    IoServerConnection *conn = &c->conn;
+    ssize_t n = recv(c->fd, conn->in + conn->in_size, sizeof(conn->in) - conn->in_size, MSG_DONTWAIT);
+    if (n < 0)
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    if (n == 0)
+        return false;
+    conn->in_size += (size_t)n;
+    return io_server_process(&d->server, conn);
+}
+
+static bool client_write(Client *c)
+{
+    IoServerConnection *conn = &c->conn;
+    while (conn->out_sent < conn->out_size) {
+        ssize_t n = send(c->fd, conn->out + conn->out_sent, conn->out_size - conn->out_sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0)
+            return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+        conn->out_sent += (size_t)n;
+    }
+    conn->out_size = conn->out_sent = 0;
+    return true;
+}
+
+static void client_close(Daemon *d, size_t index)
+{
+    Client *c = &d->clients[index];
+    io_remote_close(c->fd);
+    io_server_connection_free(&c->conn);
+    if (index != d->client_count - 1)
+        memcpy(c, &d->clients[d->client_count - 1], sizeof(*c));
+    d->client_count--;
+}
+
+static bool serve(Daemon *d, int listener)
+{
+    struct pollfd fds[1 + CLIENTS_MAX];
+    while (running) {
+        fds[0].fd = listener;
+        fds[0].events = d->client_count < CLIENTS_MAX ? POLLIN : 0;
+        for (size_t n = 0; n < d->client_count; n++) {
+            const Client *c = &d->clients[n];
+            fds[1 + n].fd = c->fd;
+            fds[1 + n].events = (c->conn.out_size - c->conn.out_sent < OUT_PENDING_MAX ? POLLIN : 0) | (c->conn.out_size > c->conn.out_sent ? POLLOUT : 0);
+            fds[1 + n].revents = 0;
+        }
+        size_t count = d->client_count;
+        if (poll(fds, 1 + count, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            printf("poll() failed\n");
+            return false;
+        }
+        // Clients are closed from the end, indices below stay valid
+        for (size_t n = count; n-- > 0;) {
+            Client *c = &d->clients[n];
+            bool ok = true;
+            if (fds[1 + n].revents & (POLLIN | POLLHUP | POLLERR))
+                ok = client_read(d, c);
+            if (ok && c->conn.out_size > c->conn.out_sent)
+                ok = client_write(c);
+            if (!ok)
+                client_close(d, n);
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd >= 0) {
+                Client *c = &d->clients[d->client_count++];
+                memset(c, 0, sizeof(*c));
+                c->fd = fd;
+            }
+        }
+    }
+    return true;
+}
+
+static void print_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spdd [OPTIONS]\n\n"
+        "SPD daemon: keeps the I2C backend and device sessions open and serves\n"
+        "read, decode, verify, patch and flash requests over a Unix socket, see\n"
+        "'spd-tool --remote'.\n\n"
+        "OPTIONS:\n"
+        "    --socket,-s PATH\n"
+        "        Socket path, default " IO_REMOTE_SOCKET "\n"
+        "    --simulate FILE\n"
+        "        Simulated EEPROM with the dump as device 0, 1, ... in order, at most %d\n"
+        , IO_SERVER_SIMULATED_MAX
+    );
+}
+
+int main(int argc, char *argv[])
+{
+    Daemon *d = calloc(1, sizeof(Daemon));
+    const char *path = IO_REMOTE_SOCKET;
+    if (!d) {
+        printf("Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    io_server_init(&d->server, false);
+    while (true) {
+        static struct option options[] = {
+            { "socket",             required_argument, 0, 's' },
+            { "simulate",           required_argument, 0, 'S' },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "s:h", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case 's':
+                path = optarg;
+                break;
+            case 'S': {
+                uint8_t image[SPD_SIZE_MAX];
+                size_t size = io_file_read_some(optarg, image, sizeof(image));
+                if (size < SPD_DDR3_SIZE || !io_server_simulate(&d->server, image, spd_image_size(image, size))) {
+                    printf("Can't simulate device: %s\n", optarg);
+                    free(d);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            default:
+                print_usage();
+                free(d);
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    d->server.i2c = io_i2c_init();
+    if (!d->server.i2c && !d->server.simulated_count)
+        printf("I2C driver isn't available, only dumps sent with requests are served\n");
+
+    int listener = io_remote_listen(path);
+    if (listener < 0) {
+        printf("Can't listen on socket: %s: %s\n", path, errno == EADDRINUSE ? "in use by another daemon" : strerror(errno));
+        free(d);
+        return EXIT_FAILURE;
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    signal(SIGPIPE, SIG_IGN);
+    printf("Listening on %s\n", path);
+    fflush(stdout);
+    bool ok = serve(d, listener);
+    while (d->client_count)
+        client_close(d, d->client_count - 1);
+    io_remote_close(listener);
+    unlink(path);
+    printf("Requests: %llu\n", (unsigned long long)d->server.requests);
+    free(d);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
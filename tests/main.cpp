@@ -21,13 +21,44 @@
  * THE SOFTWARE.
  */
 
+#include <spd/archive.h>
+#include <spd/cache.h>
+#include <spd/decoder.h>
+#include <spd/diff.h>
+#include <spd/fingerprint.h>
+#include <spd/intern.h>
+#include <spd/index.h>
+#include <spd/packed.h>
+#include <spd/patch.h>
+#include <spd/query.h>
+#include <spd/serialize.h>
 #include <spd/spd.h>
+#include <spd/stats.h>
+#include <spd/txn.h>
+#include <spd/validate.h>
+#include <spd/view.h>
+#include <io/bulk.h>
+#include <io/ee1004.h>
+#include <io/io.h>
+#include <io/journal.h>
+#include <io/remote.h>
+#include <io/server.h>
+#include <io/watch.h>
 
+#include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <sys/stat.h>
+#if _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
 static const char i2cdump[] =
     "     0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f    0123456789abcdef\n"
     "00: 92 11 0b 03 04 21 00 09 03 11 01 08 0a 00 fe 00    ?????!.??????.?.\n"
@@ -47,7 +78,7 @@ static const char i2cdump[] =
     "e0: ff ff ff ff ff ff ff ff ff ff ff ff ff ff ff ff    ................\n"
     "f0: ff ff ff ff ff ff ff ff ff ff ff ff ff ff ff ff    ................";
 
-static const uint8_t spd_data[SPD_SIZE_MAX] = {
+static const uint8_t spd_data[SPD_DDR3_SIZE] = {
     0x92, 0x11, 0x0b, 0x03, 0x04, 0x21, 0x00, 0x09, 0x03, 0x11, 0x01, 0x08, 0x0a, 0x00, 0xfe, 0x00,
     0x69, 0x78, 0x69, 0x30, 0x69, 0x11, 0x18, 0x81, 0x20, 0x08, 0x3c, 0x3c, 0x00, 0xf0, 0x83, 0x05,
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -66,9 +97,81 @@ static const uint8_t spd_data[SPD_SIZE_MAX] = {
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
 };
 
-int main (int argc, char *argv[])
+// Library-side decoder of a made-up device type: capacity in GB at byte 4
+static bool custom_decode(SpdInfo *i, const uint8_t *data, size_t size)
+{
+    memset(i, 0, sizeof(i[0]));
+    i->DRAM_Device_Type = data[2];
+    i->Module_Capacity = data[4] * 1024;
+    return size >= SPD_DDR3_SIZE;
+}
+
+// Overwrite confirmation that counts the questions and keeps every file
+static bool decline_overwrite(void *ctx, const char *path)
 {
+    (void)path;
+    ++*(int *)ctx;
+    return false;
+}
+
+// One --once pass of 'spd-tool watch': counts new and already processed dumps
+typedef struct WatchPass
+{
+    IoWatchState state;
+    const char *dir;
+    int added;
+    int skipped;
+} WatchPass;
+
+static bool watch_pass_file(void *ctx, const char *path)
+{
+    WatchPass *p = (WatchPass *)ctx;
+    const char *name = path + strlen(p->dir) + 1;
+    if (!io_watch_is_candidate(name))
+        return true;
     uint8_t data[SPD_SIZE_MAX];
+    size_t size = io_file_read_some(path, data, sizeof(data));
+    char key[256];
+    size_t len = io_watch_key(key, sizeof(key), name, data, size);
+    if (io_watch_state_has(&p->state, key, len)) {
+        p->skipped++;
+        return true;
+    }
+    p->added++;
+    return io_watch_state_add(&p->state, key, len);
+}
+
+static bool watch_pass(WatchPass *p, const char *dir, const char *state)
+{
+    p->dir = dir;
+    p->added = p->skipped = 0;
+    bool ok = io_watch_state_open(&p->state, state) && io_dir_list(dir, watch_pass_file, p);
+    io_watch_state_close(&p->state);
+    return ok;
+}
+
+static void server_request(IoServerConnection *c, uint32_t id, uint8_t code, uint8_t device, const void *payload, size_t size)
+{
+    IoRemoteHeader h = { (uint32_t)size, id, code, device };
+    io_remote_pack(c->in + c->in_size, &h);
+    memcpy(c->in + c->in_size + IO_REMOTE_HEADER_SIZE, payload, size);
+    c->in_size += IO_REMOTE_HEADER_SIZE + size;
+}
+
+// Next queued response, NULL when it isn't the expected one
+static const uint8_t *server_response(const IoServerConnection *c, size_t *offset, uint32_t id, uint8_t status, size_t size)
+{
+    IoRemoteHeader h;
+    if (c->out_size - *offset < IO_REMOTE_HEADER_SIZE || !io_remote_unpack(&h, c->out + *offset)
+        || h.id != id || h.code != status || h.size != size)
+        return NULL;
+    *offset += IO_REMOTE_HEADER_SIZE + size;
+    return c->out + *offset - size;
+}
+
+int main (int argc, char *argv[])
+{
+    uint8_t data[SPD_DDR3_SIZE];
     spd_parse_i2cdump(data, i2cdump);
     if (memcmp(data, spd_data, sizeof(data))) {
         printf("spd_read_i2cdump() failed\n");
@@ -80,7 +183,786 @@ int main (int argc, char *argv[])
         printf("spd_decode() failed\n");
         exit(EXIT_FAILURE);
     }
-    spd_print(&i, false);
+    char text[4096];
+    size_t length = spd_format(&i, false, text, sizeof(text));
+    if (length >= sizeof(text) || strlen(text) != length || spd_info_error(&i) != SPD_OK) {
+        printf("spd_format() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    fputs(text, stdout);
+    char small[16];
+    if (spd_format(&i, false, small, sizeof(small)) != length || strncmp(small, text, sizeof(small) - 1) || small[sizeof(small) - 1]) {
+        printf("spd_format() truncation failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (spd_validate_fields(&i)) {
+        printf("spd_validate_fields() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    uint8_t encoded[SPD_DDR3_SIZE];
+    memcpy(encoded, spd_data, sizeof(encoded));
+    memset(encoded, 0, 9);
+    spd_encode_fields(&i, encoded);
+    if (memcmp(encoded, spd_data, 9)) {
+        printf("spd_encode_fields() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (spd_field_find("ranks") != SPD_FIELD_RANKS || spd_field_value(SPD_FIELD_RANKS, i.Number_of_Ranks) != 2) {
+        printf("spd_field_find() failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    SpdView v;
+    spd_view_init(&v, spd_data);
+    size_t part_len = 0;
+    const char *part = spd_view_part_number(&v, &part_len);
+    if (spd_view_voltage(&v) != i.Module_Minimum_Nominal_Voltage || spd_view_capacity(&v) != i.Module_Capacity
+        || part_len != strlen(i.Module_Part_Number) || memcmp(part, i.Module_Part_Number, part_len)
+        || !spd_view_crc_ok(&v)) {
+        printf("spd_view failed\n");
+        exit(EXIT_FAILURE);
+    }
+    SpdInfo projected;
+    spd_view_decode(&v, &projected, SPD_PROJ_FIELD(SPD_FIELD_VOLTAGE) | SPD_PROJ_PART_NUMBER);
+    if (projected.Module_Type != 0 || projected.CRC_real != 0 || strcmp(projected.Module_Part_Number, i.Module_Part_Number)) {
+        printf("spd_view_decode() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    // A DDR2 record of the same size has none of the DDR3 fields
+    uint8_t ddr2_record[SPD_DDR3_SIZE];
+    memcpy(ddr2_record, spd_data, SPD_DDR3_SIZE);
+    ddr2_record[2] = SPD_DEVICE_TYPE_DDR2;
+    spd_view_init(&v, ddr2_record);
+    spd_view_part_number(&v, &part_len);
+    spd_view_decode(&v, &projected, SPD_PROJ_ALL);
+    if (spd_view_device_type(&v) != SPD_DEVICE_TYPE_DDR2 || spd_view_ranks(&v) || spd_view_capacity(&v) || part_len
+        || spd_view_crc_ok(&v) || spd_view_cas_latency(&v) || projected.DRAM_Device_Type != SPD_DEVICE_TYPE_DDR2
+        || projected.Module_Capacity || projected.Module_Part_Number[0] || projected.tCKmin) {
+        printf("spd_view DDR2 failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    SpdPacked packed;
+    SpdInfo unpacked;
+    SpdInfo ddr4_info = i;
+    ddr4_info.DRAM_Device_Type = SPD_DEVICE_TYPE_DDR4;
+    bool packed_ok = spd_pack(&packed, &i, 7) && !spd_pack(&packed, &ddr4_info, 8) && errno == EINVAL;
+    spd_unpack(&unpacked, &packed, i.Module_Part_Number);
+    uint32_t match = 0;
+    if (!packed_ok || sizeof(packed) != 16 || packed.part != 7 || memcmp(&unpacked, &i, offsetof(SpdInfo, Medium_Timebase_fs))
+        || spd_packed_filter(&packed, 1, spd_packed_mask(SPD_FIELD_RANKS), spd_packed_value(SPD_FIELD_RANKS, 1), &match) != 1) {
+        printf("spd_pack() failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    SpdIntern parts;
+    spd_intern_init(&parts);
+    char part_number[32];
+    for (int n = 0; n < 3000; n++) {
+        snprintf(part_number, sizeof(part_number), "PART-%d", n % 1000);
+        if (spd_intern(&parts, part_number, strlen(part_number)) != (uint32_t)(n % 1000)) {
+            printf("spd_intern() failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    spd_pack_interned(&packed, &i, &parts);
+    spd_unpack_interned(&unpacked, &packed, &parts);
+    if (spd_intern_count(&parts) != 1001 || strcmp(spd_intern_str(&parts, 999), "PART-999")
+        || spd_intern_find(&parts, "PART-1000", 9) != SPD_INTERN_NONE || memcmp(&unpacked, &i, offsetof(SpdInfo, Medium_Timebase_fs))) {
+        printf("spd_intern_find() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_intern_free(&parts);
+
+    SpdCache cache;
+    if (!spd_cache_init(&cache, 16)) {
+        printf("spd_cache_init() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int n = 0; n < 4; n++) {
+        SpdInfo cached;
+        if (!spd_cache_decode(&cache, &cached, spd_data) || memcmp(&cached, &i, sizeof(i))) {
+            printf("spd_cache_decode() failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (cache.stats.hits != 3 || cache.stats.misses != 1) {
+        printf("spd_cache_decode() stats failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_cache_free(&cache);
+
+    SpdQuery q;
+    SpdIndex x;
+    uint64_t result = 0;
+    if (!spd_query_parse(&q, "voltage=1.5 && capacity>=8192 && part~'GR1600*' || ranks=4", NULL)
+        || !spd_query_match(&q, spd_data) || !spd_index_build(&x, spd_data, 1)
+        || !spd_hash_equal(x.corpus_hash, spd_hash(spd_data, SPD_DDR3_SIZE))
+        || spd_query_run(&q, &x, spd_data, 1, &result) != 1 || result != 1) {
+        printf("spd_query_run() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!spd_query_parse(&q, "voltage=1.35/1.5 || crc=err", NULL) || spd_query_match(&q, spd_data)
+        || spd_query_run(&q, &x, spd_data, 1, &result) != 0) {
+        printf("spd_query_match() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_index_free(&x);
+
+    SpdStats stats, other;
+    spd_stats_init(&stats);
+    spd_stats_init(&other);
+    if (!spd_stats_add(&stats, &i, true) || !spd_stats_add(&other, &i, true) || !spd_stats_add(&other, &i, true)
+        || !spd_stats_merge(&stats, &other) || stats.images != 3 || stats.capacities != 1
+        || stats.capacity_count[0] != 3 || spd_intern_count(&stats.parts) != 1 || stats.part_count[0] != 3) {
+        printf("spd_stats_merge() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_stats_free(&other);
+    spd_stats_free(&stats);
+
+    uint8_t similar[3][SPD_DDR3_SIZE];
+    uint64_t changed[SPD_DIFF_WORDS];
+    memcpy(similar[0], spd_data, SPD_DDR3_SIZE);
+    memcpy(similar[1], spd_data, SPD_DDR3_SIZE);
+    memset(similar[2], 0xa5, SPD_DDR3_SIZE);
+    similar[1][7] ^= 0x08;
+    similar[1][200] ^= 0x81;
+    if (spd_diff(similar[0], similar[1], changed) != 2 || changed[0] != 1ull << 7 || changed[3] != 1ull << 8
+        || spd_distance(similar[0], similar[1]) != 3
+        || spd_diff_signature(similar[0], similar[1]) != (SPD_SIGNATURE_FIELD(SPD_FIELD_RANKS) | SPD_SIGNATURE_REGION(SPD_REGION_CUSTOMER))) {
+        printf("spd_diff() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    uint8_t stored[1024], restored[3 * SPD_DDR3_SIZE];
+    SpdClustering clusters;
+    if (!spd_cluster(&clusters, similar[0], 3, 8) || clusters.count != 2 || clusters.cluster[1] != 0 || clusters.size[0] != 2) {
+        printf("spd_cluster() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_cluster_free(&clusters);
+
+    // The third record differs from the first one in the serial number only
+    memcpy(similar[1], similar[2], SPD_DDR3_SIZE);
+    memcpy(similar[2], similar[0], SPD_DDR3_SIZE);
+    memset(similar[2] + 122, 0x5a, 4);
+    FILE *stream = tmpfile();
+    SpdArchiveWriter writer;
+    bool written = stream && spd_archive_writer_open(&writer, stream, NULL);
+    for (int n = 0; n < 3 && written; n++)
+        written = spd_archive_append(&writer, similar[n]);
+    size_t stored_size = written ? (size_t)writer.size : 0;
+    if (written) {
+        spd_archive_writer_close(&writer);
+        rewind(stream);
+        written = stored_size < sizeof(stored) && fread(stored, 1, stored_size, stream) == stored_size;
+    }
+    if (stream)
+        fclose(stream);
+    SpdArchive archive;
+    if (!written || !spd_archive_attach(&archive, stored, stored_size) || archive.count != 3 || archive.template_count != 2
+        || spd_archive_read(&archive, 0, restored, 3) != 3 || memcmp(restored, similar, sizeof(restored))) {
+        printf("spd_archive_read() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_archive_free(&archive);
+
+    // A run reaching past the image rejects the whole archive
+    uint8_t evil[SPD_ARCHIVE_MAGIC_SIZE + 1 + SPD_DDR3_SIZE + 4 + 10] = { 0 };
+    memcpy(evil, stored, SPD_ARCHIVE_MAGIC_SIZE);
+    evil[SPD_ARCHIVE_MAGIC_SIZE] = 1;
+    uint8_t *evil_delta = evil + SPD_ARCHIVE_MAGIC_SIZE + 1 + SPD_DDR3_SIZE;
+    evil_delta[0] = 0;
+    evil_delta[1] = 1;
+    evil_delta[2] = 250;
+    evil_delta[3] = 9;
+    if (spd_archive_attach(&archive, evil, sizeof(evil)) || !spd_archive_attach(&archive, evil, sizeof(evil) - 14) || archive.count != 1) {
+        printf("spd_archive_attach() malformed failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_archive_free(&archive);
+
+    SpdFingerprints known;
+    SpdHash hashes[2] = { spd_hash(similar[0], SPD_DDR3_SIZE), spd_hash(similar[1], SPD_DDR3_SIZE) };
+    uint8_t classes[2] = { SPD_CLASS_GOOD, SPD_CLASS_BAD };
+    if (!spd_fingerprint_build(&known, hashes, classes, 2) || spd_fingerprint_probe(&known, similar[0]) != SPD_CLASS_GOOD
+        || spd_fingerprint_probe(&known, similar[1]) != SPD_CLASS_BAD || spd_fingerprint_probe(&known, similar[2]) != SPD_CLASS_UNKNOWN) {
+        printf("spd_fingerprint_probe() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_fingerprint_free(&known);
+
+    uint64_t violations[3];
+    memcpy(similar[1], spd_data, SPD_DDR3_SIZE);
+    similar[1][6] |= 0x80;
+    similar[1][7] ^= 0x01;
+    memset(similar[2], 0xa5, SPD_DDR3_SIZE);
+    spd_validate_batch(violations, similar[0], 3, SPD_DDR3_SIZE);
+    if (violations[0] || violations[1] != (SPD_VIOLATION_RULE(SPD_RULE_CRC) | SPD_VIOLATION_RULE(SPD_RULE_RESERVED_BITS) | SPD_VIOLATION_RULE(SPD_RULE_GEOMETRY))
+        || !(violations[2] & SPD_VIOLATION_RULE(SPD_RULE_DEVICE_TYPE)) || spd_validate(spd_data)) {
+        printf("spd_validate_batch() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(spd_violation_key(32 + SPD_RULE_CRC), "crc") || strcmp(spd_violation_key(SPD_FIELD_DEVICE_TYPE), spd_field_info(SPD_FIELD_DEVICE_TYPE)->key)) {
+        printf("spd_violation_key() failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    SpdInfo timed;
+    spd_decode(&timed, spd_data);
+    if (timed.tCKmin != 1250 || timed.tAAmin != 13125 || timed.tAAmin_nCK != 11 || timed.CAS_Latency != 11
+        || spd_timing_ps(spd_data, SPD_TIMING_TRFC) != timed.tRFCmin || spd_cas_latency(timed.CAS_Latencies_Supported, 13125, 1500) != 9
+        || spd_cas_latency(timed.CAS_Latencies_Supported, 13125, 0)) {
+        printf("spd_decode_timings() failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // DDR4-2400 8 GB SO-DIMM, 1Rx8 8 Gbit, CL17
+    uint8_t ddr4[SPD_DDR4_SIZE] = { 0x23, 0x11, 0x0c, 0x03, 0x85, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x01, 0x03 };
+    static const uint8_t ddr4_timings[] = { 0x00, 0x07, 0x00, 0xf8, 0x0f, 0x00, 0x00, 0x6e, 0x6e, 0x6e, 0x11, 0x00, 0x6e, 0xf0, 0x0a };
+    memcpy(ddr4 + 17, ddr4_timings, sizeof(ddr4_timings));
+    ddr4[125] = 0xd6;
+    memcpy(ddr4 + 329, "M471A1K43CB1-CRC    ", 20);
+    SpdInfo d4;
+    if (spd_decode_ex(&d4, ddr4, sizeof(ddr4)) || spd_crc_ok(&d4) || !spd_fix_crc(ddr4, &d4)
+        || !spd_decode_ex(&d4, ddr4, sizeof(ddr4)) || spd_image_size(ddr4, sizeof(ddr4)) != SPD_DDR4_SIZE
+        || d4.Module_Capacity != 8192 || strcmp(d4.Module_Part_Number, "M471A1K43CB1-CRC    ")
+        || d4.tCKmin != 833 || d4.tAAmin != 13750 || d4.tAAmin_nCK != 17 || d4.CAS_Latency != 17 || d4.tRFCmin != 350000) {
+        printf("spd_decode_ex() DDR4 failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    IoI2cBus bus;
+    IoEe1004Sim sim;
+    IoEe1004 eeprom;
+    uint8_t read[SPD_SIZE_MAX], edited[SPD_SIZE_MAX];
+    io_ee1004_sim_init(&sim, &bus, ddr4, sizeof(ddr4));
+    io_ee1004_init(&eeprom, &bus, IO_SPD_ADDRESS);
+    if (io_spd_read(&eeprom, read) != SPD_DDR4_SIZE || memcmp(read, ddr4, sizeof(ddr4)) || eeprom.page_switches != 2) {
+        printf("io_spd_read() DDR4 failed\n");
+        exit(EXIT_FAILURE);
+    }
+    // Page 1 is still selected, the part number block goes first and page 0 once
+    memcpy(edited, read, sizeof(edited));
+    edited[345] = 'X';
+    edited[5] = 0x29;
+    spd_decode_ex(&d4, edited, sizeof(edited));
+    spd_fix_crc(edited, &d4);
+    if (io_ee1004_dirty(read, edited, sizeof(edited)) != 0x5
+        || !io_ee1004_write(&eeprom, edited, io_ee1004_dirty(read, edited, sizeof(edited)))
+        || memcmp(sim.memory, edited, sizeof(edited)) || eeprom.page_switches != 3 || sim.bytes_written != 256
+        || io_spd_read(&eeprom, read) != SPD_DDR4_SIZE || eeprom.page_switches != 4 || memcmp(read, edited, sizeof(edited))) {
+        printf("io_ee1004_write() failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // DDR2-800 2 GB SO-DIMM, 2 ranks of 1 GB, CL5
+    uint8_t ddr2[SPD_DDR3_SIZE] = { 0x80, 0x08, 0x08, 0x0e, 0x0a, 0x61, 0x40, 0x00, 0x05, 0x25 };
+    ddr2[13] = 0x08;
+    ddr2[17] = 0x08;
+    ddr2[18] = 0x38;
+    ddr2[20] = 0x04;
+    ddr2[27] = 0x32;
+    ddr2[29] = 0x32;
+    ddr2[30] = 0x2d;
+    ddr2[31] = 0x01;
+    memcpy(ddr2 + 73, "HYMP125S64CP8-S6  ", 18);
+    SpdInfo d2;
+    if (spd_decode(&d2, ddr2) || !spd_fix_crc(ddr2, &d2) || !spd_decode(&d2, ddr2) || d2.Module_Capacity != 2048
+        || d2.tCKmin != 2500 || d2.CAS_Latency != 5 || d2.tRCDmin != 12500 || d2.tRCDmin_nCK != 5 || d2.tRASmin != 45000
+        || strcmp(d2.Module_Part_Number, "HYMP125S64CP8-S6  ")) {
+        printf("spd_decode() DDR2 failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    uint8_t custom[SPD_DDR3_SIZE] = { 0x00, 0x00, 0x0f, 0x00, 0x20 };
+    SpdImage images[4] = { { spd_data, SPD_DDR3_SIZE }, { ddr4, sizeof(ddr4) }, { ddr2, sizeof(ddr2) }, { custom, sizeof(custom) } };
+    SpdInfo mixed[4];
+    bool mixed_ok[4];
+    SpdDecoder decoder = { "Custom", SPD_DDR3_SIZE, custom_decode, spd_decoder_unsupported.format, spd_decoder_unsupported.fix_crc, NULL };
+    if (spd_decoder_register(0x0f, &decoder) != &spd_decoder_unsupported || spd_decoder_find(SPD_DEVICE_TYPE_DDR4) != &spd_decoder_ddr4
+        || spd_image_decode_batch(mixed, mixed_ok, images, 4) != 4 || mixed[1].Module_Capacity != 8192 || strcmp(mixed[1].Module_Part_Number, "M471A1K43CB1-CRC    ")
+        || mixed[2].Module_Capacity != 2048 || mixed[3].Module_Capacity != 32768 || mixed[0].CAS_Latency != 11
+        || spd_image_size(ddr4, sizeof(ddr4)) != SPD_DDR4_SIZE || spd_image_size(ddr4, SPD_DDR3_SIZE) != SPD_DDR3_SIZE
+        || spd_decoder_register(0x0f, NULL) != &decoder || spd_image_decode(mixed, images[3])
+        || spd_info_error(mixed) != SPD_ERROR_UNSUPPORTED) {
+        printf("spd_image_decode_batch() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("\n");
+
+    io_ee1004_sim_init(&sim, &bus, spd_data, SPD_DDR3_SIZE);
+    io_ee1004_init(&eeprom, &bus, IO_SPD_ADDRESS);
+    if (io_spd_read(&eeprom, read) != SPD_DDR3_SIZE || memcmp(read, spd_data, SPD_DDR3_SIZE) || eeprom.paged
+        || io_ee1004_read(&eeprom, read, IO_EE1004_PAGE1)) {
+        printf("io_spd_read() DDR3 failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    static SpdSerializer serializer;
+    static uint8_t units[3 * SPD_DDR4_SIZE];
+    SpdUnit unit = { 0x2c, 24, 17, 0x00fffffe };
+    SpdInfo serialized;
+    uint8_t ddr3[SPD_DDR3_SIZE];
+    memcpy(ddr3, spd_data, SPD_DDR3_SIZE);
+    ddr3[0] &= 0x7f;
+    spd_decode(&serialized, ddr3);
+    spd_fix_crc(ddr3, &serialized);
+    if (!spd_serializer_init(&serializer, ddr3, SPD_DDR3_SIZE) || serializer.crc_offset != 126) {
+        printf("spd_serializer_init() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_serialize_range(&serializer, &unit, 3, units);
+    for (int n = 0; n < 3; n++) {
+        const uint8_t *u = units + n * SPD_DDR3_SIZE;
+        if (!spd_decode(&serialized, u) || spd_crc16(u, 126) != (u[126] | u[127] << 8) || u[119] != 0x2c
+            || u[120] != 0x24 || u[121] != 0x17 || u[122] != (n == 2 ? 0x01 : 0x00) || u[125] != (uint8_t)(0xfe + n)
+            || memcmp(u, ddr3, 119)) {
+            printf("spd_serialize_range() DDR3 failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    unit.serial = 0x12345678;
+    spd_serialize(&serializer, &unit, units);
+    if (!spd_decode(&serialized, units) || units[122] != 0x12 || units[125] != 0x78) {
+        printf("spd_serialize() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    // CRC over bytes 0 ~ 116 doesn't change per unit
+    if (!spd_serializer_init(&serializer, spd_data, SPD_DDR3_SIZE) || serializer.crc_offset) {
+        printf("spd_serializer_init() CRC 0 ~ 116 failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_serialize_range(&serializer, &unit, 2, units);
+    if (!spd_decode(&serialized, units + SPD_DDR3_SIZE) || units[SPD_DDR3_SIZE + 125] != 0x79) {
+        printf("spd_serialize_range() CRC 0 ~ 116 failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!spd_serializer_init(&serializer, ddr4, sizeof(ddr4)) || spd_serializer_init(&serializer, ddr4, SPD_DDR3_SIZE)
+        || !spd_serializer_init(&serializer, ddr4, sizeof(ddr4))) {
+        printf("spd_serializer_init() DDR4 failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_serialize_range(&serializer, &unit, 3, units);
+    if (!spd_decode_ex(&serialized, units + 2 * SPD_DDR4_SIZE, SPD_DDR4_SIZE) || units[2 * SPD_DDR4_SIZE + 328] != 0x7a
+        || units[2 * SPD_DDR4_SIZE + 322] != 0x2c || memcmp(units, ddr4, 322)) {
+        printf("spd_serialize_range() DDR4 failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // encode(decode(x)) == x over x and for the described bits over zeros
+    static uint8_t encoded_image[SPD_SIZE_MAX], encoded_mask[SPD_SIZE_MAX];
+    // CL 31 and 32 of the DDR4 low range aren't decoded and are kept
+    uint8_t ddr4_cl[SPD_DDR4_SIZE];
+    memcpy(ddr4_cl, ddr4, sizeof(ddr4_cl));
+    ddr4_cl[23] = 0x03;
+    int ddr4_crc = spd_crc16(ddr4_cl, 126);
+    ddr4_cl[126] = (uint8_t)ddr4_crc;
+    ddr4_cl[127] = (uint8_t)(ddr4_crc >> 8);
+    const SpdImage round_trip[4] = { { spd_data, SPD_DDR3_SIZE }, { ddr4, sizeof(ddr4) }, { ddr2, sizeof(ddr2) }, { ddr4_cl, sizeof(ddr4_cl) } };
+    for (int n = 0; n < 4; n++) {
+        SpdInfo info;
+        size_t size = round_trip[n].size;
+        memcpy(encoded_image, round_trip[n].data, size);
+        bool ok = spd_image_decode(&info, round_trip[n]) && spd_encode(&info, encoded_image) == size
+            && !memcmp(encoded_image, round_trip[n].data, size);
+        memset(encoded_image, 0, sizeof(encoded_image));
+        ok = ok && spd_encode(&info, encoded_image) == size && spd_encode_mask(info.DRAM_Device_Type, encoded_mask) == size;
+        for (size_t k = 0; ok && k < size; k++)
+            ok = !((encoded_image[k] ^ round_trip[n].data[k]) & encoded_mask[k]);
+        if (!ok) {
+            printf("spd_encode() round trip %d failed\n", n);
+            exit(EXIT_FAILURE);
+        }
+    }
+    // A low CL range image that would fit the high range keeps its range
+    uint8_t ddr4_cl_low[SPD_DDR4_SIZE];
+    memcpy(ddr4_cl_low, ddr4, sizeof(ddr4_cl_low));
+    ddr4_cl_low[20] = ddr4_cl_low[21] = ddr4_cl_low[23] = 0;
+    ddr4_cl_low[22] = 0x2a;
+    ddr4_crc = spd_crc16(ddr4_cl_low, 126);
+    ddr4_cl_low[126] = (uint8_t)ddr4_crc;
+    ddr4_cl_low[127] = (uint8_t)(ddr4_crc >> 8);
+    SpdImage ddr4_cl_image = { ddr4_cl_low, sizeof(ddr4_cl_low) };
+    SpdInfo ddr4_cl_info;
+    memcpy(encoded_image, ddr4_cl_low, sizeof(ddr4_cl_low));
+    if (!spd_image_decode(&ddr4_cl_info, ddr4_cl_image) || ddr4_cl_info.CAS_Latencies_Supported != (1 << 24 | 1 << 26 | 1 << 28)
+        || spd_encode(&ddr4_cl_info, encoded_image) != sizeof(ddr4_cl_low) || memcmp(encoded_image, ddr4_cl_low, sizeof(ddr4_cl_low))) {
+        printf("spd_encode() low CL range failed\n");
+        exit(EXIT_FAILURE);
+    }
+    // DDR3-1866 from parameters: 1.071 ns is 9 MTB and -54 FTB
+    SpdInfo spec;
+    spd_decode(&spec, spd_data);
+    spec.tCKmin = 1071;
+    spec.tAAmin = 13910;
+    spec.CAS_Latencies_Supported |= 1 << 13;
+    memcpy(spec.Module_Part_Number, "SPEC-1866         ", 18);
+    memcpy(encoded_image, spd_data, SPD_DDR3_SIZE);
+    if (spd_encode(&spec, encoded_image) != SPD_DDR3_SIZE || !spd_decode(&spec, encoded_image) || encoded_image[12] != 9
+        || encoded_image[34] != 0xca || encoded_image[16] != 112 || encoded_image[35] != 0xa6 || spec.tCKmin != 1071
+        || spec.tAAmin != 13910 || spec.CAS_Latency != 13 || strcmp(spec.Module_Part_Number, "SPEC-1866         ")) {
+        printf("spd_encode() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spec.DRAM_Device_Type = 0x0f;
+    if (spd_encode(&spec, encoded_image) || spd_encode_mask(0x0f, encoded_mask)) {
+        printf("spd_encode() unsupported failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // One transaction, one CRC, changed ranges only
+    SpdTxn txn;
+    SpdRange ranges[4];
+    uint8_t txn_image[SPD_DDR4_SIZE];
+    memcpy(txn_image, spd_data, SPD_DDR3_SIZE);
+    spd_txn_begin(&txn, txn_image, SPD_DDR3_SIZE);
+    if (!spd_txn_parse(&txn, "byte6.bit1=1") || !spd_txn_parse(&txn, "128..145=\"PARTNO\"") || !spd_txn_parse(&txn, "field:ranks=1")
+        || !spd_txn_parse(&txn, "byte0x20=0x5a") || spd_txn_parse(&txn, "byte6.bit8=1") || spd_txn_parse(&txn, "128..129=PARTNO")
+        || spd_txn_parse(&txn, "field:ranks=5") || spd_txn_parse(&txn, "field:none=1") || spd_txn_parse(&txn, "byte256=1")
+        || spd_txn_commit(&txn, &spec, ranges, 4) != 3 || !spec.CRC_real || spec.CRC != spec.CRC_real
+        || ranges[0].offset != 6 || ranges[0].size != 2 || ranges[1].offset != 32 || ranges[2].offset != 126 || ranges[2].size != 20
+        || strcmp(spec.Module_Part_Number, "PARTNO            ") || spec.Number_of_Ranks != 0 || !(txn_image[6] & 2)) {
+        printf("spd_txn_commit() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_txn_parse(&txn, "byte200=1");
+    spd_txn_rollback(&txn);
+    if (txn_image[200] != spd_data[200] || spd_txn_commit(&txn, &spec, ranges, 4)) {
+        printf("spd_txn_rollback() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    // DDR4 fields have their own layout, changed chunks go to the device
+    memcpy(txn_image, ddr4, sizeof(ddr4));
+    spd_txn_begin(&txn, txn_image, sizeof(txn_image));
+    if (!spd_txn_parse(&txn, "field:ranks=2") || !spd_txn_parse(&txn, "329..348=NEWPART") || spd_txn_commit(&txn, &spec, ranges, 4) != 4
+        || spec.Number_of_Ranks != 1 || (txn_image[12] >> 3 & 7) != 1 || strncmp(spec.Module_Part_Number, "NEWPART ", 8)
+        || ranges[0].offset != 12 || ranges[1].offset != 126 || ranges[1].size != 2 || ranges[2].offset != 329 || !spd_crc_ok(&spec)) {
+        printf("spd_txn_commit() DDR4 failed\n");
+        exit(EXIT_FAILURE);
+    }
+    io_ee1004_sim_init(&sim, &bus, ddr4, sizeof(ddr4));
+    io_ee1004_init(&eeprom, &bus, IO_SPD_ADDRESS);
+    uint32_t chunks = 0;
+    for (int n = 0; n < 4; n++)
+        chunks |= io_ee1004_range_chunks(ranges[n].offset, ranges[n].size);
+    if (chunks != 0x00300081 || !io_ee1004_write_chunks(&eeprom, txn_image, chunks) || sim.bytes_written != 4 * 16
+        || memcmp(sim.memory, txn_image, sizeof(txn_image))) {
+        printf("io_ee1004_write_chunks() failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Rules see the unpatched image, all matches are one transaction
+    static SpdPatch patch;
+    int patch_line;
+    const char *patch_error;
+    if (!spd_patch_parse(&patch, "# fleet fixes\n part~'GR1600*' && crc=ok => byte6.bit1=1 # LV\n\nvoltage=1.35/1.5 => 128..131=\"A B\"\n* => byte200=7\n", &patch_line, &patch_error)
+        || patch.count != 3 || patch.rules[1].line != 4 || patch.rules[1].edit_count != 1 || !patch.rules[2].all
+        || spd_patch_parse(&patch, "crc=ok => byte6.bit1=1\nranks=2 => byte6.bit9=1\n", &patch_line, &patch_error)
+        || patch_line != 2 || strncmp(patch_error, "byte6.bit9", 10) || spd_patch_parse(&patch, "crc=ok\n", &patch_line, &patch_error)) {
+        printf("spd_patch_parse() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    spd_patch_parse(&patch, "part~'GR1600*' && crc=ok => byte6.bit1=1\nvoltage=1.35/1.5 => 128..131=\"A B\"\n* => byte200=7\n", &patch_line, &patch_error);
+    memcpy(txn_image, spd_data, SPD_DDR3_SIZE);
+    SpdPatchResult patched = spd_patch_apply(&patch, txn_image);
+    if (patched.matched != 0x5 || !patched.changed || patched.failed || !(txn_image[6] & 2) || txn_image[200] != 7
+        || txn_image[128] != spd_data[128] || !spd_decode(&spec, txn_image)) {
+        printf("spd_patch_apply() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    patched = spd_patch_apply(&patch, txn_image);
+    if (patched.matched != 0x7 || !patched.changed || memcmp(txn_image + 128, "A B ", 4) || !spd_decode(&spec, txn_image)
+        || spd_patch_apply(&patch, txn_image).changed) {
+        printf("spd_patch_apply() second pass failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Journal records round trip through the mapping, a torn tail is padded
+    // to a record that fails its check
+    const char *journal_path = "spd-journal.test";
+    remove(journal_path);
+    IoJournal journal;
+    IoJournalView journal_view;
+    IoJournalRecord journal_record;
+    memcpy(txn_image, spd_data, SPD_DDR3_SIZE);
+    txn_image[6] ^= 2;
+    if (!io_journal_open(&journal, journal_path, 2)
+        || !io_journal_append(&journal, 5, 1000, spd_data, txn_image, SPD_DDR3_SIZE)
+        || !io_journal_append(&journal, 7, 2000, txn_image, spd_data, SPD_DDR3_SIZE)
+        || journal.pending || !io_journal_close(&journal)) {
+        printf("io_journal_append() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    FILE *torn = fopen(journal_path, "ab");
+    fwrite(spd_data, 1, 100, torn);
+    fclose(torn);
+    if (!io_journal_open(&journal, journal_path, IO_JOURNAL_BATCH)
+        || !io_journal_append(&journal, 5, 3000, txn_image, txn_image, SPD_DDR3_SIZE) || !io_journal_close(&journal)
+        || !io_journal_map(&journal_view, journal_path) || journal_view.count != 4
+        || !io_journal_record(&journal_view, 1, &journal_record) || journal_record.device_id != 7 || journal_record.time != 2000
+        || journal_record.size != SPD_DDR3_SIZE || memcmp(journal_record.before, txn_image, SPD_DDR3_SIZE)
+        || memcmp(journal_record.after, spd_data, SPD_DDR3_SIZE)
+        || io_journal_record(&journal_view, 2, &journal_record)
+        || !io_journal_record(&journal_view, 3, &journal_record) || journal_record.time != 3000) {
+        printf("io_journal_record() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    io_journal_unmap(&journal_view);
+    remove(journal_path);
+    // Files that aren't journals are never appended to
+    for (size_t victim_size = 5; victim_size <= SPD_DDR3_SIZE; victim_size += SPD_DDR3_SIZE - 5) {
+        FILE *victim = fopen(journal_path, "wb");
+        fwrite(spd_data, 1, victim_size, victim);
+        fclose(victim);
+        uint64_t journal_size;
+        bool journal_dir;
+        if (io_journal_open(&journal, journal_path, 1) || errno != EINVAL
+            || !io_file_size(journal_path, &journal_size, &journal_dir) || journal_size != victim_size) {
+            printf("io_journal_open() non-journal failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    remove(journal_path);
+
+    // Existing files are kept, suffixed or replaced, batches appear at commit
+    const char *writer_path = "spd-writer.test.bin", *writer_suffix = "spd-writer.test.1.bin";
+    const char *writer_user_tmp = "spd-writer.test.bin.tmp", *writer_late = "spd-writer-late.test.bin";
+    remove(writer_path);
+    remove(writer_suffix);
+    remove(writer_late);
+    FILE *user_tmp = fopen(writer_user_tmp, "wb");
+    fwrite(spd_data, 1, 7, user_tmp);
+    fclose(user_tmp);
+    IoWriter file_writer;
+    IoMapping writer_map;
+    io_writer_init(&file_writer, IO_OVERWRITE_NEVER, false);
+    bool writer_ok = io_writer_write(&file_writer, writer_path, spd_data, SPD_DDR3_SIZE) && !io_writer_write(&file_writer, writer_path, txn_image, SPD_DDR3_SIZE)
+        && errno == EEXIST;
+    int writer_asked = 0;
+    io_writer_init(&file_writer, IO_OVERWRITE_ASK, false);
+    writer_ok = writer_ok && !io_writer_write(&file_writer, writer_path, txn_image, SPD_DDR3_SIZE) && errno == EEXIST;
+    file_writer.confirm = decline_overwrite;
+    file_writer.confirm_ctx = &writer_asked;
+    writer_ok = writer_ok && io_writer_write(&file_writer, writer_path, txn_image, SPD_DDR3_SIZE) && writer_asked == 1;
+    io_writer_init(&file_writer, IO_OVERWRITE_SUFFIX, true);
+    writer_ok = writer_ok && io_writer_write(&file_writer, writer_path, txn_image, 16) && file_writer.count == 1
+        && strcmp(spd_intern_str(&file_writer.targets, 0), writer_suffix) == 0;
+    uint64_t writer_size;
+    bool writer_dir;
+    writer_ok = writer_ok && !io_file_size(writer_suffix, &writer_size, &writer_dir) && io_writer_commit(&file_writer) && !file_writer.count
+        && io_file_size(writer_suffix, &writer_size, &writer_dir) && writer_size == 16;
+    // Temporary files are unique and go away on abort
+    char writer_temp[64] = "";
+    io_writer_init(&file_writer, IO_OVERWRITE_ALWAYS, true);
+    writer_ok = writer_ok && io_writer_write(&file_writer, writer_path, txn_image, SPD_DDR3_SIZE) && file_writer.count == 1
+        && strcmp(file_writer.pending[0].temp, writer_user_tmp) != 0 && strlen(file_writer.pending[0].temp) < sizeof(writer_temp);
+    if (writer_ok)
+        strcpy(writer_temp, file_writer.pending[0].temp);
+    io_writer_abort(&file_writer);
+    writer_ok = writer_ok && !io_file_size(writer_temp, &writer_size, &writer_dir);
+    writer_ok = writer_ok && io_file_map(&writer_map, writer_path) && writer_map.size == SPD_DDR3_SIZE && !memcmp(writer_map.data, spd_data, SPD_DDR3_SIZE);
+    io_file_unmap(&writer_map);
+    // A file appearing before the commit isn't replaced by the never policy
+    io_writer_init(&file_writer, IO_OVERWRITE_NEVER, true);
+    writer_ok = writer_ok && io_writer_write(&file_writer, writer_late, txn_image, SPD_DDR3_SIZE);
+    FILE *late = fopen(writer_late, "wb");
+    fwrite(spd_data, 1, 9, late);
+    fclose(late);
+    writer_ok = writer_ok && !io_writer_commit(&file_writer) && errno == EEXIST
+        && io_file_size(writer_late, &writer_size, &writer_dir) && writer_size == 9;
+    // Parts land at their offsets in any order
+    IoWriterFile parts_file;
+    io_writer_init(&file_writer, IO_OVERWRITE_ALWAYS, false);
+    writer_ok = writer_ok && io_writer_open(&file_writer, &parts_file, writer_path)
+        && io_writer_file_write(&parts_file, txn_image + 128, 128, 128) && io_writer_file_write(&parts_file, txn_image, 128, 0)
+        && io_writer_close(&file_writer, &parts_file);
+    writer_ok = writer_ok && io_file_map(&writer_map, writer_path) && writer_map.size == SPD_DDR3_SIZE && !memcmp(writer_map.data, txn_image, SPD_DDR3_SIZE);
+    io_file_unmap(&writer_map);
+    if (!writer_ok || !io_file_size(writer_user_tmp, &writer_size, &writer_dir) || writer_size != 7) {
+        printf("io_writer_write() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    remove(writer_path);
+    remove(writer_suffix);
+    remove(writer_user_tmp);
+    remove(writer_late);
+
+    // Bulk reads match with and without io_uring, failures are per file
+    const char *bulk_short = "spd-bulk-short.test.bin";
+    char bulk_names[4][32] = { "spd-bulk-0.test.bin", "spd-bulk-missing.test.bin", "spd-bulk-short.test.bin", "spd-bulk-0.test.bin" };
+    char *bulk_paths[4] = { bulk_names[0], bulk_names[1], bulk_names[2], bulk_names[3] };
+    IoWriter bulk_writer;
+    io_writer_init(&bulk_writer, IO_OVERWRITE_ALWAYS, false);
+    io_writer_write(&bulk_writer, bulk_names[0], spd_data, SPD_DDR3_SIZE);
+    io_writer_write(&bulk_writer, bulk_short, spd_data, 100);
+    for (int uring = 0; uring < 2; uring++) {
+        IoBulkReader bulk;
+        static uint8_t bulk_arena[4 * SPD_DDR3_SIZE];
+        uint8_t bulk_failed[4];
+        memset(bulk_arena, 0, sizeof(bulk_arena));
+        io_bulk_open(&bulk, uring != 0);
+        size_t bulk_read = io_bulk_read(&bulk, bulk_paths, 4, bulk_arena, SPD_DDR3_SIZE, bulk_failed);
+        io_bulk_close(&bulk);
+        if (bulk_read != 2 || bulk_failed[0] || bulk_failed[1] != ENOENT || bulk_failed[2] != ENODATA || bulk_failed[3]
+            || memcmp(bulk_arena, spd_data, SPD_DDR3_SIZE) || memcmp(bulk_arena + 3 * SPD_DDR3_SIZE, spd_data, SPD_DDR3_SIZE)) {
+            printf("io_bulk_read() failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    uint8_t short_image[SPD_DDR3_SIZE];
+    if (io_file_read(bulk_short, short_image, SPD_DDR3_SIZE) || errno != ENODATA
+        || io_file_read(bulk_names[1], short_image, SPD_DDR3_SIZE) || errno != ENOENT) {
+        printf("io_file_read() errno failed\n");
+        exit(EXIT_FAILURE);
+    }
+    remove(bulk_names[0]);
+    remove(bulk_short);
+
+    // spdd frame headers are little endian, oversized payloads are rejected
+    uint8_t remote_frame[IO_REMOTE_HEADER_SIZE];
+    IoRemoteHeader remote_header = { 321, 0x01020304, IO_REMOTE_DECODE, 7 }, remote_parsed;
+    io_remote_pack(remote_frame, &remote_header);
+    bool remote_ok = remote_frame[0] == 0x41 && remote_frame[1] == 1 && remote_frame[4] == 4 && remote_frame[8] == IO_REMOTE_DECODE
+        && io_remote_unpack(&remote_parsed, remote_frame) && remote_parsed.size == 321 && remote_parsed.id == 0x01020304
+        && remote_parsed.code == IO_REMOTE_DECODE && remote_parsed.device == 7;
+    remote_header.size = IO_REMOTE_PAYLOAD_MAX + 1;
+    io_remote_pack(remote_frame, &remote_header);
+    if (!remote_ok || io_remote_unpack(&remote_parsed, remote_frame)) {
+        printf("io_remote_pack() failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // spdd requests go through the same frames a socket would carry, the
+    // device page is reselected even when another master switched it
+    IoServer *server = (IoServer *)malloc(sizeof(IoServer));
+    static IoServerConnection conn;
+    io_server_init(server, false);
+    if (!io_server_simulate(server, ddr4, sizeof(ddr4))) {
+        printf("io_server_simulate() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    const char server_patch[] = "329..348=NEWPART";
+    server_request(&conn, 1, IO_REMOTE_READ, 0, "", 0);
+    server_request(&conn, 2, IO_REMOTE_DECODE, 0, "", 0);
+    server_request(&conn, 3, IO_REMOTE_VERIFY, 0, spd_data, SPD_DDR3_SIZE);
+    server_request(&conn, 4, IO_REMOTE_PATCH, 0, server_patch, strlen(server_patch));
+    server_request(&conn, 5, 99, 0, "", 0);
+    server_request(&conn, 6, IO_REMOTE_READ, 5, "", 0);
+    size_t server_offset = 0;
+    uint64_t server_bits = spd_validate(spd_data);
+    const uint8_t *server_out;
+    bool server_ok = io_server_process(server, &conn) && !conn.in_size && server->requests == 6
+        && (server_out = server_response(&conn, &server_offset, 1, IO_REMOTE_OK, sizeof(ddr4))) && !memcmp(server_out, ddr4, sizeof(ddr4))
+        && (server_out = server_response(&conn, &server_offset, 2, IO_REMOTE_OK, 1 + sizeof(ddr4))) && server_out[0] == 1
+        && !memcmp(server_out + 1, ddr4, sizeof(ddr4))
+        && (server_out = server_response(&conn, &server_offset, 3, IO_REMOTE_OK, 9)) && server_out[0] == 1;
+    for (int n = 0; server_ok && n < 8; n++)
+        server_ok = server_out[1 + n] == (uint8_t)(server_bits >> (8 * n));
+    server_ok = server_ok && (server_out = server_response(&conn, &server_offset, 4, IO_REMOTE_OK, sizeof(ddr4)))
+        && !memcmp(server_out + 329, "NEWPART ", 8) && !memcmp(server_out, ddr4, 329)
+        && !memcmp(server->simulated[0].memory, server_out, sizeof(ddr4))
+        && server_response(&conn, &server_offset, 5, IO_REMOTE_BAD_REQUEST, 0)
+        && server_response(&conn, &server_offset, 6, IO_REMOTE_NO_DEVICE, 0) && server_offset == conn.out_size;
+    if (!server_ok) {
+        printf("io_server_process() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    uint8_t server_flash[4 + SPD_DDR4_SIZE] = { 0xff, 0xff, 0xff, 0xff };
+    memcpy(server_flash + 4, ddr4, sizeof(ddr4));
+    conn.out_size = server_offset = 0;
+    server_request(&conn, 7, IO_REMOTE_FLASH, 0, server_flash, sizeof(server_flash));
+    server_request(&conn, 8, IO_REMOTE_FLASH, 0, server_flash, 4 + SPD_DDR3_SIZE);
+    // A header without its payload waits for the rest of the frame
+    server_request(&conn, 9, IO_REMOTE_VERIFY, 0, spd_data, SPD_DDR3_SIZE);
+    conn.in_size -= 1;
+    server_ok = io_server_process(server, &conn) && conn.in_size == IO_REMOTE_HEADER_SIZE + SPD_DDR3_SIZE - 1
+        && server_response(&conn, &server_offset, 7, IO_REMOTE_OK, 0) && server_response(&conn, &server_offset, 8, IO_REMOTE_BAD_REQUEST, 0)
+        && server_offset == conn.out_size && !memcmp(server->simulated[0].memory, ddr4, sizeof(ddr4));
+    conn.in_size = conn.out_size = server_offset = 0;
+    server->simulated[0].page = 1;
+    server->sessions[0].eeprom.page = 0;
+    server_request(&conn, 10, IO_REMOTE_READ, 0, "", 0);
+    server_ok = server_ok && io_server_process(server, &conn)
+        && (server_out = server_response(&conn, &server_offset, 10, IO_REMOTE_OK, sizeof(ddr4))) && !memcmp(server_out, ddr4, sizeof(ddr4));
+    conn.out_size = 0;
+    remote_header.size = IO_REMOTE_PAYLOAD_MAX + 1;
+    io_remote_pack(conn.in, &remote_header);
+    conn.in_size = IO_REMOTE_HEADER_SIZE;
+    errno = 0;
+    if (!server_ok || io_server_process(server, &conn) || errno != EPROTO || conn.out_size) {
+        printf("io_server_process() second pass failed\n");
+        exit(EXIT_FAILURE);
+    }
+    io_server_connection_free(&conn);
+    free(server);
+
+    // JEDEC byte 2: 0x0D is reserved
+    if (spd_field_text(SPD_FIELD_DEVICE_TYPE, 0x0d) || strcmp(spd_field_text(SPD_FIELD_DEVICE_TYPE, 0x0e), "DDR4E SDRAM")
+        || strcmp(spd_field_text(SPD_FIELD_DEVICE_TYPE, 0x0f), "LPDDR3 SDRAM") || strcmp(spd_field_text(SPD_FIELD_DEVICE_TYPE, 0x10), "LPDDR4 SDRAM")) {
+        printf("spd_field_text() device type failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Finished dumps are reported, dot and temporary files are filtered,
+    // a second pass over the same state skips what the first one processed
+    const char *watch_dir = "spd-watch.test";
+    const char *watch_files[] = { "spd-watch.test/dump.bin", "spd-watch.test/.hidden", "spd-watch.test/dump.bin.tmp", "spd-watch.test/.spd-watch" };
+    for (size_t n = 0; n < sizeof(watch_files) / sizeof(watch_files[0]); n++)
+        remove(watch_files[n]);
+#if _WIN32
+    _mkdir(watch_dir);
+#else
+    mkdir(watch_dir, 0755);
+#endif
+    IoWatch *watch = (IoWatch *)malloc(sizeof(IoWatch));
+    bool watch_ok = watch && io_watch_is_candidate("dump.bin") && !io_watch_is_candidate(".hidden")
+        && !io_watch_is_candidate("dump.bin.tmp") && !io_watch_is_candidate(".dump.bin.0123abcd.tmp");
+    if (watch_ok && io_watch_open(watch, watch_dir)) {
+        for (size_t n = 1; n <= 2; n++) {
+            FILE *other = fopen(watch_files[n], "wb");
+            fwrite(spd_data, 1, SPD_DDR3_SIZE, other);
+            fclose(other);
+        }
+        IoWriter watch_writer;
+        io_writer_init(&watch_writer, IO_OVERWRITE_NEVER, false);
+        watch_ok = io_writer_write(&watch_writer, watch_files[0], spd_data, SPD_DDR3_SIZE);
+        // Every file raises an event, the writer's temporary file too
+        char watch_name[256];
+        int watch_events = 0, watch_found = 0;
+        IoWatchEvent watch_event;
+        while ((watch_event = io_watch_next(watch, watch_name, sizeof(watch_name), 200)) == IO_WATCH_FILE) {
+            watch_events++;
+            if (io_watch_is_candidate(watch_name))
+                watch_ok = watch_ok && watch_found++ == 0 && !strcmp(watch_name, "dump.bin");
+        }
+        watch_ok = watch_ok && watch_event == IO_WATCH_TIMEOUT && watch_events >= 4 && watch_found == 1;
+        io_watch_close(watch);
+    } else {
+        watch_ok = watch_ok && errno == ENOSYS;
+        watch_ok = watch_ok && io_file_write(watch_files[0], (uint8_t *)spd_data, SPD_DDR3_SIZE);
+    }
+    free(watch);
+    WatchPass pass;
+    watch_ok = watch_ok && watch_pass(&pass, watch_dir, watch_files[3]) && pass.added == 1 && pass.skipped == 0
+        && watch_pass(&pass, watch_dir, watch_files[3]) && pass.added == 0 && pass.skipped == 1;
+    // Rewritten content is new work
+    IoWriter watch_rewrite;
+    io_writer_init(&watch_rewrite, IO_OVERWRITE_ALWAYS, false);
+    watch_ok = watch_ok && io_writer_write(&watch_rewrite, watch_files[0], txn_image, SPD_DDR3_SIZE)
+        && watch_pass(&pass, watch_dir, watch_files[3]) && pass.added == 1 && pass.skipped == 0;
+    for (size_t n = 0; n < sizeof(watch_files) / sizeof(watch_files[0]); n++)
+        remove(watch_files[n]);
+#if _WIN32
+    _rmdir(watch_dir);
+#else
+    rmdir(watch_dir);
+#endif
+    if (!watch_ok) {
+        printf("io_watch_next() failed\n");
+        exit(EXIT_FAILURE);
+    }
 
     printf("OK");
     return EXIT_SUCCESS;
@@ -0,0 +1,221 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/archive.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+bool archive_open(Archive *a, const char *path)
+{
+    memset(a, 0, sizeof(a[0]));
+    if (!io_file_map(&a->map, path)) {
+        print_error("Can't open file", path, errno);
+        return false;
+    }
+    if (!spd_archive_attach(&a->archive, a->map.data, a->map.size)) {
+        printf("Not an SPD archive: %s\n", path);
+        io_file_unmap(&a->map);
+        return false;
+    }
+    if (a->archive.size != a->map.size)
+        printf("Skipped incomplete last record of archive: %s\n", path);
+    size_t len = strlen(path) + 1;
+    a->path = malloc(len);
+    if (!a->path) {
+        archive_close(a);
+        return false;
+    }
+    memcpy(a->path, path, len);
+    return true;
+}
+
+void archive_close(Archive *a)
+{
+    spd_archive_free(&a->archive);
+    io_file_unmap(&a->map);
+    free(a->path);
+    memset(a, 0, sizeof(a[0]));
+}
+
+static bool append_batch(void *ctx, const SourceBatch *b)
+{
+    SpdArchiveWriter *w = ctx;
+    for (size_t n = 0; n < b->count; n++) {
+        if (b->failed && b->failed[n])
+            continue;
+        if (!spd_archive_append(w, b->images + n * SPD_DDR3_SIZE))
+            return false;
+    }
+    return true;
+}
+
+static bool append_stdin(SpdArchiveWriter *w)
+{
+    uint8_t image[SPD_DDR3_SIZE];
+    size_t size;
+#if _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    while ((size = fread(image, 1, SPD_DDR3_SIZE, stdin)) == SPD_DDR3_SIZE) {
+        if (!spd_archive_append(w, image))
+            return false;
+    }
+    if (size) {
+        printf("Incomplete image of %zu bytes at the end of input\n", size);
+        return false;
+    }
+    return true;
+}
+
+// New records go to the end; an existing archive is only read to restore
+// its templates, so appending doesn't rewrite anything
+static int archive_add(const char *path, char *inputs[], int count)
+{
+    SpdArchiveWriter w;
+    uint64_t records = 0, size = 0;
+    bool is_dir;
+    bool exists = io_file_size(path, &size, &is_dir) && size;
+    if (exists) {
+        // The writer copies the templates, the mapping is closed before writing
+        Archive a;
+        if (!archive_open(&a, path))
+            return EXIT_FAILURE;
+        bool complete = a.archive.size == a.map.size;
+        bool ok = complete && spd_archive_writer_open(&w, NULL, &a.archive);
+        records = a.archive.count;
+        archive_close(&a);
+        if (!complete)
+            printf("Can't append to an archive with an incomplete record: %s\n", path);
+        if (!ok)
+            return EXIT_FAILURE;
+    }
+
+    FILE *f = fopen(path, exists ? "ab" : "wb");
+    if (!f) {
+        printf("Can't open file: %s\n", path);
+        if (exists)
+            spd_archive_writer_close(&w);
+        return EXIT_FAILURE;
+    }
+    bool ok = true;
+    if (exists)
+        w.file = f;
+    else
+        ok = spd_archive_writer_open(&w, f, NULL);
+    for (int n = 0; n < count && ok; n++) {
+        if (!strcmp(inputs[n], "-")) {
+            ok = append_stdin(&w);
+            continue;
+        }
+        Source source;
+        ok = source_open(&source, &inputs[n], 1);
+        if (ok) {
+            ok = source_foreach_ahead(&source, 0, source.count, parallel_cpus(), append_batch, &w);
+            source_close(&source);
+        }
+    }
+    ok = !fclose(f) && ok;
+    if (ok) {
+        printf("Records: %llu (+%llu), templates: %u, size: %llu bytes, ratio: %.1f\n"
+            , (unsigned long long)w.records, (unsigned long long)(w.records - records), w.template_count
+            , (unsigned long long)w.size, spd_archive_ratio(w.records, w.size));
+    } else {
+        printf("Archive write failed: %s\n", path);
+    }
+    spd_archive_writer_close(&w);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int archive_info(const char *path)
+{
+    Archive a;
+    if (!archive_open(&a, path))
+        return EXIT_FAILURE;
+    const SpdArchive *x = &a.archive;
+    printf(
+        "Records:            %zu\n"
+        "Templates:          %u\n"
+        "Size:               %zu bytes\n"
+        "Raw size:           %llu bytes\n"
+        "Compression ratio:  %.1f\n"
+        , x->count, x->template_count, a.map.size
+        , (unsigned long long)x->count * SPD_DDR3_SIZE, spd_archive_ratio(x->count, a.map.size)
+    );
+    archive_close(&a);
+    return EXIT_SUCCESS;
+}
+
+static int archive_get(const char *path, const char *index, const char *output)
+{
+    Archive a;
+    if (!archive_open(&a, path))
+        return EXIT_FAILURE;
+    char *end;
+    unsigned long long n = strtoull(index, &end, 10);
+    uint8_t image[SPD_DDR3_SIZE];
+    bool ok = !*end && end != index && n < a.archive.count && spd_archive_get(&a.archive, (size_t)n, image);
+    if (!ok)
+        printf("No record %s in archive: %s\n", index, path);
+    archive_close(&a);
+    IoWriter writer;
+    writer_init(&writer, IO_OVERWRITE_ASK, false);
+    if (ok && !io_writer_write(&writer, output, image, SPD_DDR3_SIZE)) {
+        print_error("Can't write file", output, errno);
+        ok = false;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int cmd_archive(int argc, char *argv[])
+{
+    if (argc >= 4 && !strcmp(argv[1], "add"))
+        return archive_add(argv[2], argv + 3, argc - 3);
+    if (argc == 3 && !strcmp(argv[1], "info"))
+        return archive_info(argv[2]);
+    if (argc == 5 && !strcmp(argv[1], "get"))
+        return archive_get(argv[2], argv[3], argv[4]);
+    printf(
+        "Usage:\n"
+        "    spd-tool archive add ARCHIVE INPUT...\n"
+        "        Append images of dumps, corpora, archives and directories, '-' reads\n"
+        "        concatenated images from stdin. The archive is created if missing.\n"
+        "    spd-tool archive info ARCHIVE\n"
+        "        Record and template counts, compression ratio\n"
+        "    spd-tool archive get ARCHIVE N OUTPUT\n"
+        "        Extract record N into a dump file\n\n"
+        "Archives store per-SKU template images and sparse deltas of the other\n"
+        "records. Other commands accept archives as INPUT and ARCHIVE:N as an image.\n"
+    );
+    return argc == 2 && !strcmp(argv[1], "--help") ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,79 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#if _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+void print_error(const char *message, const char *path, int error)
+{
+    const char *reason = error == ENODATA ? "file too small" : strerror(error);
+    if (path)
+        printf("%s: %s: %s\n", message, path, reason);
+    else
+        printf("%s: %s\n", message, reason);
+}
+
+static char get_answer()
+{
+    char ans, c;
+    (void)scanf("%c", &ans);
+
+    // https://c-faq.com/stdio/stdinflush2.html
+    while (ans != '\n' && (c = getchar()) != '\n' && c != EOF)
+        /* discard */;
+
+    return ans;
+}
+
+static bool confirm_overwrite(void *ctx, const char *path)
+{
+    (void)ctx;
+    printf("The file already exists: %s\nDo you want to overwrite it? (y/N): ", path);
+    char ans = get_answer();
+    return ans == 'y' || ans == 'Y';
+}
+
+static bool is_terminal(void)
+{
+#if _WIN32
+    return _isatty(_fileno(stdin)) != 0;
+#else
+    return isatty(STDIN_FILENO) != 0;
+#endif
+}
+
+void writer_init(IoWriter *w, IoOverwrite overwrite, bool batch)
+{
+    io_writer_init(w, overwrite, batch);
+    if (is_terminal())
+        w->confirm = confirm_overwrite;
+}
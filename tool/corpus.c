@@ -0,0 +1,62 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+bool corpus_open(Corpus *c, const char *path)
+{
+    memset(c, 0, sizeof(c[0]));
+    if (!io_file_map(&c->map, path)) {
+        print_error("Can't open file", path, errno);
+        return false;
+    }
+    if (c->map.size % SPD_DDR3_SIZE) {
+        printf("Not a corpus of %d byte images: %s\n", SPD_DDR3_SIZE, path);
+        io_file_unmap(&c->map);
+        return false;
+    }
+    size_t len = strlen(path) + 1;
+    c->path = malloc(len);
+    if (!c->path) {
+        io_file_unmap(&c->map);
+        return false;
+    }
+    memcpy(c->path, path, len);
+    c->images = c->map.data;
+    c->count = c->map.size / SPD_DDR3_SIZE;
+    return true;
+}
+
+void corpus_close(Corpus *c)
+{
+    io_file_unmap(&c->map);
+    free(c->path);
+    memset(c, 0, sizeof(c[0]));
+}
@@ -0,0 +1,360 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/diff.h>
+#include <spd/view.h>
+#include <spd/bits.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+static double elapsed_ms(clock_t start)
+{
+    return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+typedef struct Picker
+{
+    uint8_t *data;
+} Picker;
+
+static bool pick_batch(void *ctx, const SourceBatch *b)
+{
+    Picker *p = ctx;
+    if (b->failed && b->failed[0])
+        return false;
+    memcpy(p->data, b->images, SPD_DDR3_SIZE);
+    return true;
+}
+
+// Dump file, or CORPUS:N and ARCHIVE:N image as printed by query and cluster
+static bool load_image(const char *spec, uint8_t data[SPD_DDR3_SIZE])
+{
+    uint64_t size;
+    bool is_dir;
+    const char *colon = strrchr(spec, ':');
+    if ((io_file_size(spec, &size, &is_dir) && !is_dir) || !colon) {
+        if (io_file_read(spec, data, SPD_DDR3_SIZE))
+            return true;
+        print_error("Can't read file", spec, errno);
+        return false;
+    }
+
+    char *path = malloc((size_t)(colon - spec) + 1);
+    if (!path)
+        return false;
+    memcpy(path, spec, (size_t)(colon - spec));
+    path[colon - spec] = 0;
+    char *end;
+    unsigned long long index = strtoull(colon + 1, &end, 10);
+    Source s;
+    Picker p = { data };
+    bool ok = source_open(&s, &path, 1);
+    if (ok && (*end || end == colon + 1 || index >= s.count)) {
+        printf("No image %s in: %s\n", colon + 1, path);
+        ok = false;
+    }
+    if (ok)
+        ok = source_foreach(&s, (size_t)index, (size_t)index + 1, pick_batch, &p);
+    source_close(&s);
+    free(path);
+    return ok;
+}
+
+static void print_field_change(SpdField f, const uint8_t a[SPD_DDR3_SIZE], const uint8_t b[SPD_DDR3_SIZE])
+{
+    const SpdFieldInfo *fi = spd_field_info(f);
+    char before[64], after[64];
+    spd_field_format(f, a[fi->byte] >> fi->shift, before, sizeof(before));
+    spd_field_format(f, b[fi->byte] >> fi->shift, after, sizeof(after));
+    printf("%s: %s -> %s", fi->label, before, after);
+}
+
+int cmd_diff(int argc, char *argv[])
+{
+    if (argc != 3) {
+        printf(
+            "Usage:\n"
+            "    spd-tool diff A B\n\n"
+            "Print bytes that differ between two images with the decoded fields they\n"
+            "hold. An image is a dump file or CORPUS:N. Exits with 0 when the images\n"
+            "are identical, 1 when they differ and 2 on errors, like diff(1).\n"
+        );
+        return 2;
+    }
+    uint8_t a[SPD_DDR3_SIZE], b[SPD_DDR3_SIZE];
+    if (!load_image(argv[1], a) || !load_image(argv[2], b))
+        return 2;
+
+    uint64_t changed[SPD_DIFF_WORDS];
+    int bytes = spd_diff(a, b, changed);
+    if (!bytes)
+        return EXIT_SUCCESS;
+
+    printf("Byte  A  B  Field\n");
+    for (int w = 0; w < SPD_DIFF_WORDS; w++) {
+        for (uint64_t bits = changed[w]; bits; bits &= bits - 1) {
+            int n = w * 64 + spd_ctz64(bits);
+            unsigned covered = 0;
+            const char *sep = "";
+            printf("%4d  %02X %02X  ", n, a[n], b[n]);
+            for (int f = 0; f < SPD_FIELD_COUNT; f++) {
+                const SpdFieldInfo *fi = spd_field_info((SpdField)f);
+                unsigned mask = ((1u << fi->width) - 1) << fi->shift;
+                if (fi->byte != n)
+                    continue;
+                covered |= mask;
+                if (!((a[n] ^ b[n]) & mask))
+                    continue;
+                printf("%s", sep);
+                print_field_change((SpdField)f, a, b);
+                sep = "; ";
+            }
+            if ((a[n] ^ b[n]) & ~covered)
+                printf("%s%s", sep, spd_region_name(spd_region(n)));
+            printf("\n");
+        }
+    }
+    printf("%d bytes, %d bits differ\n", bytes, spd_distance(a, b));
+    return 1;
+}
+
+static void print_signature(uint64_t signature)
+{
+    if (!signature) {
+        printf("identical");
+        return;
+    }
+    const char *sep = "";
+    for (int f = 0; f < SPD_FIELD_COUNT; f++) {
+        if (signature & SPD_SIGNATURE_FIELD(f)) {
+            printf("%s%s", sep, spd_field_info((SpdField)f)->key);
+            sep = ", ";
+        }
+    }
+    for (int r = 0; r < SPD_REGION_COUNT; r++) {
+        if (signature & SPD_SIGNATURE_REGION(r)) {
+            printf("%s%s", sep, spd_region_name((SpdRegion)r));
+            sep = ", ";
+        }
+    }
+}
+
+typedef struct Group
+{
+    uint64_t signature;
+    size_t first;
+    size_t size;
+} Group;
+
+static int compare_signature(const void *a, const void *b)
+{
+    const Group *x = a, *y = b;
+    if (x->signature != y->signature)
+        return x->signature < y->signature ? -1 : 1;
+    return x->first < y->first ? -1 : x->first > y->first;
+}
+
+static int compare_size(const void *a, const void *b)
+{
+    const Group *x = a, *y = b;
+    if (x->size != y->size)
+        return x->size < y->size ? 1 : -1;
+    return x->first < y->first ? -1 : x->first > y->first;
+}
+
+static void print_part(const uint8_t *image)
+{
+    SpdView v;
+    size_t len;
+    spd_view_init(&v, image);
+    const char *part = spd_view_part_number(&v, &len);
+    printf("%.*s", (int)len, part);
+}
+
+// Hamming clusters become groups of leader + size, sorted by size
+static Group *cluster_groups(const uint8_t *images, size_t count, int distance, size_t *groups, bool assign, const Source *s)
+{
+    clock_t start = clock();
+    SpdClustering c;
+    if (!spd_cluster(&c, images, count, distance))
+        return NULL;
+    Group *g = malloc((c.count ? c.count : 1) * sizeof(g[0]));
+    if (g) {
+        for (size_t n = 0; n < c.count; n++)
+            g[n] = (Group){ 0, c.leader[n], c.size[n] };
+        qsort(g, c.count, sizeof(g[0]), compare_size);
+        *groups = c.count;
+        if (assign) {
+            char name[1024];
+            for (size_t n = 0; n < count; n++) {
+                source_name(s, n, name, sizeof(name));
+                printf("%s %u\n", name, c.cluster[n]);
+            }
+        }
+        printf("%zu clusters of %zu images within %d bits, %llu comparisons, %.1f ms\n"
+            , c.count, count, distance, (unsigned long long)c.comparisons, elapsed_ms(start));
+    }
+    spd_cluster_free(&c);
+    return g;
+}
+
+// Images grouped by the changed-field signature against a reference image
+static Group *signature_groups(const uint8_t *images, size_t count, const uint8_t *reference, size_t *groups)
+{
+    clock_t start = clock();
+    Group *g = malloc((count ? count : 1) * sizeof(g[0]));
+    if (!g)
+        return NULL;
+    for (size_t n = 0; n < count; n++)
+        g[n] = (Group){ spd_diff_signature(reference, images + n * SPD_DDR3_SIZE), n, 1 };
+    qsort(g, count, sizeof(g[0]), compare_signature);
+    size_t out = 0;
+    for (size_t n = 0; n < count; n++) {
+        if (out && g[out - 1].signature == g[n].signature)
+            g[out - 1].size++;
+        else
+            g[out++] = g[n];
+    }
+    qsort(g, out, sizeof(g[0]), compare_size);
+    *groups = out;
+    printf("%zu signatures of %zu images, %.1f ms\n", out, count, elapsed_ms(start));
+    return g;
+}
+
+static void print_cluster_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool cluster [OPTIONS] INPUT...\n\n"
+        "Group images of dumps, corpora and directories by similarity.\n\n"
+        "OPTIONS:\n"
+        "    --by hamming|fields\n"
+        "        hamming (default) - clusters of images within --distance bits of a leader\n"
+        "        fields - groups of images with the same changed fields against --golden\n"
+        "    --distance,-d N\n"
+        "        Maximum Hamming distance in bits to a cluster leader, default 32\n"
+        "    --golden IMAGE\n"
+        "        Reference dump file or CORPUS:N for --by fields, default the first image\n"
+        "    --top N\n"
+        "        Print N largest groups, default 20\n"
+        "    --assign\n"
+        "        Print the cluster id of every image\n"
+    );
+}
+
+int cmd_cluster(int argc, char *argv[])
+{
+    enum { OP_BY = 'z' + 1, OP_GOLDEN, OP_TOP, OP_ASSIGN };
+    bool fields = false;
+    bool assign = false;
+    int distance = 32;
+    long top = 20;
+    const char *golden = NULL;
+    while (true) {
+        static struct option options[] = {
+            { "by",                 required_argument, 0, OP_BY },
+            { "distance",           required_argument, 0, 'd' },
+            { "golden",             required_argument, 0, OP_GOLDEN },
+            { "top",                required_argument, 0, OP_TOP },
+            { "assign",             no_argument,       0, OP_ASSIGN },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "d:h", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case OP_BY:
+                if (strcmp(optarg, "fields") && strcmp(optarg, "hamming")) {
+                    printf("Unknown clustering: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                fields = !strcmp(optarg, "fields");
+                break;
+            case 'd': distance = atoi(optarg); break;
+            case OP_GOLDEN: golden = optarg; break;
+            case OP_TOP: top = atol(optarg); break;
+            case OP_ASSIGN: assign = true; break;
+            default:
+                print_cluster_usage();
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        print_cluster_usage();
+        return EXIT_FAILURE;
+    }
+
+    Source source;
+    if (!source_open(&source, argv + optind, argc - optind))
+        return EXIT_FAILURE;
+    uint8_t *owned;
+    const uint8_t *images = source_load(&source, &owned);
+    uint8_t reference[SPD_DDR3_SIZE];
+    bool ok = images != NULL;
+    if (ok && fields) {
+        if (golden)
+            ok = load_image(golden, reference);
+        else if (source.count)
+            memcpy(reference, images, SPD_DDR3_SIZE);
+    }
+
+    size_t count = 0;
+    Group *g = NULL;
+    if (ok) {
+        g = fields ? signature_groups(images, source.count, reference, &count)
+                   : cluster_groups(images, source.count, distance, &count, assign, &source);
+        ok = g != NULL;
+    }
+    if (ok) {
+        char name[1024];
+        printf("%12s  %-40s %s\n", "Images", fields ? "Example" : "Leader", fields ? "Changed fields" : "Part number");
+        for (size_t n = 0; n < count && (top < 0 || n < (size_t)top); n++) {
+            source_name(&source, g[n].first, name, sizeof(name));
+            printf("%12zu  %-40s ", g[n].size, name);
+            if (fields)
+                print_signature(g[n].signature);
+            else
+                print_part(images + g[n].first * SPD_DDR3_SIZE);
+            printf("\n");
+        }
+        if (top >= 0 && count > (size_t)top)
+            printf("... %zu more\n", count - (size_t)top);
+    } else {
+        printf("Clustering failed\n");
+    }
+
+    free(g);
+    free(owned);
+    source_close(&source);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
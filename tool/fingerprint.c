@@ -0,0 +1,138 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/fingerprint.h>
+#include <spd/hash.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct Collected
+{
+    SpdHash *hashes;
+    uint8_t *classes;
+    size_t count;
+    size_t capacity;
+    SpdClass cls;
+} Collected;
+
+static bool collect_batch(void *ctx, const SourceBatch *b)
+{
+    Collected *c = ctx;
+    if (c->count + b->count > c->capacity) {
+        size_t capacity = c->capacity ? c->capacity * 2 : 4096;
+        while (capacity < c->count + b->count)
+            capacity *= 2;
+        SpdHash *hashes = realloc(c->hashes, capacity * sizeof(hashes[0]));
+        if (hashes)
+            c->hashes = hashes;
+        uint8_t *classes = realloc(c->classes, capacity * sizeof(classes[0]));
+        if (classes)
+            c->classes = classes;
+        if (!hashes || !classes)
+            return false;
+        c->capacity = capacity;
+    }
+    for (size_t n = 0; n < b->count; n++) {
+        if (b->failed && b->failed[n])
+            continue;
+        c->hashes[c->count] = spd_hash(b->images + n * SPD_DDR3_SIZE, SPD_DDR3_SIZE);
+        c->classes[c->count++] = (uint8_t)c->cls;
+    }
+    return true;
+}
+
+static void print_fingerprint_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool fingerprint SET [--good INPUT]... [--bad INPUT]...\n\n"
+        "Build a fingerprint set of known-good and known-bad images for\n"
+        "'spd-tool --classify SET'. INPUT is a dump, corpus, archive or directory.\n"
+        "An image listed both as good and bad is classified as bad.\n"
+    );
+}
+
+int cmd_fingerprint(int argc, char *argv[])
+{
+    enum { OP_GOOD = 'z' + 1, OP_BAD };
+    Collected c = {0};
+    bool ok = true;
+    while (ok) {
+        static struct option options[] = {
+            { "good",               required_argument, 0, OP_GOOD },
+            { "bad",                required_argument, 0, OP_BAD },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int opt = getopt_long(argc, argv, "h", options, NULL);
+        if (opt == -1)
+            break;
+        if (opt != OP_GOOD && opt != OP_BAD) {
+            print_fingerprint_usage();
+            free(c.hashes);
+            free(c.classes);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        Source source;
+        c.cls = opt == OP_GOOD ? SPD_CLASS_GOOD : SPD_CLASS_BAD;
+        ok = source_open(&source, &optarg, 1);
+        if (ok)
+            ok = source_foreach_ahead(&source, 0, source.count, parallel_cpus(), collect_batch, &c);
+        source_close(&source);
+    }
+    if (ok && optind + 1 != argc) {
+        print_fingerprint_usage();
+        ok = false;
+    }
+
+    clock_t start = clock();
+    SpdFingerprints f;
+    if (ok && !spd_fingerprint_build(&f, c.hashes, c.classes, c.count)) {
+        printf("Fingerprint set build failed\n");
+        ok = false;
+    }
+    free(c.hashes);
+    free(c.classes);
+    if (!ok)
+        return EXIT_FAILURE;
+
+    FILE *file = fopen(argv[optind], "wb");
+    ok = file && spd_fingerprint_write(&f, file);
+    ok = file && !fclose(file) && ok;
+    if (ok) {
+        printf("Fingerprints: %llu of %zu images, %zu bytes, %.1f ms\n", (unsigned long long)f.count, c.count, f.size
+            , (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC);
+    } else {
+        printf("Can't write file: %s\n", argv[optind]);
+    }
+    spd_fingerprint_free(&f);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,115 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <stdlib.h>
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+int parallel_cpus(void)
+{
+#if _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+typedef struct Worker
+{
+    void (*fn)(void *ctx, int thread, int threads);
+    void *ctx;
+    int thread;
+    int threads;
+} Worker;
+
+#if _WIN32
+static DWORD WINAPI worker_main(LPVOID arg)
+#else
+static void *worker_main(void *arg)
+#endif
+{
+    Worker *w = arg;
+    w->fn(w->ctx, w->thread, w->threads);
+    return 0;
+}
+
+// Runs fn(ctx, thread, threads) on every thread, the caller is thread 0
+bool parallel_run(int threads, void (*fn)(void *ctx, int thread, int threads), void *ctx)
+{
+    if (threads < 1)
+        threads = 1;
+    Worker *workers = calloc((size_t)threads, sizeof(workers[0]));
+#if _WIN32
+    HANDLE *handles = calloc((size_t)threads, sizeof(handles[0]));
+#else
+    pthread_t *handles = calloc((size_t)threads, sizeof(handles[0]));
+#endif
+    if (!workers || !handles) {
+        free(workers);
+        free(handles);
+        return false;
+    }
+
+    int started = 1;
+    for (int t = 0; t < threads; t++) {
+        workers[t].fn = fn;
+        workers[t].ctx = ctx;
+        workers[t].thread = t;
+        workers[t].threads = threads;
+    }
+    for (int t = 1; t < threads; t++, started++) {
+#if _WIN32
+        handles[t] = CreateThread(NULL, 0, worker_main, &workers[t], 0, NULL);
+        if (!handles[t])
+            break;
+#else
+        if (pthread_create(&handles[t], NULL, worker_main, &workers[t]))
+            break;
+#endif
+    }
+    // Threads that failed to start are run inline
+    for (int t = started; t < threads; t++)
+        worker_main(&workers[t]);
+    worker_main(&workers[0]);
+    for (int t = 1; t < started; t++) {
+#if _WIN32
+        WaitForSingleObject(handles[t], INFINITE);
+        CloseHandle(handles[t]);
+#else
+        pthread_join(handles[t], NULL);
+#endif
+    }
+    free(workers);
+    free(handles);
+    return true;
+}
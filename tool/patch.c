@@ -0,0 +1,510 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/patch.h>
+#include <spd/bits.h>
+#include <io/io.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+
+enum PatchState
+{
+    PATCH_UNCHANGED,
+    PATCH_CHANGED,
+    PATCH_FAILED,               // an edit doesn't apply to the image
+    PATCH_UNREADABLE
+};
+
+// Per thread results. Thread shares are consecutive, so the reports read
+// in thread order are in image order.
+typedef struct PatchThread
+{
+    uint8_t *images;            // the patched batch
+    size_t capacity;
+    char *report;
+    size_t report_length;
+    size_t report_capacity;
+    uint64_t changed_bytes;
+    int error;                  // errno of a failed write
+    bool ok;
+} PatchThread;
+
+// Images are patched batch by batch and streamed to the outputs, nothing
+// of the source is held in memory
+typedef struct PatchJob
+{
+    const Source *source;
+    const SpdPatch *patch;
+    uint32_t *matched;
+    uint8_t *state;
+    size_t begin;
+    size_t end;
+    PatchThread *threads;
+    bool report;                // dry run: the changed bytes of every image
+    IoWriterFile *output;       // every image at its index
+    IoWriterFile *corpora;      // in place: per source corpus, fd < 0 if kept
+    size_t *corpus_first;
+} PatchJob;
+
+typedef struct PatchWorker
+{
+    PatchJob *job;
+    PatchThread *thread;
+} PatchWorker;
+
+static bool report_printf(PatchThread *t, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (len < 0)
+        return false;
+    if (t->report_length + (size_t)len + 1 > t->report_capacity) {
+        size_t capacity = t->report_capacity ? t->report_capacity * 2 : 4096;
+        while (capacity < t->report_length + (size_t)len + 1)
+            capacity *= 2;
+        char *report = realloc(t->report, capacity);
+        if (!report)
+            return false;
+        t->report = report;
+        t->report_capacity = capacity;
+    }
+    va_start(args, format);
+    vsnprintf(t->report + t->report_length, (size_t)len + 1, format, args);
+    va_end(args);
+    t->report_length += (size_t)len;
+    return true;
+}
+
+// Dry-run report: changed bytes of a patched image
+static bool report_image(const PatchJob *job, PatchThread *t, size_t index, const uint8_t *before, const uint8_t *after)
+{
+    char name[1024];
+    source_name(job->source, index, name, sizeof(name));
+    bool ok = report_printf(t, "%s (line", name);
+    for (uint32_t bits = job->matched[index]; bits && ok; bits &= bits - 1)
+        ok = report_printf(t, " %d", job->patch->rules[spd_ctz64(bits)].line);
+    ok = ok && report_printf(t, "):");
+    for (int k = 0; k < SPD_DDR3_SIZE && ok; k++) {
+        if (before[k] != after[k])
+            ok = report_printf(t, " %d:%02x>%02x", k, before[k], after[k]);
+    }
+    return ok && report_printf(t, "\n");
+}
+
+static size_t find_corpus(const PatchJob *job, size_t index)
+{
+    size_t n = 0;
+    while (n + 1 < job->source->corpus_count && job->corpus_first[n + 1] <= index)
+        n++;
+    return n;
+}
+
+static bool patch_batch(void *ctx, const SourceBatch *b)
+{
+    PatchWorker *worker = ctx;
+    PatchJob *job = worker->job;
+    PatchThread *t = worker->thread;
+    if (b->count > t->capacity) {
+        uint8_t *images = realloc(t->images, b->count * SPD_DDR3_SIZE);
+        if (!images) {
+            t->error = ENOMEM;
+            return t->ok = false;
+        }
+        t->images = images;
+        t->capacity = b->count;
+    }
+    for (size_t n = 0; n < b->count; n++) {
+        size_t index = b->first + n;
+        const uint8_t *before = b->images + n * SPD_DDR3_SIZE;
+        uint8_t *image = t->images + n * SPD_DDR3_SIZE;
+        // Unreadable images keep their place in the output as zeros
+        if (b->failed && b->failed[n]) {
+            memset(image, 0, SPD_DDR3_SIZE);
+            job->state[index] = PATCH_UNREADABLE;
+            continue;
+        }
+        memcpy(image, before, SPD_DDR3_SIZE);
+        SpdPatchResult r = spd_patch_apply(job->patch, image);
+        job->matched[index] = r.matched;
+        job->state[index] = r.failed ? PATCH_FAILED : r.changed ? PATCH_CHANGED : PATCH_UNCHANGED;
+        if (job->state[index] != PATCH_CHANGED)
+            continue;
+        for (int k = 0; k < SPD_DDR3_SIZE; k++)
+            t->changed_bytes += before[k] != image[k];
+        if (job->report && !report_image(job, t, index, before, image)) {
+            t->error = ENOMEM;
+            return t->ok = false;
+        }
+    }
+    size_t size = b->count * SPD_DDR3_SIZE;
+    bool ok = !job->output || io_writer_file_write(job->output, t->images, size, (uint64_t)b->first * SPD_DDR3_SIZE);
+    // Corpus batches don't cross corpora
+    if (ok && job->corpora) {
+        size_t c = find_corpus(job, b->first);
+        ok = io_writer_file_write(&job->corpora[c], t->images, size, (uint64_t)(b->first - job->corpus_first[c]) * SPD_DDR3_SIZE);
+    }
+    if (!ok) {
+        t->error = errno;
+        t->ok = false;
+    }
+    return ok;
+}
+
+static void patch_thread(void *ctx, int thread, int threads)
+{
+    PatchJob *job = ctx;
+    PatchWorker worker = { job, &job->threads[thread] };
+    size_t count = job->end - job->begin;
+    size_t begin = job->begin + parallel_share(count, thread, threads), end = job->begin + parallel_share(count, thread + 1, threads);
+    if (!source_foreach(job->source, begin, end, patch_batch, &worker) && worker.thread->ok) {
+        worker.thread->error = ENOMEM;
+        worker.thread->ok = false;
+    }
+}
+
+// Runs the patch over [begin, end) of the source, false with errno after
+// a write failure
+static bool patch_run(PatchJob *job, int threads, size_t begin, size_t end)
+{
+    job->begin = begin;
+    job->end = end;
+    for (int t = 0; t < threads; t++)
+        job->threads[t].ok = true;
+    if (!parallel_run(threads, patch_thread, job)) {
+        errno = ENOMEM;
+        return false;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (!job->threads[t].ok) {
+            errno = job->threads[t].error;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_rules(const SpdPatch *p, uint32_t matched)
+{
+    printf(" (line");
+    for (uint32_t bits = matched; bits; bits &= bits - 1)
+        printf(" %d", p->rules[spd_ctz64(bits)].line);
+    printf(")");
+}
+
+static char *read_text(const char *path)
+{
+    uint64_t size;
+    bool is_dir;
+    if (!io_file_size(path, &size, &is_dir) || is_dir || size > (1u << 20)) {
+        printf("Can't read file: %s\n", path);
+        return NULL;
+    }
+    char *text = malloc((size_t)size + 1);
+    if (text && !io_file_read(path, (uint8_t *)text, (size_t)size)) {
+        print_error("Can't read file", path, errno);
+        free(text);
+        return NULL;
+    }
+    if (text)
+        text[size] = 0;
+    return text;
+}
+
+// Parsed rules file, NULL after reporting errors. The caller frees it.
+SpdPatch *patch_load(const char *path)
+{
+    char *text = read_text(path);
+    SpdPatch *patch = malloc(sizeof(*patch));
+    int line;
+    const char *error = NULL;
+    bool ok = text && patch && spd_patch_parse(patch, text, &line, &error);
+    if (text && patch && !ok) {
+        const char *eol = strchr(error, '\n');
+        printf("Invalid rule at line %d: %.*s\n", line, eol ? (int)(eol - error) : (int)strlen(error), error);
+    }
+    if (!patch)
+        printf("Out of memory\n");
+    free(text);
+    if (!ok) {
+        free(patch);
+        return NULL;
+    }
+    return patch;
+}
+
+static bool range_changed(const PatchJob *job, size_t first, size_t count)
+{
+    for (size_t n = first; n < first + count; n++) {
+        if (job->state[n] == PATCH_CHANGED)
+            return true;
+    }
+    return false;
+}
+
+// Copy-on-write: patched copies replace the originals in one batch once
+// all of them are written. Changed corpora are patched again and streamed
+// to their copies, changed dump files are read and patched again one by
+// one. Corpora are mapped, they are replaced after the source is closed.
+static bool patch_in_place(PatchJob *job, Source *source, int threads)
+{
+    IoWriter writer;
+    io_writer_init(&writer, IO_OVERWRITE_ALWAYS, true);
+    size_t base = 0, corpus_count = source->corpus_count;
+    job->corpora = calloc(corpus_count + 1, sizeof(job->corpora[0]));
+    job->corpus_first = calloc(corpus_count + 1, sizeof(job->corpus_first[0]));
+    char **indexes = calloc(corpus_count + 1, sizeof(indexes[0]));
+    bool ok = job->corpora && job->corpus_first && indexes;
+    if (!ok)
+        printf("Out of memory\n");
+    for (size_t n = 0; n < corpus_count && ok; n++)
+        job->corpora[n].fd = -1;
+    for (size_t n = 0; n < corpus_count && ok; n++) {
+        Corpus *c = &source->corpora[n];
+        job->corpus_first[n] = base;
+        if (range_changed(job, base, c->count)) {
+            if (!io_writer_open(&writer, &job->corpora[n], c->path)) {
+                print_error("Can't write file", c->path, errno);
+                ok = false;
+            }
+            indexes[n] = index_path(c->path);
+        }
+        base += c->count;
+    }
+    size_t corpus_end = base;
+    for (size_t n = 0; n < source->archive_count && ok; n++) {
+        const Archive *a = &source->archives[n];
+        if (range_changed(job, base, a->archive.count)) {
+            printf("Archives can't be patched in place, use --output: %s\n", a->path);
+            ok = false;
+        }
+        base += a->archive.count;
+    }
+    if (ok && corpus_end && !patch_run(job, threads, 0, corpus_end)) {
+        print_error("Can't write patched corpora", NULL, errno);
+        ok = false;
+    }
+    for (size_t n = 0; n < source->file_count && ok; n++) {
+        if (job->state[base + n] != PATCH_CHANGED)
+            continue;
+        uint8_t image[SPD_DDR3_SIZE];
+        if (!io_file_read(source->files[n], image, sizeof(image))) {
+            print_error("Can't read file", source->files[n], errno);
+            ok = false;
+        } else if (!spd_patch_apply(job->patch, image).changed) {
+            printf("File changed while patching: %s\n", source->files[n]);
+            ok = false;
+        } else if (!io_writer_write(&writer, source->files[n], image, sizeof(image))) {
+            print_error("Can't write file", source->files[n], errno);
+            ok = false;
+        }
+    }
+    for (size_t n = 0; n < corpus_count && job->corpora; n++) {
+        if (ok && !io_writer_close(&writer, &job->corpora[n])) {
+            print_error("Can't write file", source->corpora[n].path, errno);
+            ok = false;
+        }
+        io_writer_discard(&job->corpora[n]);
+    }
+    source_close(source);
+    if (!ok)
+        io_writer_abort(&writer);
+    else if (!(ok = io_writer_commit(&writer)))
+        print_error("Can't replace patched files", NULL, errno);
+    // Indexes of replaced corpora describe the old content
+    for (size_t n = 0; n < corpus_count && indexes; n++) {
+        if (ok && indexes[n] && remove(indexes[n]) == 0)
+            printf("Removed stale index, rebuild it with 'spd-tool index': %s\n", indexes[n]);
+        free(indexes[n]);
+    }
+    free(indexes);
+    return ok;
+}
+
+static void print_patch_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool patch --rules RULES [OPTIONS] INPUT...\n\n"
+        "Apply rule based edits to dumps, corpora, archives and directories in one\n"
+        "parallel pass. Every line of RULES is a query and the edits for images\n"
+        "matching it, rules are evaluated against the unpatched image:\n"
+        "    # Reset LV on GR1600 images with a valid CRC\n"
+        "    part~'GR1600*' && crc=ok => byte6.bit1=0\n"
+        "    * => 128..145=\"PARTNO\" field:ranks=2\n"
+        "Edits are the --set edits, see 'spd-tool --help'. The CRC is recomputed\n"
+        "once per image.\n\n"
+        "OPTIONS:\n"
+        "    --rules,-r RULES\n"
+        "        Rules file\n"
+        "    --dry-run,-n\n"
+        "        Print the changed bytes of every matching image, nothing is written\n"
+        "    --output,-o OUTPUT\n"
+        "        Write all images, patched or not, to a new corpus. Unreadable\n"
+        "        images are written as zeros, record N is input image N.\n"
+        "    --overwrite POLICY\n"
+        "        Existing OUTPUT: ask, never, always or suffix, see 'spd-tool --help'\n"
+        "    --in-place\n"
+        "        Replace changed dumps and corpora by their patched copies\n"
+        "    --jobs,-j N\n"
+        "        Number of threads, default is the number of CPUs\n"
+    );
+}
+
+int cmd_patch(int argc, char *argv[])
+{
+    const char *rules = NULL, *output = NULL;
+    bool dry_run = false, in_place = false;
+    IoOverwrite overwrite = IO_OVERWRITE_ASK;
+    int threads = parallel_cpus();
+    while (true) {
+        static struct option options[] = {
+            { "rules",              required_argument, 0, 'r' },
+            { "dry-run",            no_argument,       0, 'n' },
+            { "output",             required_argument, 0, 'o' },
+            { "in-place",           no_argument,       0, 'I' },
+            { "jobs",               required_argument, 0, 'j' },
+            { "overwrite",          required_argument, 0, 'W' },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "r:no:j:h", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case 'r': rules = optarg; break;
+            case 'n': dry_run = true; break;
+            case 'o': output = optarg; break;
+            case 'I': in_place = true; break;
+            case 'j': threads = atoi(optarg); break;
+            case 'W':
+                if (!io_overwrite_parse(optarg, &overwrite)) {
+                    printf("Invalid overwrite policy: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                print_patch_usage();
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || !rules || (!dry_run && !output == !in_place)) {
+        print_patch_usage();
+        return EXIT_FAILURE;
+    }
+
+    SpdPatch *patch = patch_load(rules);
+    Source source;
+    if (!patch || !source_open(&source, argv + optind, argc - optind)) {
+        free(patch);
+        return EXIT_FAILURE;
+    }
+    if (threads < 1)
+        threads = 1;
+    if ((size_t)threads > source.count / 1024 + 1)
+        threads = (int)(source.count / 1024 + 1);
+
+    size_t count = source.count ? source.count : 1;
+    PatchJob job;
+    memset(&job, 0, sizeof(job));
+    job.source = &source;
+    job.patch = patch;
+    job.report = dry_run;
+    job.matched = calloc(count, sizeof(job.matched[0]));
+    job.state = calloc(count, sizeof(job.state[0]));
+    job.threads = calloc((size_t)threads, sizeof(job.threads[0]));
+    bool ok = job.matched && job.state && job.threads;
+    if (!ok)
+        printf("Out of memory\n");
+
+    // The output is written in the same pass, in place replacements need
+    // the changed images first
+    IoWriter output_writer;
+    IoWriterFile output_file;
+    if (ok && !dry_run && output) {
+        writer_init(&output_writer, overwrite, false);
+        if (!(ok = io_writer_open(&output_writer, &output_file, output)))
+            print_error("Can't write file", output, errno);
+        job.output = &output_file;
+    }
+    if (ok && !patch_run(&job, threads, 0, source.count)) {
+        print_error(output ? "Can't write file" : "Patch failed", output, errno);
+        ok = false;
+    }
+    if (ok && dry_run) {
+        for (int t = 0; t < threads; t++)
+            fwrite(job.threads[t].report, 1, job.threads[t].report_length, stdout);
+    }
+    if (ok) {
+        uint64_t states[4] = {0}, rule_counts[SPD_PATCH_RULES_MAX] = {0}, changed_bytes = 0;
+        char name[1024];
+        for (size_t n = 0; n < source.count; n++) {
+            states[job.state[n]]++;
+            for (uint32_t bits = job.matched[n]; bits; bits &= bits - 1)
+                rule_counts[spd_ctz64(bits)]++;
+            if (job.state[n] == PATCH_FAILED) {
+                source_name(&source, n, name, sizeof(name));
+                printf("Edits don't apply, unchanged: %s", name);
+                print_rules(patch, job.matched[n]);
+                printf("\n");
+            }
+        }
+        for (int t = 0; t < threads; t++)
+            changed_bytes += job.threads[t].changed_bytes;
+        for (int r = 0; r < patch->count; r++)
+            printf("Rule at line %d: %llu matches\n", patch->rules[r].line, (unsigned long long)rule_counts[r]);
+        printf("Images: %zu, changed: %llu (%llu bytes), failed: %llu, unreadable: %llu\n", source.count
+            , (unsigned long long)states[PATCH_CHANGED], (unsigned long long)changed_bytes
+            , (unsigned long long)states[PATCH_FAILED], (unsigned long long)states[PATCH_UNREADABLE]);
+    }
+    if (job.output) {
+        if (ok && !(ok = io_writer_close(&output_writer, &output_file)))
+            print_error("Can't write file", output, errno);
+        io_writer_discard(&output_file);
+        job.output = NULL;
+    }
+    if (ok && !dry_run && in_place)
+        ok = patch_in_place(&job, &source, threads);
+    source_close(&source);
+    for (int t = 0; job.threads && t < threads; t++) {
+        free(job.threads[t].images);
+        free(job.threads[t].report);
+    }
+    free(job.threads);
+    free(job.corpora);
+    free(job.corpus_first);
+    free(job.matched);
+    free(job.state);
+    free(patch);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
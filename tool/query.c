@@ -0,0 +1,206 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/hash.h>
+#include <spd/index.h>
+#include <spd/query.h>
+#include <spd/view.h>
+#include <spd/bits.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+char *index_path(const char *corpus)
+{
+    size_t size = strlen(corpus) + sizeof(".idx");
+    char *path = malloc(size);
+    if (path)
+        snprintf(path, size, "%s.idx", corpus);
+    return path;
+}
+
+static double elapsed_ms(clock_t start)
+{
+    return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+int cmd_index(int argc, char *argv[])
+{
+    if (argc != 2) {
+        printf(
+            "Usage:\n"
+            "    spd-tool index CORPUS\n\n"
+            "Build secondary indexes for queries, stored in CORPUS.idx\n"
+        );
+        return EXIT_FAILURE;
+    }
+    Corpus corpus;
+    if (!corpus_open(&corpus, argv[1]))
+        return EXIT_FAILURE;
+
+    clock_t start = clock();
+    SpdIndex x;
+    bool ok = spd_index_build(&x, corpus.images, corpus.count);
+    corpus_close(&corpus);
+    if (!ok) {
+        printf("Index build failed\n");
+        return EXIT_FAILURE;
+    }
+
+    char *path = index_path(argv[1]);
+    FILE *f = path ? fopen(path, "wb") : NULL;
+    ok = f && spd_index_write(&x, f);
+    if (f)
+        ok = (fclose(f) == 0) && ok;
+    if (ok) {
+        printf("Indexed %llu images, %u part numbers in %.1f ms: %s\n"
+            , (unsigned long long)x.count, x.part_count, elapsed_ms(start), path);
+    } else {
+        printf("Can't write file: %s\n", path ? path : argv[1]);
+    }
+    free(path);
+    spd_index_free(&x);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void print_query_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool query CORPUS --where EXPR [OPTIONS]\n\n"
+        "OPTIONS:\n"
+        "    --where,-w EXPR\n"
+        "        Filter expression, terms KEY OP VALUE joined by && and ||\n"
+        "        KEY - SPD field key, capacity, part or crc\n"
+        "        OP  - = != < <= > >= or ~ (glob match)\n"
+        "    --count,-c\n"
+        "        Print the number of matches only\n"
+        "    --limit,-n N\n"
+        "        Print at most N matches\n"
+        "    --no-index\n"
+        "        Ignore CORPUS.idx and scan the corpus\n\n"
+        "EXAMPLES\n"
+        "    spd-tool query fleet.bin --where \"voltage=1.35/1.5 && capacity>=8192 && part~'GR1600*'\"\n"
+    );
+}
+
+int cmd_query(int argc, char *argv[])
+{
+    enum { OP_NO_INDEX = 'z' + 1 };
+    const char *where = NULL;
+    bool count_only = false, use_index = true;
+    long limit = -1;
+    while (true) {
+        static struct option options[] = {
+            { "where",              required_argument, 0, 'w' },
+            { "count",              no_argument,       0, 'c' },
+            { "limit",              required_argument, 0, 'n' },
+            { "no-index",           no_argument,       0, OP_NO_INDEX },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "w:cn:h", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case 'w': where = optarg; break;
+            case 'c': count_only = true; break;
+            case 'n': limit = atol(optarg); break;
+            case OP_NO_INDEX: use_index = false; break;
+            default:
+                print_query_usage();
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (!where || optind != argc - 1) {
+        print_query_usage();
+        return EXIT_FAILURE;
+    }
+    const char *path = argv[optind];
+
+    SpdQuery q;
+    const char *error = NULL;
+    if (!spd_query_parse(&q, where, &error)) {
+        printf("Invalid query at: %s\n", error);
+        return EXIT_FAILURE;
+    }
+
+    Corpus corpus;
+    if (!corpus_open(&corpus, path))
+        return EXIT_FAILURE;
+
+    // The index is only trusted for the corpus it was built from, rewrites
+    // in place keep the size so the content is compared too
+    IoMapping index_map = {0};
+    SpdIndex x;
+    bool indexed = false;
+    char *idx = index_path(path);
+    FILE *probe = use_index && idx ? fopen(idx, "rb") : NULL;
+    if (probe) {
+        fclose(probe);
+        indexed = io_file_map(&index_map, idx) && spd_index_attach(&x, index_map.data, index_map.size)
+            && x.corpus_size == corpus.map.size
+            && spd_hash_equal(x.corpus_hash, spd_hash(corpus.images, corpus.count * SPD_DDR3_SIZE));
+        if (!indexed)
+            printf("Index is stale, scanning: %s\n", idx);
+    }
+    free(idx);
+
+    clock_t start = clock();
+    uint64_t *result = malloc(spd_bitmap_words(corpus.count) * sizeof(result[0]) + 1);
+    if (!result) {
+        corpus_close(&corpus);
+        io_file_unmap(&index_map);
+        return EXIT_FAILURE;
+    }
+    size_t matches = spd_query_run(&q, indexed ? &x : NULL, corpus.images, corpus.count, result);
+    double ms = elapsed_ms(start);
+
+    if (!count_only) {
+        long printed = 0;
+        for (size_t w = 0; w < spd_bitmap_words(corpus.count) && printed != limit; w++) {
+            for (uint64_t bits = result[w]; bits && printed != limit; bits &= bits - 1, printed++) {
+                size_t r = w * 64 + spd_ctz64(bits);
+                SpdView v;
+                spd_view_init(&v, corpus.images + r * SPD_DDR3_SIZE);
+                size_t len;
+                const char *part = spd_view_part_number(&v, &len);
+                const char *voltage = spd_field_text(SPD_FIELD_VOLTAGE, spd_view_voltage(&v));
+                printf("%zu\t%.*s\t%d MB\t%s\n", r, (int)len, part, spd_view_capacity(&v), voltage ? voltage : "Unknown");
+            }
+        }
+    }
+    printf("%zu of %zu images matched in %.1f ms (%s)\n", matches, corpus.count, ms, indexed ? "indexed" : "scan");
+
+    free(result);
+    corpus_close(&corpus);
+    io_file_unmap(&index_map);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/serialize.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#if _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#define SERIALIZE_BATCH 4096
+
+static void print_serialize_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool serialize TEMPLATE --serial FIRST --count N [OPTIONS] -o OUTPUT\n\n"
+        "Stamp serial numbers FIRST ~ FIRST + N - 1 on a DDR3 or DDR4 template and\n"
+        "write the images concatenated, ready for a programming station.\n"
+        "'-o -' streams the images to stdout.\n\n"
+        "OPTIONS:\n"
+        "    --serial,-s FIRST\n"
+        "        First serial number, decimal or 0x hexadecimal\n"
+        "    --count,-n N\n"
+        "        Number of images\n"
+        "    --date YYWW\n"
+        "        Manufacturing year and week, template date by default\n"
+        "    --location N\n"
+        "        Manufacturing location, template location by default\n"
+        "    --output,-o OUTPUT\n"
+        "        Output corpus file or '-'\n"
+    );
+}
+
+static bool parse_number(const char *text, unsigned long max, unsigned long *value)
+{
+    char *end;
+    *value = strtoul(text, &end, 0);
+    return end != text && !*end && *value <= max;
+}
+
+int cmd_serialize(int argc, char *argv[])
+{
+    const char *serial = NULL, *count = NULL, *date = NULL, *location = NULL, *output = NULL;
+    while (true) {
+        static struct option options[] = {
+            { "serial",             required_argument, 0, 's' },
+            { "count",              required_argument, 0, 'n' },
+            { "date",               required_argument, 0, 'D' },
+            { "location",           required_argument, 0, 'L' },
+            { "output",             required_argument, 0, 'o' },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "s:n:o:h", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case 's': serial = optarg; break;
+            case 'n': count = optarg; break;
+            case 'D': date = optarg; break;
+            case 'L': location = optarg; break;
+            case 'o': output = optarg; break;
+            default:
+                print_serialize_usage();
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind + 1 != argc || !serial || !count || !output) {
+        print_serialize_usage();
+        return EXIT_FAILURE;
+    }
+
+    uint8_t image[SPD_SIZE_MAX];
+    size_t size = io_file_read_some(argv[optind], image, sizeof(image));
+    if (!size) {
+        print_error("Can't read file", argv[optind], errno);
+        return EXIT_FAILURE;
+    }
+    static SpdSerializer s;
+    if (!spd_serializer_init(&s, image, size)) {
+        printf("Not a DDR3 or DDR4 template: %s\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    SpdUnit unit;
+    spd_unit_from_image(&s, &unit);
+    unsigned long first, total, value;
+    if (!parse_number(serial, 0xFFFFFFFFUL, &first)) {
+        printf("Invalid serial number: %s\n", serial);
+        return EXIT_FAILURE;
+    }
+    if (!parse_number(count, 0xFFFFFFFFUL, &total) || total - 1 > 0xFFFFFFFFUL - first) {
+        printf("Invalid count: %s\n", count);
+        return EXIT_FAILURE;
+    }
+    if (date) {
+        if (strlen(date) != 4 || !parse_number(date, 9999, &value) || value % 100 < 1 || value % 100 > 53) {
+            printf("Invalid date, expected YYWW: %s\n", date);
+            return EXIT_FAILURE;
+        }
+        unit.year = (uint8_t)(value / 100);
+        unit.week = (uint8_t)(value % 100);
+    }
+    if (location) {
+        if (!parse_number(location, 255, &value)) {
+            printf("Invalid location: %s\n", location);
+            return EXIT_FAILURE;
+        }
+        unit.location = (uint8_t)value;
+    }
+
+    // Reports go to stderr when the images stream to stdout
+    bool to_stdout = !strcmp(output, "-");
+    FILE *report = to_stdout ? stderr : stdout;
+    FILE *f = stdout;
+    if (to_stdout) {
+#if _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    } else if (!(f = fopen(output, "wb"))) {
+        printf("Can't open file: %s\n", output);
+        return EXIT_FAILURE;
+    }
+    uint8_t *batch = malloc(SERIALIZE_BATCH * s.size);
+    bool ok = batch != NULL;
+    clock_t start = clock();
+    unit.serial = (uint32_t)first;
+    for (unsigned long done = 0; ok && done < total; ) {
+        size_t n = total - done < SERIALIZE_BATCH ? (size_t)(total - done) : SERIALIZE_BATCH;
+        spd_serialize_range(&s, &unit, n, batch);
+        ok = fwrite(batch, s.size, n, f) == n;
+        unit.serial += (uint32_t)n;
+        done += n;
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    ok = !(to_stdout ? fflush(f) : fclose(f)) && ok;
+    free(batch);
+    if (!ok) {
+        fprintf(report, "Write failed: %s\n", output);
+        return EXIT_FAILURE;
+    }
+    fprintf(report, "Images: %lu, serials: %lu ~ %lu, size: %zu bytes, time: %.3f s",
+        total, first, first + total - 1, s.size, seconds);
+    if (seconds > 0)
+        fprintf(report, ", rate: %.0f images/s", (double)total / seconds);
+    fprintf(report, "\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,331 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <io/bulk.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define BATCH_IMAGES 256
+
+typedef struct Collector
+{
+    Source *s;
+    bool ok;
+} Collector;
+
+static bool add_corpus(Source *s, const char *path)
+{
+    Corpus *corpora = realloc(s->corpora, (s->corpus_count + 1) * sizeof(corpora[0]));
+    if (!corpora)
+        return false;
+    s->corpora = corpora;
+    if (!corpus_open(&s->corpora[s->corpus_count], path))
+        return false;
+    s->corpus_count++;
+    return true;
+}
+
+static bool add_archive(Source *s, const char *path)
+{
+    Archive *archives = realloc(s->archives, (s->archive_count + 1) * sizeof(archives[0]));
+    if (!archives)
+        return false;
+    s->archives = archives;
+    if (!archive_open(&s->archives[s->archive_count], path))
+        return false;
+    s->archive_count++;
+    return true;
+}
+
+static bool add_file(Source *s, const char *path)
+{
+    if (s->file_count % 1024 == 0) {
+        char **files = realloc(s->files, (s->file_count + 1024) * sizeof(files[0]));
+        if (!files)
+            return false;
+        s->files = files;
+    }
+    size_t len = strlen(path) + 1;
+    char *copy = malloc(len);
+    if (!copy)
+        return false;
+    memcpy(copy, path, len);
+    s->files[s->file_count++] = copy;
+    return true;
+}
+
+// A whole DDR4 EEPROM has the size of a two record corpus
+static bool is_ddr4_dump(const char *path, uint64_t size)
+{
+    uint8_t head[SPD_DDR3_SIZE];
+    return size == SPD_DDR4_SIZE && io_file_read(path, head, sizeof(head)) && spd_image_size(head, SPD_DDR4_SIZE) == SPD_DDR4_SIZE;
+}
+
+// One image files are read, archives and corpora are mapped. Sources hold
+// SPD_DDR3_SIZE records, DDR4 dumps are skipped rather than split.
+static bool add_path(void *ctx, const char *path)
+{
+    Collector *c = ctx;
+    uint8_t magic[SPD_ARCHIVE_MAGIC_SIZE];
+    uint64_t size;
+    bool is_dir;
+    if (!io_file_size(path, &size, &is_dir)) {
+        print_error("Can't open file", path, errno);
+        c->ok = false;
+        return false;
+    }
+    if (is_dir) {
+        if (io_dir_list(path, add_path, ctx))
+            return true;
+        // errno is clear when a nested call stopped the listing
+        if (errno)
+            print_error("Can't open directory", path, errno);
+        return false;
+    }
+    if (size == SPD_DDR3_SIZE) {
+        c->ok = add_file(c->s, path);
+    } else if (size >= sizeof(magic) && io_file_read(path, magic, sizeof(magic)) && spd_archive_check(magic, sizeof(magic))) {
+        c->ok = add_archive(c->s, path);
+    } else if (is_ddr4_dump(path, size)) {
+        printf("Skipped, DDR4 dumps aren't supported here: %s\n", path);
+    } else if (size && size % SPD_DDR3_SIZE == 0) {
+        c->ok = add_corpus(c->s, path);
+    } else {
+        printf("Skipped, not a dump or corpus: %s\n", path);
+    }
+    return c->ok;
+}
+
+bool source_open(Source *s, char *const paths[], int count)
+{
+    memset(s, 0, sizeof(s[0]));
+    Collector c = { s, true };
+    for (int n = 0; n < count && c.ok; n++)
+        add_path(&c, paths[n]);
+    if (!c.ok) {
+        source_close(s);
+        return false;
+    }
+    for (size_t n = 0; n < s->corpus_count; n++)
+        s->count += s->corpora[n].count;
+    for (size_t n = 0; n < s->archive_count; n++)
+        s->count += s->archives[n].archive.count;
+    s->count += s->file_count;
+    return true;
+}
+
+void source_close(Source *s)
+{
+    for (size_t n = 0; n < s->corpus_count; n++)
+        corpus_close(&s->corpora[n]);
+    for (size_t n = 0; n < s->archive_count; n++)
+        archive_close(&s->archives[n]);
+    for (size_t n = 0; n < s->file_count; n++)
+        free(s->files[n]);
+    free(s->corpora);
+    free(s->archives);
+    free(s->files);
+    memset(s, 0, sizeof(s[0]));
+}
+
+void source_name(const Source *s, size_t index, char *name, size_t size)
+{
+    for (size_t n = 0; n < s->corpus_count; n++) {
+        if (index < s->corpora[n].count) {
+            snprintf(name, size, "%s:%zu", s->corpora[n].path, index);
+            return;
+        }
+        index -= s->corpora[n].count;
+    }
+    for (size_t n = 0; n < s->archive_count; n++) {
+        if (index < s->archives[n].archive.count) {
+            snprintf(name, size, "%s:%zu", s->archives[n].path, index);
+            return;
+        }
+        index -= s->archives[n].archive.count;
+    }
+    snprintf(name, size, "%s", index < s->file_count ? s->files[index] : "?");
+}
+
+// Corpus images are passed in place, archives are decoded and files are
+// read in batches
+bool source_foreach(const Source *s, size_t begin, size_t end, bool (*fn)(void *ctx, const SourceBatch *b), void *ctx)
+{
+    size_t base = 0;
+    for (size_t n = 0; n < s->corpus_count && begin < end; n++) {
+        const Corpus *c = &s->corpora[n];
+        if (begin < base + c->count) {
+            size_t last = end < base + c->count ? end : base + c->count;
+            for (size_t i = begin; i < last; i += BATCH_IMAGES) {
+                SourceBatch b = { c->images + (i - base) * SPD_DDR3_SIZE, i, 0, NULL };
+                b.count = last - i < BATCH_IMAGES ? last - i : BATCH_IMAGES;
+                if (!fn(ctx, &b))
+                    return false;
+            }
+            begin = last;
+        }
+        base += c->count;
+    }
+    if (begin >= end)
+        return true;
+
+    uint8_t *images = malloc(BATCH_IMAGES * SPD_DDR3_SIZE);
+    uint8_t failed[BATCH_IMAGES];
+    if (!images)
+        return false;
+    bool ok = true;
+    for (size_t n = 0; n < s->archive_count && begin < end && ok; n++) {
+        const SpdArchive *a = &s->archives[n].archive;
+        if (begin < base + a->count) {
+            size_t last = end < base + a->count ? end : base + a->count;
+            for (size_t i = begin; i < last && ok; i += BATCH_IMAGES) {
+                SourceBatch b = { images, i, last - i < BATCH_IMAGES ? last - i : BATCH_IMAGES, NULL };
+                spd_archive_read(a, i - base, images, b.count);
+                ok = fn(ctx, &b);
+            }
+            begin = last;
+        }
+        base += a->count;
+    }
+    // Dump files go through one bulk reader per call, callers run a call
+    // per thread
+    IoBulkReader reader;
+    if (begin < end)
+        io_bulk_open(&reader, true);
+    for (size_t i = begin; i < end && ok; i += BATCH_IMAGES) {
+        SourceBatch b = { images, i, end - i < BATCH_IMAGES ? end - i : BATCH_IMAGES, failed };
+        io_bulk_read(&reader, s->files + (i - base), b.count, images, SPD_DDR3_SIZE, failed);
+        for (size_t n = 0; n < b.count; n++) {
+            if (failed[n])
+                print_error("Can't read file", s->files[i - base + n], failed[n]);
+        }
+        ok = fn(ctx, &b);
+    }
+    if (begin < end)
+        io_bulk_close(&reader);
+    free(images);
+    return ok;
+}
+
+// Images of [begin, end) copied to their place in images, read failures
+// to failed or, without it, as zeroed images
+typedef struct Window
+{
+    const Source *s;
+    size_t begin;
+    size_t end;
+    uint8_t *images;
+    uint8_t *failed;
+    bool *ok;
+} Window;
+
+static bool window_batch(void *ctx, const SourceBatch *b)
+{
+    Window *w = ctx;
+    size_t at = b->first - w->begin;
+    uint8_t *dst = w->images + at * SPD_DDR3_SIZE;
+    memcpy(dst, b->images, b->count * SPD_DDR3_SIZE);
+    for (size_t n = 0; n < b->count; n++) {
+        uint8_t error = b->failed ? b->failed[n] : 0;
+        if (w->failed)
+            w->failed[at + n] = error;
+        else if (error)
+            memset(dst + n * SPD_DDR3_SIZE, 0, SPD_DDR3_SIZE);
+    }
+    return true;
+}
+
+static void window_thread(void *ctx, int thread, int threads)
+{
+    Window *w = ctx;
+    size_t count = w->end - w->begin;
+    w->ok[thread] = source_foreach(w->s, w->begin + parallel_share(count, thread, threads), w->begin + parallel_share(count, thread + 1, threads), window_batch, w);
+}
+
+static bool window_read(Window *w, int threads)
+{
+    if (!parallel_run(threads, window_thread, w))
+        return false;
+    for (int t = 0; t < threads; t++) {
+        if (!w->ok[t])
+            return false;
+    }
+    return true;
+}
+
+// Callers without threads of their own still read dump files in parallel:
+// threads fill a window of images, then fn gets its batches in order
+bool source_foreach_ahead(const Source *s, size_t begin, size_t end, int threads, bool (*fn)(void *ctx, const SourceBatch *b), void *ctx)
+{
+    // Corpus images are mapped, there is nothing to read ahead
+    size_t mapped = 0;
+    for (size_t n = 0; n < s->corpus_count; n++)
+        mapped += s->corpora[n].count;
+    mapped = mapped < begin ? begin : mapped > end ? end : mapped;
+    if (threads < 2 || mapped == end)
+        return source_foreach(s, begin, end, fn, ctx);
+    if (begin < mapped && !source_foreach(s, begin, mapped, fn, ctx))
+        return false;
+
+    size_t window = (size_t)threads * BATCH_IMAGES;
+    Window w = { s, 0, 0, malloc(window * SPD_DDR3_SIZE), malloc(window), calloc((size_t)threads, sizeof(bool)) };
+    bool ok = w.images && w.failed && w.ok;
+    for (size_t i = mapped; i < end && ok; i += window) {
+        w.begin = i;
+        w.end = end - i < window ? end : i + window;
+        ok = window_read(&w, threads);
+        for (size_t k = w.begin; k < w.end && ok; k += BATCH_IMAGES) {
+            SourceBatch b = { w.images + (k - i) * SPD_DDR3_SIZE, k, w.end - k < BATCH_IMAGES ? w.end - k : BATCH_IMAGES, w.failed + (k - i) };
+            ok = fn(ctx, &b);
+        }
+    }
+    free(w.images);
+    free(w.failed);
+    free(w.ok);
+    return ok;
+}
+
+// All images in one contiguous array: a single corpus is used in place,
+// anything else is copied into *owned, which the caller frees
+const uint8_t *source_load(const Source *s, uint8_t **owned)
+{
+    *owned = NULL;
+    if (s->corpus_count == 1 && !s->archive_count && !s->file_count)
+        return s->corpora[0].images;
+    int threads = parallel_cpus();
+    Window w = { s, 0, s->count, malloc((s->count ? s->count : 1) * SPD_DDR3_SIZE), NULL, calloc((size_t)threads, sizeof(bool)) };
+    if (!w.images || !w.ok || !window_read(&w, threads)) {
+        free(w.images);
+        free(w.ok);
+        return NULL;
+    }
+    free(w.ok);
+    *owned = w.images;
+    return w.images;
+}
@@ -0,0 +1,376 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/cache.h>
+#include <spd/stats.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct StatsJob
+{
+    const Source *source;
+    size_t cache_size;
+    SpdStats *stats;
+    SpdCacheStats *cache;
+    bool *ok;
+} StatsJob;
+
+typedef struct StatsWorker
+{
+    SpdStats *stats;
+    SpdCache *cache;
+    bool ok;
+} StatsWorker;
+
+static bool stats_batch(void *ctx, const SourceBatch *b)
+{
+    StatsWorker *w = ctx;
+    for (size_t n = 0; n < b->count && w->ok; n++) {
+        if (b->failed && b->failed[n])
+            continue;
+        const uint8_t *image = b->images + n * SPD_DDR3_SIZE;
+        SpdInfo i;
+        bool decoded = w->cache ? spd_cache_decode(w->cache, &i, image) : spd_decode(&i, image);
+        w->ok = spd_stats_add(w->stats, &i, decoded);
+    }
+    return w->ok;
+}
+
+static void stats_thread(void *ctx, int thread, int threads)
+{
+    StatsJob *job = ctx;
+    SpdCache cache;
+    StatsWorker w = { &job->stats[thread], NULL, true };
+    if (job->cache_size) {
+        if (!spd_cache_init(&cache, job->cache_size)) {
+            job->ok[thread] = false;
+            return;
+        }
+        w.cache = &cache;
+    }
+    size_t count = job->source->count;
+    source_foreach(job->source, parallel_share(count, thread, threads), parallel_share(count, thread + 1, threads), stats_batch, &w);
+    if (w.cache) {
+        job->cache[thread] = cache.stats;
+        spd_cache_free(&cache);
+    }
+    job->ok[thread] = w.ok;
+}
+
+static double percent(uint64_t part, uint64_t total)
+{
+    return total ? 100.0 * (double)part / (double)total : 0.0;
+}
+
+static const char *text(const char *s)
+{
+    return s ? s : "Unknown";
+}
+
+static void geometry_name(char *name, size_t size, int ranks, int width)
+{
+    snprintf(name, size, "%dRx%d", spd_field_value(SPD_FIELD_RANKS, ranks), spd_field_value(SPD_FIELD_SDRAM_WIDTH, width));
+}
+
+// Part ids ordered by descending count
+static const SpdStats *sort_stats;
+
+static int compare_parts(const void *a, const void *b)
+{
+    uint64_t x = sort_stats->part_count[*(const uint32_t *)a];
+    uint64_t y = sort_stats->part_count[*(const uint32_t *)b];
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static void print_row(const char *name, uint64_t count, uint64_t total)
+{
+    printf("    %-40s %12llu %7.2f%%\n", name, (unsigned long long)count, percent(count, total));
+}
+
+static void print_table(const SpdStats *s, const uint32_t *parts, uint32_t top)
+{
+    char name[64];
+    printf(
+        "Images:                         %llu\n"
+        "Unsupported device type:        %llu\n"
+        "CRC errors:                     %llu (%.2f%%)\n"
+        , (unsigned long long)s->images
+        , (unsigned long long)s->unsupported
+        , (unsigned long long)s->crc_errors, percent(s->crc_errors, s->images - s->unsupported)
+    );
+    printf("\nDRAM Device Type:\n");
+    for (int n = 0; n < 256; n++) {
+        if (s->device_type[n])
+            print_row(text(spd_field_text(SPD_FIELD_DEVICE_TYPE, n)), s->device_type[n], s->images);
+    }
+    uint64_t total = s->images - s->unsupported;
+    printf("\nModule Type:\n");
+    for (int n = 0; n < 16; n++) {
+        if (s->module_type[n])
+            print_row(text(spd_field_text(SPD_FIELD_MODULE_TYPE, n)), s->module_type[n], total);
+    }
+    printf("\nModule Minimum Nominal Voltage:\n");
+    for (int n = 0; n < 8; n++) {
+        if (s->voltage[n])
+            print_row(text(spd_field_text(SPD_FIELD_VOLTAGE, n)), s->voltage[n], total);
+    }
+    printf("\nModule Capacity:\n");
+    for (int n = 0; n < s->capacities; n++) {
+        snprintf(name, sizeof(name), s->capacity[n] < 0 ? "Other" : "%d MB", s->capacity[n]);
+        print_row(name, s->capacity_count[n], total);
+    }
+    printf("\nMinimum Cycle Time (speed):\n");
+    for (int n = 0; n < s->tcks; n++) {
+        if (s->tck[n] > 0)
+            snprintf(name, sizeof(name), "%d.%03d ns (%d MT/s)", s->tck[n] / 1000, s->tck[n] % 1000, 2000000 / s->tck[n]);
+        else
+            snprintf(name, sizeof(name), s->tck[n] < 0 ? "Other" : "Undefined");
+        print_row(name, s->tck_count[n], total);
+    }
+    printf("\nCAS Latency at tCKmin:\n");
+    for (int n = 0; n < 32; n++) {
+        snprintf(name, sizeof(name), n ? "CL%d" : "None supported", n);
+        if (s->cas_latency[n])
+            print_row(name, s->cas_latency[n], total);
+    }
+    printf("\nGeometry (ranks x width):\n");
+    for (int r = 0; r < 8; r++) {
+        for (int w = 0; w < 8; w++) {
+            geometry_name(name, sizeof(name), r, w);
+            if (s->geometry[r][w])
+                print_row(name, s->geometry[r][w], total);
+        }
+    }
+    printf("\nModule Part Number:\n");
+    for (uint32_t n = 0; n < top; n++)
+        print_row(spd_intern_str(&s->parts, parts[n]), s->part_count[parts[n]], total);
+    if (top < spd_intern_count(&s->parts))
+        printf("    ... %u more\n", spd_intern_count(&s->parts) - top);
+}
+
+void print_json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20 || c >= 0x7f)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static void print_json_pair(bool *first, const char *name, uint64_t count)
+{
+    printf("%s", *first ? "" : ", ");
+    print_json_string(stdout, name);
+    printf(": %llu", (unsigned long long)count);
+    *first = false;
+}
+
+static void print_json(const SpdStats *s, const uint32_t *parts, uint32_t top)
+{
+    char name[64];
+    bool first;
+    printf("{\n  \"images\": %llu,\n  \"unsupported\": %llu,\n  \"crc_errors\": %llu,\n  \"crc_failure_rate\": %.6f,\n"
+        , (unsigned long long)s->images, (unsigned long long)s->unsupported, (unsigned long long)s->crc_errors
+        , percent(s->crc_errors, s->images - s->unsupported) / 100.0);
+
+    printf("  \"device_type\": {");
+    first = true;
+    for (int n = 0; n < 256; n++) {
+        if (s->device_type[n])
+            print_json_pair(&first, text(spd_field_text(SPD_FIELD_DEVICE_TYPE, n)), s->device_type[n]);
+    }
+    printf("},\n  \"module_type\": {");
+    first = true;
+    for (int n = 0; n < 16; n++) {
+        if (s->module_type[n])
+            print_json_pair(&first, text(spd_field_text(SPD_FIELD_MODULE_TYPE, n)), s->module_type[n]);
+    }
+    printf("},\n  \"voltage\": {");
+    first = true;
+    for (int n = 0; n < 8; n++) {
+        if (s->voltage[n])
+            print_json_pair(&first, text(spd_field_text(SPD_FIELD_VOLTAGE, n)), s->voltage[n]);
+    }
+    printf("},\n  \"capacity_mb\": {");
+    first = true;
+    for (int n = 0; n < s->capacities; n++) {
+        snprintf(name, sizeof(name), s->capacity[n] < 0 ? "other" : "%d", s->capacity[n]);
+        print_json_pair(&first, name, s->capacity_count[n]);
+    }
+    printf("},\n  \"tck_ps\": {");
+    first = true;
+    for (int n = 0; n < s->tcks; n++) {
+        snprintf(name, sizeof(name), s->tck[n] < 0 ? "other" : "%d", s->tck[n]);
+        print_json_pair(&first, name, s->tck_count[n]);
+    }
+    printf("},\n  \"cas_latency\": {");
+    first = true;
+    for (int n = 0; n < 32; n++) {
+        snprintf(name, sizeof(name), "%d", n);
+        if (s->cas_latency[n])
+            print_json_pair(&first, name, s->cas_latency[n]);
+    }
+    printf("},\n  \"geometry\": {");
+    first = true;
+    for (int r = 0; r < 8; r++) {
+        for (int w = 0; w < 8; w++) {
+            geometry_name(name, sizeof(name), r, w);
+            if (s->geometry[r][w])
+                print_json_pair(&first, name, s->geometry[r][w]);
+        }
+    }
+    printf("},\n  \"part_number\": {");
+    first = true;
+    for (uint32_t n = 0; n < top; n++)
+        print_json_pair(&first, spd_intern_str(&s->parts, parts[n]), s->part_count[parts[n]]);
+    printf("}\n}\n");
+}
+
+static void print_stats_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool stats [OPTIONS] INPUT...\n\n"
+        "Counts by device type, module type, voltage, capacity, speed, CAS latency,\n"
+        "geometry and part number,\n"
+        "and the CRC failure rate, in one pass over dumps, corpora and directories.\n\n"
+        "OPTIONS:\n"
+        "    --json\n"
+        "        JSON output\n"
+        "    --jobs,-j N\n"
+        "        Number of threads, default is the number of CPUs\n"
+        "    --top N\n"
+        "        Print N most frequent part numbers, default 20 (all for JSON)\n"
+        "    --cache N\n"
+        "        Per-thread decode cache of N images for repeated SKUs\n"
+    );
+}
+
+int cmd_stats(int argc, char *argv[])
+{
+    enum { OP_JSON = 'z' + 1, OP_TOP, OP_CACHE };
+    bool json = false;
+    int threads = parallel_cpus();
+    long top = -1;
+    long cache_size = 0;
+    while (true) {
+        static struct option options[] = {
+            { "json",               no_argument,       0, OP_JSON },
+            { "jobs",               required_argument, 0, 'j' },
+            { "top",                required_argument, 0, OP_TOP },
+            { "cache",              required_argument, 0, OP_CACHE },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "j:h", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case OP_JSON: json = true; break;
+            case 'j': threads = atoi(optarg); break;
+            case OP_TOP: top = atol(optarg); break;
+            case OP_CACHE: cache_size = atol(optarg); break;
+            default:
+                print_stats_usage();
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        print_stats_usage();
+        return EXIT_FAILURE;
+    }
+
+    Source source;
+    if (!source_open(&source, argv + optind, argc - optind))
+        return EXIT_FAILURE;
+    if (threads < 1)
+        threads = 1;
+    if ((size_t)threads > source.count / 1024 + 1)
+        threads = (int)(source.count / 1024 + 1);
+
+    StatsJob job = { &source, cache_size > 0 ? (size_t)cache_size : 0, NULL, NULL, NULL };
+    job.stats = calloc((size_t)threads, sizeof(job.stats[0]));
+    job.cache = calloc((size_t)threads, sizeof(job.cache[0]));
+    job.ok = calloc((size_t)threads, sizeof(job.ok[0]));
+    bool ok = job.stats && job.cache && job.ok;
+    for (int t = 0; ok && t < threads; t++)
+        spd_stats_init(&job.stats[t]);
+    ok = ok && parallel_run(threads, stats_thread, &job);
+
+    SpdCacheStats cache = {0};
+    for (int t = 0; ok && t < threads; t++) {
+        ok = job.ok[t] && (t == 0 || spd_stats_merge(&job.stats[0], &job.stats[t]));
+        cache.hits += job.cache[t].hits;
+        cache.misses += job.cache[t].misses;
+        cache.evictions += job.cache[t].evictions;
+    }
+
+    uint32_t *parts = NULL;
+    if (ok) {
+        const SpdStats *s = &job.stats[0];
+        uint32_t count = spd_intern_count(&s->parts);
+        parts = malloc((count ? count : 1) * sizeof(parts[0]));
+        ok = parts != NULL;
+        if (ok) {
+            for (uint32_t n = 0; n < count; n++)
+                parts[n] = n;
+            sort_stats = s;
+            qsort(parts, count, sizeof(parts[0]), compare_parts);
+            if (top < 0)
+                top = json ? (long)count : 20;
+            uint32_t shown = (uint64_t)top < count ? (uint32_t)top : count;
+            if (json) {
+                print_json(s, parts, shown);
+            } else {
+                print_table(s, parts, shown);
+                if (job.cache_size)
+                    printf("\nDecode cache hit rate:          %.2f%% (%llu evictions)\n"
+                        , 100.0 * spd_cache_hit_rate(&cache), (unsigned long long)cache.evictions);
+            }
+        }
+    }
+    if (!ok)
+        printf("Statistics failed\n");
+
+    free(parts);
+    for (int t = 0; job.stats && t < threads; t++)
+        spd_stats_free(&job.stats[t]);
+    free(job.stats);
+    free(job.cache);
+    free(job.ok);
+    source_close(&source);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
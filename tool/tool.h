@@ -0,0 +1,120 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <io/io.h>
+#include <spd/archive.h>
+#include <spd/patch.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// spd-tool subcommands: spd-tool COMMAND ARGS...
+int cmd_archive(int argc, char *argv[]);
+int cmd_cluster(int argc, char *argv[]);
+int cmd_diff(int argc, char *argv[]);
+int cmd_fingerprint(int argc, char *argv[]);
+int cmd_index(int argc, char *argv[]);
+int cmd_patch(int argc, char *argv[]);
+int cmd_query(int argc, char *argv[]);
+int cmd_serialize(int argc, char *argv[]);
+int cmd_stats(int argc, char *argv[]);
+int cmd_undo(int argc, char *argv[]);
+int cmd_validate(int argc, char *argv[]);
+int cmd_watch(int argc, char *argv[]);
+
+// Read-only corpus of SPD_DDR3_SIZE byte records
+typedef struct Corpus
+{
+    char *path;
+    IoMapping map;
+    const uint8_t *images;
+    size_t count;
+} Corpus;
+
+bool corpus_open(Corpus *c, const char *path);
+void corpus_close(Corpus *c);
+// CORPUS.idx, the caller frees it
+char *index_path(const char *corpus);
+
+// Mapped delta-compressed archive
+typedef struct Archive
+{
+    char *path;
+    IoMapping map;
+    SpdArchive archive;
+} Archive;
+
+bool archive_open(Archive *a, const char *path);
+void archive_close(Archive *a);
+
+// Images from any mix of dump files, corpora, archives and directories of
+// them, addressed by a single index: corpora images first, then archives,
+// then dump files
+typedef struct Source
+{
+    Corpus *corpora;
+    size_t corpus_count;
+    Archive *archives;
+    size_t archive_count;
+    char **files;
+    size_t file_count;
+    size_t count;
+} Source;
+
+typedef struct SourceBatch
+{
+    const uint8_t *images;
+    size_t first;
+    size_t count;
+    const uint8_t *failed;  // NULL or per image errno of read failures
+} SourceBatch;
+
+bool source_open(Source *s, char *const paths[], int count);
+void source_close(Source *s);
+void source_name(const Source *s, size_t index, char *name, size_t size);
+bool source_foreach(const Source *s, size_t begin, size_t end, bool (*fn)(void *ctx, const SourceBatch *b), void *ctx);
+bool source_foreach_ahead(const Source *s, size_t begin, size_t end, int threads, bool (*fn)(void *ctx, const SourceBatch *b), void *ctx);
+const uint8_t *source_load(const Source *s, uint8_t **owned);
+
+// Thread [begin, end) share of count items
+static inline size_t parallel_share(size_t count, int thread, int threads)
+{
+    return (size_t)((unsigned long long)count * (unsigned)thread / (unsigned)threads);
+}
+
+int parallel_cpus(void);
+bool parallel_run(int threads, void (*fn)(void *ctx, int thread, int threads), void *ctx);
+
+SpdPatch *patch_load(const char *path);
+
+// JSON string literal with escapes
+void print_json_string(FILE *f, const char *s);
+
+// "message: path: reason" for an errno value, path may be NULL
+void print_error(const char *message, const char *path, int error);
+// Writer whose ask policy prompts on a terminal
+void writer_init(IoWriter *w, IoOverwrite overwrite, bool batch);
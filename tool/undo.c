@@ -0,0 +1,319 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <io/ee1004.h>
+#include <io/journal.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+// Writes of one device since the requested time: the image before the
+// first one is restored, the one after the last is expected on the device
+typedef struct UndoTarget
+{
+    uint32_t device_id;
+    unsigned writes;
+    int64_t first_time;
+    size_t size;
+    uint8_t before[IO_JOURNAL_IMAGE_SIZE];
+    uint8_t expected[IO_JOURNAL_IMAGE_SIZE];
+} UndoTarget;
+
+typedef struct UndoEntry
+{
+    uint32_t device_id;
+    size_t index;
+} UndoEntry;
+
+static int compare_entries(const void *a, const void *b)
+{
+    const UndoEntry *x = a, *y = b;
+    if (x->device_id != y->device_id)
+        return x->device_id < y->device_id ? -1 : 1;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// Unix time, seconds before now if negative, or local YYYY-MM-DD[THH:MM[:SS]]
+static bool parse_time(const char *text, int64_t *t)
+{
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    if (end != text && !*end) {
+        *t = value < 0 ? (int64_t)time(NULL) + value : value;
+        return true;
+    }
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    int n = sscanf(text, "%d-%d-%d%*1[T ]%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    if (n != 3 && n < 5)
+        return false;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    time_t local = mktime(&tm);
+    *t = (int64_t)local;
+    return local != (time_t)-1;
+}
+
+static void format_time(int64_t t, char *text, size_t size)
+{
+    time_t value = (time_t)t;
+    struct tm *tm = localtime(&value);
+    if (!tm || !strftime(text, size, "%Y-%m-%d %H:%M:%S", tm))
+        snprintf(text, size, "%lld", (long long)t);
+}
+
+static UndoTarget *collect_targets(const char *path, int64_t since, const char *device, size_t *count)
+{
+    IoJournalView v;
+    *count = 0;
+    if (!io_journal_map(&v, path)) {
+        if (errno == EINVAL)
+            printf("Not an SPD journal: %s\n", path);
+        else
+            print_error("Can't open file", path, errno);
+        return NULL;
+    }
+    UndoEntry *entries = malloc((v.count ? v.count : 1) * sizeof(entries[0]));
+    UndoTarget *targets = NULL;
+    size_t entry_count = 0, skipped = 0;
+    IoJournalRecord r;
+    for (size_t n = 0; entries && n < v.count; n++) {
+        if (!io_journal_record(&v, n, &r)) {
+            skipped++;
+            continue;
+        }
+        if (r.time >= since && (!device || r.device_id == (uint32_t)strtoul(device, NULL, 0))) {
+            entries[entry_count].device_id = r.device_id;
+            entries[entry_count].index = n;
+            entry_count++;
+        }
+    }
+    if (skipped)
+        printf("Skipped %zu damaged records\n", skipped);
+    if (entries) {
+        qsort(entries, entry_count, sizeof(entries[0]), compare_entries);
+        targets = malloc((entry_count ? entry_count : 1) * sizeof(targets[0]));
+    }
+    for (size_t n = 0; targets && n < entry_count; n++) {
+        io_journal_record(&v, entries[n].index, &r);
+        UndoTarget *t = *count ? &targets[*count - 1] : NULL;
+        if (!t || t->device_id != r.device_id) {
+            t = &targets[(*count)++];
+            t->device_id = r.device_id;
+            t->writes = 0;
+            t->first_time = r.time;
+            t->size = r.size;
+            memcpy(t->before, r.before, r.size);
+        }
+        t->writes++;
+        memcpy(t->expected, r.after, r.size);
+    }
+    if (!targets)
+        printf("Out of memory\n");
+    free(entries);
+    io_journal_unmap(&v);
+    return targets;
+}
+
+static bool write_image(IoWriter *writer, const char *dir, const UndoTarget *t)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/device-%u.bin", dir, t->device_id);
+    if (io_writer_write(writer, path, t->before, t->size))
+        return true;
+    print_error("Can't write file", path, errno);
+    return false;
+}
+
+// Only the chunks differing from the device content are written, the
+// restore is journaled as any other write
+static bool restore_device(const UndoTarget *t, IoJournal *journal, bool force)
+{
+    IoI2cBus bus;
+    IoEe1004 eeprom;
+    uint8_t current[IO_EE1004_SIZE];
+    if (!io_i2c_bus(&bus, t->device_id)) {
+        printf("Device %u: I2C device isn't available\n", t->device_id);
+        return false;
+    }
+    io_ee1004_init(&eeprom, &bus, IO_SPD_ADDRESS);
+    size_t size = io_spd_read(&eeprom, current);
+    if (size != t->size) {
+        printf("Device %u: read failed\n", t->device_id);
+        return false;
+    }
+    if (memcmp(current, t->expected, size) && !force) {
+        printf("Device %u: changed after the last journaled write, skipped\n", t->device_id);
+        return false;
+    }
+    uint32_t chunks = 0;
+    for (size_t n = 0; n < size; n++) {
+        if (current[n] != t->before[n])
+            chunks |= io_ee1004_range_chunks(n, 1);
+    }
+    if (!chunks)
+        return true;
+    // The record reaches the disk before the device is written
+    if (!io_journal_append(journal, t->device_id, (int64_t)time(NULL), current, t->before, size) || !io_journal_sync(journal)) {
+        print_error("Can't write journal", NULL, errno);
+        return false;
+    }
+    if (!io_ee1004_write_chunks(&eeprom, t->before, chunks)) {
+        printf("Device %u: write failed\n", t->device_id);
+        return false;
+    }
+    return true;
+}
+
+static void print_undo_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool undo JOURNAL --since TIME [OPTIONS]\n\n"
+        "Restore every device written since TIME to its image before the first of\n"
+        "those writes. TIME is unix time, seconds before now if negative, or local\n"
+        "time as YYYY-MM-DD[THH:MM[:SS]]. Devices changed after their last journaled\n"
+        "write are skipped. Restores are journaled too.\n\n"
+        "OPTIONS:\n"
+        "    --since,-s TIME\n"
+        "        Undo writes at or after TIME\n"
+        "    --device,-d ID\n"
+        "        Only this device\n"
+        "    --dry-run,-n\n"
+        "        List the devices and writes, nothing is written\n"
+        "    --output,-o DIR\n"
+        "        Save the images to restore as DIR/device-ID.bin instead\n"
+        "    --overwrite POLICY\n"
+        "        Existing images in DIR: ask, never, always or suffix, see 'spd-tool --help'\n"
+        "    --force\n"
+        "        Restore devices changed after their last journaled write\n"
+    );
+}
+
+int cmd_undo(int argc, char *argv[])
+{
+    const char *since = NULL, *device = NULL, *output = NULL;
+    bool dry_run = false, force = false;
+    IoOverwrite overwrite = IO_OVERWRITE_ASK;
+    while (true) {
+        static struct option options[] = {
+            { "since",              required_argument, 0, 's' },
+            { "device",             required_argument, 0, 'd' },
+            { "dry-run",            no_argument,       0, 'n' },
+            { "output",             required_argument, 0, 'o' },
+            { "force",              no_argument,       0, 'F' },
+            { "overwrite",          required_argument, 0, 'W' },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "s:d:no:h", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case 's': since = optarg; break;
+            case 'd': device = optarg; break;
+            case 'n': dry_run = true; break;
+            case 'o': output = optarg; break;
+            case 'F': force = true; break;
+            case 'W':
+                if (!io_overwrite_parse(optarg, &overwrite)) {
+                    printf("Invalid overwrite policy: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                print_undo_usage();
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    int64_t t;
+    if (optind + 1 != argc || !since) {
+        print_undo_usage();
+        return EXIT_FAILURE;
+    }
+    if (!parse_time(since, &t)) {
+        printf("Invalid time: %s\n", since);
+        return EXIT_FAILURE;
+    }
+
+    size_t count;
+    UndoTarget *targets = collect_targets(argv[optind], t, device, &count);
+    if (!targets)
+        return EXIT_FAILURE;
+    char when[32];
+    for (size_t n = 0; n < count; n++) {
+        const UndoTarget *x = &targets[n];
+        size_t changed = 0;
+        for (size_t k = 0; k < x->size; k++)
+            changed += x->before[k] != x->expected[k];
+        format_time(x->first_time, when, sizeof(when));
+        printf("Device %u: %u writes since %s, %zu bytes to restore\n", x->device_id, x->writes, when, changed);
+    }
+
+    bool ok = true;
+    size_t restored = 0;
+    if (!dry_run && output) {
+        IoWriter writer;
+        writer_init(&writer, overwrite, true);
+        for (size_t n = 0; n < count && ok; n++)
+            ok = write_image(&writer, output, &targets[n]);
+        if (!ok)
+            io_writer_abort(&writer);
+        if (ok && !io_writer_commit(&writer)) {
+            print_error("Can't replace restored files", NULL, errno);
+            ok = false;
+        }
+        restored = ok ? count : 0;
+    } else if (!dry_run && count) {
+        IoJournal journal;
+        ok = io_i2c_init();
+        if (!ok)
+            printf("I2C driver isn't available\n");
+        if (ok) {
+            ok = io_journal_open(&journal, argv[optind], IO_JOURNAL_BATCH);
+            if (!ok && errno == EINVAL)
+                printf("Not an SPD journal: %s\n", argv[optind]);
+            else if (!ok)
+                print_error("Can't open journal", argv[optind], errno);
+        }
+        for (size_t n = 0; n < count && ok; n++)
+            restored += restore_device(&targets[n], &journal, force);
+        if (ok && !io_journal_close(&journal)) {
+            print_error("Can't sync journal", argv[optind], errno);
+            ok = false;
+        }
+        ok = ok && restored == count;
+    }
+    printf("Devices: %zu, restored: %zu\n", count, restored);
+    free(targets);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
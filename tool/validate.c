@@ -0,0 +1,172 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/validate.h>
+#include <spd/bits.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ValidateJob
+{
+    const Source *source;
+    uint64_t *violations;       // per image, all zero for failed reads
+    uint64_t (*counts)[SPD_VIOLATION_BITS];
+    uint64_t *failed;
+} ValidateJob;
+
+typedef struct ValidateWorker
+{
+    ValidateJob *job;
+    int thread;
+} ValidateWorker;
+
+static bool validate_batch(void *ctx, const SourceBatch *b)
+{
+    ValidateWorker *w = ctx;
+    uint64_t *violations = w->job->violations + b->first;
+    spd_validate_batch(violations, b->images, b->count, SPD_DDR3_SIZE);
+    for (size_t n = 0; b->failed && n < b->count; n++) {
+        if (b->failed[n]) {
+            violations[n] = 0;
+            w->job->failed[w->thread]++;
+        }
+    }
+    spd_violations_count(w->job->counts[w->thread], violations, b->count);
+    return true;
+}
+
+static void validate_thread(void *ctx, int thread, int threads)
+{
+    ValidateJob *job = ctx;
+    ValidateWorker w = { job, thread };
+    size_t count = job->source->count;
+    source_foreach(job->source, parallel_share(count, thread, threads), parallel_share(count, thread + 1, threads), validate_batch, &w);
+}
+
+static void violation_label(char *label, size_t size, int bit)
+{
+    if (bit < 32)
+        snprintf(label, size, "%s: reserved encoding", spd_field_info((SpdField)bit)->label);
+    else
+        snprintf(label, size, "%s", spd_rule_label((SpdRule)(bit - 32)));
+}
+
+static void print_validate_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool validate [OPTIONS] INPUT...\n\n"
+        "Check JEDEC consistency rules and field encodings of dumps, corpora,\n"
+        "archives and directories, and count violations per rule.\n\n"
+        "OPTIONS:\n"
+        "    --jobs,-j N\n"
+        "        Number of threads, default is the number of CPUs\n"
+        "    --list,-l\n"
+        "        Print every inconsistent image with its violations\n"
+    );
+}
+
+int cmd_validate(int argc, char *argv[])
+{
+    int threads = parallel_cpus();
+    bool list = false;
+    while (true) {
+        static struct option options[] = {
+            { "jobs",               required_argument, 0, 'j' },
+            { "list",               no_argument,       0, 'l' },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "j:lh", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case 'j': threads = atoi(optarg); break;
+            case 'l': list = true; break;
+            default:
+                print_validate_usage();
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        print_validate_usage();
+        return EXIT_FAILURE;
+    }
+
+    Source source;
+    if (!source_open(&source, argv + optind, argc - optind))
+        return EXIT_FAILURE;
+    if (threads < 1)
+        threads = 1;
+    if ((size_t)threads > source.count / 1024 + 1)
+        threads = (int)(source.count / 1024 + 1);
+
+    ValidateJob job = { &source, NULL, NULL, NULL };
+    job.violations = malloc((source.count ? source.count : 1) * sizeof(job.violations[0]));
+    job.counts = calloc((size_t)threads, sizeof(job.counts[0]));
+    job.failed = calloc((size_t)threads, sizeof(job.failed[0]));
+    bool ok = job.violations && job.counts && job.failed && parallel_run(threads, validate_thread, &job);
+    if (ok) {
+        uint64_t counts[SPD_VIOLATION_BITS] = {0}, failed = 0, inconsistent = 0;
+        for (int t = 0; t < threads; t++) {
+            for (int bit = 0; bit < SPD_VIOLATION_BITS; bit++)
+                counts[bit] += job.counts[t][bit];
+            failed += job.failed[t];
+        }
+        char name[1024];
+        for (size_t n = 0; n < source.count; n++) {
+            if (!job.violations[n])
+                continue;
+            inconsistent++;
+            if (!list)
+                continue;
+            source_name(&source, n, name, sizeof(name));
+            printf("%s:", name);
+            for (uint64_t bits = job.violations[n]; bits; bits &= bits - 1)
+                printf(" %s", spd_violation_key(spd_ctz64(bits)));
+            printf("\n");
+        }
+        printf("Images: %zu, inconsistent: %llu, unreadable: %llu\n"
+            , source.count, (unsigned long long)inconsistent, (unsigned long long)failed);
+        for (int bit = 0; bit < SPD_VIOLATION_BITS; bit++) {
+            if (!counts[bit])
+                continue;
+            violation_label(name, sizeof(name), bit);
+            printf("    %-20s %12llu  %s\n", spd_violation_key(bit), (unsigned long long)counts[bit], name);
+        }
+    } else {
+        printf("Validation failed\n");
+    }
+    free(job.violations);
+    free(job.counts);
+    free(job.failed);
+    source_close(&source);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,292 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Mikhail Karev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tool.h"
+
+#include <spd/spd.h>
+#include <spd/bits.h>
+#include <spd/decoder.h>
+#include <spd/hash.h>
+#include <spd/patch.h>
+#include <spd/validate.h>
+#include <io/watch.h>
+
+#include <getopt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define STATE_NAME ".spd-watch"
+
+// Dumps are processed once per content, see IoWatchState. Results are
+// written before the key, a crash in between repeats one result.
+typedef struct Watcher
+{
+    const char *dir;
+    const char *state_path;
+    SpdPatch *patch;
+    FILE *ndjson;
+    FILE *corpus;
+    IoWatchState state;
+    uint64_t files;
+    uint64_t skipped;
+} Watcher;
+
+static bool mark_processed(Watcher *w, const char *key, size_t len)
+{
+    if (io_watch_state_add(&w->state, key, len))
+        return true;
+    print_error("Can't write watch state", w->state_path, errno);
+    return false;
+}
+
+static void write_result(Watcher *w, const char *name, const uint8_t *data, size_t size, bool patched)
+{
+    FILE *f = w->ndjson;
+    fprintf(f, "{\"file\": ");
+    print_json_string(f, name);
+    fprintf(f, ", \"time\": %lld, \"size\": %zu", (long long)time(NULL), size);
+    const SpdDecoder *d = size >= SPD_DDR3_SIZE ? spd_decoder_find(data[2]) : NULL;
+    if (!d || d == &spd_decoder_unsupported || size < d->size) {
+        fprintf(f, ", \"error\": \"%s\"}\n", d == &spd_decoder_unsupported ? "unsupported" : "too small");
+        return;
+    }
+    SpdInfo info;
+    memset(&info, 0, sizeof(info));
+    bool crc = d->decode(&info, data, size);
+    char part[sizeof(info.Module_Part_Number)];
+    snprintf(part, sizeof(part), "%s", info.Module_Part_Number);
+    for (size_t len = strlen(part); len && part[len - 1] == ' '; len--)
+        part[len - 1] = 0;
+    fprintf(f, ", \"device\": ");
+    print_json_string(f, d->name);
+    fprintf(f, ", \"part\": ");
+    print_json_string(f, part);
+    fprintf(f, ", \"crc\": \"%s\"", crc ? "ok" : "bad");
+    if (data[2] == SPD_DEVICE_TYPE_DDR3) {
+        fprintf(f, ", \"violations\": [");
+        uint64_t bits = spd_validate(data);
+        for (bool first = true; bits; bits &= bits - 1, first = false)
+            fprintf(f, "%s\"%s\"", first ? "" : ", ", spd_violation_key(spd_ctz64(bits)));
+        fprintf(f, "]");
+    }
+    fprintf(f, ", \"patched\": %s}\n", patched ? "true" : "false");
+}
+
+// Patches, reports and records one dump, false only for sink failures
+static bool watch_file(Watcher *w, const char *name)
+{
+    if (!io_watch_is_candidate(name))
+        return true;
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", w->dir, name);
+    uint8_t data[SPD_SIZE_MAX];
+    uint64_t file_size;
+    bool is_dir;
+    // Vanished files and directories are someone else's business
+    if (!io_file_size(path, &file_size, &is_dir) || is_dir)
+        return true;
+    size_t size = file_size ? io_file_read_some(path, data, sizeof(data)) : 0;
+    if (file_size && !size)
+        print_error("Can't read file", path, errno);
+    char key[4096 + SPD_HASH_HEX_SIZE + 1];
+    size_t key_len = io_watch_key(key, sizeof(key), name, data, size);
+    if (io_watch_state_has(&w->state, key, key_len)) {
+        w->skipped++;
+        return true;
+    }
+
+    bool patched = false;
+    if (w->patch && size >= SPD_DDR3_SIZE && data[2] == SPD_DEVICE_TYPE_DDR3) {
+        uint8_t original[SPD_DDR3_SIZE];
+        memcpy(original, data, sizeof(original));
+        SpdPatchResult r = spd_patch_apply(w->patch, data);
+        if (r.changed) {
+            IoWriter writer;
+            io_writer_init(&writer, IO_OVERWRITE_ALWAYS, false);
+            patched = io_writer_write(&writer, path, data, size);
+            if (!patched) {
+                print_error("Can't write file", path, errno);
+                memcpy(data, original, sizeof(original));
+            }
+        }
+    }
+    if (w->ndjson) {
+        write_result(w, name, data, size, patched);
+        if (fflush(w->ndjson)) {
+            printf("Can't write results\n");
+            return false;
+        }
+    }
+    if (w->corpus && size >= SPD_DDR3_SIZE && (fwrite(data, 1, SPD_DDR3_SIZE, w->corpus) != SPD_DDR3_SIZE || fflush(w->corpus))) {
+        printf("Can't write corpus\n");
+        return false;
+    }
+    w->files++;
+    // The patched file comes back as a new event, it's already done
+    if (patched) {
+        char patched_key[sizeof(key)];
+        size_t patched_len = io_watch_key(patched_key, sizeof(patched_key), name, data, size);
+        if (!mark_processed(w, patched_key, patched_len))
+            return false;
+    }
+    return mark_processed(w, key, key_len);
+}
+
+static bool scan_file(void *ctx, const char *path)
+{
+    Watcher *w = ctx;
+    return watch_file(w, path + strlen(w->dir) + 1);
+}
+
+static bool scan_dir(Watcher *w)
+{
+    if (io_dir_list(w->dir, scan_file, w))
+        return true;
+    if (errno)
+        print_error("Can't open directory", w->dir, errno);
+    return false;
+}
+
+static void print_watch_usage(void)
+{
+    printf(
+        "Usage:\n"
+        "    spd-tool watch DIR [OPTIONS]\n\n"
+        "Process dumps as soon as they are written to DIR or moved into it: decode,\n"
+        "validate, optionally patch, then report. Dumps already in DIR are processed\n"
+        "first, DIR/" STATE_NAME " lists processed dumps by content, so restarts and\n"
+        "rewritten files with the same content are skipped. Results are flushed per\n"
+        "dump. Watching needs inotify.\n\n"
+        "OPTIONS:\n"
+        "    --ndjson,-n FILE\n"
+        "        Append one JSON line per dump, - for stdout, the default without --corpus\n"
+        "    --corpus,-c FILE\n"
+        "        Append the first %d bytes of every dump to a corpus\n"
+        "    --rules,-r RULES\n"
+        "        Patch DDR3 dumps in place by rules, see 'spd-tool patch --help'\n"
+        "    --state FILE\n"
+        "        Processed dumps, default DIR/" STATE_NAME "\n"
+        "    --once\n"
+        "        Process the dumps in DIR and exit\n"
+        , SPD_DDR3_SIZE
+    );
+}
+
+int cmd_watch(int argc, char *argv[])
+{
+    const char *ndjson = NULL, *corpus = NULL, *rules = NULL, *state = NULL;
+    bool once = false;
+    while (true) {
+        static struct option options[] = {
+            { "ndjson",             required_argument, 0, 'n' },
+            { "corpus",             required_argument, 0, 'c' },
+            { "rules",              required_argument, 0, 'r' },
+            { "state",              required_argument, 0, 'S' },
+            { "once",               no_argument,       0, 'O' },
+            { "help",               no_argument,       0, 'h' },
+            { 0, 0, 0, 0 }
+        };
+        int c = getopt_long(argc, argv, "n:c:r:h", options, NULL);
+        if (c == -1)
+            break;
+        switch (c) {
+            case 'n': ndjson = optarg; break;
+            case 'c': corpus = optarg; break;
+            case 'r': rules = optarg; break;
+            case 'S': state = optarg; break;
+            case 'O': once = true; break;
+            default:
+                print_watch_usage();
+                return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind + 1 != argc) {
+        print_watch_usage();
+        return EXIT_FAILURE;
+    }
+    if (!ndjson && !corpus)
+        ndjson = "-";
+
+    Watcher w;
+    memset(&w, 0, sizeof(w));
+    w.dir = argv[optind];
+    char state_path[4096];
+    snprintf(state_path, sizeof(state_path), "%s/%s", w.dir, STATE_NAME);
+    w.state_path = state ? state : state_path;
+    bool ok = io_watch_state_open(&w.state, w.state_path);
+    if (!ok)
+        print_error("Can't open file", w.state_path, errno);
+    if (ok && rules)
+        ok = (w.patch = patch_load(rules)) != NULL;
+    if (ok && ndjson) {
+        w.ndjson = strcmp(ndjson, "-") ? fopen(ndjson, "ab") : stdout;
+        if (!(ok = w.ndjson != NULL))
+            printf("Can't open file: %s\n", ndjson);
+    }
+    if (ok && corpus) {
+        w.corpus = fopen(corpus, "ab");
+        if (!(ok = w.corpus != NULL))
+            printf("Can't open file: %s\n", corpus);
+    }
+
+    // The watch starts before the scan, dumps landing meanwhile aren't lost
+    IoWatch *watch = NULL;
+    if (ok && !once) {
+        watch = malloc(sizeof(*watch));
+        ok = watch && io_watch_open(watch, w.dir);
+        if (!ok && watch) {
+            print_error("Can't watch directory", w.dir, errno);
+            free(watch);
+            watch = NULL;
+        }
+    }
+    ok = ok && scan_dir(&w);
+    char name[4096];
+    while (ok && watch) {
+        IoWatchEvent e = io_watch_next(watch, name, sizeof(name), -1);
+        if (e == IO_WATCH_FILE)
+            ok = watch_file(&w, name);
+        else if (e == IO_WATCH_OVERFLOW)
+            ok = scan_dir(&w);
+        else if (e == IO_WATCH_ERROR) {
+            print_error("Can't watch directory", w.dir, errno);
+            ok = false;
+        }
+    }
+    if (watch) {
+        io_watch_close(watch);
+        free(watch);
+    }
+    fprintf(stderr, "Processed: %llu, already processed: %llu\n", (unsigned long long)w.files, (unsigned long long)w.skipped);
+    if (w.ndjson && w.ndjson != stdout)
+        fclose(w.ndjson);
+    if (w.corpus)
+        fclose(w.corpus);
+    io_watch_state_close(&w.state);
+    free(w.patch);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}